@@ -19,6 +19,7 @@
 #include <functional>
 #include "Util/util.h"
 #include "Util/ResourcePool.h"
+#include "Network/BufferArena.h"
 
 namespace toolkit {
 
@@ -115,9 +116,7 @@ public:
     static Ptr create();
 
     ~BufferRaw() override {
-        if (_data) {
-            delete[] _data;
-        }
+        BufferArena::free(_data, _capacity);
     }
 
     //在写入数据时请确保内存是否越界
@@ -150,9 +149,10 @@ public:
                 }
             } while (false);
 
-            delete[] _data;
+            BufferArena::free(_data, _capacity);
         }
-        _data = new char[capacity];
+        //从分级缓存中分配，capacity会被向上取整到所在分级大小
+        _data = BufferArena::alloc(capacity);
         _capacity = capacity;
     }
 
@@ -0,0 +1,291 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include "BufferArena.h"
+
+using namespace std;
+
+namespace toolkit {
+
+//最小分级32字节，最大分级64KB
+static constexpr size_t kMinShift = 5;
+static constexpr size_t kMaxShift = 16;
+static constexpr size_t kClassCount = kMaxShift - kMinShift + 1;
+//跨线程释放时，攒够该个数的内存块后一次性归还给分配线程
+static constexpr size_t kBatchSize = 32;
+//每个线程同时攒批的分配线程个数
+static constexpr size_t kPendingSize = 4;
+
+static atomic<size_t> s_max_cache_bytes(1024 * 1024);
+
+//计数器只由所属线程修改，其他线程只读，所以不需要原子的读改写操作
+template<typename T>
+static inline void addCounter(atomic<T> &counter, T val) {
+    counter.store(counter.load(memory_order_relaxed) + val, memory_order_relaxed);
+}
+
+class ThreadCache;
+
+struct FreeBlock {
+    FreeBlock *next;
+};
+
+//分级内存块头部，记录分配该内存块的线程缓存，释放时归还给该线程
+struct BlockHeader {
+    ThreadCache *owner;
+    size_t index;
+};
+//保持返回给用户的内存16字节对齐
+static constexpr size_t kHeaderSize = 16;
+static_assert(sizeof(BlockHeader) <= kHeaderSize, "BlockHeader too large");
+
+static inline BlockHeader *getHeader(void *ptr) {
+    return (BlockHeader *) ((char *) ptr - kHeaderSize);
+}
+
+static inline void deleteBlock(void *ptr) {
+    delete[] ((char *) ptr - kHeaderSize);
+}
+
+class ThreadCache {
+public:
+    struct Pending {
+        ThreadCache *owner = nullptr;
+        FreeBlock *head = nullptr;
+        FreeBlock *tail = nullptr;
+        size_t count = 0;
+    };
+
+    //放入本线程的空闲列表，超过缓存上限时直接释放
+    void cacheBlock(FreeBlock *block, size_t index) {
+        size_t capacity = (size_t) 1 << (kMinShift + index);
+        if ((count[index] + 1) * capacity > s_max_cache_bytes.load(memory_order_relaxed)) {
+            deleteBlock(block);
+            return;
+        }
+        block->next = head[index];
+        head[index] = block;
+        ++count[index];
+        addCounter<int64_t>(cached_blocks, 1);
+        addCounter<int64_t>(cached_bytes, capacity);
+    }
+
+    //取回其他线程归还的内存块
+    void drainInbox() {
+        auto block = inbox.exchange(nullptr, memory_order_acquire);
+        while (block) {
+            auto next = block->next;
+            cacheBlock(block, getHeader(block)->index);
+            block = next;
+        }
+    }
+
+    //把一串内存块归还给分配它们的线程，多生产者单消费者的无锁栈
+    static void pushInbox(ThreadCache *owner, FreeBlock *head, FreeBlock *tail) {
+        tail->next = owner->inbox.load(memory_order_relaxed);
+        while (!owner->inbox.compare_exchange_weak(tail->next, head, memory_order_release, memory_order_relaxed));
+    }
+
+    void flushPending(Pending &pending) {
+        if (pending.head) {
+            pushInbox(pending.owner, pending.head, pending.tail);
+        }
+        pending = Pending();
+    }
+
+    //释放其他线程分配的内存块，攒批后归还
+    void returnBlock(ThreadCache *owner, FreeBlock *block) {
+        auto &ref = pending[((uintptr_t) owner / sizeof(ThreadCache)) % kPendingSize];
+        if (ref.owner != owner) {
+            flushPending(ref);
+            ref.owner = owner;
+        }
+        block->next = ref.head;
+        ref.head = block;
+        if (!ref.tail) {
+            ref.tail = block;
+        }
+        if (++ref.count >= kBatchSize) {
+            flushPending(ref);
+        }
+        addCounter<uint64_t>(remote_free_count, 1);
+    }
+
+    FreeBlock *head[kClassCount] = { nullptr };
+    size_t count[kClassCount] = { 0 };
+    Pending pending[kPendingSize];
+    //其他线程归还的内存块
+    atomic<FreeBlock *> inbox { nullptr };
+
+    atomic<uint64_t> alloc_count { 0 };
+    atomic<uint64_t> hit_count { 0 };
+    atomic<uint64_t> large_alloc_count { 0 };
+    atomic<uint64_t> remote_free_count { 0 };
+    atomic<int64_t> cached_blocks { 0 };
+    atomic<int64_t> cached_bytes { 0 };
+    //本线程分配与释放的差值，跨线程释放时可能为负，所有线程求和后才有意义
+    atomic<int64_t> used_bytes { 0 };
+};
+
+struct Registry {
+    mutex mtx;
+    //所有线程缓存，线程缓存从不析构，其他线程可以随时归还内存块
+    vector<ThreadCache *> caches;
+    //线程退出后空闲的线程缓存，由新线程复用
+    vector<ThreadCache *> idle;
+};
+
+static Registry &getRegistry() {
+    //不析构，防止其他线程退出时访问已析构的对象
+    static auto registry = new Registry;
+    return *registry;
+}
+
+//线程缓存释放后，该线程再分配的内存不再缓存
+static thread_local bool s_cache_destroyed = false;
+
+class ThreadCacheHolder {
+public:
+    ThreadCacheHolder() {
+        auto &registry = getRegistry();
+        lock_guard<mutex> lck(registry.mtx);
+        if (!registry.idle.empty()) {
+            cache = registry.idle.back();
+            registry.idle.pop_back();
+        } else {
+            cache = new ThreadCache;
+            registry.caches.emplace_back(cache);
+        }
+    }
+
+    ~ThreadCacheHolder() {
+        s_cache_destroyed = true;
+        //攒批中的内存块立即归还，空闲列表留给复用该缓存的线程
+        for (auto &pending : cache->pending) {
+            cache->flushPending(pending);
+        }
+        auto &registry = getRegistry();
+        lock_guard<mutex> lck(registry.mtx);
+        registry.idle.emplace_back(cache);
+    }
+
+    ThreadCache *cache;
+};
+
+static ThreadCache *getThreadCache() {
+    if (s_cache_destroyed) {
+        return nullptr;
+    }
+    static thread_local ThreadCacheHolder holder;
+    return holder.cache;
+}
+
+static inline int getClassIndex(size_t capacity) {
+    size_t size = 1 << kMinShift;
+    for (size_t i = 0; i < kClassCount; ++i, size <<= 1) {
+        if (capacity <= size) {
+            return (int) i;
+        }
+    }
+    return -1;
+}
+
+char *BufferArena::alloc(size_t &capacity) {
+    auto index = getClassIndex(capacity);
+    auto cache = getThreadCache();
+    if (index == -1) {
+        if (cache) {
+            addCounter<uint64_t>(cache->large_alloc_count, 1);
+        }
+        return new char[capacity];
+    }
+    capacity = (size_t) 1 << (kMinShift + index);
+    if (cache) {
+        addCounter<uint64_t>(cache->alloc_count, 1);
+        addCounter<int64_t>(cache->used_bytes, capacity);
+        if (!cache->head[index]) {
+            cache->drainInbox();
+        }
+        auto block = cache->head[index];
+        if (block) {
+            //命中线程缓存
+            cache->head[index] = block->next;
+            --cache->count[index];
+            addCounter<uint64_t>(cache->hit_count, 1);
+            addCounter<int64_t>(cache->cached_blocks, -1);
+            addCounter<int64_t>(cache->cached_bytes, -(int64_t) capacity);
+            return (char *) block;
+        }
+    }
+    auto ptr = new char[kHeaderSize + capacity] + kHeaderSize;
+    auto header = getHeader(ptr);
+    header->owner = cache;
+    header->index = index;
+    return ptr;
+}
+
+void BufferArena::free(char *ptr, size_t capacity) {
+    if (!ptr) {
+        return;
+    }
+    auto index = getClassIndex(capacity);
+    if (index == -1) {
+        delete[] ptr;
+        return;
+    }
+    auto owner = getHeader(ptr)->owner;
+    auto cache = getThreadCache();
+    if (cache) {
+        addCounter<int64_t>(cache->used_bytes, -(int64_t) capacity);
+    }
+    if (!owner) {
+        //分配时线程缓存已释放
+        deleteBlock(ptr);
+        return;
+    }
+    auto block = (FreeBlock *) ptr;
+    if (owner == cache) {
+        cache->cacheBlock(block, index);
+        return;
+    }
+    if (!cache) {
+        //本线程正在退出，直接归还
+        ThreadCache::pushInbox(owner, block, block);
+        return;
+    }
+    cache->returnBlock(owner, block);
+}
+
+void BufferArena::setMaxCacheBytes(size_t bytes) {
+    s_max_cache_bytes = bytes;
+}
+
+BufferArena::Statistic BufferArena::getStatistic() {
+    auto &registry = getRegistry();
+    lock_guard<mutex> lck(registry.mtx);
+    BufferArena::Statistic ret;
+    int64_t used_bytes = 0;
+    for (auto cache : registry.caches) {
+        ret.alloc_count += cache->alloc_count.load(memory_order_relaxed);
+        ret.hit_count += cache->hit_count.load(memory_order_relaxed);
+        ret.large_alloc_count += cache->large_alloc_count.load(memory_order_relaxed);
+        ret.remote_free_count += cache->remote_free_count.load(memory_order_relaxed);
+        ret.cached_blocks += cache->cached_blocks.load(memory_order_relaxed);
+        ret.cached_bytes += cache->cached_bytes.load(memory_order_relaxed);
+        used_bytes += cache->used_bytes.load(memory_order_relaxed);
+    }
+    ret.used_bytes = used_bytes > 0 ? used_bytes : 0;
+    return ret;
+}
+
+} /* namespace toolkit */
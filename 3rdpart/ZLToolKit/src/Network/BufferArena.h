@@ -0,0 +1,69 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_BUFFERARENA_H
+#define ZLTOOLKIT_BUFFERARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace toolkit {
+
+/**
+ * BufferRaw负载内存的分级缓存分配器
+ * 内存按2的幂次分级(32字节~64KB)，每个线程独立缓存已释放的内存块，分配与释放都无锁
+ * 在A线程分配、B线程释放的内存块由B线程攒批后通过无锁链表归还给A线程，A线程缓存为空时取回，
+ * 所以生产者线程能重新拿回自己分配出去的内存；超过64KB的内存直接使用new/delete
+ */
+class BufferArena {
+public:
+    struct Statistic {
+        //分配次数
+        uint64_t alloc_count = 0;
+        //命中线程缓存的分配次数
+        uint64_t hit_count = 0;
+        //超过最大分级，直接new的次数
+        uint64_t large_alloc_count = 0;
+        //在其他线程释放、归还给分配线程的内存块个数
+        uint64_t remote_free_count = 0;
+        //线程缓存中空闲的内存块个数与字节数
+        uint64_t cached_blocks = 0;
+        uint64_t cached_bytes = 0;
+        //正在使用的分级内存字节数
+        uint64_t used_bytes = 0;
+    };
+
+    /**
+     * 分配内存
+     * @param capacity 请求的内存大小，将被向上取整到所在分级的大小
+     * @return 内存指针
+     */
+    static char *alloc(size_t &capacity);
+
+    /**
+     * 释放内存
+     * @param ptr alloc返回的内存指针
+     * @param capacity alloc返回的实际内存大小
+     */
+    static void free(char *ptr, size_t capacity);
+
+    /**
+     * 设置每个线程每个分级最多缓存的字节数，默认1MB
+     */
+    static void setMaxCacheBytes(size_t bytes);
+
+    /**
+     * 获取所有线程汇总的分配统计
+     */
+    static Statistic getStatistic();
+};
+
+} /* namespace toolkit */
+#endif //ZLTOOLKIT_BUFFERARENA_H
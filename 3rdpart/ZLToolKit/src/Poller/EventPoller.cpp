@@ -18,6 +18,7 @@
 
 #if defined(HAS_EPOLL)
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 #ifdef HAIVISION_SRT
 #include "srt/srt.h"
@@ -50,14 +51,22 @@ EventPoller &EventPoller::Instance(bool srt_thread) {
     return *(EventPollerPool::Instance().getFirstPoller());
 }
 
-EventPoller::EventPoller(std::string name, ThreadPool::Priority priority, bool srt_thread) {
+EventPoller::EventPoller(std::string name, ThreadPool::Priority priority, bool srt_thread) : _delay_task_wheel(getCurrentMillisecond()) {
 #ifdef HAIVISION_SRT
     _srt_thread = srt_thread;
 #endif
     _name = std::move(name);
     _priority = priority;
+
+#if defined(HAS_EPOLL)
+    _event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_event_fd == -1) {
+        throw runtime_error(StrPrinter << "Create eventfd failed: " << get_uv_errmsg());
+    }
+#else
     SockUtil::setNoBlocked(_pipe.readFD());
     SockUtil::setNoBlocked(_pipe.writeFD());
+#endif
 
 #if defined(HAS_EPOLL)
 #ifdef HAIVISION_SRT
@@ -78,7 +87,12 @@ EventPoller::EventPoller(std::string name, ThreadPool::Priority priority, bool s
     _loop_thread_id = this_thread::get_id();
 
     //添加内部管道事件
-    if (addEvent(_pipe.readFD(), Event_Read, [this](int event) { onPipeEvent(); }) == -1) {
+#if defined(HAS_EPOLL)
+    auto wakeup_fd = _event_fd;
+#else
+    auto wakeup_fd = _pipe.readFD();
+#endif
+    if (addEvent(wakeup_fd, Event_Read, [this](int event) { onPipeEvent(); }) == -1) {
         throw std::runtime_error("Add pipe fd to poller failed");
     }
 }
@@ -114,6 +128,10 @@ EventPoller::~EventPoller() {
     //退出前清理管道中的数据
     _loop_thread_id = this_thread::get_id();
     onPipeEvent();
+#if defined(HAS_EPOLL)
+    close(_event_fd);
+    _event_fd = -1;
+#endif
     InfoL << this;
 }
 
@@ -243,17 +261,46 @@ Task::Ptr EventPoller::async_l(TaskIn task, bool may_sync, bool first) {
     }
 
     auto ret = std::make_shared<Task>(std::move(task));
-    {
-        lock_guard<mutex> lck(_mtx_task);
-        if (first) {
+    if (first) {
+        {
+            lock_guard<mutex> lck(_mtx_task);
             _list_task.emplace_front(ret);
-        } else {
-            _list_task.emplace_back(ret);
         }
+        _has_first_task = true;
+    } else {
+        _task_queue.push(ret);
+    }
+    //轮询线程处于休眠状态时才需要唤醒
+    wakeup();
+    return ret;
+}
+
+void EventPoller::wakeup() {
+    if (!_sleeping.load() || _wakeup_pending.exchange(true)) {
+        //轮询线程未休眠(休眠前会检查任务队列)，或者已经唤醒过了
+        return;
     }
+#if defined(HAS_EPOLL)
+    uint64_t one = 1;
+    int ret;
+    do {
+        ret = ::write(_event_fd, &one, sizeof(one));
+    } while (-1 == ret && UV_EINTR == get_uv_error(true));
+#else
     //写数据到管道,唤醒主线程
     _pipe.write("", 1);
-    return ret;
+#endif
+}
+
+bool EventPoller::prepareSleep() {
+    //先标记休眠再检查任务队列，与生产者的入队+检查休眠标记形成顺序一致性，不会丢失唤醒
+    _sleeping = true;
+    return _has_first_task.load() || !_task_queue.empty();
+}
+
+void EventPoller::onWakeup() {
+    _sleeping = false;
+    flushAsyncTask();
 }
 
 bool EventPoller::isCurrentThread() {
@@ -261,6 +308,10 @@ bool EventPoller::isCurrentThread() {
 }
 
 inline void EventPoller::onPipeEvent() {
+#if defined(HAS_EPOLL)
+    uint64_t count;
+    while (::read(_event_fd, &count, sizeof(count)) == -1 && UV_EINTR == get_uv_error(true)) {}
+#else
     char buf[1024];
     int err = 0;
     do {
@@ -269,12 +320,22 @@ inline void EventPoller::onPipeEvent() {
         }
         err = get_uv_error(true);
     } while (err != UV_EAGAIN);
+#endif
+    _wakeup_pending = false;
+    flushAsyncTask();
+}
 
+void EventPoller::flushAsyncTask() {
     decltype(_list_task) _list_swap;
-    {
+    if (_has_first_task.exchange(false)) {
         lock_guard<mutex> lck(_mtx_task);
         _list_swap.swap(_list_task);
     }
+    //只执行本次之前入队的任务，任务中再次切换到本线程的任务留到下次循环
+    Task::Ptr task;
+    while (_task_queue.pop(task)) {
+        _list_swap.emplace_back(std::move(task));
+    }
 
     _list_swap.for_each([&](const Task::Ptr &task) {
         try {
@@ -336,9 +397,12 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
             SRT_EPOLL_EVENT srt_events[EPOLL_SIZE];
             while (!_exit_flag) {
                 minDelay = getMinDelay();//此调用会刷新定时器任务
+                //有未执行的异步任务时不休眠
+                int64_t timeout = prepareSleep() ? 0 : (minDelay ? (int64_t) minDelay : -1);
                 startSleep();//用于统计当前线程负载情况
-                int ret = srt_epoll_uwait(_epoll_fd, srt_events, EPOLL_SIZE, minDelay ? minDelay : -1);
+                int ret = srt_epoll_uwait(_epoll_fd, srt_events, EPOLL_SIZE, timeout);
                 sleepWakeUp();//用于统计当前线程负载情况
+                onWakeup();
                 if (ret <= 0) {
                     //超时或被打断
                     continue;
@@ -367,9 +431,12 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
         struct epoll_event events[EPOLL_SIZE];
         while (!_exit_flag) {
             minDelay = getMinDelay();//此调用会刷新定时器任务
+            //有未执行的异步任务时不休眠
+            int timeout = prepareSleep() ? 0 : (minDelay ? (int) minDelay : -1);
             startSleep();//用于统计当前线程负载情况
-            int ret = epoll_wait(_epoll_fd, events, EPOLL_SIZE, minDelay ? minDelay : -1);
+            int ret = epoll_wait(_epoll_fd, events, EPOLL_SIZE, timeout);
             sleepWakeUp();//用于统计当前线程负载情况
+            onWakeup();
             if (ret <= 0) {
                 //超时或被打断
                 continue;
@@ -398,6 +465,11 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
         while (!_exit_flag) {
             //定时器事件中可能操作_event_map
             minDelay = getMinDelay();
+            bool has_task = prepareSleep();
+            if (has_task) {
+                //有未执行的异步任务，不休眠
+                minDelay = 0;
+            }
             tv.tv_sec = (decltype(tv.tv_sec)) (minDelay / 1000);
             tv.tv_usec = 1000 * (minDelay % 1000);
 
@@ -421,8 +493,9 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
             }
 
             startSleep();//用于统计当前线程负载情况
-            ret = zl_select(max_fd + 1, &set_read, &set_write, &set_err, minDelay ? &tv : nullptr);
+            ret = zl_select(max_fd + 1, &set_read, &set_write, &set_err, (minDelay || has_task) ? &tv : nullptr);
             sleepWakeUp();//用于统计当前线程负载情况
+            onWakeup();
 
             if (ret <= 0) {
                 //超时或被打断
@@ -463,44 +536,27 @@ void EventPoller::runLoop(bool blocked, bool ref_self) {
 }
 
 uint64_t EventPoller::flushDelayTask(uint64_t now_time) {
-    decltype(_delay_task_map) task_copy;
-    task_copy.swap(_delay_task_map);
-
-    for (auto it = task_copy.begin(); it != task_copy.end() && it->first <= now_time; it = task_copy.erase(it)) {
-        //已到期的任务
-        try {
-            auto next_delay = (*(it->second))();
-            if (next_delay) {
-                //可重复任务,更新时间截止线
-                _delay_task_map.emplace(next_delay + now_time, std::move(it->second));
-            }
-        } catch (std::exception &ex) {
-            ErrorL << "Exception occurred when do delay task: " << ex.what();
-        }
-    }
-
-    task_copy.insert(_delay_task_map.begin(), _delay_task_map.end());
-    task_copy.swap(_delay_task_map);
-
-    auto it = _delay_task_map.begin();
-    if (it == _delay_task_map.end()) {
+    //执行已到期的任务
+    _delay_task_wheel.flush(now_time);
+    if (_delay_task_wheel.empty()) {
         //没有剩余的定时器了
         return 0;
     }
-    //最近一个定时器的执行延时
-    return it->first - now_time;
+    //最近一个定时器的执行延时，已到期(例如任务执行期间时间已流逝)时至少休眠1ms，避免返回下溢的延时
+    auto next_time = _delay_task_wheel.nextExpireTime();
+    return next_time > now_time ? next_time - now_time : 1;
 }
 
 uint64_t EventPoller::getMinDelay() {
-    auto it = _delay_task_map.begin();
-    if (it == _delay_task_map.end()) {
+    if (_delay_task_wheel.empty()) {
         //没有剩余的定时器了
         return 0;
     }
     auto now = getCurrentMillisecond();
-    if (it->first > now) {
+    auto next_time = _delay_task_wheel.nextExpireTime();
+    if (next_time > now) {
         //所有任务尚未到期
-        return it->first - now;
+        return next_time - now;
     }
     //执行已到期的任务并刷新休眠延时
     return flushDelayTask(now);
@@ -511,7 +567,7 @@ EventPoller::DelayTask::Ptr EventPoller::doDelayTask(uint64_t delay_ms, function
     auto time_line = getCurrentMillisecond() + delay_ms;
     async_first([time_line, ret, this]() {
         //异步执行的目的是刷新select或epoll的休眠时间
-        _delay_task_map.emplace(time_line, ret);
+        _delay_task_wheel.add(time_line, ret);
     });
     return ret;
 }
@@ -16,10 +16,13 @@
 #include <string>
 #include <functional>
 #include <memory>
+#include <atomic>
 #include <unordered_map>
 #include "PipeWrap.h"
+#include "TimingWheel.h"
 #include "Util/logger.h"
 #include "Util/List.h"
+#include "Util/MpscQueue.h"
 #include "Thread/TaskExecutor.h"
 #include "Thread/ThreadPool.h"
 #include "Network/Buffer.h"
@@ -148,6 +151,27 @@ private:
      */
     void onPipeEvent();
 
+    /**
+     * 执行其他线程切换过来的任务
+     */
+    void flushAsyncTask();
+
+    /**
+     * 如果轮询线程正在休眠，则唤醒之
+     */
+    void wakeup();
+
+    /**
+     * 进入epoll_wait/select前调用
+     * @return 是否有未执行的异步任务，有则不应该阻塞休眠
+     */
+    bool prepareSleep();
+
+    /**
+     * epoll_wait/select返回后调用，执行异步任务
+     */
+    void onWakeup();
+
     /**
      * 切换线程并执行任务
      * @param task
@@ -206,9 +230,21 @@ private:
     //通知事件循环的线程已启动
     semaphore _sem_run_started;
 
+#if defined(HAS_EPOLL)
+    //内部事件eventfd，用于唤醒轮询线程
+    int _event_fd = -1;
+#else
     //内部事件管道
     PipeWrap _pipe;
-    //从其他线程切换过来的任务
+#endif
+    //轮询线程是否正在(或即将)阻塞在epoll_wait/select中，只有此时才需要唤醒
+    std::atomic<bool> _sleeping { false };
+    //已写入唤醒事件但轮询线程尚未读取，防止重复写入
+    std::atomic<bool> _wakeup_pending { false };
+    //从其他线程切换过来的任务，无锁多生产者单消费者队列
+    MpscQueue<Task::Ptr> _task_queue;
+    //async_first优先任务，数量很少，仍然加锁
+    std::atomic<bool> _has_first_task { false };
     std::mutex _mtx_task;
     List<Task::Ptr> _list_task;
 
@@ -230,8 +266,8 @@ private:
     unordered_map<int, Poll_Record::Ptr> _event_map;
 #endif //HAS_EPOLL
 
-    //定时器相关
-    std::multimap<uint64_t, DelayTask::Ptr> _delay_task_map;
+    //定时器相关，分层时间轮
+    TimingWheel _delay_task_wheel;
 };
 
 class EventPollerPool : public std::enable_shared_from_this<EventPollerPool>, public TaskExecutorGetterImp {
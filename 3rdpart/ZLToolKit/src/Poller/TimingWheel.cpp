@@ -0,0 +1,184 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "TimingWheel.h"
+#include "Util/logger.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+using namespace std;
+
+namespace toolkit {
+
+static inline int findFirstBit(uint64_t bits) {
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int) index;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+TimingWheel::TimingWheel(uint64_t now) {
+    _current = now;
+}
+
+void TimingWheel::add(uint64_t expire_time, Task::Ptr task) {
+    ++_size;
+    addEntry(Entry { expire_time, std::move(task) });
+}
+
+void TimingWheel::addEntry(Entry entry) {
+    if (entry.expire_time < _current) {
+        //已经过期的任务，下个tick执行
+        entry.expire_time = _current;
+    }
+    auto diff = entry.expire_time - _current;
+    for (size_t level = 0; level < kLevels; ++level) {
+        if (diff < (1ULL << (kLevelBits * (level + 1)))) {
+            auto index = (entry.expire_time >> (kLevelBits * level)) & kLevelMask;
+            _slots[level][index].emplace_back(std::move(entry));
+            setBit(level, index);
+            return;
+        }
+    }
+    _overflow.emplace_back(std::move(entry));
+}
+
+int TimingWheel::findSlot(size_t level, size_t from) const {
+    for (auto word = from >> 6; word < kLevelSize / 64; ++word) {
+        auto bits = _bitmap[level][word];
+        if (word == (from >> 6)) {
+            bits &= ~0ULL << (from & 63);
+        }
+        if (bits) {
+            return (int) (word * 64 + findFirstBit(bits));
+        }
+    }
+    return -1;
+}
+
+void TimingWheel::flush(uint64_t now) {
+    while (_current <= now) {
+        auto found = findSlot(0, _current & kLevelMask);
+        if (found == -1) {
+            //本轮剩余槽位都为空，直接跳到下一轮起点
+            auto next = std::min((_current | kLevelMask) + 1, now + 1);
+            _current = next;
+            if ((_current & kLevelMask) == 0) {
+                cascade();
+            }
+            continue;
+        }
+        auto tick = (_current & ~(uint64_t) kLevelMask) + found;
+        if (tick > now) {
+            //最近的任务尚未到期
+            _current = now + 1;
+            break;
+        }
+        _current = tick;
+        runSlot(found, now);
+        if ((++_current & kLevelMask) == 0) {
+            cascade();
+        }
+    }
+}
+
+void TimingWheel::runSlot(size_t index, uint64_t now) {
+    //整槽取出后批量执行，可重复任务重新加入时间轮；交换而非拷贝，槽位与_expired的内存都得以复用
+    _expired.swap(_slots[0][index]);
+    clearBit(0, index);
+    _size -= _expired.size();
+
+    for (auto &entry : _expired) {
+        try {
+            auto next_delay = (*entry.task)();
+            if (next_delay) {
+                //可重复任务,更新时间截止线
+                add(now + next_delay, std::move(entry.task));
+            }
+        } catch (std::exception &ex) {
+            ErrorL << "Exception occurred when do delay task: " << ex.what();
+        }
+    }
+    _expired.clear();
+}
+
+void TimingWheel::cascade() {
+    //_current刚好进入低层新的一轮，把高层对应槽位的任务降级
+    for (size_t level = 1; level < kLevels; ++level) {
+        auto index = (_current >> (kLevelBits * level)) & kLevelMask;
+        if (!_slots[level][index].empty()) {
+            std::vector<Entry> entries;
+            entries.swap(_slots[level][index]);
+            clearBit(level, index);
+            for (auto &entry : entries) {
+                addEntry(std::move(entry));
+            }
+        }
+        if (index) {
+            //本层尚未转完一圈，更高层无需降级
+            return;
+        }
+    }
+    //最高层也转完一圈，重新分配溢出任务
+    std::vector<Entry> entries;
+    entries.swap(_overflow);
+    for (auto &entry : entries) {
+        addEntry(std::move(entry));
+    }
+}
+
+uint64_t TimingWheel::nextExpireTime() const {
+    if (!_size) {
+        return 0;
+    }
+    auto base = _current & ~(uint64_t) kLevelMask;
+    auto found = findSlot(0, _current & kLevelMask);
+    if (found != -1) {
+        //最底层本轮的任务一定最早到期
+        return base + found;
+    }
+
+    uint64_t ret = UINT64_MAX;
+    found = findSlot(0, 0);
+    if (found != -1) {
+        //最底层下一轮的任务
+        ret = base + kLevelSize + found;
+    }
+    for (size_t level = 1; level < kLevels; ++level) {
+        //高层槽位相对当前位置的偏移为1~256，到达该槽位起点时降级
+        //与当前位置相同的槽位属于下一轮(偏移256)，本轮的该槽位在到达时已经降级完毕
+        auto shift = kLevelBits * level;
+        auto cur = _current >> shift;
+        auto start = (cur + 1) & kLevelMask;
+        found = findSlot(level, start);
+        if (found == -1) {
+            found = findSlot(level, 0);
+        }
+        if (found != -1) {
+            uint64_t offset = (found - cur) & kLevelMask;
+            if (!offset) {
+                offset = kLevelSize;
+            }
+            ret = std::min(ret, (cur + offset) << shift);
+        }
+    }
+    for (auto &entry : _overflow) {
+        ret = std::min(ret, entry.expire_time);
+    }
+    //到期时间不会早于当前时间，防止调用方计算休眠时长时下溢
+    return std::max(ret, _current);
+}
+
+} /* namespace toolkit */
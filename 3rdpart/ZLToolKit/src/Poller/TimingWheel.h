@@ -0,0 +1,97 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_TIMINGWHEEL_H
+#define ZLTOOLKIT_TIMINGWHEEL_H
+
+#include <vector>
+#include <cstdint>
+#include "Util/util.h"
+#include "Thread/TaskExecutor.h"
+
+namespace toolkit {
+
+/**
+ * 分层时间轮，精度1毫秒，用于EventPoller的延时任务
+ * 共4层，每层256个槽位，可覆盖2^32毫秒(约49天)，超出部分放入溢出列表
+ * 插入O(1)，到期时整槽批量执行；取消任务沿用DelayTask的惰性取消语义(到期时跳过已取消的任务)
+ * 非线程安全，只能在所属EventPoller线程中使用
+ */
+class TimingWheel : public noncopyable {
+public:
+    using Task = TaskCancelableImp<uint64_t(void)>;
+
+    /**
+     * @param now 当前时间(毫秒)，作为时间轮起点
+     */
+    TimingWheel(uint64_t now);
+    ~TimingWheel() = default;
+
+    /**
+     * 添加任务
+     * @param expire_time 到期时间(毫秒)，早于当前时间的任务将在下次flush时执行
+     * @param task 任务，返回值为下次执行延时，返回0则不再重复
+     */
+    void add(uint64_t expire_time, Task::Ptr task);
+
+    /**
+     * 执行所有已到期的任务，可重复任务会以now为起点重新加入时间轮
+     * @param now 当前时间(毫秒)
+     */
+    void flush(uint64_t now);
+
+    /**
+     * 获取最近一个任务的到期时间(毫秒)
+     * 高层槽位只能给出其降级时间，该值不会晚于真实到期时间
+     * @return 时间轮为空时返回0
+     */
+    uint64_t nextExpireTime() const;
+
+    /**
+     * 任务个数(包括已取消但尚未到期的任务)
+     */
+    size_t size() const { return _size; }
+
+    bool empty() const { return _size == 0; }
+
+private:
+    struct Entry {
+        uint64_t expire_time;
+        Task::Ptr task;
+    };
+
+    void addEntry(Entry entry);
+    void runSlot(size_t index, uint64_t now);
+    void cascade();
+    int findSlot(size_t level, size_t from) const;
+
+    void setBit(size_t level, size_t index) { _bitmap[level][index >> 6] |= (1ULL << (index & 63)); }
+    void clearBit(size_t level, size_t index) { _bitmap[level][index >> 6] &= ~(1ULL << (index & 63)); }
+
+private:
+    static constexpr size_t kLevelBits = 8;
+    static constexpr size_t kLevelSize = 1 << kLevelBits;
+    static constexpr size_t kLevelMask = kLevelSize - 1;
+    static constexpr size_t kLevels = 4;
+
+    //下一个待处理的tick
+    uint64_t _current;
+    size_t _size = 0;
+    //每个槽位是否非空的位图，用于跳过空槽以及计算最近到期时间
+    uint64_t _bitmap[kLevels][kLevelSize / 64] = {{0}};
+    std::vector<Entry> _slots[kLevels][kLevelSize];
+    //超出2^32毫秒的任务
+    std::vector<Entry> _overflow;
+    //正在执行的到期任务
+    std::vector<Entry> _expired;
+};
+
+} /* namespace toolkit */
+#endif //ZLTOOLKIT_TIMINGWHEEL_H
@@ -69,6 +69,31 @@ public:
 #endif
     }
 
+    /**
+     * 等待信号，最多等待ms毫秒
+     * @return 是否等到了信号
+     */
+    bool waitFor(size_t ms) {
+#if defined(HAVE_SEM)
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        ts.tv_sec += ms / 1000;
+        ts.tv_nsec += (ms % 1000) * 1000000;
+        if (ts.tv_nsec >= 1000000000) {
+            ++ts.tv_sec;
+            ts.tv_nsec -= 1000000000;
+        }
+        return sem_timedwait(&_sem, &ts) == 0;
+#else
+        std::unique_lock<std::recursive_mutex> lock(_mutex);
+        if (!_condition.wait_for(lock, std::chrono::milliseconds(ms), [this]() { return _count > 0; })) {
+            return false;
+        }
+        --_count;
+        return true;
+#endif
+    }
+
 private:
 #if defined(HAVE_SEM)
     sem_t _sem;
@@ -0,0 +1,92 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLTOOLKIT_MPSCQUEUE_H
+#define ZLTOOLKIT_MPSCQUEUE_H
+
+#include <atomic>
+#include <utility>
+#include "Util/util.h"
+
+namespace toolkit {
+
+/**
+ * 无锁多生产者单消费者队列(Dmitry Vyukov算法)
+ * push可以在任意线程并发调用，pop与empty只能在唯一的消费者线程调用
+ * 生产者入队只需一次原子交换，没有锁竞争
+ */
+template<typename T>
+class MpscQueue : public noncopyable {
+public:
+    MpscQueue() {
+        _head = new Node;
+        _tail.store(_head);
+    }
+
+    ~MpscQueue() {
+        T value;
+        while (pop(value)) {}
+        delete _head;
+    }
+
+    /**
+     * 入队，可以多线程同时调用
+     */
+    template<typename ...ARGS>
+    void push(ARGS &&...args) {
+        auto node = new Node(std::forward<ARGS>(args)...);
+        //交换尾节点后再链接，两步之间消费者可能暂时看不到该节点，但是empty()会返回false
+        auto prev = _tail.exchange(node);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    /**
+     * 出队，只能在消费者线程调用
+     * @return 队列为空(或生产者正在入队)时返回false
+     */
+    bool pop(T &value) {
+        auto next = _head->next.load(std::memory_order_acquire);
+        if (!next) {
+            return false;
+        }
+        value = std::move(next->value);
+        delete _head;
+        //next成为新的哨兵节点
+        _head = next;
+        return true;
+    }
+
+    /**
+     * 队列是否为空，只能在消费者线程调用
+     * 与push中的原子交换构成顺序一致性，用于判断是否可以安全休眠
+     */
+    bool empty() const {
+        return _tail.load() == _head;
+    }
+
+private:
+    struct Node {
+        Node() = default;
+        template<typename ...ARGS>
+        Node(ARGS &&...args) : value(std::forward<ARGS>(args)...) {}
+
+        std::atomic<Node *> next { nullptr };
+        T value;
+    };
+
+    //消费者独占的哨兵节点
+    Node *_head;
+    //填充字节，避免_head与生产者竞争的_tail伪共享
+    char _padding[64];
+    std::atomic<Node *> _tail;
+};
+
+} /* namespace toolkit */
+#endif //ZLTOOLKIT_MPSCQUEUE_H
@@ -17,6 +17,7 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <vector>
 #include <unordered_set>
 
 namespace toolkit {
@@ -31,6 +32,66 @@ class ResourcePool_l;
 template <typename C>
 class ResourcePool;
 
+/**
+ * 循环池使用的线程序号，同时存在的线程最多kMaxThreads个，线程退出后序号被复用
+ * 超出个数的线程及正在退出的线程序号为-1，此时循环池退化为共享列表
+ */
+class ResourcePoolThreadIndex {
+public:
+    static constexpr int kMaxThreads = 64;
+
+    static int get() {
+        if (destroyed()) {
+            return -1;
+        }
+        static thread_local Holder holder;
+        return holder.index;
+    }
+
+private:
+    struct Registry {
+        std::mutex mtx;
+        std::vector<int> free_index;
+        int next_index = 0;
+    };
+
+    struct Holder {
+        Holder() {
+            auto &registry = getRegistry();
+            std::lock_guard<std::mutex> lck(registry.mtx);
+            if (!registry.free_index.empty()) {
+                index = registry.free_index.back();
+                registry.free_index.pop_back();
+            } else if (registry.next_index < kMaxThreads) {
+                index = registry.next_index++;
+            }
+        }
+
+        ~Holder() {
+            //此后本线程不再使用该序号，防止与复用该序号的新线程冲突
+            destroyed() = true;
+            if (index >= 0) {
+                auto &registry = getRegistry();
+                std::lock_guard<std::mutex> lck(registry.mtx);
+                registry.free_index.emplace_back(index);
+            }
+        }
+
+        int index = -1;
+    };
+
+    static Registry &getRegistry() {
+        //不析构，防止其他线程退出时访问已析构的对象
+        static auto registry = new Registry;
+        return *registry;
+    }
+
+    static bool &destroyed() {
+        static thread_local bool flag = false;
+        return flag;
+    }
+};
+
 template <typename C>
 class shared_ptr_imp : public std::shared_ptr<C> {
 public:
@@ -39,11 +100,12 @@ public:
     /**
      * 构造智能指针
      * @param ptr 裸指针
+     * @param owner 获取该对象的线程序号
      * @param weakPool 管理本指针的循环池
      * @param quit 对接是否放弃循环使用
      */
     shared_ptr_imp(
-        C *ptr, const std::weak_ptr<ResourcePool_l<C>> &weakPool, std::shared_ptr<std::atomic_bool> quit,
+        C *ptr, int owner, const std::weak_ptr<ResourcePool_l<C>> &weakPool, std::shared_ptr<std::atomic_bool> quit,
         const std::function<void(C *)> &on_recycle);
 
     /**
@@ -60,6 +122,11 @@ private:
     std::shared_ptr<std::atomic_bool> _quit;
 };
 
+/**
+ * 每个线程一个无锁的空闲对象列表
+ * 对象在其他线程释放时，先攒入该线程的待归还批次，攒满kBatchSize个后通过无锁链表一次性归还给获取它的线程，
+ * 由获取线程在本地列表为空时取回；线程数超出限制时使用共享列表，抢锁失败直接new/delete，从不阻塞
+ */
 template <typename C>
 class ResourcePool_l : public std::enable_shared_from_this<ResourcePool_l<C>> {
 public:
@@ -79,27 +146,52 @@ public:
 #endif // defined(SUPPORT_DYNAMIC_TEMPLATE)
 
     ~ResourcePool_l() {
-        for (auto ptr : _objs) {
+        for (auto &ref : _slots) {
+            auto slot = ref.load(std::memory_order_acquire);
+            if (!slot) {
+                continue;
+            }
+            for (auto ptr : slot->objs) {
+                delete ptr;
+            }
+            for (auto batch : slot->pending) {
+                deleteBatch(batch);
+            }
+            auto batch = slot->returned.exchange(nullptr, std::memory_order_acquire);
+            while (batch) {
+                auto next = batch->next;
+                deleteBatch(batch);
+                batch = next;
+            }
+            delete slot;
+        }
+        for (auto ptr : _shared_objs) {
             delete ptr;
         }
     }
 
+    /**
+     * 设置每个线程最多缓存的空闲对象个数
+     */
     void setSize(size_t size) {
         _pool_size = size;
-        _objs.reserve(size);
     }
 
     ValuePtr obtain(const std::function<void(C *)> &on_recycle = nullptr) {
-        return ValuePtr(getPtr(), _weak_self, std::make_shared<std::atomic_bool>(false), on_recycle);
+        int owner;
+        auto ptr = getPtr(owner);
+        return ValuePtr(ptr, owner, _weak_self, std::make_shared<std::atomic_bool>(false), on_recycle);
     }
 
     std::shared_ptr<C> obtain2() {
         auto weak_self = _weak_self;
-        return std::shared_ptr<C>(getPtr(), [weak_self](C *ptr) {
+        int owner;
+        auto ptr = getPtr(owner);
+        return std::shared_ptr<C>(ptr, [weak_self, owner](C *ptr) {
             auto strongPool = weak_self.lock();
             if (strongPool) {
                 //放入循环池
-                strongPool->recycle(ptr);
+                strongPool->recycle(ptr, owner);
             } else {
                 delete ptr;
             }
@@ -107,48 +199,153 @@ public:
     }
 
 private:
-    void recycle(C *obj) {
-        auto is_busy = _busy.test_and_set();
-        if (!is_busy) {
-            //获取到锁
-            if (_objs.size() >= _pool_size) {
+    static constexpr size_t kBatchSize = 16;
+    static constexpr size_t kPendingSize = 4;
+
+    struct Batch {
+        Batch *next;
+        int owner;
+        size_t size;
+        C *objs[kBatchSize];
+    };
+
+    struct Slot {
+        //本线程独占的空闲对象列表
+        std::vector<C *> objs;
+        //其他线程归还的批次，多生产者单消费者的无锁栈
+        std::atomic<Batch *> returned { nullptr };
+        //本线程释放的其他线程的对象，按获取线程序号映射
+        Batch *pending[kPendingSize] = { nullptr };
+    };
+
+    static void deleteBatch(Batch *batch) {
+        if (!batch) {
+            return;
+        }
+        for (size_t i = 0; i < batch->size; ++i) {
+            delete batch->objs[i];
+        }
+        delete batch;
+    }
+
+    Slot *getSlot(int index) {
+        auto slot = _slots[index].load(std::memory_order_acquire);
+        if (!slot) {
+            //只有该序号的线程会创建该槽位
+            slot = new Slot;
+            _slots[index].store(slot, std::memory_order_release);
+        }
+        return slot;
+    }
+
+    void pushBatch(Batch *batch) {
+        auto &returned = _slots[batch->owner].load(std::memory_order_acquire)->returned;
+        batch->next = returned.load(std::memory_order_relaxed);
+        while (!returned.compare_exchange_weak(batch->next, batch, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void recycle(C *obj, int owner) {
+        auto index = ResourcePoolThreadIndex::get();
+        if (index < 0 || owner < 0) {
+            recycleShared(obj);
+            return;
+        }
+        auto slot = getSlot(index);
+        if (owner == index) {
+            //本线程获取的对象，无锁回收
+            if (slot->objs.size() >= _pool_size) {
                 delete obj;
             } else {
-                _objs.emplace_back(obj);
+                slot->objs.emplace_back(obj);
             }
-            _busy.clear();
-        } else {
-            //未获取到锁
-            delete obj;
+            return;
+        }
+        //其他线程获取的对象，攒批后归还
+        auto &batch = slot->pending[owner % kPendingSize];
+        if (batch && batch->owner != owner) {
+            pushBatch(batch);
+            batch = nullptr;
+        }
+        if (!batch) {
+            batch = new Batch;
+            batch->owner = owner;
+            batch->size = 0;
+        }
+        batch->objs[batch->size++] = obj;
+        if (batch->size == kBatchSize) {
+            pushBatch(batch);
+            batch = nullptr;
         }
     }
 
-    C *getPtr() {
-        C *ptr;
-        auto is_busy = _busy.test_and_set();
-        if (!is_busy) {
-            //获取到锁
-            if (_objs.size() == 0) {
-                ptr = _alloc();
-            } else {
-                ptr = _objs.back();
-                _objs.pop_back();
+    C *getPtr(int &owner) {
+        owner = ResourcePoolThreadIndex::get();
+        if (owner < 0) {
+            return getShared();
+        }
+        auto slot = getSlot(owner);
+        if (slot->objs.empty()) {
+            //本地列表为空，取回其他线程归还的对象
+            auto batch = slot->returned.exchange(nullptr, std::memory_order_acquire);
+            while (batch) {
+                for (size_t i = 0; i < batch->size; ++i) {
+                    if (slot->objs.size() >= _pool_size) {
+                        delete batch->objs[i];
+                    } else {
+                        slot->objs.emplace_back(batch->objs[i]);
+                    }
+                }
+                auto next = batch->next;
+                delete batch;
+                batch = next;
             }
-            _busy.clear();
+        }
+        if (slot->objs.empty()) {
+            return _alloc();
+        }
+        auto ptr = slot->objs.back();
+        slot->objs.pop_back();
+        return ptr;
+    }
+
+    void recycleShared(C *obj) {
+        if (_busy.test_and_set(std::memory_order_acquire)) {
+            //未获取到锁
+            delete obj;
+            return;
+        }
+        if (_shared_objs.size() >= _pool_size) {
+            delete obj;
         } else {
+            _shared_objs.emplace_back(obj);
+        }
+        _busy.clear(std::memory_order_release);
+    }
+
+    C *getShared() {
+        if (_busy.test_and_set(std::memory_order_acquire)) {
             //未获取到锁
-            ptr = _alloc();
+            return _alloc();
         }
-        return ptr;
+        C *ptr = nullptr;
+        if (!_shared_objs.empty()) {
+            ptr = _shared_objs.back();
+            _shared_objs.pop_back();
+        }
+        _busy.clear(std::memory_order_release);
+        return ptr ? ptr : _alloc();
     }
 
     void setup() { _weak_self = this->shared_from_this(); }
 
 private:
     size_t _pool_size = 8;
-    std::vector<C *> _objs;
-    std::function<C *(void)> _alloc;
+    //按线程序号索引的槽位
+    std::atomic<Slot *> _slots[ResourcePoolThreadIndex::kMaxThreads] {};
+    //无线程序号时使用的共享列表
     std::atomic_flag _busy { false };
+    std::vector<C *> _shared_objs;
+    std::function<C *(void)> _alloc;
     std::weak_ptr<ResourcePool_l> _weak_self;
 };
 
@@ -185,17 +382,18 @@ private:
 
 template<typename C>
 shared_ptr_imp<C>::shared_ptr_imp(C *ptr,
+                                  int owner,
                                   const std::weak_ptr<ResourcePool_l<C> > &weakPool,
                                   std::shared_ptr<std::atomic_bool> quit,
                                   const std::function<void(C *)> &on_recycle) :
-    std::shared_ptr<C>(ptr, [weakPool, quit, on_recycle](C *ptr) {
+    std::shared_ptr<C>(ptr, [weakPool, owner, quit, on_recycle](C *ptr) {
             if (on_recycle) {
                 on_recycle(ptr);
             }
             auto strongPool = weakPool.lock();
             if (strongPool && !(*quit)) {
                 //循环池还在并且不放弃放入循环池
-                strongPool->recycle(ptr);
+                strongPool->recycle(ptr, owner);
             } else {
                 delete ptr;
             }
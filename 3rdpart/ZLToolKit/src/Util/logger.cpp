@@ -15,6 +15,8 @@
 #include "onceToken.h"
 #include "File.h"
 #include "NoticeCenter.h"
+#include "ResourcePool.h"
+#include "TimeTicker.h"
 
 #if defined(_WIN32)
 #include "strptime_win.h"
@@ -182,21 +184,130 @@ LogContext::LogContext(LogLevel level, const char *file, const char *function, i
     _thread_name = getThreadName();
 }
 
+void LogContext::reset(LogLevel level, const char *file, const char *function, int line, const char *module_name, const char *flag) {
+    _level = level;
+    _line = line;
+    _repeat = 0;
+    _dropped = 0;
+    //string赋值会复用已有内存
+    _file = getFileName(file);
+    _function = getFunctionName(function);
+    _module_name = module_name;
+    _flag = flag;
+    gettimeofday(&_tv, nullptr);
+    _thread_name = getThreadName();
+    _got_content = false;
+    _formatted = false;
+    _content.clear();
+    _record.clear();
+
+    //清空缓存并恢复上次日志可能修改的格式(std::hex等)
+    ostringstream::str(string());
+    ostringstream::clear();
+    flags(ios_base::dec | ios_base::skipws);
+    precision(6);
+    width(0);
+    fill(' ');
+}
+
 const string &LogContext::str() {
     if (_got_content) {
         return _content;
     }
+    formatRecord();
     _content = ostringstream::str();
     _got_content = true;
     return _content;
 }
 
+void LogContext::appendString(const char *data, size_t size) {
+    _record.push_back((char) kArgString);
+    appendRaw(size);
+    _record.append(data, size);
+}
+
+template<typename T>
+static T readRaw(const char *&ptr) {
+    T ret;
+    memcpy(&ret, ptr, sizeof(ret));
+    ptr += sizeof(ret);
+    return ret;
+}
+
+void LogContext::formatRecord() {
+    _formatted = true;
+    if (_record.empty()) {
+        return;
+    }
+    auto ptr = _record.data();
+    auto end = ptr + _record.size();
+    while (ptr < end) {
+        switch (*ptr++) {
+            case kArgBool: *this << (bool) *ptr++; break;
+            case kArgChar: *this << *ptr++; break;
+            case kArgInteger: {
+                auto type = (uint8_t) *ptr++;
+                auto value = readRaw<uint64_t>(ptr);
+                switch (type) {
+                    case 0x82: *this << (int16_t) value; break;
+                    case 0x84: *this << (int32_t) value; break;
+                    case 0x88: *this << (int64_t) value; break;
+                    case 0x02: *this << (uint16_t) value; break;
+                    case 0x04: *this << (uint32_t) value; break;
+                    default: *this << value; break;
+                }
+                break;
+            }
+            case kArgFloat: *this << readRaw<double>(ptr); break;
+            case kArgLongDouble: *this << readRaw<long double>(ptr); break;
+            case kArgString: {
+                auto size = readRaw<size_t>(ptr);
+                write(ptr, size);
+                ptr += size;
+                break;
+            }
+            case kArgPointer: *this << readRaw<const void *>(ptr); break;
+            case kArgManip: *this << readRaw<Manip>(ptr); break;
+            default: break;
+        }
+    }
+    _record.clear();
+}
+
 ///////////////////AsyncLogWriter///////////////////
 
 static string s_module_name = exeName(false);
 
-LogContextCapture::LogContextCapture(Logger &logger, LogLevel level, const char *file, const char *function, int line, const char *flag) :
-        _ctx(new LogContext(level, file, function, line, s_module_name.c_str(), flag)), _logger(logger) {
+//线程退出时循环池可能先于其他线程局部对象析构，此后该线程打印的日志不再复用对象
+static thread_local bool s_log_pool_destroyed = false;
+
+class LogContextPool : public ResourcePool<LogContext> {
+public:
+    LogContextPool() { setSize(64); }
+    ~LogContextPool() { s_log_pool_destroyed = true; }
+};
+
+static LogContextPtr obtainLogContext() {
+    if (s_log_pool_destroyed) {
+        return std::make_shared<LogContext>();
+    }
+    //每个线程一个循环池，本线程获取与回收都无锁，日志线程释放的对象批量归还
+    static thread_local LogContextPool s_pool;
+    return s_pool.obtain2();
+}
+
+LogContextCapture::LogContextCapture(Logger &logger, LogLevel level, const char *file, const char *function, int line, const char *flag, LogRateLimiter *limiter) :
+        _logger(logger) {
+    int dropped = 0;
+    //错误日志不限流
+    if (limiter && level < LError && !limiter->allow(dropped)) {
+        //被限流，后续的<<操作都不会格式化
+        limiter->registerSite(logger, level, file, function, line);
+        return;
+    }
+    _ctx = obtainLogContext();
+    _ctx->reset(level, file, function, line, s_module_name.c_str(), flag);
+    _ctx->_dropped = dropped;
 }
 
 LogContextCapture::LogContextCapture(const LogContextCapture &that) : _ctx(that._ctx), _logger(that._logger) {
@@ -220,9 +331,68 @@ void LogContextCapture::clear() {
     _ctx.reset();
 }
 
+///////////////////LogRateLimiter///////////////////
+
+static atomic<size_t> s_max_log_per_second(0);
+
+//已登记的打印点链表头，只增不减
+static atomic<LogRateLimiter *> s_limiter_list(nullptr);
+
+void LogRateLimiter::setMaxPerSecond(size_t max_per_second) {
+    s_max_log_per_second = max_per_second;
+}
+
+size_t LogRateLimiter::getMaxPerSecond() {
+    return s_max_log_per_second.load(memory_order_relaxed);
+}
+
+void LogRateLimiter::registerSite(Logger &logger, LogLevel level, const char *file, const char *function, int line) {
+    if (_registered.load(memory_order_relaxed) || _registered.exchange(true)) {
+        return;
+    }
+    _logger = &logger;
+    _level = level;
+    _file = file;
+    _function = function;
+    _line = line;
+    //无锁插入链表头，release语义确保日志线程看到完整的打印点信息
+    _next = s_limiter_list.load(memory_order_relaxed);
+    while (!s_limiter_list.compare_exchange_weak(_next, this, memory_order_release, memory_order_relaxed));
+}
+
+void LogRateLimiter::flushDropped() {
+    for (auto limiter = s_limiter_list.load(memory_order_acquire); limiter; limiter = limiter->_next) {
+        auto dropped = limiter->_dropped.exchange(0, memory_order_relaxed);
+        if (dropped) {
+            LogContextCapture(*limiter->_logger, limiter->_level, limiter->_file, limiter->_function, limiter->_line)
+                << dropped << " messages from this line suppressed by rate limit";
+        }
+    }
+}
+
+bool LogRateLimiter::allow(int &dropped) {
+    auto max_count = s_max_log_per_second.load(memory_order_relaxed);
+    if (!max_count) {
+        return true;
+    }
+    //多线程同时打印同一打印点时计数可能略有偏差，但无需加锁
+    auto second = (uint64_t) time(nullptr);
+    if (_second.load(memory_order_relaxed) != second && _second.exchange(second, memory_order_relaxed) != second) {
+        //进入新的统计周期
+        _count.store(0, memory_order_relaxed);
+        dropped = (int) _dropped.exchange(0, memory_order_relaxed);
+    }
+    if (_count.fetch_add(1, memory_order_relaxed) < max_count) {
+        return true;
+    }
+    _dropped.fetch_add(1, memory_order_relaxed);
+    dropped = 0;
+    return false;
+}
+
 ///////////////////AsyncLogWriter///////////////////
 
-AsyncLogWriter::AsyncLogWriter() : _exit_flag(false) {
+AsyncLogWriter::AsyncLogWriter() {
     _thread = std::make_shared<thread>([this]() { this->run(); });
 }
 
@@ -234,31 +404,49 @@ AsyncLogWriter::~AsyncLogWriter() {
 }
 
 void AsyncLogWriter::write(const LogContextPtr &ctx, Logger &logger) {
-    {
-        lock_guard<mutex> lock(_mutex);
-        _pending.emplace_back(std::make_pair(ctx, &logger));
+    _pending.push(ctx, &logger);
+    //日志线程正在忙时无需唤醒，其处理完当前批次后会再次检查队列
+    if (_sleeping.load() && !_wakeup_pending.exchange(true)) {
+        _sem.post();
     }
-    _sem.post();
 }
 
 void AsyncLogWriter::run() {
     setThreadName("async log");
+    Ticker ticker;
     while (!_exit_flag) {
-        _sem.wait();
         flushAll();
+        auto limited = LogRateLimiter::getMaxPerSecond() > 0;
+        if (limited && ticker.elapsedTime() >= 1000) {
+            //限流的打印点之后可能不再打印，定时输出其丢弃条数
+            ticker.resetTime();
+            LogRateLimiter::flushDropped();
+        }
+        //先声明即将休眠再检查队列，与write中的入队、检查休眠标记构成顺序一致，不会漏掉唤醒
+        _sleeping = true;
+        if (_pending.empty() && !_exit_flag) {
+            if (limited) {
+                _sem.waitFor(1000);
+            } else {
+                _sem.wait();
+            }
+        }
+        _sleeping = false;
+        _wakeup_pending = false;
     }
 }
 
 void AsyncLogWriter::flushAll() {
-    decltype(_pending) tmp;
-    {
-        lock_guard<mutex> lock(_mutex);
-        tmp.swap(_pending);
-    }
-
-    tmp.for_each([&](std::pair<LogContextPtr, Logger *> &pr) {
+    std::pair<LogContextPtr, Logger *> pr;
+    while (!_pending.empty()) {
+        if (!_pending.pop(pr)) {
+            //生产者正在入队，稍后即可取出
+            this_thread::yield();
+            continue;
+        }
         pr.second->writeChannels(pr.first);
-    });
+        pr.first = nullptr;
+    }
 }
 
 ///////////////////EventChannel////////////////////
@@ -405,6 +593,11 @@ void LogChannel::format(const Logger &logger, ostream &ost, const LogContextPtr
         ost << "\r\n    Last message repeated " << ctx->_repeat << " times";
     }
 
+    if (ctx->_dropped > 0) {
+        // log dropped by rate limiter
+        ost << "\r\n    " << ctx->_dropped << " messages from this line suppressed by rate limit";
+    }
+
     // flush log and new line
     ost << endl;
 }
@@ -17,13 +17,18 @@
 #include <thread>
 #include <memory>
 #include <mutex>
+#include <atomic>
+#include <cstring>
+#include <type_traits>
 #include "util.h"
 #include "List.h"
+#include "MpscQueue.h"
 #include "Thread/semaphore.h"
 
 namespace toolkit {
 
 class LogContext;
+class LogRateLimiter;
 class LogChannel;
 class LogWriter;
 class Logger;
@@ -124,9 +129,16 @@ public:
     LogContext(LogLevel level, const char *file, const char *function, int line, const char *module_name, const char *flag);
     ~LogContext() = default;
 
+    /**
+     * 重新初始化日志上下文，用于循环池复用对象，避免每条日志都构造ostringstream
+     */
+    void reset(LogLevel level, const char *file, const char *function, int line, const char *module_name, const char *flag);
+
     LogLevel _level;
     int _line;
     int _repeat = 0;
+    //该打印点被限流丢弃的日志条数
+    int _dropped = 0;
     std::string _file;
     std::string _function;
     std::string _thread_name;
@@ -134,11 +146,127 @@ public:
     std::string _flag;
     struct timeval _tv;
 
+    /**
+     * 获取日志内容，未格式化的二进制记录在此时格式化(异步日志时在日志线程中执行)
+     */
     const std::string &str();
 
+    /**
+     * 记录一个日志参数
+     * 整数、浮点数、字符、字符串、指针以及std::hex等格式控制符以二进制形式追加到记录中，推迟到str()时再格式化
+     * 其他类型(自定义operator<<、std::setw等)无法推迟，遇到后先格式化已有记录，本条日志余下的参数都直接格式化
+     */
+    template<typename T>
+    void capture(T &&data) {
+        if (_formatted) {
+            *this << std::forward<T>(data);
+            return;
+        }
+        captureArg(std::forward<T>(data), typename ArgKind<typename std::decay<T>::type>::type());
+    }
+
+private:
+    enum {
+        kArgGeneric = 0,
+        kArgBool,
+        kArgChar,
+        kArgInteger,
+        kArgFloat,
+        kArgLongDouble,
+        kArgString,
+        kArgPointer,
+        kArgManip,
+    };
+
+    using Manip = std::ios_base &(*)(std::ios_base &);
+
+    template<typename T>
+    struct ArgKind {
+        using type = std::integral_constant<int,
+            std::is_same<T, bool>::value ? kArgBool :
+            (std::is_same<T, char>::value || std::is_same<T, signed char>::value || std::is_same<T, unsigned char>::value) ? kArgChar :
+            std::is_integral<T>::value ? kArgInteger :
+            (std::is_same<T, float>::value || std::is_same<T, double>::value) ? kArgFloat :
+            std::is_same<T, long double>::value ? kArgLongDouble :
+            (std::is_same<T, std::string>::value || std::is_same<T, const char *>::value || std::is_same<T, char *>::value) ? kArgString :
+            std::is_same<T, Manip>::value ? kArgManip :
+            (std::is_pointer<T>::value && std::is_convertible<T, const void *>::value) ? kArgPointer :
+            kArgGeneric>;
+    };
+
+    template<typename T>
+    void appendRaw(const T &value) {
+        _record.append((const char *) &value, sizeof(value));
+    }
+
+    template<typename T>
+    void captureArg(T &&data, std::integral_constant<int, kArgGeneric>) {
+        formatRecord();
+        *this << std::forward<T>(data);
+    }
+
+    void captureArg(bool data, std::integral_constant<int, kArgBool>) {
+        _record.push_back((char) kArgBool);
+        _record.push_back((char) data);
+    }
+
+    template<typename T>
+    void captureArg(T data, std::integral_constant<int, kArgChar>) {
+        _record.push_back((char) kArgChar);
+        _record.push_back((char) data);
+    }
+
+    template<typename T>
+    void captureArg(T data, std::integral_constant<int, kArgInteger>) {
+        //保存原类型的长度与符号，确保std::hex等格式下输出与直接格式化一致
+        _record.push_back((char) kArgInteger);
+        _record.push_back((char) (sizeof(T) | (std::is_signed<T>::value ? 0x80 : 0)));
+        appendRaw(std::is_signed<T>::value ? (uint64_t) (int64_t) data : (uint64_t) data);
+    }
+
+    void captureArg(double data, std::integral_constant<int, kArgFloat>) {
+        _record.push_back((char) kArgFloat);
+        appendRaw(data);
+    }
+
+    void captureArg(long double data, std::integral_constant<int, kArgLongDouble>) {
+        _record.push_back((char) kArgLongDouble);
+        appendRaw(data);
+    }
+
+    void captureArg(const std::string &data, std::integral_constant<int, kArgString>) {
+        appendString(data.data(), data.size());
+    }
+
+    void captureArg(const char *data, std::integral_constant<int, kArgString>) {
+        if (!data) {
+            //与直接输出空指针的行为保持一致
+            captureArg(data, std::integral_constant<int, kArgGeneric>());
+            return;
+        }
+        appendString(data, strlen(data));
+    }
+
+    void captureArg(const void *data, std::integral_constant<int, kArgPointer>) {
+        _record.push_back((char) kArgPointer);
+        appendRaw(data);
+    }
+
+    void captureArg(Manip data, std::integral_constant<int, kArgManip>) {
+        _record.push_back((char) kArgManip);
+        appendRaw(data);
+    }
+
+    void appendString(const char *data, size_t size);
+    void formatRecord();
+
 private:
     bool _got_content = false;
+    //本条日志是否已开始直接格式化
+    bool _formatted = false;
     std::string _content;
+    //未格式化的日志参数
+    std::string _record;
 };
 
 /**
@@ -148,7 +276,7 @@ class LogContextCapture {
 public:
     using Ptr = std::shared_ptr<LogContextCapture>;
 
-    LogContextCapture(Logger &logger, LogLevel level, const char *file, const char *function, int line, const char *flag = "");
+    LogContextCapture(Logger &logger, LogLevel level, const char *file, const char *function, int line, const char *flag = "", LogRateLimiter *limiter = nullptr);
     LogContextCapture(const LogContextCapture &that);
     ~LogContextCapture();
 
@@ -164,7 +292,7 @@ public:
         if (!_ctx) {
             return *this;
         }
-        (*_ctx) << std::forward<T>(data);
+        _ctx->capture(std::forward<T>(data));
         return *this;
     }
 
@@ -176,6 +304,57 @@ private:
 };
 
 
+///////////////////LogRateLimiter///////////////////
+/**
+ * 日志打印点限流器，每个WriteL/WriteF打印点拥有一个静态实例
+ * 防止网络异常时某个打印点(例如丢包告警)刷屏，拖慢poller线程与日志线程
+ * 超过限制的日志直接丢弃(不再格式化)，丢弃的条数会附加在该打印点下一条日志中，
+ * 该打印点之后不再打印时由日志线程每秒汇总输出一次；错误日志(LError)不限流
+ */
+class LogRateLimiter {
+public:
+    /**
+     * 是否允许打印本条日志
+     * @param dropped 允许打印时，返回上个统计周期内被丢弃的日志条数
+     */
+    bool allow(int &dropped);
+
+    /**
+     * 本打印点首次丢弃日志时登记打印点信息，以便定时汇总输出丢弃条数
+     */
+    void registerSite(Logger &logger, LogLevel level, const char *file, const char *function, int line);
+
+    /**
+     * 设置每个打印点每秒最多输出的日志条数，0为不限制(默认)
+     */
+    static void setMaxPerSecond(size_t max_per_second);
+
+    /**
+     * 获取每个打印点每秒最多输出的日志条数
+     */
+    static size_t getMaxPerSecond();
+
+    /**
+     * 输出所有打印点尚未报告的丢弃条数，由日志线程定时调用
+     */
+    static void flushDropped();
+
+private:
+    //成员都是常量初始化，作为函数内静态变量时无需线程安全的初始化检查
+    std::atomic<uint64_t> _second { 0 };
+    std::atomic<uint32_t> _count { 0 };
+    std::atomic<uint32_t> _dropped { 0 };
+    std::atomic<bool> _registered { false };
+    //打印点信息，登记后不再修改
+    Logger *_logger = nullptr;
+    LogLevel _level = LTrace;
+    const char *_file = nullptr;
+    const char *_function = nullptr;
+    int _line = 0;
+    //已登记打印点组成的单向链表
+    LogRateLimiter *_next = nullptr;
+};
+
 ///////////////////LogWriter///////////////////
 /**
  * 写日志器
@@ -199,11 +378,14 @@ private:
     void write(const LogContextPtr &ctx, Logger &logger) override;
 
 private:
-    bool _exit_flag;
+    std::atomic<bool> _exit_flag { false };
+    //日志线程是否正在(或即将)休眠，只有此时写日志才需要唤醒，避免每条日志一次系统调用
+    std::atomic<bool> _sleeping { false };
+    std::atomic<bool> _wakeup_pending { false };
     semaphore _sem;
-    std::mutex _mutex;
     std::shared_ptr<std::thread> _thread;
-    List<std::pair<LogContextPtr, Logger *> > _pending;
+    //无锁队列，写日志的线程之间不再竞争互斥锁
+    MpscQueue<std::pair<LogContextPtr, Logger *> > _pending;
 };
 
 ///////////////////LogChannel///////////////////
@@ -404,8 +586,11 @@ public:
 //可重置默认值
 extern Logger *g_defaultLogger;
 
+//每个打印点独立的限流器(lambda内的静态变量)
+#define LOG_RATE_LIMITER() ([]() -> ::toolkit::LogRateLimiter * { static ::toolkit::LogRateLimiter s_limiter; return &s_limiter; }())
+
 //用法: DebugL << 1 << "+" << 2 << '=' << 3;
-#define WriteL(level) ::toolkit::LogContextCapture(::toolkit::getLogger(), level, __FILE__, __FUNCTION__, __LINE__)
+#define WriteL(level) ::toolkit::LogContextCapture(::toolkit::getLogger(), level, __FILE__, __FUNCTION__, __LINE__, "", LOG_RATE_LIMITER())
 #define TraceL WriteL(::toolkit::LTrace)
 #define DebugL WriteL(::toolkit::LDebug)
 #define InfoL WriteL(::toolkit::LInfo)
@@ -413,7 +598,7 @@ extern Logger *g_defaultLogger;
 #define ErrorL WriteL(::toolkit::LError)
 
 //只能在虚继承BaseLogFlagInterface的类中使用
-#define WriteF(level) ::toolkit::LogContextCapture(::toolkit::getLogger(), level, __FILE__, __FUNCTION__, __LINE__, getLogFlag())
+#define WriteF(level) ::toolkit::LogContextCapture(::toolkit::getLogger(), level, __FILE__, __FUNCTION__, __LINE__, getLogFlag(), LOG_RATE_LIMITER())
 #define TraceF WriteF(::toolkit::LTrace)
 #define DebugF WriteF(::toolkit::LDebug)
 #define InfoF WriteF(::toolkit::LInfo)
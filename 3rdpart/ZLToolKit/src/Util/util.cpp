@@ -453,9 +453,11 @@ static string limitString(const char *name, size_t max_size) {
 void setThreadName(const char *name) {
     assert(name);
 #if defined(__linux) || defined(__linux__) || defined(__MINGW32__)
-    pthread_setname_np(pthread_self(), limitString(name, 16).data());
+    thread_name = limitString(name, 16);
+    pthread_setname_np(pthread_self(), thread_name.data());
 #elif defined(__MACH__) || defined(__APPLE__)
-    pthread_setname_np(limitString(name, 32).data());
+    thread_name = limitString(name, 32);
+    pthread_setname_np(thread_name.data());
 #elif defined(_MSC_VER)
     // SetThreadDescription was added in 1607 (aka RS1). Since we can't guarantee the user is running 1607 or later, we need to ask for the function from the kernel.
     using SetThreadDescriptionFunc = HRESULT(WINAPI * )(_In_ HANDLE hThread, _In_ PCWSTR lpThreadDescription);
@@ -501,6 +503,10 @@ void setThreadName(const char *name) {
 }
 
 string getThreadName() {
+    if (!thread_name.empty()) {
+        //通过setThreadName设置过线程名，直接返回缓存，避免每条日志都调用系统接口
+        return thread_name;
+    }
 #if ((defined(__linux) || defined(__linux__)) && !defined(ANDROID)) || (defined(__MACH__) || defined(__APPLE__)) || (defined(ANDROID) && __ANDROID_API__ >= 26) || defined(__MINGW32__)
     string ret;
     ret.resize(32);
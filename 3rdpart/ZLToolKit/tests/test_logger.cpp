@@ -88,6 +88,17 @@ int main() {
     toolkit::SockException ex((ErrCode)1, "test");
     DebugL << "sock exception: " << ex;
 
+    //格式控制符与基础类型一样推迟到日志线程格式化
+    InfoL << "hex: " << hex << 255 << ", dec: " << dec << 255;
+
+    //日志限流：每个打印点每秒最多输出10条，超出部分丢弃，日志线程每秒汇总提示丢弃条数(错误日志不限流)
+    LogRateLimiter::setMaxPerSecond(10);
+    for (int i = 0; i < 100; ++i) {
+        WarnL << "rate limited log: " << i;
+    }
+    this_thread::sleep_for(chrono::milliseconds(1500));
+    LogRateLimiter::setMaxPerSecond(0);
+
     InfoL << "done!";
     return 0;
 }
@@ -0,0 +1,72 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <csignal>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <iostream>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Poller/EventPoller.h"
+
+using namespace std;
+using namespace toolkit;
+
+/**
+ * EventPoller跨线程切换任务性能测试
+ * 多个生产者线程同时往同一个EventPoller投递任务，统计每秒执行任务数
+ * 用法: test_pollerAsyncBenchmark [生产者线程数] [每个线程投递任务数]
+ */
+int main(int argc, char *argv[]) {
+    signal(SIGINT, [](int) {
+        exit(0);
+    });
+    //初始化日志系统
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    int thread_count = argc > 1 ? atoi(argv[1]) : 4;
+    uint64_t task_count = argc > 2 ? atoll(argv[2]) : 1000 * 10000 / thread_count;
+    uint64_t total = task_count * thread_count;
+
+    EventPollerPool::setPoolSize(1);
+    auto poller = EventPollerPool::Instance().getPoller(false);
+
+    //只在poller线程中修改，但是主线程需要读取
+    atomic<uint64_t> count(0);
+    Ticker ticker;
+    vector<std::thread> producers;
+    for (int i = 0; i < thread_count; ++i) {
+        producers.emplace_back([&]() {
+            for (uint64_t j = 0; j < task_count; ++j) {
+                poller->async([&]() {
+                    if (count.fetch_add(1, memory_order_relaxed) + 1 == total) {
+                        InfoL << "执行" << total << "个跨线程任务总共耗时:" << ticker.elapsedTime() << "ms";
+                    }
+                }, false);
+            }
+        });
+    }
+
+    uint64_t last_count = 0, now_count;
+    while (true) {
+        sleep(1);
+        now_count = count.load();
+        InfoL << "每秒执行跨线程任务数:" << now_count - last_count;
+        if (now_count == total) {
+            break;
+        }
+        last_count = now_count;
+    }
+    for (auto &producer : producers) {
+        producer.join();
+    }
+    return 0;
+}
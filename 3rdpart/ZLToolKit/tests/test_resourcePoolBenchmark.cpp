@@ -0,0 +1,236 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <condition_variable>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Util/ResourcePool.h"
+#include "Network/Buffer.h"
+
+using namespace std;
+using namespace toolkit;
+
+//模拟rtp包等循环使用的对象，统计new的次数以计算复用率
+class Packet {
+public:
+    Packet() { ++s_created; }
+    char data[256];
+    static atomic<uint64_t> s_created;
+};
+
+atomic<uint64_t> Packet::s_created { 0 };
+
+//原先基于atomic_flag的实现，作为对照：抢锁失败时直接new/delete
+class FlagPool : public std::enable_shared_from_this<FlagPool> {
+public:
+    ~FlagPool() {
+        for (auto ptr : _objs) {
+            delete ptr;
+        }
+    }
+
+    shared_ptr<Packet> obtain2() {
+        weak_ptr<FlagPool> weak_self = shared_from_this();
+        return shared_ptr<Packet>(getPtr(), [weak_self](Packet *ptr) {
+            auto strong_self = weak_self.lock();
+            if (strong_self) {
+                strong_self->recycle(ptr);
+            } else {
+                delete ptr;
+            }
+        });
+    }
+
+private:
+    Packet *getPtr() {
+        if (_busy.test_and_set()) {
+            return new Packet;
+        }
+        Packet *ptr = nullptr;
+        if (!_objs.empty()) {
+            ptr = _objs.back();
+            _objs.pop_back();
+        }
+        _busy.clear();
+        return ptr ? ptr : new Packet;
+    }
+
+    void recycle(Packet *ptr) {
+        if (_busy.test_and_set()) {
+            delete ptr;
+            return;
+        }
+        if (_objs.size() >= 1024) {
+            delete ptr;
+        } else {
+            _objs.emplace_back(ptr);
+        }
+        _busy.clear();
+    }
+
+private:
+    atomic_flag _busy { false };
+    vector<Packet *> _objs;
+};
+
+//生产者与消费者之间批量传递对象，各方案的传递开销相同
+//限制积压的批次数，模拟发送线程跟得上生产速度的情况
+template <typename T>
+class BatchQueue {
+public:
+    void push(vector<T> batch) {
+        unique_lock<mutex> lck(_mtx);
+        _cond.wait(lck, [&]() { return _batches.size() < 4; });
+        _batches.emplace_back(std::move(batch));
+        _cond.notify_all();
+    }
+
+    bool pop(vector<T> &batch) {
+        unique_lock<mutex> lck(_mtx);
+        _cond.wait(lck, [&]() { return !_batches.empty(); });
+        batch = std::move(_batches.front());
+        _batches.erase(_batches.begin());
+        _cond.notify_all();
+        return !batch.empty();
+    }
+
+private:
+    mutex _mtx;
+    condition_variable _cond;
+    vector<vector<T> > _batches;
+};
+
+/**
+ * 多个线程共用一个循环池，各自在本线程获取与释放
+ */
+template <typename Obtain>
+static void runLocal(const char *name, size_t threads, size_t count, const Obtain &obtain) {
+    Packet::s_created = 0;
+    Ticker ticker;
+    vector<thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&]() {
+            vector<shared_ptr<Packet> > hold(16);
+            for (size_t n = 0; n < count; ++n) {
+                //同时持有少量对象，模拟合并写时的rtp包
+                hold[n % hold.size()] = obtain();
+            }
+        });
+    }
+    for (auto &worker : workers) {
+        worker.join();
+    }
+    auto total = threads * count;
+    InfoL << name << " 本线程获取释放, 线程数:" << threads << ", 次数:" << total << ", 耗时:" << ticker.elapsedTime()
+          << "ms, new次数:" << Packet::s_created << ", 复用率:" << 100.0 * (total - Packet::s_created) / total << "%";
+}
+
+/**
+ * 生产者线程获取对象，交给消费者线程释放(例如解复用线程生成rtp包，发送线程释放)
+ */
+template <typename Obtain>
+static void runCrossThread(const char *name, size_t count, const Obtain &obtain) {
+    Packet::s_created = 0;
+    BatchQueue<shared_ptr<Packet> > queue;
+    Ticker ticker;
+    thread consumer([&]() {
+        vector<shared_ptr<Packet> > batch;
+        while (queue.pop(batch)) {
+            batch.clear();
+        }
+    });
+    vector<shared_ptr<Packet> > batch;
+    for (size_t n = 0; n < count; ++n) {
+        batch.emplace_back(obtain());
+        if (batch.size() == 64) {
+            queue.push(std::move(batch));
+            batch.clear();
+        }
+    }
+    queue.push(std::move(batch));
+    queue.push({});
+    consumer.join();
+    InfoL << name << " 跨线程释放, 次数:" << count << ", 耗时:" << ticker.elapsedTime() << "ms, new次数:" << Packet::s_created
+          << ", 复用率:" << 100.0 * (count - Packet::s_created) / count << "%";
+}
+
+/**
+ * 生产者线程分配BufferRaw，消费者线程释放，统计生产者命中线程缓存的比例
+ */
+static void runBufferArena(size_t count) {
+    auto before = BufferArena::getStatistic();
+    BatchQueue<Buffer::Ptr> queue;
+    Ticker ticker;
+    thread consumer([&]() {
+        vector<Buffer::Ptr> batch;
+        while (queue.pop(batch)) {
+            batch.clear();
+        }
+    });
+    vector<Buffer::Ptr> batch;
+    for (size_t n = 0; n < count; ++n) {
+        auto buffer = BufferRaw::create();
+        buffer->setCapacity(1400);
+        batch.emplace_back(std::move(buffer));
+        if (batch.size() == 64) {
+            queue.push(std::move(batch));
+            batch.clear();
+        }
+    }
+    queue.push(std::move(batch));
+    queue.push({});
+    consumer.join();
+    auto after = BufferArena::getStatistic();
+    auto allocs = after.alloc_count - before.alloc_count;
+    auto hits = after.hit_count - before.hit_count;
+    InfoL << "BufferArena 跨线程释放, 次数:" << count << ", 耗时:" << ticker.elapsedTime() << "ms, 分配:" << allocs
+          << ", 命中缓存:" << hits << ", 命中率:" << (allocs ? 100.0 * hits / allocs : 0) << "%, 归还分配线程:"
+          << after.remote_free_count - before.remote_free_count;
+}
+
+/**
+ * 循环池性能测试，对比new/delete、原先基于atomic_flag的循环池与线程本地缓存的循环池
+ * 用法: test_resourcePoolBenchmark [线程数] [每线程次数]
+ */
+int main(int argc, char *argv[]) {
+    //初始化日志系统
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    size_t threads = argc > 1 ? atoi(argv[1]) : 4;
+    size_t count = argc > 2 ? atoi(argv[2]) : 2000000;
+
+    runLocal("new/delete", threads, count, []() { return shared_ptr<Packet>(new Packet); });
+    {
+        auto pool = std::make_shared<FlagPool>();
+        runLocal("atomic_flag循环池", threads, count, [&]() { return pool->obtain2(); });
+    }
+    {
+        ResourcePool<Packet> pool;
+        pool.setSize(1024);
+        runLocal("线程缓存循环池", threads, count, [&]() { return pool.obtain2(); });
+    }
+
+    runCrossThread("new/delete", count, []() { return shared_ptr<Packet>(new Packet); });
+    {
+        auto pool = std::make_shared<FlagPool>();
+        runCrossThread("atomic_flag循环池", count, [&]() { return pool->obtain2(); });
+    }
+    {
+        ResourcePool<Packet> pool;
+        pool.setSize(1024);
+        runCrossThread("线程缓存循环池", count, [&]() { return pool.obtain2(); });
+    }
+
+    runBufferArena(count);
+    return 0;
+}
@@ -0,0 +1,122 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <set>
+#include <random>
+#include <iostream>
+#include "Util/logger.h"
+#include "Poller/TimingWheel.h"
+
+using namespace std;
+using namespace toolkit;
+
+using DelayTask = TimingWheel::Task;
+
+static int s_failed = 0;
+
+#define CHECK(exp) \
+    do { \
+        if (!(exp)) { \
+            ErrorL << "check failed: " << #exp; \
+            ++s_failed; \
+        } \
+    } while (0)
+
+/**
+ * 高层槽位与当前位置相同时，该槽位属于下一轮，nextExpireTime不能返回过去的时间
+ */
+static void testSameSlotNextRound() {
+    uint64_t now = 0x10FE;
+    TimingWheel wheel(now);
+    uint64_t fired = 0;
+    //与当前时间相差0xFF52，落在第1层的0x10号槽位，与当前第1层位置相同
+    uint64_t expire = 0x11050;
+    wheel.add(expire, std::make_shared<DelayTask>([&]() -> uint64_t {
+        fired = now;
+        return 0;
+    }));
+    wheel.flush(now);
+    auto next = wheel.nextExpireTime();
+    CHECK(next > now);
+    CHECK(next <= expire);
+
+    //按nextExpireTime逐步推进，任务须恰好在到期时刻执行
+    while (!wheel.empty()) {
+        next = wheel.nextExpireTime();
+        CHECK(next >= now);
+        if (next < now) {
+            break;
+        }
+        now = next;
+        wheel.flush(now);
+    }
+    CHECK(fired == expire);
+}
+
+/**
+ * 随机时间点插入不同量级的定时器，校验nextExpireTime不晚于最早的任务且不早于当前时间，以及每个任务的执行时刻
+ */
+static void testRandom() {
+    mt19937_64 rng(0);
+    uint64_t now = rng() % (1ULL << 32);
+    TimingWheel wheel(now);
+    multiset<uint64_t> pending;
+    size_t mismatch = 0;
+    //按nextExpireTime逐个到期时刻推进到target
+    auto advance = [&](uint64_t target) {
+        while (!wheel.empty()) {
+            auto next = wheel.nextExpireTime();
+            CHECK(next >= now);
+            CHECK(next <= *pending.begin());
+            if (next < now || next > *pending.begin() || next > target) {
+                break;
+            }
+            now = next;
+            wheel.flush(now);
+        }
+        if (target != UINT64_MAX && target > now) {
+            now = target;
+            wheel.flush(now);
+        }
+    };
+    for (int i = 0; i < 2000; ++i) {
+        //1ms ~ 2^24ms
+        uint64_t expire = now + 1 + (rng() % (1ULL << (1 + rng() % 24)));
+        pending.emplace(expire);
+        wheel.add(expire, std::make_shared<DelayTask>([&, expire]() -> uint64_t {
+            if (expire != now) {
+                ++mismatch;
+            }
+            pending.erase(pending.find(expire));
+            return 0;
+        }));
+        //偶尔推进时间，使当前位置落在各层的不同槽位
+        if (rng() % 4 == 0) {
+            advance(now + rng() % 1024);
+        }
+    }
+    advance(UINT64_MAX);
+    CHECK(pending.empty());
+    CHECK(mismatch == 0);
+}
+
+int main(int argc, char *argv[]) {
+    //初始化日志系统
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    testSameSlotNextRound();
+    testRandom();
+    if (s_failed) {
+        ErrorL << "timing wheel test failed: " << s_failed;
+        return -1;
+    }
+    InfoL << "timing wheel test passed";
+    return 0;
+}
@@ -0,0 +1,98 @@
+﻿/*
+ * Copyright (c) 2016 The ZLToolKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLToolKit(https://github.com/ZLMediaKit/ZLToolKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <map>
+#include <random>
+#include <iostream>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Poller/TimingWheel.h"
+
+using namespace std;
+using namespace toolkit;
+
+using DelayTask = TimingWheel::Task;
+
+/**
+ * 生成可重复的定时任务，周期为1~100ms(与rtcp、心跳、srt ack等定时器量级相当)
+ * 每20个任务中有1个在执行若干次后被取消，模拟会话断开
+ */
+static vector<DelayTask::Ptr> makeTasks(size_t count, uint64_t &executed) {
+    vector<DelayTask::Ptr> ret;
+    mt19937 rng(0);
+    for (size_t i = 0; i < count; ++i) {
+        uint64_t interval = 1 + rng() % 100;
+        bool cancel = i % 20 == 0;
+        auto times = make_shared<int>(0);
+        ret.emplace_back(std::make_shared<DelayTask>([interval, cancel, times, &executed]() -> uint64_t {
+            ++executed;
+            if (cancel && ++(*times) >= 10) {
+                return 0;
+            }
+            return interval;
+        }));
+    }
+    return ret;
+}
+
+//原先基于multimap的实现，作为对照
+static void runMultimap(size_t count, uint64_t duration) {
+    uint64_t executed = 0;
+    auto tasks = makeTasks(count, executed);
+    multimap<uint64_t, DelayTask::Ptr> task_map;
+    Ticker ticker;
+    for (auto &task : tasks) {
+        task_map.emplace(1, task);
+    }
+    for (uint64_t now = 1; now <= duration; ++now) {
+        decltype(task_map) task_copy;
+        task_copy.swap(task_map);
+        for (auto it = task_copy.begin(); it != task_copy.end() && it->first <= now; it = task_copy.erase(it)) {
+            auto next_delay = (*(it->second))();
+            if (next_delay) {
+                task_map.emplace(next_delay + now, std::move(it->second));
+            }
+        }
+        task_copy.insert(task_map.begin(), task_map.end());
+        task_copy.swap(task_map);
+    }
+    InfoL << "multimap: " << count << "个定时器运行" << duration << "ms(模拟时间), 执行次数:" << executed
+          << ", 耗时:" << ticker.elapsedTime() << "ms";
+}
+
+static void runTimingWheel(size_t count, uint64_t duration) {
+    uint64_t executed = 0;
+    auto tasks = makeTasks(count, executed);
+    TimingWheel wheel(0);
+    Ticker ticker;
+    for (auto &task : tasks) {
+        wheel.add(1, task);
+    }
+    for (uint64_t now = 1; now <= duration; ++now) {
+        wheel.flush(now);
+    }
+    InfoL << "timing wheel: " << count << "个定时器运行" << duration << "ms(模拟时间), 执行次数:" << executed
+          << ", 耗时:" << ticker.elapsedTime() << "ms";
+}
+
+/**
+ * 定时器性能测试，对比时间轮与multimap
+ * 用法: test_timingWheelBenchmark [定时器个数] [模拟时长(毫秒)]
+ */
+int main(int argc, char *argv[]) {
+    //初始化日志系统
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    size_t count = argc > 1 ? atoi(argv[1]) : 100000;
+    uint64_t duration = argc > 2 ? atoll(argv[2]) : 10 * 1000;
+    runMultimap(count, duration);
+    runTimingWheel(count, duration);
+    return 0;
+}
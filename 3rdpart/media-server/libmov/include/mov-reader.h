@@ -27,6 +27,14 @@ int mov_reader_getinfo(mov_reader_t* mov, struct mov_reader_trackinfo_t *ontrack
 
 uint64_t mov_reader_getduration(mov_reader_t* mov);
 
+/// @param[in] offset sample offset in file
+/// @param[in] pts/dts sample timestamp in ms
+/// @param[in] flags MOV_AV_FLAG_xxx, such as: MOV_AV_FLAG_KEYFREAME
+typedef void (*mov_reader_onsample)(void* param, uint32_t track, uint64_t offset, size_t bytes, int64_t pts, int64_t dts, int flags);
+/// enumerate the sample table of all tracks, track by track
+/// @return 0-ok, other-error(sample table not complete, e.g. fmp4 with MOV_READER_FLAG_FMP4_FAST)
+int mov_reader_getsamples(mov_reader_t* mov, mov_reader_onsample onsample, void* param);
+
 /// audio: AAC raw data, don't include ADTS/AudioSpecificConfig
 /// video: 4-byte data length(don't include self length) + H.264 NALU(don't include 0x00000001)
 /// @param[in] flags MOV_AV_FLAG_xxx, such as: MOV_AV_FLAG_KEYFREAME
@@ -74,6 +74,19 @@ int ps_muxer_add_stream(struct ps_muxer_t* muxer, int codecid, const void* extra
 /// @return 0-ok, ENOMEM-alloc failed, <0-error
 int ps_muxer_input(struct ps_muxer_t* muxer, int stream, int flags, int64_t pts, int64_t dts, const void* data, size_t bytes);
 
+/// callback on PS packet segment
+/// @param[in] param user-defined parameter(by ps_muxer_input_v)
+/// @param[in] data pack_header/system_header/psm/PES header(valid in callback only), or ES payload(point to ps_muxer_input_v data)
+/// @param[in] bytes segment size in byte
+/// @param[in] payload 0-header, 1-ES payload
+/// @return 0-ok, other-error
+typedef int (*ps_muxer_onsegment)(void* param, const void* data, size_t bytes, int payload);
+
+/// input ES, same as ps_muxer_input, but output PS packet as header/payload segments without alloc/copy
+/// the concatenation of all segments equals to the ps_muxer_input output packet
+/// @return 0-ok, <0-error, other-onsegment return value
+int ps_muxer_input_v(struct ps_muxer_t* muxer, int stream, int flags, int64_t pts, int64_t dts, const void* data, size_t bytes, ps_muxer_onsegment onsegment, void* param);
+
 
 /// @param[in] codecid 0-unknown, other-enum EPSI_STREAM_TYPE, see more @mpeg-ts-proto.h
 /// @return 0-ok, other-error
@@ -184,6 +184,116 @@ int ps_muxer_input(struct ps_muxer_t* ps, int streamid, int flags, int64_t pts,
 	return r;
 }
 
+int ps_muxer_input_v(struct ps_muxer_t* ps, int streamid, int flags, int64_t pts, int64_t dts, const void* data, size_t bytes, ps_muxer_onsegment onsegment, void* param)
+{
+	int r, first;
+	size_t i, n;
+	uint8_t *p, *pes;
+	struct pes_t* stream;
+	const uint8_t* payload;
+	uint8_t header[MAX_PES_HEADER + 64];
+
+	i = 0;
+	first = 1;
+	payload = (const uint8_t*)data;
+
+	stream = ps_stream_find(ps, streamid);
+	if (NULL == stream) return -1; // not found
+	stream->data_alignment_indicator = (flags & MPEG_FLAG_IDR_FRAME) ? 1 : 0; // idr frame
+	stream->pts = pts;
+	stream->dts = dts;
+
+	// Add PSM for IDR frame
+	ps->psm_period = ((flags & MPEG_FLAG_IDR_FRAME) && mpeg_stream_type_video(stream->codecid)) ? 0 : ps->psm_period;
+	ps->h26x_with_aud = (flags & MPEG_FLAG_H264_H265_WITH_AUD) ? 1 : 0;
+
+	// write pack_header(p74), same as ps_muxer_input
+	ps->pack.system_clock_reference_base = dts >= 3600 ? (dts - 3600) : 0;
+	ps->pack.system_clock_reference_extension = 0;
+	ps->pack.program_mux_rate = 6106;
+	i += pack_header_write(&ps->pack, header + i);
+
+#if !defined(MPEG_FIX_VLC_3_X_PS_SYSTEM_HEADER)
+	// write system_header(p76)
+	if(0 == (ps->psm_period % 30))
+		i += system_header_write(&ps->system, header + i);
+#endif
+
+	// write program_stream_map(p79)
+	if (0 == (ps->psm_period % 30))
+	{
+#if defined(MPEG_CLOCK_EXTENSION_DESCRIPTOR)
+		ps->psm.clock = time(NULL) * 1000; // todo: gettimeofday
+#endif
+		i += psm_write(&ps->psm, header + i);
+	}
+
+	// check packet size
+	assert(i < MAX_PES_HEADER);
+
+	r = 0 == bytes ? onsegment(param, header, i, 0) : 0;
+
+	// write data, pes header to local buffer, payload by reference
+	while(bytes > 0 && 0 == r)
+	{
+		pes = header + i;
+		p = pes + pes_write_header(stream, pes, sizeof(header) - i);
+		stream->pts = stream->dts = PTS_NO_VALUE; // clear pts/dts flags
+		stream->data_alignment_indicator = 0; // clear flags
+		assert(p - pes < 64);
+
+		if(first)
+		{
+			if (PSI_STREAM_H264 == stream->codecid && !ps->h26x_with_aud)
+			{
+				nbo_w32(p, 0x00000001);
+				p[4] = 0x09; // AUD
+				p[5] = 0xE0; // any slice type (0xe) + rbsp stop one bit
+				p += 6;
+			}
+			else if (PSI_STREAM_H265 == stream->codecid && !ps->h26x_with_aud)
+			{
+				nbo_w32(p, 0x00000001);
+				p[4] = 0x46; // 35-AUD_NUT
+				p[5] = 0x01;
+				p[6] = 0x50; // B&P&I (0x2) + rbsp stop one bit
+				p += 7;
+			}
+			else if (PSI_STREAM_H266 == stream->codecid && !ps->h26x_with_aud)
+			{
+				nbo_w32(p, 0x00000001);
+				p[4] = 0x00; // 20-AUD_NUT
+				p[5] = 0xA1;
+				p[6] = 0x18; // B&P&I (0x1) + rbsp stop one bit
+				p += 7;
+			}
+		}
+
+		if((p - pes - 6) + bytes > MAX_PES_PACKET)
+		{
+			nbo_w16(pes + 4, MAX_PES_PACKET);
+			n = MAX_PES_PACKET - (p - pes - 6);
+		}
+		else
+		{
+			nbo_w16(pes + 4, (uint16_t)((p - pes - 6) + bytes));
+			n = bytes;
+		}
+
+		r = onsegment(param, header, p - header, 0);
+		if (0 == r)
+			r = onsegment(param, payload, n, 1);
+		payload += n;
+		bytes -= n;
+
+		i = 0; // the next pes packet don't need pack_header
+		first = 0; // clear first packet flag
+	}
+
+	++ps->psm_period;
+	return r;
+}
+
 struct ps_muxer_t* ps_muxer_create(const struct ps_muxer_func_t *func, void* param)
 {
 	struct ps_muxer_t *ps = NULL;
@@ -23,6 +23,8 @@
 #endif //ENABLE_MYSQL
 #include "Common/config.h"
 #include "Common/MediaSource.h"
+#include "Common/IngestProfiler.h"
+#include "Common/SyntheticSource.h"
 #include "Http/HttpRequester.h"
 #include "Http/HttpSession.h"
 #include "Network/TcpServer.h"
@@ -34,6 +36,9 @@
 #include "WebHook.h"
 #include "Thread/WorkThreadPool.h"
 #include "Rtp/RtpSelector.h"
+#include "Rtsp/RtpMultiCaster.h"
+#include "TS/TSUdpPusher.h"
+#include "Record/RecordCatalog.h"
 #include "FFmpegSource.h"
 #if defined(ENABLE_RTPPROXY)
 #include "Rtp/RtpServer.h"
@@ -298,6 +303,9 @@ static recursive_mutex s_proxyPusherMapMtx;
 static unordered_map<string, FFmpegSource::Ptr> s_ffmpegMap;
 static recursive_mutex s_ffmpegMapMtx;
 
+static unordered_map<string, SyntheticSource::Ptr> s_syntheticMap;
+static recursive_mutex s_syntheticMapMtx;
+
 #if defined(ENABLE_RTPPROXY)
 //rtp服务器列表
 static unordered_map<string, RtpServer::Ptr> s_rtpServerMap;
@@ -406,8 +414,14 @@ uint16_t openRtpServer(uint16_t local_port, const string &stream_id, int tcp_mod
         return 0;
     }
 
+    GET_CONFIG(uint16_t, shared_port, RtpProxy::kPort);
     RtpServer::Ptr server = std::make_shared<RtpServer>();
-    server->start(local_port, stream_id, (RtpServer::TcpMode)tcp_mode, local_ip.c_str(), re_use_port, ssrc, only_audio);
+    if (local_port && local_port == shared_port) {
+        //指定公共rtp端口时为单端口复用模式，根据ssrc区分流，不再为每个流创建独立的socket
+        server->startShared(stream_id, (RtpServer::TcpMode)tcp_mode, ssrc, only_audio);
+    } else {
+        server->start(local_port, stream_id, (RtpServer::TcpMode)tcp_mode, local_ip.c_str(), re_use_port, ssrc, only_audio);
+    }
     server->setOnDetach([stream_id]() {
         //设置rtp超时移除事件
         lock_guard<recursive_mutex> lck(s_rtpServerMapMtx);
@@ -462,8 +476,58 @@ void getStatisticJson(const function<void(Value &val)> &cb) {
     val["BufferRaw"] = (Json::UInt64)(ObjectStatistic<BufferRaw>::count());
     val["BufferLikeString"] = (Json::UInt64)(ObjectStatistic<BufferLikeString>::count());
     val["BufferList"] = (Json::UInt64)(ObjectStatistic<BufferList>::count());
+    {
+        auto arena = BufferArena::getStatistic();
+        auto &obj = val["BufferArena"];
+        obj["allocCount"] = (Json::UInt64) arena.alloc_count;
+        obj["hitCount"] = (Json::UInt64) arena.hit_count;
+        obj["largeAllocCount"] = (Json::UInt64) arena.large_alloc_count;
+        obj["remoteFreeCount"] = (Json::UInt64) arena.remote_free_count;
+        obj["cachedBlocks"] = (Json::UInt64) arena.cached_blocks;
+        obj["cachedBytes"] = (Json::UInt64) arena.cached_bytes;
+        obj["usedBytes"] = (Json::UInt64) arena.used_bytes;
+    }
 
     val["RtpPacket"] = (Json::UInt64)(ObjectStatistic<RtpPacket>::count());
+    val["RtpMultiCaster"] = Json::arrayValue;
+    for (auto &stat : RtpMultiCaster::getStatistic()) {
+        Value item;
+        item["multicast_ip"] = stat.multicast_ip;
+        item["local_ip"] = stat.local_ip;
+        item["vhost"] = stat.vhost;
+        item["app"] = stat.app;
+        item["stream"] = stat.stream;
+        for (auto type : { TrackVideo, TrackAudio }) {
+            auto &track = stat.track[type];
+            auto &obj = item[getTrackString(type)];
+            obj["port"] = track.port;
+            obj["packets"] = (Json::UInt64) track.packets;
+            obj["bytes"] = (Json::UInt64) track.bytes;
+            obj["sendFailed"] = (Json::UInt64) track.send_failed;
+            obj["bytesSpeed"] = track.bytes_speed;
+        }
+        val["RtpMultiCaster"].append(item);
+    }
+    val["TSUdpPusher"] = Json::arrayValue;
+    for (auto &stat : TSUdpPusher::getStatistic()) {
+        Value item;
+        item["url"] = stat.url;
+        item["vhost"] = stat.vhost;
+        item["app"] = stat.app;
+        item["stream"] = stat.stream;
+        item["bitrate"] = (Json::UInt64) stat.bitrate;
+        item["datagrams"] = (Json::UInt64) stat.datagrams;
+        item["bytes"] = (Json::UInt64) stat.bytes;
+        item["tsPackets"] = (Json::UInt64) stat.ts_packets;
+        item["nullPackets"] = (Json::UInt64) stat.null_packets;
+        item["sendFailed"] = (Json::UInt64) stat.send_failed;
+        item["latePackets"] = (Json::UInt64) stat.late_packets;
+        item["droppedPackets"] = (Json::UInt64) stat.dropped_packets;
+        item["pcrJitterUs"] = (Json::Int64) stat.pcr_jitter_us;
+        item["pcrJitterMaxUs"] = (Json::Int64) stat.pcr_jitter_max_us;
+        item["queueMS"] = (Json::Int64) stat.queue_ms;
+        val["TSUdpPusher"].append(item);
+    }
     val["RtmpPacket"] = (Json::UInt64)(ObjectStatistic<RtmpPacket>::count());
 #ifdef ENABLE_MEM_DEBUG
     auto bytes = getTotalMemUsage();
@@ -937,6 +1001,7 @@ void installWebApi() {
                                           int retry_count,
                                           int rtp_type,
                                           float timeout_sec,
+                                          uint64_t ts_bitrate,
                                           const function<void(const SockException &ex, const string &key)> &cb) {
         auto key = getPusherKey(schema, vhost, app, stream, url);
         auto src = MediaSource::find(schema, vhost, app, stream);
@@ -963,6 +1028,11 @@ void installWebApi() {
             (*pusher)[Client::kTimeoutMS] = timeout_sec * 1000;
         }
 
+        if (ts_bitrate) {
+            //mpeg-ts over udp/rtp推流的恒定码率(udp://、rtp://推流有效)
+            (*pusher)[Client::kTsBitrate] = ts_bitrate;
+        }
+
         //开始推流，如果推流失败或者推流中止，将会自动重试若干次，默认一直重试
         pusher->setPushCallbackOnce([cb, key, url](const SockException &ex) {
             if (ex) {
@@ -982,7 +1052,7 @@ void installWebApi() {
         pusher->publish(url);
     };
 
-    //动态添加rtsp/rtmp推流代理
+    //动态添加rtsp/rtmp推流代理，也支持udp://、rtp://的mpeg-ts推流(schema=ts)，可通过ts_bitrate参数指定恒定码率
     //测试url http://127.0.0.1/index/api/addStreamPusherProxy?schema=rtmp&vhost=__defaultVhost__&app=proxy&stream=0&dst_url=rtmp://127.0.0.1/live/obs
     api_regist("/index/api/addStreamPusherProxy", [](API_ARGS_MAP_ASYNC) {
         CHECK_SECRET();
@@ -997,6 +1067,7 @@ void installWebApi() {
                              retry_count,
                              allArgs["rtp_type"],
                              allArgs["timeout_sec"],
+                             allArgs["ts_bitrate"],
                              [invoker, val, headerOut, dst_url](const SockException &ex, const string &key) mutable {
                                  if (ex) {
                                      val["code"] = API::OtherFailed;
@@ -1054,6 +1125,76 @@ void installWebApi() {
         val["data"]["flag"] = s_proxyMap.erase(allArgs["key"]) == 1;
     });
 
+    //添加合成媒体源(不需要编码器与媒体文件)，用于压测转发性能；count大于1时流id为stream_0 ~ stream_{count-1}
+    //video_codec/audio_codec为none时不生成该轨道，也可以通过close_streams接口批量关闭
+    //video_codec只支持H264
+    //测试url http://127.0.0.1/index/api/addSyntheticSource?vhost=__defaultVhost__&app=bench&stream=test&count=100&video_codec=H264&width=1280&height=720&fps=25&bitrate=2000&gop=50&b_frames=0&audio_codec=AAC
+    api_regist("/index/api/addSyntheticSource",[](API_ARGS_MAP){
+        CHECK_SECRET();
+        CHECK_ARGS("vhost","app","stream");
+
+        auto video_codec = allArgs["video_codec"].empty() ? string("H264") : allArgs["video_codec"];
+        auto audio_codec = allArgs["audio_codec"].empty() ? string("AAC") : allArgs["audio_codec"];
+        VideoInfo video;
+        video.codecId = getCodecId(video_codec);
+        video.iWidth = allArgs["width"].empty() ? 1280 : allArgs["width"].as<int>();
+        video.iHeight = allArgs["height"].empty() ? 720 : allArgs["height"].as<int>();
+        video.iFrameRate = allArgs["fps"].empty() ? 25 : allArgs["fps"].as<float>();
+        //单位kbit/s
+        video.iBitRate = (allArgs["bitrate"].empty() ? 2000 : allArgs["bitrate"].as<int>()) * 1000;
+        auto gop = allArgs["gop"].empty() ? (int) (video.iFrameRate * 2) : allArgs["gop"].as<int>();
+        auto b_frames = allArgs["b_frames"].as<int>();
+
+        AudioInfo audio;
+        audio.codecId = !strcasecmp(audio_codec.data(), "aac") ? CodecAAC : getCodecId(audio_codec);
+        audio.iSampleRate = allArgs["sample_rate"].empty() ? 44100 : allArgs["sample_rate"].as<int>();
+        audio.iChannel = allArgs["channels"].empty() ? 2 : allArgs["channels"].as<int>();
+        audio.iSampleBit = 16;
+
+        bool have_video = strcasecmp(video_codec.data(), "none") != 0;
+        bool have_audio = strcasecmp(audio_codec.data(), "none") != 0;
+        if (have_video && video.codecId != CodecH264) {
+            throw InvalidArgsException("video_codec只支持H264");
+        }
+        auto count = allArgs["count"].empty() ? 1 : allArgs["count"].as<int>();
+        if (count <= 0 || (!have_video && !have_audio)) {
+            throw InvalidArgsException("count必须大于0且至少包含一个轨道");
+        }
+
+        ProtocolOption option(allArgs);
+        val["data"]["key"] = Json::arrayValue;
+        for (int i = 0; i < count; ++i) {
+            auto stream = count > 1 ? allArgs["stream"] + "_" + to_string(i) : allArgs["stream"];
+            auto key = getProxyKey(allArgs["vhost"], allArgs["app"], stream);
+            lock_guard<recursive_mutex> lck(s_syntheticMapMtx);
+            if (s_syntheticMap.find(key) == s_syntheticMap.end()) {
+                auto source = std::make_shared<SyntheticSource>(allArgs["vhost"], allArgs["app"], stream, option);
+                if (have_video && !source->initVideo(video, gop, b_frames)) {
+                    throw InvalidArgsException("视频参数不合法");
+                }
+                if (have_audio && !source->initAudio(audio)) {
+                    throw InvalidArgsException("音频参数不合法");
+                }
+                source->setOnClose([key]() {
+                    lock_guard<recursive_mutex> lck(s_syntheticMapMtx);
+                    s_syntheticMap.erase(key);
+                });
+                source->start();
+                s_syntheticMap[key] = source;
+            }
+            val["data"]["key"].append(key);
+        }
+    });
+
+    //关闭合成媒体源
+    //测试url http://127.0.0.1/index/api/delSyntheticSource?key=__defaultVhost__/bench/test
+    api_regist("/index/api/delSyntheticSource",[](API_ARGS_MAP){
+        CHECK_SECRET();
+        CHECK_ARGS("key");
+        lock_guard<recursive_mutex> lck(s_syntheticMapMtx);
+        val["data"]["flag"] = s_syntheticMap.erase(allArgs["key"]) == 1;
+    });
+
     static auto addFFmpegSource = [](const string &ffmpeg_cmd_key,
                                      const string &src_url,
                                      const string &dst_url,
@@ -1427,36 +1568,45 @@ void installWebApi() {
 
     //获取录像文件夹列表或mp4文件列表
     //http://127.0.0.1/index/api/getMp4RecordFile?vhost=__defaultVhost__&app=live&stream=ss&period=2020-01
+    //按时间段查询录像文件(GMT标准时间，单位秒)
+    //http://127.0.0.1/index/api/getMp4RecordFile?vhost=__defaultVhost__&app=live&stream=ss&start_time=1682902800&end_time=1682931600
     api_regist("/index/api/getMp4RecordFile", [](API_ARGS_MAP){
         CHECK_SECRET();
         CHECK_ARGS("vhost", "app", "stream");
         auto record_path = Recorder::getRecordPath(Recorder::type_mp4, allArgs["vhost"], allArgs["app"], allArgs["stream"], allArgs["customized_path"]);
         auto period = allArgs["period"];
 
+        if (!allArgs["start_time"].empty() && !allArgs["end_time"].empty()) {
+            Json::Value files(arrayValue);
+            for (auto &item : RecordCatalog::Instance().getRecords(record_path, allArgs["start_time"].as<time_t>(), allArgs["end_time"].as<time_t>())) {
+                Json::Value obj;
+                obj["file_name"] = item.file_name;
+                obj["start_time"] = (Json::Int64)item.start_time;
+                obj["time_len"] = item.time_len;
+                obj["file_size"] = (Json::UInt64)item.file_size;
+                obj["index_offset"] = (Json::UInt64)item.index_offset;
+                files.append(obj);
+            }
+            val["data"]["rootPath"] = record_path;
+            val["data"]["files"] = files;
+            return;
+        }
+
         //判断是获取mp4文件列表还是获取文件夹列表
         bool search_mp4 = period.size() == sizeof("2020-02-01") - 1;
+        Json::Value paths(arrayValue);
+        //从录像目录查询，不再遍历磁盘
         if (search_mp4) {
+            for (auto &item : RecordCatalog::Instance().getRecords(record_path, period)) {
+                paths.append(item.file_name.substr(item.file_name.rfind('/') + 1));
+            }
             record_path = record_path + period + "/";
-        }
-
-        Json::Value paths(arrayValue);
-        //这是筛选日期，获取文件夹列表
-        File::scanDir(record_path, [&](const string &path, bool isDir) {
-            auto pos = path.rfind('/');
-            if (pos != string::npos) {
-                string relative_path = path.substr(pos + 1);
-                if (search_mp4) {
-                    if (!isDir) {
-                        //我们只收集mp4文件，对文件夹不感兴趣
-                        paths.append(relative_path);
-                    }
-                } else if (isDir && relative_path.find(period) == 0) {
-                    //匹配到对应日期的文件夹
-                    paths.append(relative_path);
-                }
+        } else {
+            //这是筛选日期，获取文件夹列表
+            for (auto &date : RecordCatalog::Instance().getDates(record_path, period)) {
+                paths.append(date);
             }
-            return true;
-        }, false);
+        }
 
         val["data"]["rootPath"] = record_path;
         val["data"]["paths"] = paths;
@@ -1560,6 +1710,40 @@ void installWebApi() {
         });
     });
 
+    //获取直播流输入链路各阶段延时统计(需开启general.enable_profiler)，单位微秒
+    //测试url http://127.0.0.1/index/api/getIngestProfile?vhost=__defaultVhost__&app=live&stream=obs
+    api_regist("/index/api/getIngestProfile",[](API_ARGS_MAP){
+        CHECK_SECRET();
+        val["data"] = Json::arrayValue;
+        for (auto &stat : IngestProfiler::getStatistic()) {
+            if ((!allArgs["vhost"].empty() && allArgs["vhost"] != stat.vhost) ||
+                (!allArgs["app"].empty() && allArgs["app"] != stat.app) ||
+                (!allArgs["stream"].empty() && allArgs["stream"] != stat.stream)) {
+                continue;
+            }
+            Value item;
+            item["vhost"] = stat.vhost;
+            item["app"] = stat.app;
+            item["stream"] = stat.stream;
+            item["protocol"] = stat.protocol;
+            for (int i = 0; i < IngestProfiler::kStageMax; ++i) {
+                auto &stage = stat.stages[i];
+                if (!stage.count) {
+                    continue;
+                }
+                auto &obj = item["stages"][IngestProfiler::getStageName((IngestProfiler::Stage)i)];
+                obj["count"] = (Json::UInt64) stage.count;
+                obj["mean"] = (Json::UInt64) stage.mean;
+                obj["p50"] = (Json::UInt64) stage.p50;
+                obj["p90"] = (Json::UInt64) stage.p90;
+                obj["p99"] = (Json::UInt64) stage.p99;
+                obj["p999"] = (Json::UInt64) stage.p999;
+                obj["max"] = (Json::UInt64) stage.max;
+            }
+            val["data"].append(item);
+        }
+    });
+
 #ifdef ENABLE_WEBRTC
     class WebRtcArgsImp : public WebRtcArgs {
     public:
@@ -1729,6 +1913,7 @@ void installWebApi() {
 
         ProtocolOption option;
         option.enable_hls = allArgs["schema"] == HLS_SCHEMA;
+        option.enable_dash = allArgs["schema"] == DASH_SCHEMA;
         option.enable_mp4 = false;
 
         //通过内置支持的rtsp/rtmp按需拉流
@@ -1819,6 +2004,11 @@ void unInstallWebApi(){
         s_ffmpegMap.clear();
     }
 
+    {
+        lock_guard<recursive_mutex> lck(s_syntheticMapMtx);
+        s_syntheticMap.clear();
+    }
+
     {
         lock_guard<recursive_mutex> lck(s_proxyPusherMapMtx);
         s_proxyPusherMap.clear();
@@ -281,6 +281,7 @@ static void pullStreamFromOrigin(const vector<string> &urls, size_t index, size_
 
     ProtocolOption option;
     option.enable_hls = option.enable_hls || (args._schema == HLS_SCHEMA);
+    option.enable_dash = option.enable_dash || (args._schema == DASH_SCHEMA);
     option.enable_mp4 = false;
 
     addStreamProxy(args._vhost, args._app, args._streamid, url, retry_count, option, Rtsp::RTP_TCP, timeout_sec, [=](const SockException &ex, const string &key) mutable {
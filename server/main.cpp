@@ -24,6 +24,7 @@
 #include "Shell/ShellSession.h"
 #include "Http/WebSocketSession.h"
 #include "Rtp/RtpServer.h"
+#include "Record/RecordCatalog.h"
 #include "WebApi.h"
 #include "WebHook.h"
 
@@ -189,6 +190,11 @@ int start_main(int argc,char *argv[]) {
 
         InfoL << kServerName;
 
+        //日志限流配置，支持热加载
+        NoticeCenter::Instance().addListener(ReloadConfigTag, Broadcast::kBroadcastReloadConfig, [](BroadcastReloadConfigArgs) {
+            LogRateLimiter::setMaxPerSecond(mINI::Instance()[General::kLogRateLimit]);
+        });
+
         //加载配置文件，如果配置文件不存在就创建一个
         loadIniConfig(g_ini_file.data());
 
@@ -364,6 +370,8 @@ int start_main(int argc,char *argv[]) {
         //处理http请求的api接口，比如获取服务器状态等等
         installWebApi();
         InfoL << "已启动http api 接口";
+        //后台加载录像目录并与磁盘文件核对
+        RecordCatalog::Instance().loadAll();
 #if defined(ENABLE_MGW)
         //在这里监听事件，触发hook调用，比如鉴权，注册和注销流 事件
         EventProcess::Instance()->run();
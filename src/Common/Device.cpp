@@ -16,6 +16,7 @@
 #include "Extension/G711.h"
 #include "Extension/H264.h"
 #include "Extension/H265.h"
+#include "Common/LatencyProbe.h"
 #ifdef ENABLE_FAAC
 #include "Codec/AACEncoder.h"
 #endif //ENABLE_FAAC
@@ -93,6 +94,7 @@ bool DevChannel::inputH264(const char *data, int len, uint64_t dts, uint64_t pts
     frame->_pts = pts;
     frame->_buffer.assign(data, len);
     frame->_prefix_size = prefixSize(data,len);
+    inputLatencyProbe(frame);
     return inputFrame(frame);
 }
 
@@ -112,9 +114,38 @@ bool DevChannel::inputH265(const char *data, int len, uint64_t dts, uint64_t pts
     frame->_pts = pts;
     frame->_buffer.assign(data, len);
     frame->_prefix_size = prefixSize(data,len);
+    inputLatencyProbe(frame);
     return inputFrame(frame);
 }
 
+void DevChannel::enableLatencyProbe(bool enable) {
+    _latency_probe = enable;
+}
+
+void DevChannel::inputLatencyProbe(const Frame::Ptr &frame) {
+    if (!_latency_probe) {
+        return;
+    }
+    //多个nal粘合时(例如sps+pps+idr)，逐个判断是否为一帧图像的开始
+    bool have_picture = false;
+    splitH264(frame->data(), frame->size(), frame->prefixSize(), [&](const char *ptr, size_t len, size_t prefix) {
+        auto nal = (uint8_t *) ptr + prefix;
+        if (have_picture || len < prefix + 3) {
+            return;
+        }
+        if (frame->getCodecId() == CodecH264) {
+            auto type = H264_TYPE(nal[0]);
+            have_picture = type >= H264Frame::NAL_B_P && type <= H264Frame::NAL_IDR && (nal[1] & 0x80);
+        } else {
+            //vcl nal且first_slice_segment_in_pic_flag为1
+            have_picture = H265_TYPE(nal[0]) < H265Frame::NAL_VPS && (nal[2] & 0x80);
+        }
+    });
+    if (have_picture) {
+        inputFrame(LatencyProbe::makeSEIFrame(frame->getCodecId(), frame->dts(), frame->pts()));
+    }
+}
+
 class FrameAutoDelete : public FrameFromPtr{
 public:
     template <typename ... ARGS>
@@ -118,6 +118,12 @@ public:
      */
     bool inputPCM(char *data, int len, uint64_t cts);
 
+    /**
+     * 开启端到端延时测量模式，开启后每帧h264/h265图像前插入携带系统时间的sei帧
+     * 播放端使用LatencyProbe提取并统计延时
+     */
+    void enableLatencyProbe(bool enable = true);
+
     //// 重载基类方法，确保线程安全 ////
     bool inputFrame(const Frame::Ptr &frame) override;
     bool addTrack(const Track::Ptr & track) override;
@@ -125,12 +131,14 @@ public:
 
 private:
     MediaOriginType getOriginType(MediaSource &sender) const override;
+    void inputLatencyProbe(const Frame::Ptr &frame);
 
 private:
     std::shared_ptr<H264Encoder> _pH264Enc;
     std::shared_ptr<AACEncoder> _pAacEnc;
     std::shared_ptr<VideoInfo> _video;
     std::shared_ptr<AudioInfo> _audio;
+    bool _latency_probe = false;
     toolkit::SmoothTicker _aTicker[2];
 };
 
@@ -0,0 +1,219 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+#include "IngestProfiler.h"
+#include "Common/config.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+static mutex s_mtx;
+static unordered_map<void *, weak_ptr<IngestProfiler> > s_profilers;
+
+//本线程当前socket读取的时间起点(单调时钟)与协议，为0时不统计
+static thread_local uint64_t s_recv_us = 0;
+static thread_local const char *s_recv_protocol = nullptr;
+//本线程当前输入帧的流
+static thread_local IngestProfiler *s_current = nullptr;
+
+static uint64_t getNowUS() {
+    return chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+IngestProfiler::RecvScope::RecvScope(const char *protocol) {
+    GET_CONFIG(bool, enable, General::kEnableProfiler);
+    if (!enable || s_recv_us) {
+        //未开启或嵌套调用(以最外层为准)
+        return;
+    }
+    _owner = true;
+    s_recv_us = getNowUS();
+    s_recv_protocol = protocol;
+}
+
+IngestProfiler::RecvScope::~RecvScope() {
+    if (_owner) {
+        s_recv_us = 0;
+        s_recv_protocol = nullptr;
+    }
+}
+
+IngestProfiler::FrameScope::FrameScope(IngestProfiler *profiler) {
+    if (!profiler || !s_recv_us) {
+        //未开启或非socket读取触发(例如定时器)
+        return;
+    }
+    _profiler = profiler;
+    _last = s_current;
+    s_current = profiler;
+    if (!profiler->_protocol.load(memory_order_relaxed)) {
+        profiler->_protocol.store(s_recv_protocol, memory_order_relaxed);
+    }
+    profiler->record(kStageFrame, s_recv_us);
+}
+
+IngestProfiler::FrameScope::~FrameScope() {
+    if (_profiler) {
+        _profiler->record(kStageMuxer, s_recv_us);
+        s_current = _last;
+    }
+}
+
+IngestProfiler::Ptr IngestProfiler::create(const string &vhost, const string &app, const string &stream) {
+    GET_CONFIG(bool, enable, General::kEnableProfiler);
+    if (!enable) {
+        return nullptr;
+    }
+    auto ret = std::make_shared<IngestProfiler>(vhost, app, stream);
+    lock_guard<mutex> lck(s_mtx);
+    s_profilers[ret.get()] = ret;
+    return ret;
+}
+
+IngestProfiler::IngestProfiler(const string &vhost, const string &app, const string &stream) {
+    _vhost = vhost;
+    _app = app;
+    _stream = stream;
+}
+
+IngestProfiler::~IngestProfiler() {
+    lock_guard<mutex> lck(s_mtx);
+    s_profilers.erase(this);
+}
+
+void IngestProfiler::onRingWrite(Stage stage) {
+    if (s_current) {
+        s_current->record(stage, s_recv_us);
+    }
+}
+
+void IngestProfiler::record(Stage stage, uint64_t recv_us) {
+    auto now = getNowUS();
+    _histograms[stage].record(now > recv_us ? now - recv_us : 0);
+}
+
+vector<IngestProfiler::Statistic> IngestProfiler::getStatistic() {
+    vector<Ptr> profilers;
+    {
+        lock_guard<mutex> lck(s_mtx);
+        for (auto &pr : s_profilers) {
+            if (auto profiler = pr.second.lock()) {
+                profilers.emplace_back(std::move(profiler));
+            }
+        }
+    }
+    vector<Statistic> ret;
+    for (auto &profiler : profilers) {
+        Statistic stat;
+        stat.vhost = profiler->_vhost;
+        stat.app = profiler->_app;
+        stat.stream = profiler->_stream;
+        auto protocol = profiler->_protocol.load(memory_order_relaxed);
+        stat.protocol = protocol ? protocol : "";
+        for (int i = 0; i < kStageMax; ++i) {
+            stat.stages[i] = profiler->_histograms[i].getStatistic();
+        }
+        ret.emplace_back(std::move(stat));
+    }
+    return ret;
+}
+
+const char *IngestProfiler::getStageName(Stage stage) {
+    switch (stage) {
+        case kStageFrame: return "frame";
+        case kStageMuxer: return "muxer";
+        case kStageRtsp: return "rtsp";
+        case kStageRtmp: return "rtmp";
+        case kStageTS: return "ts";
+        case kStageFMP4: return "fmp4";
+        default: return "invalid";
+    }
+}
+
+///////////////////////////////////////////Histogram///////////////////////////////////////////
+
+IngestProfiler::Histogram::Histogram() {
+    for (auto &bucket : _buckets) {
+        bucket.store(0, memory_order_relaxed);
+    }
+}
+
+size_t IngestProfiler::Histogram::getIndex(uint64_t us) {
+    if (us < kLinear) {
+        return (size_t)us;
+    }
+    //最高位的位置，不小于5
+    size_t msb = 5;
+    while (msb < 63 && (us >> (msb + 1))) {
+        ++msb;
+    }
+    if (msb > 30) {
+        return kBucketCount - 1;
+    }
+    //取最高位之后的4位作为区间内的下标
+    return kLinear + (msb - 5) * kSubBucket + (size_t)((us >> (msb - 4)) - kSubBucket);
+}
+
+uint64_t IngestProfiler::Histogram::getValue(size_t index) {
+    if (index < kLinear) {
+        return index;
+    }
+    auto msb = (index - kLinear) / kSubBucket + 5;
+    auto sub = (index - kLinear) % kSubBucket;
+    //返回桶的上限
+    return ((kSubBucket + sub + 1) << (msb - 4)) - 1;
+}
+
+void IngestProfiler::Histogram::record(uint64_t us) {
+    _buckets[getIndex(us)].fetch_add(1, memory_order_relaxed);
+    _count.fetch_add(1, memory_order_relaxed);
+    _sum.fetch_add(us, memory_order_relaxed);
+    auto max = _max.load(memory_order_relaxed);
+    while (us > max && !_max.compare_exchange_weak(max, us, memory_order_relaxed));
+}
+
+IngestProfiler::StageStatistic IngestProfiler::Histogram::getStatistic() const {
+    StageStatistic ret;
+    uint64_t counts[kBucketCount];
+    uint64_t total = 0;
+    for (size_t i = 0; i < kBucketCount; ++i) {
+        counts[i] = _buckets[i].load(memory_order_relaxed);
+        total += counts[i];
+    }
+    if (!total) {
+        return ret;
+    }
+    ret.count = total;
+    ret.mean = _sum.load(memory_order_relaxed) / max(_count.load(memory_order_relaxed), (uint64_t)1);
+    ret.max = _max.load(memory_order_relaxed);
+
+    struct {
+        double ratio;
+        uint64_t *value;
+    } percents[] = { { 0.5, &ret.p50 }, { 0.9, &ret.p90 }, { 0.99, &ret.p99 }, { 0.999, &ret.p999 } };
+    uint64_t acc = 0;
+    size_t pos = 0;
+    for (size_t i = 0; i < kBucketCount && pos < sizeof(percents) / sizeof(percents[0]); ++i) {
+        acc += counts[i];
+        while (pos < sizeof(percents) / sizeof(percents[0]) && acc >= percents[pos].ratio * total) {
+            //分位数不超过最大值
+            *percents[pos].value = min(getValue(i), ret.max);
+            ++pos;
+        }
+    }
+    return ret;
+}
+
+} // namespace mediakit
@@ -0,0 +1,147 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_INGESTPROFILER_H
+#define ZLMEDIAKIT_INGESTPROFILER_H
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace mediakit {
+
+/**
+ * 直播流输入链路的延时统计(general.enable_profiler开启后生效)
+ * socket读取回调中通过RecvScope记录时间起点，此后同一调用栈内各阶段相对该起点的耗时计入本流的直方图：
+ * frame: socket读取 -> 协议拆包、解复用、生成帧 -> 进入MultiMediaSourceMuxer
+ * muxer: socket读取 -> 所有协议复用器处理完毕
+ * rtsp/rtmp/ts/fmp4: socket读取 -> 该协议写入RingBuffer(合并写缓存flush时)
+ * 直方图采用对数分段线性分桶(HDR风格，相对误差约6%)，原子计数无锁写入
+ */
+class IngestProfiler {
+public:
+    using Ptr = std::shared_ptr<IngestProfiler>;
+
+    enum Stage {
+        kStageFrame = 0,
+        kStageMuxer,
+        kStageRtsp,
+        kStageRtmp,
+        kStageTS,
+        kStageFMP4,
+        kStageMax
+    };
+
+    struct StageStatistic {
+        uint64_t count = 0;
+        //以下单位为微秒
+        uint64_t mean = 0;
+        uint64_t p50 = 0;
+        uint64_t p90 = 0;
+        uint64_t p99 = 0;
+        uint64_t p999 = 0;
+        uint64_t max = 0;
+    };
+
+    struct Statistic {
+        std::string vhost;
+        std::string app;
+        std::string stream;
+        //推流或拉流协议
+        std::string protocol;
+        StageStatistic stages[kStageMax];
+    };
+
+    /**
+     * 在socket读取回调中声明，本次读取触发生成的帧以此为时间起点
+     * 未开启统计时仅判断一次配置
+     */
+    class RecvScope {
+    public:
+        RecvScope(const char *protocol);
+        ~RecvScope();
+
+    private:
+        bool _owner = false;
+    };
+
+    /**
+     * 在MultiMediaSourceMuxer输入帧时声明，构造时统计frame阶段，析构时统计muxer阶段
+     * 期间写入RingBuffer的耗时通过onRingWrite计入本流
+     */
+    class FrameScope {
+    public:
+        FrameScope(IngestProfiler *profiler);
+        ~FrameScope();
+
+    private:
+        IngestProfiler *_profiler = nullptr;
+        IngestProfiler *_last = nullptr;
+    };
+
+    /**
+     * 未开启统计时返回nullptr
+     */
+    static Ptr create(const std::string &vhost, const std::string &app, const std::string &stream);
+
+    IngestProfiler(const std::string &vhost, const std::string &app, const std::string &stream);
+    ~IngestProfiler();
+
+    /**
+     * 协议数据写入RingBuffer时调用，不在FrameScope内时忽略
+     */
+    static void onRingWrite(Stage stage);
+
+    /**
+     * 获取所有流的统计信息，线程安全
+     */
+    static std::vector<Statistic> getStatistic();
+
+    /**
+     * 获取阶段名
+     */
+    static const char *getStageName(Stage stage);
+
+private:
+    class Histogram {
+    public:
+        //小于32微秒时每微秒一个桶，此后每个2的幂次区间划分16个桶，上限约2^31微秒
+        static constexpr size_t kLinear = 32;
+        static constexpr size_t kSubBucket = 16;
+        static constexpr size_t kBucketCount = kLinear + (31 - 5) * kSubBucket;
+
+        Histogram();
+        void record(uint64_t us);
+        StageStatistic getStatistic() const;
+
+    private:
+        static size_t getIndex(uint64_t us);
+        static uint64_t getValue(size_t index);
+
+    private:
+        std::atomic<uint64_t> _count { 0 };
+        std::atomic<uint64_t> _sum { 0 };
+        std::atomic<uint64_t> _max { 0 };
+        std::atomic<uint64_t> _buckets[kBucketCount];
+    };
+
+    void record(Stage stage, uint64_t recv_us);
+
+private:
+    std::string _vhost;
+    std::string _app;
+    std::string _stream;
+    std::atomic<const char *> _protocol { nullptr };
+    Histogram _histograms[kStageMax];
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_INGESTPROFILER_H
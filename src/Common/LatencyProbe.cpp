@@ -0,0 +1,144 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cstring>
+#include <algorithm>
+#include "LatencyProbe.h"
+#include "Util/util.h"
+#include "Extension/H264.h"
+#include "Extension/H265.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+//sei user_data_unregistered的uuid，不含0字节，避免插入防竞争字节
+static constexpr char kProbeUUID[] = "ZLMLatencyProbe!";
+static constexpr size_t kUUIDSize = sizeof(kProbeUUID) - 1;
+//系统时间以16进制字符串保存，同样不含0字节
+static constexpr size_t kStampSize = 16;
+static constexpr uint8_t kSEIUserDataUnregistered = 5;
+
+LatencyProbe::LatencyProbe(string name) {
+    _name = std::move(name);
+}
+
+Frame::Ptr LatencyProbe::makeSEIFrame(CodecId codec, uint64_t dts, uint64_t pts) {
+    FrameImp::Ptr frame;
+    switch (codec) {
+        case CodecH264: {
+            frame = FrameImp::create<H264Frame>();
+            frame->_buffer.assign("\x00\x00\x00\x01\x06", 5);
+            break;
+        }
+        case CodecH265: {
+            frame = FrameImp::create<H265Frame>();
+            frame->_buffer.assign("\x00\x00\x00\x01", 4);
+            frame->_buffer.push_back((char) (H265Frame::NAL_SEI_PREFIX << 1));
+            frame->_buffer.push_back(1);
+            break;
+        }
+        default: return nullptr;
+    }
+    char stamp[kStampSize + 1];
+    snprintf(stamp, sizeof(stamp), "%016llX", (unsigned long long) getCurrentMicrosecond(true));
+
+    frame->_buffer.push_back(kSEIUserDataUnregistered);
+    frame->_buffer.push_back((char) (kUUIDSize + kStampSize));
+    frame->_buffer.append(kProbeUUID, kUUIDSize);
+    frame->_buffer.append(stamp, kStampSize);
+    //rbsp_trailing_bits
+    frame->_buffer.push_back((char) 0x80);
+    frame->_prefix_size = 4;
+    frame->_dts = dts;
+    frame->_pts = pts;
+    return frame;
+}
+
+bool LatencyProbe::parseSEIFrame(const Frame::Ptr &frame, uint64_t &stamp_us) {
+    size_t header_size;
+    switch (frame->getCodecId()) {
+        case CodecH264: header_size = 1; break;
+        case CodecH265: header_size = 2; break;
+        default: return false;
+    }
+    bool ret = false;
+    //播放器输出的帧可能包含多个nal
+    splitH264(frame->data(), frame->size(), frame->prefixSize(), [&](const char *ptr, size_t len, size_t prefix) {
+        auto nal = (const uint8_t *) ptr + prefix;
+        auto size = len - prefix;
+        if (ret || size < header_size + 2 + kUUIDSize + kStampSize) {
+            return;
+        }
+        bool is_sei = frame->getCodecId() == CodecH264 ? H264_TYPE(nal[0]) == H264Frame::NAL_SEI
+                                                       : H265_TYPE(nal[0]) == H265Frame::NAL_SEI_PREFIX;
+        auto payload = nal + header_size;
+        if (!is_sei || payload[0] != kSEIUserDataUnregistered || payload[1] != kUUIDSize + kStampSize ||
+            memcmp(payload + 2, kProbeUUID, kUUIDSize)) {
+            return;
+        }
+        string stamp((const char *) payload + 2 + kUUIDSize, kStampSize);
+        stamp_us = strtoull(stamp.data(), nullptr, 16);
+        ret = true;
+    });
+    return ret;
+}
+
+void LatencyProbe::attach(const Track::Ptr &track) {
+    weak_ptr<LatencyProbe> weak_self = shared_from_this();
+    track->addDelegate([weak_self](const Frame::Ptr &frame) {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->inputFrame(frame);
+        }
+        return true;
+    });
+}
+
+void LatencyProbe::inputFrame(const Frame::Ptr &frame) {
+    uint64_t stamp_us;
+    if (!parseSEIFrame(frame, stamp_us)) {
+        return;
+    }
+    auto now = getCurrentMicrosecond(true);
+    lock_guard<mutex> lck(_mtx);
+    _samples.emplace_back((int64_t) now - (int64_t) stamp_us);
+}
+
+LatencyProbe::Report LatencyProbe::getReport() const {
+    Report ret;
+    ret.name = _name;
+    vector<int64_t> samples;
+    {
+        lock_guard<mutex> lck(_mtx);
+        samples = _samples;
+    }
+    if (samples.empty()) {
+        return ret;
+    }
+    sort(samples.begin(), samples.end());
+    auto percent = [&](double ratio) {
+        return samples[min(samples.size() - 1, (size_t) (ratio * samples.size()))] / 1000.0;
+    };
+    int64_t sum = 0;
+    for (auto sample : samples) {
+        sum += sample;
+    }
+    ret.count = samples.size();
+    ret.min = samples.front() / 1000.0;
+    ret.max = samples.back() / 1000.0;
+    ret.mean = sum / 1000.0 / samples.size();
+    ret.p50 = percent(0.5);
+    ret.p90 = percent(0.9);
+    ret.p99 = percent(0.99);
+    return ret;
+}
+
+} // namespace mediakit
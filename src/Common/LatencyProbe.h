@@ -0,0 +1,85 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_LATENCYPROBE_H
+#define ZLMEDIAKIT_LATENCYPROBE_H
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Extension/Track.h"
+
+namespace mediakit {
+
+/**
+ * 端到端(glass-to-glass)延时测量
+ * 发送端(DevChannel::enableLatencyProbe)在每帧视频前插入携带系统时间的sei(user_data_unregistered)，
+ * 接收端(任意播放器的视频track)提取该时间，以接收时间减去发送时间作为本协议链路的端到端延时
+ * 收发两端需在同一主机或已做时钟同步
+ */
+class LatencyProbe : public std::enable_shared_from_this<LatencyProbe> {
+public:
+    using Ptr = std::shared_ptr<LatencyProbe>;
+
+    struct Report {
+        std::string name;
+        uint64_t count = 0;
+        //以下单位为毫秒
+        double min = 0;
+        double mean = 0;
+        double p50 = 0;
+        double p90 = 0;
+        double p99 = 0;
+        double max = 0;
+    };
+
+    /**
+     * @param name 报告名，一般为协议名
+     */
+    LatencyProbe(std::string name);
+    ~LatencyProbe() = default;
+
+    /**
+     * 生成携带当前系统时间的sei帧，仅支持h264/h265
+     * @return 不支持的编码返回nullptr
+     */
+    static Frame::Ptr makeSEIFrame(CodecId codec, uint64_t dts, uint64_t pts);
+
+    /**
+     * 从sei帧中提取发送时间
+     * @param stamp_us 发送时的系统时间，单位微秒
+     * @return 不是LatencyProbe生成的sei帧时返回false
+     */
+    static bool parseSEIFrame(const Frame::Ptr &frame, uint64_t &stamp_us);
+
+    /**
+     * 监听播放器的视频track，统计每个sei帧的延时
+     */
+    void attach(const Track::Ptr &track);
+
+    /**
+     * 输入接收到的帧，非sei帧忽略
+     */
+    void inputFrame(const Frame::Ptr &frame);
+
+    /**
+     * 获取延时统计，线程安全
+     */
+    Report getReport() const;
+
+private:
+    std::string _name;
+    mutable std::mutex _mtx;
+    //延时采样，单位微秒
+    std::vector<int64_t> _samples;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_LATENCYPROBE_H
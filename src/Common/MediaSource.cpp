@@ -16,6 +16,7 @@
 #include "Common/config.h"
 #include "Common/Parser.h"
 #include "Record/MP4Reader.h"
+#include "Record/DvrReader.h"
 #include "PacketCache.h"
 using namespace std;
 using namespace toolkit;
@@ -46,6 +47,7 @@ string getOriginTypeString(MediaOriginType type){
         SWITCH_CASE(device_chn);
         SWITCH_CASE(rtc_push);
         SWITCH_CASE(srt_push);
+        SWITCH_CASE(time_shift);
         default : return "unknown";
     }
 }
@@ -65,6 +67,7 @@ ProtocolOption::ProtocolOption() {
     GET_CONFIG(bool, s_enable_ts, Protocol::kEnableTS);
     GET_CONFIG(bool, s_enable_fmp4, Protocol::kEnableFMP4);
     GET_CONFIG(bool, s_enable_dmsp, Protocol::kEnableDmsp);
+    GET_CONFIG(bool, s_enable_dash, Protocol::kEnableDash);
 
     GET_CONFIG(bool, s_hls_demand, Protocol::kHlsDemand);
     GET_CONFIG(bool, s_rtsp_demand, Protocol::kRtspDemand);
@@ -72,6 +75,7 @@ ProtocolOption::ProtocolOption() {
     GET_CONFIG(bool, s_ts_demand, Protocol::kTSDemand);
     GET_CONFIG(bool, s_fmp4_demand, Protocol::kFMP4Demand);
     GET_CONFIG(bool, s_dmsp_demand, Protocol::kDmspDemand);
+    GET_CONFIG(bool, s_dash_demand, Protocol::kDashDemand);
 
     GET_CONFIG(bool, s_mp4_as_player, Protocol::kMP4AsPlayer);
     GET_CONFIG(uint32_t, s_mp4_max_second, Protocol::kMP4MaxSecond);
@@ -79,6 +83,8 @@ ProtocolOption::ProtocolOption() {
 
     GET_CONFIG(string, s_hls_save_path, Protocol::kHlsSavePath);
 
+    GET_CONFIG(uint32_t, s_dvr_second, Protocol::kDvrSecond);
+
     modify_stamp = s_modify_stamp;
     enable_audio = s_enabel_audio;
     add_mute_audio = s_add_mute_audio;
@@ -91,6 +97,7 @@ ProtocolOption::ProtocolOption() {
     enable_ts = s_enable_ts;
     enable_fmp4 = s_enable_fmp4;
     enable_dmsp = s_enable_dmsp;
+    enable_dash = s_enable_dash;
 
     hls_demand = s_hls_demand;
     rtsp_demand = s_rtsp_demand;
@@ -98,12 +105,15 @@ ProtocolOption::ProtocolOption() {
     ts_demand = s_ts_demand;
     fmp4_demand = s_fmp4_demand;
     dmsp_demand = s_dmsp_demand;
+    dash_demand = s_dash_demand;
 
     mp4_as_player = s_mp4_as_player;
     mp4_max_second = s_mp4_max_second;
     mp4_save_path = s_mp4_save_path;
 
     hls_save_path = s_hls_save_path;
+
+    dvr_second = s_dvr_second;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -418,9 +428,14 @@ static MediaSource::Ptr find_l(const string &schema, const string &vhost_in, con
     MediaSource::Ptr ret;
     MediaSource::for_each_media([&](const MediaSource::Ptr &src) { ret = std::move(const_cast<MediaSource::Ptr &>(src)); }, schema, vhost, app, id);
 
-    if(!ret && from_mp4 && schema != HLS_SCHEMA){
+    if (!ret && from_mp4) {
+        //未找到媒体源，如果是时移流则从直播流的时移缓存创建一个
+        ret = MediaSource::createFromDvr(schema, vhost, app, id);
+    }
+
+    if(!ret && from_mp4 && schema != HLS_SCHEMA && schema != DASH_SCHEMA){
         //未找到媒体源，则读取mp4创建一个
-        //播放hls不触发mp4点播(因为HLS也可以用于录像，不是纯粹的直播)
+        //播放hls/dash不触发mp4点播(因为HLS也可以用于录像，不是纯粹的直播)
         ret = MediaSource::createFromMP4(schema, vhost, app, id);
     }
     return ret;
@@ -657,6 +672,28 @@ MediaSource::Ptr MediaSource::createFromMP4(const string &schema, const string &
 #endif //ENABLE_MP4
 }
 
+MediaSource::Ptr MediaSource::createFromDvr(const string &schema, const string &vhost, const string &app, const string &stream) {
+    string origin_stream;
+    uint64_t delay_ms;
+    if (!DvrReader::parseStreamId(stream, origin_stream, delay_ms)) {
+        return nullptr;
+    }
+    if (MediaSource::find(vhost, app, stream)) {
+        //时移流已存在(hls等协议尚未注册)，等待其注册
+        return nullptr;
+    }
+    try {
+        auto reader = std::make_shared<DvrReader>(vhost, app, stream);
+        if (!reader->startRead()) {
+            return nullptr;
+        }
+        return MediaSource::find(schema, vhost, app, stream);
+    } catch (std::exception &ex) {
+        WarnL << ex.what();
+        return nullptr;
+    }
+}
+
 /////////////////////////////////////MediaSourceEvent//////////////////////////////////////
 
 void MediaSourceEvent::onReaderChanged(MediaSource &sender, int size){
@@ -670,7 +707,7 @@ void MediaSourceEvent::onReaderChanged(MediaSource &sender, int size){
     GET_CONFIG(string, record_app, Record::kAppName);
     GET_CONFIG(int, stream_none_reader_delay, General::kStreamNoneReaderDelayMS);
     //如果mp4点播, 无人观看时我们强制关闭点播
-    bool is_mp4_vod = sender.getApp() == record_app;
+    bool is_mp4_vod = sender.getApp() == record_app || sender.getOriginType() == MediaOriginType::time_shift;
     weak_ptr<MediaSource> weak_sender = sender.shared_from_this();
 
     _async_close_timer = std::make_shared<Timer>(stream_none_reader_delay / 1000.0f, [weak_sender, is_mp4_vod]() {
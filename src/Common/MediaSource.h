@@ -35,7 +35,8 @@ enum class MediaOriginType : uint8_t {
     mp4_vod,
     device_chn,
     rtc_push,
-    srt_push
+    srt_push,
+    time_shift
 };
 
 std::string getOriginTypeString(MediaOriginType type);
@@ -159,6 +160,8 @@ public:
     bool enable_fmp4;
     //是否开启转换为Dmsp
     bool enable_dmsp;
+    //是否开启转换为mpeg-dash，需要同时开启enable_fmp4
+    bool enable_dash;
 
     // hls协议是否按需生成，如果hls.segNum配置为0(意味着hls录制)，那么hls将一直生成(不管此开关)
     bool hls_demand;
@@ -172,6 +175,8 @@ public:
     bool fmp4_demand;
     //dmsp协议是否按需生成
     bool dmsp_demand;
+    // mpeg-dash协议是否按需生成
+    bool dash_demand;
 
     //是否将mp4录制当做观看者
     bool mp4_as_player;
@@ -183,6 +188,9 @@ public:
     //hls录制保存路径
     std::string hls_save_path;
 
+    //时移窗口长度，单位秒，置0时关闭时移
+    size_t dvr_second;
+
     template <typename MAP>
     ProtocolOption(const MAP &allArgs) : ProtocolOption() {
 #define GET_OPT_VALUE(key) getArgsValue(allArgs, #key, key)
@@ -198,6 +206,7 @@ public:
         GET_OPT_VALUE(enable_ts);
         GET_OPT_VALUE(enable_fmp4);
         GET_OPT_VALUE(enable_dmsp);
+        GET_OPT_VALUE(enable_dash);
 
         GET_OPT_VALUE(hls_demand);
         GET_OPT_VALUE(rtsp_demand);
@@ -205,12 +214,15 @@ public:
         GET_OPT_VALUE(ts_demand);
         GET_OPT_VALUE(fmp4_demand);
         GET_OPT_VALUE(dmsp_demand);
+        GET_OPT_VALUE(dash_demand);
 
         GET_OPT_VALUE(mp4_max_second);
         GET_OPT_VALUE(mp4_as_player);
         GET_OPT_VALUE(mp4_save_path);
 
         GET_OPT_VALUE(hls_save_path);
+
+        GET_OPT_VALUE(dvr_second);
     }
 
 private:
@@ -390,6 +402,9 @@ public:
                                             const std::string &app, const std::string &stream,
                                             const std::string &file_path = "",
                                             bool check_app = true, bool repeat = false);
+    // 从直播流的时移缓存生成MediaSource，stream形如"cam1@dvr60"
+    static MediaSource::Ptr createFromDvr(const std::string &schema, const std::string &vhost,
+                                          const std::string &app, const std::string &stream);
 
 protected:
     //媒体注册
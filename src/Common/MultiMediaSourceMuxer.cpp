@@ -117,11 +117,27 @@ MultiMediaSourceMuxer::MultiMediaSourceMuxer(const string &vhost, const string &
     if (option.enable_fmp4) {
         _fmp4 = std::make_shared<FMP4MediaSourceMuxer>(vhost, app, stream, option);
     }
+    if (_fmp4 && _hls && _hls->isFmp4()) {
+        _fmp4->setHlsRecorder(_hls);
+    }
+    if (option.enable_dash) {
+        if (_fmp4) {
+            //dash切片复用fmp4的复用结果
+            _dash = std::make_shared<DashRecorder>(vhost, app, stream, option);
+            _fmp4->setDashRecorder(_dash);
+        } else {
+            WarnL << "dash需要开启fmp4协议转换(protocol.enable_fmp4): " << vhost << "/" << app << "/" << stream;
+        }
+    }
 #endif
 
     if (option.enable_dmsp) {
         _dmsp = std::make_shared<DmspMediaSourceMuxer>(vhost, app, stream, option);
     }
+    if (option.dvr_second) {
+        _dvr = std::make_shared<DvrBuffer>(vhost, app, stream, option.dvr_second);
+    }
+    _profiler = IngestProfiler::create(vhost, app, stream);
 
     //音频相关设置
     enableAudio(option.enable_audio);
@@ -146,6 +162,9 @@ void MultiMediaSourceMuxer::setMediaListener(const std::weak_ptr<MediaSourceEven
     if (_fmp4) {
         _fmp4->setListener(self);
     }
+    if (_dash) {
+        _dash->setListener(self);
+    }
 #endif
     auto hls = _hls;
     if (hls) {
@@ -168,6 +187,7 @@ int MultiMediaSourceMuxer::totalReaderCount() const {
            (_ts ? _ts->readerCount() : 0) +
            #if defined(ENABLE_MP4)
            (_fmp4 ? _fmp4->readerCount() : 0) +
+           (_dash ? _dash->readerCount() : 0) +
            #endif
            (_mp4 ? _option.mp4_as_player : 0) +
            (hls ? hls->readerCount() : 0) +
@@ -218,9 +238,19 @@ bool MultiMediaSourceMuxer::setupRecord(MediaSource &sender, Recorder::type type
                     //设置HlsMediaSource的事件监听器
                     hls->setListener(shared_from_this());
                 }
+#if defined(ENABLE_MP4)
+                if (_fmp4 && hls && hls->isFmp4()) {
+                    _fmp4->setHlsRecorder(hls);
+                }
+#endif
                 _hls = hls;
             } else if (!start && _hls) {
                 //停止录制
+#if defined(ENABLE_MP4)
+                if (_fmp4) {
+                    _fmp4->setHlsRecorder(nullptr);
+                }
+#endif
                 _hls = nullptr;
             }
             return true;
@@ -367,6 +397,9 @@ bool MultiMediaSourceMuxer::onTrackReady(const Track::Ptr &track) {
     if (_dmsp) {
         ret = _dmsp->addTrack(track) ? true : ret;
     }
+    if (_dvr) {
+        ret = _dvr->addTrack(track) ? true : ret;
+    }
     return ret;
 }
 
@@ -388,6 +421,9 @@ void MultiMediaSourceMuxer::onAllTrackReady() {
     if (_dmsp) {
         _dmsp->onAllTrackReady();
     }
+    if (_dvr) {
+        _dvr->addTrackCompleted();
+    }
     auto listener = _track_listener.lock();
     if (listener) {
         listener->onAllTrackReady();
@@ -438,6 +474,9 @@ void MultiMediaSourceMuxer::resetTracks() {
     if (_dmsp) {
         _dmsp->resetTracks();
     }
+    if (_dvr) {
+        _dvr->resetTracks();
+    }
 
     //拷贝智能指针，目的是为了防止跨线程调用设置录像相关api导致的线程竞争问题
     auto hls = _hls;
@@ -452,6 +491,8 @@ void MultiMediaSourceMuxer::resetTracks() {
 }
 
 bool MultiMediaSourceMuxer::onTrackFrame(const Frame::Ptr &frame_in) {
+    //统计输入链路各阶段延时
+    IngestProfiler::FrameScope profile(_profiler.get());
     auto frame = frame_in;
    if (_option.modify_stamp) {
         //开启了时间戳覆盖
@@ -488,6 +529,9 @@ bool MultiMediaSourceMuxer::onTrackFrame(const Frame::Ptr &frame_in) {
     if (_dmsp) {
         ret = _dmsp->inputFrame(frame) ? true : ret;
     }
+    if (_dvr) {
+        ret = _dvr->inputFrame(frame) ? true : ret;
+    }
 
     if (_ring) {
         if (frame->getTrackType() == TrackVideo) {
@@ -517,6 +561,7 @@ bool MultiMediaSourceMuxer::isEnabled(){
                      #endif
                      (_ring ? (bool)_ring->readerCount() : false)  ||
                      (hls ? hls->isEnabled() : false) || _mp4 ||
+                     (_dvr ? _dvr->readerCount() > 0 : false) ||
                      (_dmsp ? _dmsp->isEnabled() : false);
 
         if (_is_enable) {
@@ -14,10 +14,12 @@
 #include "Common/Stamp.h"
 #include "Common/MediaSource.h"
 #include "Common/MediaSink.h"
+#include "Common/IngestProfiler.h"
 #include "Record/Recorder.h"
 #include "Rtp/RtpSender.h"
 #include "Record/HlsRecorder.h"
 #include "Record/HlsMediaSource.h"
+#include "Record/DvrBuffer.h"
 #include "Rtsp/RtspMediaSourceMuxer.h"
 #include "Rtmp/RtmpMediaSourceMuxer.h"
 #include "TS/TSMediaSourceMuxer.h"
@@ -175,12 +177,15 @@ private:
 
 #if defined(ENABLE_MP4)
     FMP4MediaSourceMuxer::Ptr _fmp4;
+    DashRecorder::Ptr _dash;
 #endif
     RtmpMediaSourceMuxer::Ptr _rtmp;
     RtspMediaSourceMuxer::Ptr _rtsp;
     TSMediaSourceMuxer::Ptr _ts;
     MediaSinkInterface::Ptr _mp4;
     HlsRecorder::Ptr _hls;
+    DvrBuffer::Ptr _dvr;
+    IngestProfiler::Ptr _profiler;
     toolkit::EventPoller::Ptr _poller;
     RingType::Ptr _ring;
 
@@ -41,39 +41,86 @@ string FindField(const char* buf, const char* start, const char *end ,size_t buf
     return string(msg_start, msg_end);
 }
 
-void Parser::Parse(const char *buf) {
-    //解析
-    const char *start = buf;
-    Clear();
-    while (true) {
-        auto line = FindField(start, NULL, "\r\n");
-        if (line.size() == 0) {
-            break;
+//查找\r\n，返回\r所在位置，未找到返回nullptr
+static inline const char *findCRLF(const char *ptr, const char *end) {
+    while (ptr < end) {
+        auto pos = (const char *) memchr(ptr, '\r', end - ptr);
+        if (!pos || pos + 1 >= end) {
+            return nullptr;
+        }
+        if (pos[1] == '\n') {
+            return pos;
         }
-        if (start == buf) {
-            _strMethod = FindField(line.data(), NULL, " ");
-            auto strFullUrl = FindField(line.data(), " ", " ");
-            auto args_pos = strFullUrl.find('?');
-            if (args_pos != string::npos) {
-                _strUrl = strFullUrl.substr(0, args_pos);
-                _params = strFullUrl.substr(args_pos + 1);
-                _mapUrlArgs = parseArgs(_params);
+        ptr = pos + 1;
+    }
+    return nullptr;
+}
+
+void Parser::Parse(const char *buf, size_t size) {
+    Clear();
+    if (!size) {
+        size = strlen(buf);
+    }
+    auto end = buf + size;
+    //找到信令头结尾(空行)，之后的数据为content
+    auto ptr = buf;
+    const char *line_end;
+    while ((line_end = findCRLF(ptr, end)) && line_end != ptr) {
+        ptr = line_end + 2;
+    }
+    if (line_end) {
+        //line_end为空行
+        _strContent.assign(line_end + 2, end);
+    }
+    //信令头只拷贝一次
+    _header_buf.assign(buf, ptr);
+    auto data = _header_buf.data();
+    auto header_end = data + _header_buf.size();
+
+    //解析首行: method url tail
+    ptr = data;
+    line_end = findCRLF(ptr, header_end);
+    if (!line_end) {
+        return;
+    }
+    auto space = (const char *) memchr(ptr, ' ', line_end - ptr);
+    if (space) {
+        _strMethod.assign(ptr, space);
+        auto url_start = space + 1;
+        auto url_end = (const char *) memchr(url_start, ' ', line_end - url_start);
+        if (url_end) {
+            auto args = (const char *) memchr(url_start, '?', url_end - url_start);
+            if (args) {
+                _strUrl.assign(url_start, args);
+                _params.assign(args + 1, url_end);
             } else {
-                _strUrl = strFullUrl;
+                _strUrl.assign(url_start, url_end);
             }
-            _strTail = FindField(line.data(), (strFullUrl + " ").data(), NULL);
+            _strTail.assign(url_end + 1, line_end);
         } else {
-            auto field = FindField(line.data(), NULL, ": ");
-            auto value = FindField(line.data(), ": ", NULL);
-            if (field.size() != 0) {
-                _mapHeaders.emplace_force(field, value);
-            }
+            _strTail.assign(url_start, line_end);
+        }
+    }
+
+    //解析header，只记录位置
+    for (ptr = line_end + 2; (line_end = findCRLF(ptr, header_end)) && line_end != ptr; ptr = line_end + 2) {
+        auto colon = (const char *) memchr(ptr, ':', line_end - ptr);
+        if (!colon || colon == ptr) {
+            continue;
         }
-        start = start + line.size() + 2;
-        if (strncmp(start, "\r\n", 2) == 0) { //协议解析完毕
-            _strContent = FindField(start, "\r\n", NULL);
-            break;
+        auto value = colon + 1;
+        auto value_end = line_end;
+        while (value < value_end && (*value == ' ' || *value == '\t')) {
+            ++value;
         }
+        while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+            --value_end;
+        }
+        _header_fields.emplace_back(HeaderField{(uint32_t) (ptr - data), (uint32_t) (colon - ptr), (uint32_t) (value - data),
+                                                (uint32_t) (value_end - value), false});
+    }
+    if (_header_values.size() < _header_fields.size()) {
+        _header_values.resize(_header_fields.size());
     }
 }
 
@@ -97,11 +144,29 @@ const string &Parser::Tail() const {
 }
 
 const string &Parser::operator[](const char *name) const {
-    auto it = _mapHeaders.find(name);
-    if (it == _mapHeaders.end()) {
-        return _strNull;
+    if (_header_map_ready) {
+        //header map可能已被修改，以其为准
+        auto it = _mapHeaders.find(name);
+        if (it == _mapHeaders.end()) {
+            return _strNull;
+        }
+        return it->second;
     }
-    return it->second;
+    auto len = strlen(name);
+    auto data = _header_buf.data();
+    for (size_t i = 0; i < _header_fields.size(); ++i) {
+        auto &field = _header_fields[i];
+        if (field.name_len != len || strncasecmp(data + field.name, name, len)) {
+            continue;
+        }
+        auto &value = _header_values[i];
+        if (!field.cached) {
+            value.assign(data + field.value, field.value_len);
+            field.cached = true;
+        }
+        return value;
+    }
+    return _strNull;
 }
 
 const string &Parser::Content() const {
@@ -109,13 +174,22 @@ const string &Parser::Content() const {
 }
 
 void Parser::Clear() {
+    //只清空内容，保留已分配的内存供下次解析复用
     _strMethod.clear();
     _strUrl.clear();
     _params.clear();
     _strTail.clear();
     _strContent.clear();
-    _mapHeaders.clear();
-    _mapUrlArgs.clear();
+    _header_buf.clear();
+    _header_fields.clear();
+    if (_header_map_ready) {
+        _header_map_ready = false;
+        _mapHeaders.clear();
+    }
+    if (_url_args_ready) {
+        _url_args_ready = false;
+        _mapUrlArgs.clear();
+    }
 }
 
 const string &Parser::Params() const {
@@ -131,10 +205,23 @@ void Parser::setContent(string content) {
 }
 
 StrCaseMap &Parser::getHeader() const {
+    if (!_header_map_ready) {
+        _header_map_ready = true;
+        auto data = _header_buf.data();
+        for (auto &field : _header_fields) {
+            _mapHeaders.emplace_force(string(data + field.name, field.name_len), string(data + field.value, field.value_len));
+        }
+    }
     return _mapHeaders;
 }
 
 StrCaseMap &Parser::getUrlArgs() const {
+    if (!_url_args_ready) {
+        _url_args_ready = true;
+        if (!_params.empty()) {
+            _mapUrlArgs = parseArgs(_params);
+        }
+    }
     return _mapUrlArgs;
 }
 
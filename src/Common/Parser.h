@@ -13,6 +13,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include "Util/util.h"
 
 namespace mediakit {
@@ -57,14 +58,24 @@ public:
     }
 };
 
-//rtsp/http/sip解析类
+/**
+ * rtsp/http/sip解析类
+ * 解析时只拷贝一次信令头，各header以偏移量引用其中的数据并保存在线性数组中，
+ * header map与url参数map在首次通过getHeader()/getUrlArgs()访问时才生成
+ * Parser对象重复使用时(每个会话一个)，各缓存的内存可以复用，解析不再产生内存分配
+ */
 class Parser {
 public:
     Parser() = default;
     ~Parser() = default;
 
-    //解析信令
-    void Parse(const char *buf);
+    /**
+     * 解析信令
+     * @param buf 信令数据
+     * @param size 信令数据长度，为0时通过strlen获取
+     * 只解析size范围内的数据，所以http pipelining时后续请求不会被当做content
+     */
+    void Parse(const char *buf, size_t size = 0);
 
     //获取命令字
     const std::string &Method() const;
@@ -78,7 +89,7 @@ public:
     //获取命令协议名
     const std::string &Tail() const;
 
-    //根据header key名，获取请求header value值
+    //根据header key名，获取请求header value值，未生成header map时直接在线性数组中查找
     const std::string &operator[](const char *name) const;
 
     //获取http body或sdp
@@ -96,10 +107,10 @@ public:
     //重新设置content
     void setContent(std::string content);
 
-    //获取header列表
+    //获取header列表，首次调用时生成
     StrCaseMap &getHeader() const;
 
-    //获取url参数列表
+    //获取url参数列表，首次调用时生成
     StrCaseMap &getUrlArgs() const;
 
     //解析?后面的参数
@@ -107,6 +118,17 @@ public:
 
     static std::string merge_url(const std::string &base_url, const std::string &path);
 
+private:
+    //header在_header_buf中的位置，Parser对象会被拷贝(例如被异步回调捕获)，所以记录偏移量而不是指针
+    struct HeaderField {
+        uint32_t name;
+        uint32_t name_len;
+        uint32_t value;
+        uint32_t value_len;
+        //_header_values中对应的value是否已生成
+        bool cached;
+    };
+
 private:
     std::string _strMethod;
     std::string _strUrl;
@@ -114,6 +136,13 @@ private:
     std::string _strContent;
     std::string _strNull;
     std::string _params;
+    //信令头原始数据
+    std::string _header_buf;
+    mutable std::vector<HeaderField> _header_fields;
+    //operator[]按需生成的header value，下标与_header_fields一致
+    mutable std::vector<std::string> _header_values;
+    mutable bool _header_map_ready = false;
+    mutable bool _url_args_ready = false;
     mutable StrCaseMap _mapHeaders;
     mutable StrCaseMap _mapUrlArgs;
 };
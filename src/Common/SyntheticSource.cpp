@@ -0,0 +1,507 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <cmath>
+#include "SyntheticSource.h"
+#include "Extension/AAC.h"
+#include "Extension/H264.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+static constexpr int kH264NalFiller = 12;
+
+/**
+ * 按位写入rbsp，用于生成参数集与slice头
+ */
+class BitWriter {
+public:
+    void putBit(uint32_t bit) {
+        _cur = (uint8_t) ((_cur << 1) | (bit & 1));
+        if (++_bits == 8) {
+            _buf.push_back((char) _cur);
+            _cur = 0;
+            _bits = 0;
+        }
+    }
+
+    void putBits(uint64_t value, int bits) {
+        for (int i = bits - 1; i >= 0; --i) {
+            putBit((uint32_t) (value >> i));
+        }
+    }
+
+    //无符号指数哥伦布编码
+    void putUE(uint32_t value) {
+        uint64_t code = (uint64_t) value + 1;
+        int len = 0;
+        for (auto tmp = code; tmp > 1; tmp >>= 1) {
+            ++len;
+        }
+        putBits(0, len);
+        putBits(code, len + 1);
+    }
+
+    //有符号指数哥伦布编码
+    void putSE(int32_t value) {
+        putUE(value <= 0 ? (uint32_t) (-2 * (int64_t) value) : (uint32_t) (2 * (int64_t) value - 1));
+    }
+
+    //rbsp_trailing_bits/byte_alignment
+    void putTrailingBits() {
+        putBit(1);
+        putAlignBits();
+    }
+
+    //以0补齐至字节
+    void putAlignBits() {
+        while (_bits) {
+            putBit(0);
+        }
+    }
+
+    /**
+     * 生成带起始码的nal，并插入防竞争字节
+     * @param header nal头
+     */
+    string makeNal(const string &header) const {
+        string ret("\x00\x00\x00\x01", 4);
+        ret.reserve(4 + header.size() + _buf.size() + _buf.size() / 64);
+        ret.append(header);
+        int zeros = 0;
+        for (auto ch : _buf) {
+            auto byte = (uint8_t) ch;
+            if (zeros >= 2 && byte <= 3) {
+                ret.push_back(3);
+                zeros = 0;
+            }
+            ret.push_back(ch);
+            zeros = byte ? 0 : zeros + 1;
+        }
+        return ret;
+    }
+
+    const string &data() const { return _buf; }
+
+private:
+    uint8_t _cur = 0;
+    int _bits = 0;
+    string _buf;
+};
+
+//gop内一帧的编码顺序信息
+struct PictureInfo {
+    char type;
+    //在gop内的显示序号
+    int display;
+    //b帧前后的参考帧显示序号，p帧只使用prev
+    int prev;
+    int next;
+};
+
+//按解码顺序排列gop内的帧：I P B B P B B ...
+static vector<PictureInfo> makeGopSchedule(int gop, int b_frames) {
+    vector<PictureInfo> ret;
+    ret.push_back({ 'I', 0, 0, 0 });
+    int prev = 0;
+    for (int start = 1; start < gop;) {
+        auto end = min(start + b_frames, gop - 1);
+        ret.push_back({ 'P', end, prev, 0 });
+        for (int i = start; i < end; ++i) {
+            ret.push_back({ 'B', i, prev, end });
+        }
+        prev = end;
+        start = end + 1;
+    }
+    return ret;
+}
+
+static Frame::Ptr makeVideoFrame(CodecId codec, string nal) {
+    auto frame = FrameImp::create();
+    frame->_codec_id = codec;
+    frame->_buffer = std::move(nal);
+    frame->_prefix_size = 4;
+    return frame;
+}
+
+///////////////////////////////////////////h264///////////////////////////////////////////
+
+static uint8_t getH264Level(int mbs) {
+    //按MaxFS选择level，不考虑宏块速率
+    if (mbs <= 3600) {
+        return 31;
+    }
+    if (mbs <= 8192) {
+        return 40;
+    }
+    return mbs <= 22080 ? 50 : 51;
+}
+
+static string makeH264SPS(const VideoInfo &info, int b_frames) {
+    int mb_width = (info.iWidth + 15) / 16;
+    int mb_height = (info.iHeight + 15) / 16;
+    BitWriter bw;
+    //无b帧时使用baseline，否则使用main
+    bw.putBits(b_frames ? 77 : 66, 8);
+    bw.putBits(b_frames ? 0x40 : 0xC0, 8);
+    bw.putBits(getH264Level(mb_width * mb_height), 8);
+    bw.putUE(0); // seq_parameter_set_id
+    bw.putUE(12); // log2_max_frame_num_minus4
+    bw.putUE(0); // pic_order_cnt_type
+    bw.putUE(12); // log2_max_pic_order_cnt_lsb_minus4
+    bw.putUE(b_frames ? 2 : 1); // max_num_ref_frames
+    bw.putBit(0); // gaps_in_frame_num_value_allowed_flag
+    bw.putUE(mb_width - 1);
+    bw.putUE(mb_height - 1);
+    bw.putBit(1); // frame_mbs_only_flag
+    bw.putBit(1); // direct_8x8_inference_flag
+    auto crop_right = (mb_width * 16 - info.iWidth) / 2;
+    auto crop_bottom = (mb_height * 16 - info.iHeight) / 2;
+    bw.putBit(crop_right || crop_bottom);
+    if (crop_right || crop_bottom) {
+        bw.putUE(0);
+        bw.putUE(crop_right);
+        bw.putUE(0);
+        bw.putUE(crop_bottom);
+    }
+    bw.putBit(1); // vui_parameters_present_flag
+    bw.putBits(0, 4); // aspect_ratio/overscan/video_signal_type/chroma_loc
+    bw.putBit(1); // timing_info_present_flag
+    bw.putBits(1000, 32); // num_units_in_tick
+    bw.putBits((uint32_t) lround(info.iFrameRate * 2000), 32); // time_scale
+    bw.putBit(1); // fixed_frame_rate_flag
+    bw.putBits(0, 4); // nal_hrd/vcl_hrd/pic_struct/bitstream_restriction
+    bw.putTrailingBits();
+    return bw.makeNal(string(1, 0x67));
+}
+
+static string makeH264PPS() {
+    BitWriter bw;
+    bw.putUE(0); // pic_parameter_set_id
+    bw.putUE(0); // seq_parameter_set_id
+    bw.putBit(0); // entropy_coding_mode_flag(cavlc)
+    bw.putBit(0); // bottom_field_pic_order_in_frame_present_flag
+    bw.putUE(0); // num_slice_groups_minus1
+    bw.putUE(0); // num_ref_idx_l0_default_active_minus1
+    bw.putUE(0); // num_ref_idx_l1_default_active_minus1
+    bw.putBit(0); // weighted_pred_flag
+    bw.putBits(0, 2); // weighted_bipred_idc
+    bw.putSE(0); // pic_init_qp_minus26
+    bw.putSE(0); // pic_init_qs_minus26
+    bw.putSE(0); // chroma_qp_index_offset
+    bw.putBit(1); // deblocking_filter_control_present_flag
+    bw.putBit(0); // constrained_intra_pred_flag
+    bw.putBit(0); // redundant_pic_cnt_present_flag
+    bw.putTrailingBits();
+    return bw.makeNal(string(1, 0x68));
+}
+
+/**
+ * 生成h264 slice
+ * 关键帧每个宏块为I_16x16_2_0_0(DC预测、无残差)，解码结果为灰色画面；p/b帧所有宏块均为skip
+ */
+static string makeH264Slice(const PictureInfo &pic, int mbs, uint32_t frame_num, uint32_t idr_pic_id) {
+    BitWriter bw;
+    bw.putUE(0); // first_mb_in_slice
+    bw.putUE(pic.type == 'I' ? 7 : (pic.type == 'P' ? 5 : 6));
+    bw.putUE(0); // pic_parameter_set_id
+    bw.putBits(frame_num, 16);
+    if (pic.type == 'I') {
+        bw.putUE(idr_pic_id);
+    }
+    bw.putBits((pic.display * 2) & 0xFFFF, 16); // pic_order_cnt_lsb
+    if (pic.type == 'B') {
+        bw.putBit(1); // direct_spatial_mv_pred_flag
+    }
+    if (pic.type != 'I') {
+        bw.putBit(0); // num_ref_idx_active_override_flag
+        bw.putBit(0); // ref_pic_list_modification_flag_l0
+        if (pic.type == 'B') {
+            bw.putBit(0); // ref_pic_list_modification_flag_l1
+        }
+    }
+    //b帧不作为参考帧，没有dec_ref_pic_marking
+    if (pic.type == 'I') {
+        bw.putBit(0); // no_output_of_prior_pics_flag
+        bw.putBit(0); // long_term_reference_flag
+    } else if (pic.type == 'P') {
+        bw.putBit(0); // adaptive_ref_pic_marking_mode_flag
+    }
+    bw.putSE(0); // slice_qp_delta
+    bw.putUE(1); // disable_deblocking_filter_idc
+
+    if (pic.type == 'I') {
+        for (int i = 0; i < mbs; ++i) {
+            bw.putUE(3); // mb_type
+            bw.putUE(0); // intra_chroma_pred_mode
+            bw.putSE(0); // mb_qp_delta
+            bw.putBit(1); // Intra16x16DCLevel coeff_token(TotalCoeff为0)
+        }
+    } else {
+        bw.putUE(mbs); // mb_skip_run
+    }
+    bw.putTrailingBits();
+    //idr帧nal_ref_idc为3，p帧为2，b帧为0
+    char header = pic.type == 'I' ? 0x65 : (pic.type == 'P' ? 0x41 : 0x01);
+    return bw.makeNal(string(1, header));
+}
+
+///////////////////////////////////////////SyntheticSource///////////////////////////////////////////
+
+SyntheticSource::SyntheticSource(const string &vhost, const string &app, const string &stream_id, const ProtocolOption &option)
+    : _channel(std::make_shared<DevChannel>(vhost, app, stream_id, 0, option)) {}
+
+bool SyntheticSource::initVideo(const VideoInfo &info, int gop, int b_frames) {
+    if (info.codecId != CodecH264 || info.iWidth < 16 || info.iHeight < 16 ||
+        info.iWidth % 2 || info.iHeight % 2 || info.iFrameRate <= 0 || gop <= 0 || b_frames < 0) {
+        WarnL << "合成视频参数不合法:" << getCodecName(info.codecId) << " " << info.iWidth << "x" << info.iHeight
+              << " fps:" << info.iFrameRate << " gop:" << gop << " b_frames:" << b_frames;
+        return false;
+    }
+    _video_info = info;
+    _gop = gop;
+    _b_frames = b_frames;
+    _have_video = _channel->initVideo(info);
+    return _have_video;
+}
+
+bool SyntheticSource::initAudio(const AudioInfo &info) {
+    _audio_info = info;
+    if (info.codecId == CodecOpus) {
+        _audio_info.iSampleRate = 48000;
+        _audio_samples = 960;
+    } else if (info.codecId == CodecAAC) {
+        _audio_samples = 1024;
+    } else {
+        WarnL << "合成音频不支持该编码:" << getCodecName(info.codecId);
+        return false;
+    }
+    makeAudioFrame();
+    if (!_audio_frame) {
+        return false;
+    }
+    _have_audio = _channel->initAudio(_audio_info);
+    return _have_audio;
+}
+
+void SyntheticSource::setOnClose(const function<void()> &cb) {
+    _on_close = cb;
+}
+
+void SyntheticSource::makeVideoLoop() {
+    auto codec = _video_info.codecId;
+    auto schedule = makeGopSchedule(_gop, _b_frames);
+    int mbs = ((_video_info.iWidth + 15) / 16) * ((_video_info.iHeight + 15) / 16);
+    //按码率分配每帧大小，关键帧占4帧的份额
+    size_t frame_bytes = (size_t) (_video_info.iBitRate / 8 / _video_info.iFrameRate);
+    size_t key_bytes = _gop > 4 ? frame_bytes * 4 : frame_bytes;
+    size_t other_bytes = _gop > 1 ? (frame_bytes * _gop - key_bytes) / (_gop - 1) : frame_bytes;
+
+    auto add_frame = [&](string nal, uint32_t decode_index, uint32_t display_index) {
+        _video_loop.push_back({ makeVideoFrame(codec, std::move(nal)), decode_index, display_index });
+    };
+
+    //循环两个gop，使相邻idr帧的idr_pic_id不同
+    uint32_t frame_num = 0;
+    uint32_t prev_ref_frame_num = 0;
+    for (int g = 0; g < 2; ++g) {
+        for (size_t i = 0; i < schedule.size(); ++i) {
+            auto &pic = schedule[i];
+            uint32_t decode_index = g * _gop + i;
+            uint32_t display_index = g * _gop + pic.display;
+            size_t size = 0;
+            if (pic.type == 'I') {
+                frame_num = prev_ref_frame_num = 0;
+                auto sps = makeH264SPS(_video_info, _b_frames);
+                auto pps = makeH264PPS();
+                size += sps.size() + pps.size();
+                add_frame(std::move(sps), decode_index, display_index);
+                add_frame(std::move(pps), decode_index, display_index);
+            } else {
+                //frame_num为上一个参考帧的frame_num加1，b帧不作为参考帧
+                frame_num = (prev_ref_frame_num + 1) & 0xFFFF;
+                if (pic.type == 'P') {
+                    prev_ref_frame_num = frame_num;
+                }
+            }
+            auto slice = makeH264Slice(pic, mbs, frame_num, g);
+            size += slice.size();
+            add_frame(std::move(slice), decode_index, display_index);
+
+            //不足目标码率的部分以填充数据补齐，起始码、nal头与结尾共占6字节
+            auto target = pic.type == 'I' ? key_bytes : other_bytes;
+            if (target > size + 6) {
+                string filler("\x00\x00\x00\x01", 4);
+                filler.push_back((char) kH264NalFiller);
+                filler.append(target - size - filler.size() - 1, (char) 0xFF);
+                filler.push_back((char) 0x80);
+                add_frame(std::move(filler), decode_index, display_index);
+            }
+        }
+    }
+}
+
+void SyntheticSource::makeAudioFrame() {
+    auto frame = FrameImp::create();
+    frame->_codec_id = _audio_info.codecId;
+    if (_audio_info.codecId == CodecOpus) {
+        //celt 20ms静音帧
+        frame->_buffer.assign("\xF8\xFF\xFE", 3);
+        _audio_frame = frame;
+        return;
+    }
+
+    static const int kSampleRates[] = { 96000, 88200, 64000, 48000, 44100, 32000, 24000, 22050, 16000, 12000, 11025, 8000, 7350 };
+    int rate_index = -1;
+    for (size_t i = 0; i < sizeof(kSampleRates) / sizeof(kSampleRates[0]); ++i) {
+        if (kSampleRates[i] == _audio_info.iSampleRate) {
+            rate_index = (int) i;
+            break;
+        }
+    }
+    if (rate_index < 0 || _audio_info.iChannel < 1 || _audio_info.iChannel > 2) {
+        WarnL << "合成aac参数不合法, 采样率:" << _audio_info.iSampleRate << ", 声道数:" << _audio_info.iChannel;
+        return;
+    }
+
+    //AudioSpecificConfig: aac lc
+    BitWriter config;
+    config.putBits(2, 5);
+    config.putBits(rate_index, 4);
+    config.putBits(_audio_info.iChannel, 4);
+    config.putBits(0, 3);
+
+    //raw_data_block: 单声道为SCE，双声道为CPE，max_sfb为0(无频谱数据)，解码结果为静音
+    BitWriter raw;
+    raw.putBits(_audio_info.iChannel == 1 ? 0 : 1, 3); // id_syn_ele
+    raw.putBits(0, 4); // element_instance_tag
+    if (_audio_info.iChannel == 2) {
+        raw.putBit(0); // common_window
+    }
+    for (int i = 0; i < _audio_info.iChannel; ++i) {
+        raw.putBits(100, 8); // global_gain
+        raw.putBit(0); // ics_reserved_bit
+        raw.putBits(0, 2); // window_sequence(ONLY_LONG_SEQUENCE)
+        raw.putBit(0); // window_shape
+        raw.putBits(0, 6); // max_sfb
+        raw.putBit(0); // predictor_data_present
+        raw.putBit(0); // pulse_data_present
+        raw.putBit(0); // tns_data_present
+        raw.putBit(0); // gain_control_data_present
+    }
+    raw.putBits(7, 3); // ID_END
+    raw.putAlignBits();
+    auto &payload = raw.data();
+
+    uint8_t adts[ADTS_HEADER_LEN];
+    dumpAacConfig(config.data(), payload.size(), adts, sizeof(adts));
+    frame->_buffer.assign((char *) adts, ADTS_HEADER_LEN);
+    frame->_buffer.append(payload);
+    frame->_prefix_size = ADTS_HEADER_LEN;
+    _audio_frame = frame;
+}
+
+void SyntheticSource::start() {
+    if (_have_video) {
+        makeVideoLoop();
+    }
+    //监听close等事件，使close_streams等接口能关闭本源
+    _channel->setMediaListener(shared_from_this());
+    _channel->addTrackCompleted();
+
+    double interval = 1.0;
+    if (_have_video) {
+        interval = min(interval, 1.0 / _video_info.iFrameRate);
+    }
+    if (_have_audio) {
+        interval = min(interval, (double) _audio_samples / _audio_info.iSampleRate);
+    }
+    _ticker.resetTime();
+    weak_ptr<SyntheticSource> weak_self = shared_from_this();
+    _timer = std::make_shared<Timer>((float) interval, [weak_self]() {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return false;
+        }
+        strong_self->onTick();
+        return true;
+    }, _channel->getOwnerPoller(MediaSource::NullMediaSource()));
+}
+
+void SyntheticSource::onTick() {
+    auto elapsed = _ticker.elapsedTime();
+    if (!_video_loop.empty()) {
+        //每个循环包含两个gop
+        uint64_t loop_frames = _gop * 2;
+        double frame_ms = 1000.0 / _video_info.iFrameRate;
+        //有b帧时显示时间戳整体延后一帧，确保pts不小于dts
+        uint32_t delay = _b_frames ? 1 : 0;
+        while (true) {
+            auto &item = _video_loop[_video_index % _video_loop.size()];
+            auto base = _video_index / _video_loop.size() * loop_frames;
+            auto dts = (uint64_t) ((base + item.decode_index) * frame_ms);
+            if (dts > elapsed) {
+                break;
+            }
+            auto pts = (uint64_t) ((base + item.display_index + delay) * frame_ms);
+            inputLoopFrame(item.frame, dts, pts);
+            ++_video_index;
+        }
+    }
+    if (_audio_frame) {
+        while (true) {
+            auto dts = _audio_index * _audio_samples * 1000 / _audio_info.iSampleRate;
+            if (dts > elapsed) {
+                break;
+            }
+            inputLoopFrame(_audio_frame, dts, dts);
+            ++_audio_index;
+        }
+    }
+}
+
+void SyntheticSource::inputLoopFrame(const Frame::Ptr &frame, uint64_t dts, uint64_t pts) {
+    //复用循环帧的内存，只修改时间戳
+    Frame::Ptr ret;
+    switch (frame->getCodecId()) {
+        case CodecH264:
+            ret = std::make_shared<FrameTSInternal<H264FrameNoCacheAble> >(frame, frame->data(), frame->size(), frame->prefixSize(), dts, pts);
+            break;
+        default: {
+            auto audio = std::make_shared<FrameTSInternal<FrameFromPtr> >(frame, frame->data(), frame->size(), frame->prefixSize(), dts, pts);
+            audio->setCodecId(frame->getCodecId());
+            ret = std::move(audio);
+            break;
+        }
+    }
+    //定时器运行在归属线程，直接输入，不经过DevChannel::inputFrame的线程切换
+    _channel->MultiMediaSourceMuxer::inputFrame(ret);
+}
+
+MediaOriginType SyntheticSource::getOriginType(MediaSource &sender) const {
+    return MediaOriginType::device_chn;
+}
+
+bool SyntheticSource::close(MediaSource &sender) {
+    WarnL << "close media: " << sender.getUrl();
+    //sender归属于本对象，不能在本函数内释放本对象，所以切换到归属线程后再停止定时器并通知外部
+    auto strong_self = shared_from_this();
+    _channel->getOwnerPoller(sender)->async([strong_self]() {
+        strong_self->_timer = nullptr;
+        if (strong_self->_on_close) {
+            strong_self->_on_close();
+        }
+    }, false);
+    return true;
+}
+
+} // namespace mediakit
@@ -0,0 +1,98 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_SYNTHETICSOURCE_H
+#define ZLMEDIAKIT_SYNTHETICSOURCE_H
+
+#include <vector>
+#include <functional>
+#include "Device.h"
+#include "Poller/Timer.h"
+
+namespace mediakit {
+
+/**
+ * 合成媒体源，无需编码器与媒体文件即可产生直播流，用于单独压测MultiMediaSourceMuxer、RingBuffer与各协议复用器
+ * 视频为h264骨架码流(cavlc)：关键帧为灰色画面，其余帧全部为skip宏块，不足目标码率的部分以填充数据(filler data)补齐
+ * h265只支持cabac熵编码，无法用同样的方式生成可解码的画面，因此不支持
+ * 音频为静音的aac/opus帧
+ * 所有帧在start时一次性生成，之后循环复用并只修改时间戳，运行时没有编码与内存拷贝开销
+ */
+class SyntheticSource : public MediaSourceEvent, public std::enable_shared_from_this<SyntheticSource> {
+public:
+    using Ptr = std::shared_ptr<SyntheticSource>;
+
+    SyntheticSource(const std::string &vhost, const std::string &app, const std::string &stream_id,
+                    const ProtocolOption &option = ProtocolOption());
+    ~SyntheticSource() override = default;
+
+    /**
+     * 初始化视频
+     * @param info codecId只支持h264，宽高须为偶数，iBitRate为目标码率(bit/s)
+     * @param gop 关键帧间隔，单位帧
+     * @param b_frames 相邻参考帧之间的b帧个数
+     */
+    bool initVideo(const VideoInfo &info, int gop, int b_frames = 0);
+
+    /**
+     * 初始化音频
+     * @param info codecId支持aac/opus，opus固定为48000hz
+     */
+    bool initAudio(const AudioInfo &info);
+
+    /**
+     * 生成循环帧并开始按时间戳输入，须在initVideo/initAudio之后调用
+     */
+    void start();
+
+    /**
+     * 设置被关闭(例如close_streams接口)时的回调
+     */
+    void setOnClose(const std::function<void()> &cb);
+
+private:
+    /////////////////////////////////MediaSourceEvent override/////////////////////////////////
+    MediaOriginType getOriginType(MediaSource &sender) const override;
+    bool close(MediaSource &sender) override;
+
+    void onTick();
+    void inputLoopFrame(const Frame::Ptr &frame, uint64_t dts, uint64_t pts);
+    void makeVideoLoop();
+    void makeAudioFrame();
+
+private:
+    struct LoopFrame {
+        Frame::Ptr frame;
+        //在循环内的解码序号与显示序号
+        uint32_t decode_index;
+        uint32_t display_index;
+    };
+
+    int _gop = 0;
+    int _b_frames = 0;
+    VideoInfo _video_info;
+    AudioInfo _audio_info;
+    bool _have_video = false;
+    bool _have_audio = false;
+    //已输入的帧个数
+    uint64_t _video_index = 0;
+    uint64_t _audio_index = 0;
+    //每帧音频的采样数
+    uint32_t _audio_samples = 0;
+    Frame::Ptr _audio_frame;
+    std::vector<LoopFrame> _video_loop;
+    DevChannel::Ptr _channel;
+    toolkit::Ticker _ticker;
+    toolkit::Timer::Ptr _timer;
+    std::function<void()> _on_close;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_SYNTHETICSOURCE_H
@@ -79,6 +79,8 @@ const string kEnableFFmpegLog = GENERAL_FIELD "enable_ffmpeg_log";
 const string kWaitTrackReadyMS = GENERAL_FIELD "wait_track_ready_ms";
 const string kWaitAddTrackMS = GENERAL_FIELD "wait_add_track_ms";
 const string kUnreadyFrameCache = GENERAL_FIELD "unready_frame_cache";
+const string kLogRateLimit = GENERAL_FIELD "log_rate_limit";
+const string kEnableProfiler = GENERAL_FIELD "enable_profiler";
 
 static onceToken token([]() {
     mINI::Instance()[kFlowThreshold] = 1024;
@@ -93,6 +95,8 @@ static onceToken token([]() {
     mINI::Instance()[kWaitTrackReadyMS] = 10000;
     mINI::Instance()[kWaitAddTrackMS] = 3000;
     mINI::Instance()[kUnreadyFrameCache] = 100;
+    mINI::Instance()[kLogRateLimit] = 0;
+    mINI::Instance()[kEnableProfiler] = 0;
 });
 
 } // namespace General
@@ -111,12 +115,14 @@ const string kEnableRtmp = PROTOCOL_FIELD "enable_rtmp";
 const string kEnableTS = PROTOCOL_FIELD "enable_ts";
 const string kEnableFMP4 = PROTOCOL_FIELD "enable_fmp4";
 const string kEnableDmsp = PROTOCOL_FIELD "enable_dmsp";
+const string kEnableDash = PROTOCOL_FIELD "enable_dash";
 
 const string kMP4AsPlayer = PROTOCOL_FIELD "mp4_as_player";
 const string kMP4MaxSecond = PROTOCOL_FIELD "mp4_max_second";
 const string kMP4SavePath = PROTOCOL_FIELD "mp4_save_path";
 
 const string kHlsSavePath = PROTOCOL_FIELD "hls_save_path";
+const string kDvrSecond = PROTOCOL_FIELD "dvr_second";
 
 const string kHlsDemand = PROTOCOL_FIELD "hls_demand";
 const string kRtspDemand = PROTOCOL_FIELD "rtsp_demand";
@@ -124,6 +130,7 @@ const string kRtmpDemand = PROTOCOL_FIELD "rtmp_demand";
 const string kTSDemand = PROTOCOL_FIELD "ts_demand";
 const string kFMP4Demand = PROTOCOL_FIELD "fmp4_demand";
 const string kDmspDemand = PROTOCOL_FIELD "dmsp_demand";
+const string kDashDemand = PROTOCOL_FIELD "dash_demand";
 
 static onceToken token([]() {
     mINI::Instance()[kModifyStamp] = 0;
@@ -138,12 +145,14 @@ static onceToken token([]() {
     mINI::Instance()[kEnableTS] = 1;
     mINI::Instance()[kEnableFMP4] = 1;
     mINI::Instance()[kEnableDmsp] = 0;
+    mINI::Instance()[kEnableDash] = 0;
 
     mINI::Instance()[kMP4AsPlayer] = 0;
     mINI::Instance()[kMP4MaxSecond] = 3600;
     mINI::Instance()[kMP4SavePath] = "./www";
 
     mINI::Instance()[kHlsSavePath] = "./www";
+    mINI::Instance()[kDvrSecond] = 0;
 
     mINI::Instance()[kHlsDemand] = 0;
     mINI::Instance()[kRtspDemand] = 0;
@@ -151,6 +160,7 @@ static onceToken token([]() {
     mINI::Instance()[kTSDemand] = 0;
     mINI::Instance()[kFMP4Demand] = 0;
     mINI::Instance()[kDmspDemand] = 0;
+    mINI::Instance()[kDashDemand] = 0;
 });
 } // !Protocol
 
@@ -279,11 +289,17 @@ const string kAddrMin = MULTI_FIELD "addrMin";
 const string kAddrMax = MULTI_FIELD "addrMax";
 // 组播TTL
 const string kUdpTTL = MULTI_FIELD "udpTTL";
+const string kInterface = MULTI_FIELD "interface";
+const string kSapInterval = MULTI_FIELD "sapInterval";
+const string kSapAddr = MULTI_FIELD "sapAddr";
 
 static onceToken token([]() {
     mINI::Instance()[kAddrMin] = "239.0.0.0";
     mINI::Instance()[kAddrMax] = "239.255.255.255";
     mINI::Instance()[kUdpTTL] = 64;
+    mINI::Instance()[kInterface] = "";
+    mINI::Instance()[kSapInterval] = 0;
+    mINI::Instance()[kSapAddr] = "239.255.255.255";
 });
 } // namespace MultiCast
 
@@ -295,6 +311,8 @@ const string kSampleMS = RECORD_FIELD "sampleMS";
 const string kFileBufSize = RECORD_FIELD "fileBufSize";
 const string kFastStart = RECORD_FIELD "fastStart";
 const string kFileRepeat = RECORD_FIELD "fileRepeat";
+const string kReadAheadSize = RECORD_FIELD "readAheadSize";
+const string kRetainDays = RECORD_FIELD "retainDays";
 
 static onceToken token([]() {
     mINI::Instance()[kAppName] = "record";
@@ -302,6 +320,8 @@ static onceToken token([]() {
     mINI::Instance()[kFileBufSize] = 64 * 1024;
     mINI::Instance()[kFastStart] = false;
     mINI::Instance()[kFileRepeat] = false;
+    mINI::Instance()[kReadAheadSize] = 1024 * 1024;
+    mINI::Instance()[kRetainDays] = 0;
 });
 } // namespace Record
 
@@ -315,6 +335,10 @@ const string kSegmentRetain = HLS_FIELD "segRetain";
 const string kFileBufSize = HLS_FIELD "fileBufSize";
 const string kBroadcastRecordTs = HLS_FIELD "broadcastRecordTs";
 const string kDeleteDelaySec = HLS_FIELD "deleteDelaySec";
+const string kMemoryMode = HLS_FIELD "memoryMode";
+const string kMemoryCacheMB = HLS_FIELD "memoryCacheMB";
+const string kPartDuration = HLS_FIELD "partDur";
+const string kFmp4 = HLS_FIELD "fmp4";
 
 static onceToken token([]() {
     mINI::Instance()[kSegmentDuration] = 2;
@@ -324,9 +348,29 @@ static onceToken token([]() {
     mINI::Instance()[kFileBufSize] = 64 * 1024;
     mINI::Instance()[kBroadcastRecordTs] = false;
     mINI::Instance()[kDeleteDelaySec] = 10;
+    mINI::Instance()[kMemoryMode] = false;
+    mINI::Instance()[kMemoryCacheMB] = 512;
+    mINI::Instance()[kPartDuration] = 0;
+    mINI::Instance()[kFmp4] = false;
 });
 } // namespace Hls
 
+////////////DASH相关配置///////////
+namespace Dash {
+#define DASH_FIELD "dash."
+const string kSegmentDuration = DASH_FIELD "segDur";
+const string kSegmentNum = DASH_FIELD "segNum";
+const string kSegmentRetain = DASH_FIELD "segRetain";
+const string kLowLatency = DASH_FIELD "lowLatency";
+
+static onceToken token([]() {
+    mINI::Instance()[kSegmentDuration] = 2;
+    mINI::Instance()[kSegmentNum] = 5;
+    mINI::Instance()[kSegmentRetain] = 3;
+    mINI::Instance()[kLowLatency] = 0;
+});
+} // namespace Dash
+
 ////////////Rtp代理相关配置///////////
 namespace RtpProxy {
 #define RTP_PROXY_FIELD "rtp_proxy."
@@ -365,6 +409,7 @@ const string kBeatIntervalMS = "beat_interval_ms";
 const string kBenchmarkMode = "benchmark_mode";
 const string kWaitTrackReady = "wait_track_ready";
 const string kPlayTrack = "play_track";
+const string kTsBitrate = "ts_bitrate";
 } // namespace Client
 
 //-----------------------------------------------
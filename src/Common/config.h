@@ -198,6 +198,10 @@ extern const std::string kWaitTrackReadyMS;
 extern const std::string kWaitAddTrackMS;
 // 如果track未就绪，我们先缓存帧数据，但是有最大个数限制(100帧时大约4秒)，防止内存溢出
 extern const std::string kUnreadyFrameCache;
+// 每个日志打印点每秒最多输出的日志条数，超出部分丢弃，防止异常情况下日志刷屏拖慢服务器，错误日志不限流，0为不限制(默认)
+extern const std::string kLogRateLimit;
+// 是否开启直播流输入链路(socket读取至写入RingBuffer)的分阶段延时统计，通过getIngestProfile接口查看，关闭时几乎无开销
+extern const std::string kEnableProfiler;
 } // namespace General
 
 namespace Protocol {
@@ -224,6 +228,8 @@ extern const std::string kEnableTS;
 extern const std::string kEnableFMP4;
 //是否开启转换为Dmsp
 extern const std::string kEnableDmsp;
+//是否开启转换为mpeg-dash，复用http-fmp4的切片数据，需要开启fmp4协议转换
+extern const std::string kEnableDash;
 
 //是否将mp4录制当做观看者
 extern const std::string kMP4AsPlayer;
@@ -235,6 +241,9 @@ extern const std::string kMP4SavePath;
 //hls录制保存路径
 extern const std::string kHlsSavePath;
 
+//时移窗口长度，单位秒，置0时关闭时移；开启后可通过stream@dvrN(或http-flv等的?start=N参数)播放N秒前的直播
+extern const std::string kDvrSecond;
+
 // 按需转协议的开关
 extern const std::string kHlsDemand;
 extern const std::string kRtspDemand;
@@ -242,6 +251,7 @@ extern const std::string kRtmpDemand;
 extern const std::string kTSDemand;
 extern const std::string kFMP4Demand;
 extern const std::string kDmspDemand;
+extern const std::string kDashDemand;
 } // !Protocol
 
 ////////////HTTP配置///////////
@@ -333,6 +343,12 @@ extern const std::string kAddrMin;
 extern const std::string kAddrMax;
 // 组播TTL
 extern const std::string kUdpTTL;
+// 组播出口网卡ip，为空时使用rtsp会话所在网卡
+extern const std::string kInterface;
+// sap广播组播sdp的间隔，单位秒，0为关闭
+extern const std::string kSapInterval;
+// sap广播地址
+extern const std::string kSapAddr;
 } // namespace MultiCast
 
 ////////////录像配置///////////
@@ -347,6 +363,10 @@ extern const std::string kFileBufSize;
 extern const std::string kFastStart;
 // mp4文件是否重头循环读取
 extern const std::string kFileRepeat;
+// mp4点播预读数据块大小，单位字节，多个相邻sample合并为一次磁盘读取
+extern const std::string kReadAheadSize;
+// mp4录像保留天数，超过后根据录像目录删除，置0时不删除
+extern const std::string kRetainDays;
 } // namespace Record
 
 ////////////HLS相关配置///////////
@@ -365,8 +385,28 @@ extern const std::string kFileBufSize;
 extern const std::string kBroadcastRecordTs;
 // hls直播文件删除延时，单位秒
 extern const std::string kDeleteDelaySec;
+// 是否开启hls内存模式，开启后直播切片与m3u8只保存在内存中，录制时才写文件
+extern const std::string kMemoryMode;
+// hls内存模式下，本节点所有切片占用内存的上限，单位MB，超过后按LRU淘汰
+extern const std::string kMemoryCacheMB;
+// 低延时hls(LL-HLS)的partial segment时长，单位秒，推荐0.2~0.5，设置为0则关闭低延时hls
+extern const std::string kPartDuration;
+// hls切片是否采用fmp4(CMAF)格式，开启后复用http-fmp4的切片数据，需要开启fmp4协议转换
+extern const std::string kFmp4;
 } // namespace Hls
 
+////////////DASH相关配置///////////
+namespace Dash {
+// DASH切片时长,单位秒，实际按关键帧切分
+extern const std::string kSegmentDuration;
+// mpd中的切片个数
+extern const std::string kSegmentNum;
+// 切片从mpd中移除后，继续保留在内存中的个数
+extern const std::string kSegmentRetain;
+// 是否开启低延时dash(LL-DASH)，开启后正在生成中的切片即可请求，以chunked方式按fmp4 fragment边生成边发送
+extern const std::string kLowLatency;
+} // namespace Dash
+
 ////////////Rtp代理相关配置///////////
 namespace RtpProxy {
 // rtp调试数据保存目录,置空则不生成
@@ -420,6 +460,9 @@ extern const std::string kWaitTrackReady;
 // rtsp播放指定track，可选项有0(不指定，默认)、1(视频)、2(音频)
 // 设置方法:player[Client::kPlayTrack] = 0/1/2;
 extern const std::string kPlayTrack;
+// mpeg-ts over udp/rtp推流的恒定码率(bit/s)，0或不设置时按帧时间戳以VBR方式发送
+// 设置方法:pusher[Client::kTsBitrate] = 8000000;
+extern const std::string kTsBitrate;
 } // namespace Client
 //-------------------------------------------------------------------
 //mgw业务配置
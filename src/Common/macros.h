@@ -65,6 +65,7 @@
 #define RTC_SCHEMA "rtc"
 #define RTMP_SCHEMA "rtmp"
 #define HLS_SCHEMA "hls"
+#define DASH_SCHEMA "dash"
 #define TS_SCHEMA "ts"
 #define FMP4_SCHEMA "fmp4"
 #define SRT_SCHEMA "srt"
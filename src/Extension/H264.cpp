@@ -186,7 +186,10 @@ bool H264Track::inputFrame_l(const Frame::Ptr &frame) {
             string sps = string(frame->data() + frame->prefixSize(), frame->size() - frame->prefixSize());
             _latest_is_config_frame = true;
             ret = VideoTrack::inputFrame(frame);
-            if (!_sps.empty() && _sps.compare(sps)) {
+            if (_sps.empty()) {
+                //第一次收到配置帧
+                _sps = move(sps);
+            } else if (_sps.compare(sps)) {
                 _sps_changed = true;
                 _sps = move(sps);
             }
@@ -196,7 +199,10 @@ bool H264Track::inputFrame_l(const Frame::Ptr &frame) {
             string pps = string(frame->data() + frame->prefixSize(), frame->size() - frame->prefixSize());
             _latest_is_config_frame = true;
             ret = VideoTrack::inputFrame(frame);
-            if (!_pps.empty() && _pps.compare(pps)) {
+            if (_pps.empty()) {
+                //第一次收到配置帧
+                _pps = move(pps);
+            } else if (_pps.compare(pps)) {
                 _pps_changed = true;
                 _pps = move(pps);
             }
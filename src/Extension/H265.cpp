@@ -123,7 +123,10 @@ bool H265Track::inputFrame_l(const Frame::Ptr &frame) {
     switch (H265_TYPE( frame->data()[frame->prefixSize()])) {
         case H265Frame::NAL_VPS: {
             string vps = string(frame->data() + frame->prefixSize(), frame->size() - frame->prefixSize());
-            if (!_vps.empty() && _vps.compare(vps)) {
+            if (_vps.empty()) {
+                //第一次收到配置帧
+                _vps = move(vps);
+            } else if (_vps.compare(vps)) {
                 _vps_changed = true;
                 _vps = move(vps);
             }
@@ -131,7 +134,10 @@ bool H265Track::inputFrame_l(const Frame::Ptr &frame) {
         }
         case H265Frame::NAL_SPS: {
             string sps = string(frame->data() + frame->prefixSize(), frame->size() - frame->prefixSize());
-            if (!_sps.empty() && _sps.compare(sps)) {
+            if (_sps.empty()) {
+                //第一次收到配置帧
+                _sps = move(sps);
+            } else if (_sps.compare(sps)) {
                 _sps_changed = true;
                 _sps = move(sps);
             }
@@ -139,7 +145,10 @@ bool H265Track::inputFrame_l(const Frame::Ptr &frame) {
         }
         case H265Frame::NAL_PPS: {
             string pps = string(frame->data() + frame->prefixSize(), frame->size() - frame->prefixSize());
-            if (!_pps.empty() && _pps.compare(pps)) {
+            if (_pps.empty()) {
+                //第一次收到配置帧
+                _pps = move(pps);
+            } else if (_pps.compare(pps)) {
                 _pps_changed = true;
                 _pps = move(pps);
             }
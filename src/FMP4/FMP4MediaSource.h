@@ -13,6 +13,7 @@
 
 #include "Common/MediaSource.h"
 #include "Common/PacketCache.h"
+#include "Common/IngestProfiler.h"
 #include "Util/RingBuffer.h"
 
 #define FMP4_GOP_SIZE 512
@@ -129,6 +130,7 @@ private:
     void onFlush(std::shared_ptr<toolkit::List<FMP4Packet::Ptr> > packet_list, bool key_pos) override {
         //如果不存在视频，那么就没有存在GOP缓存的意义，所以确保一直清空GOP缓存
         _ring->write(std::move(packet_list), _have_video ? key_pos : true);
+        IngestProfiler::onRingWrite(IngestProfiler::kStageFMP4);
     }
 
 private:
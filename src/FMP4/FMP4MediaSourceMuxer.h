@@ -15,6 +15,8 @@
 
 #include "FMP4MediaSource.h"
 #include "Record/MP4Muxer.h"
+#include "Record/HlsRecorder.h"
+#include "Record/DashRecorder.h"
 
 namespace mediakit {
 
@@ -55,7 +57,9 @@ public:
             _clear_cache = false;
             _media_src->clearCache();
         }
-        if (_enabled || !_option.fmp4_demand) {
+        auto hls = _hls;
+        auto dash = _dash;
+        if (_enabled || !_option.fmp4_demand || (hls && hls->isEnabled()) || (dash && dash->isEnabled())) {
             return MP4MuxerMemory::inputFrame(frame);
         }
         return false;
@@ -63,11 +67,54 @@ public:
 
     bool isEnabled() {
         //缓存尚未清空时，还允许触发inputFrame函数，以便及时清空缓存
+        auto hls = _hls;
+        if (hls && hls->isEnabled()) {
+            return true;
+        }
+        auto dash = _dash;
+        if (dash && dash->isEnabled()) {
+            return true;
+        }
         return _option.fmp4_demand ? (_clear_cache ? true : _enabled) : true;
     }
 
     void onAllTrackReady() {
-        _media_src->setInitSegment(getInitSegment());
+        auto init_segment = getInitSegment();
+        auto hls = _hls;
+        if (hls) {
+            hls->setInitSegment(init_segment);
+        }
+        auto dash = _dash;
+        if (dash) {
+            dash->setInitSegment(init_segment);
+        }
+        _media_src->setInitSegment(std::move(init_segment));
+    }
+
+    /**
+     * 设置fmp4切片的hls录制器，fragment将同时输出给hls，避免二次复用
+     */
+    void setHlsRecorder(std::shared_ptr<HlsRecorder> hls) {
+        if (hls) {
+            auto init_segment = _media_src->getInitSegment();
+            if (!init_segment.empty()) {
+                hls->setInitSegment(init_segment);
+            }
+        }
+        _hls = std::move(hls);
+    }
+
+    /**
+     * 设置dash直播，fragment将同时输出给dash，与hls、http-fmp4共用一次复用
+     */
+    void setDashRecorder(std::shared_ptr<DashRecorder> dash) {
+        if (dash) {
+            auto init_segment = _media_src->getInitSegment();
+            if (!init_segment.empty()) {
+                dash->setInitSegment(init_segment);
+            }
+        }
+        _dash = std::move(dash);
     }
 
 protected:
@@ -77,7 +124,17 @@ protected:
         }
         FMP4Packet::Ptr packet = std::make_shared<FMP4Packet>(std::move(string));
         packet->time_stamp = stamp;
-        _media_src->onWrite(std::move(packet), key_frame);
+        auto hls = _hls;
+        if (hls) {
+            hls->inputFMP4(packet, stamp, key_frame);
+        }
+        auto dash = _dash;
+        if (dash) {
+            dash->inputFMP4(packet, stamp, key_frame);
+        }
+        if (_enabled || !_option.fmp4_demand) {
+            _media_src->onWrite(std::move(packet), key_frame);
+        }
     }
 
 private:
@@ -85,6 +142,8 @@ private:
     bool _clear_cache = false;
     ProtocolOption _option;
     FMP4MediaSource::Ptr _media_src;
+    std::shared_ptr<HlsRecorder> _hls;
+    std::shared_ptr<DashRecorder> _dash;
 };
 
 }//namespace mediakit
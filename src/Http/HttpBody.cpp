@@ -324,4 +324,44 @@ Buffer::Ptr HttpBufferBody::readData(size_t size) {
     return Buffer::Ptr(std::move(_buffer));
 }
 
+//////////////////////////////////////////////////////////////////
+
+HttpChunkedBody::HttpChunkedBody(HttpBody::Ptr body) {
+    _body = std::move(body);
+}
+
+void HttpChunkedBody::readDataAsync(size_t size, const function<void(const Buffer::Ptr &buf)> &cb) {
+    if (_eof) {
+        //结束chunk已经发送
+        cb(nullptr);
+        return;
+    }
+    weak_ptr<HttpBody> weak_self = shared_from_this();
+    _body->readDataAsync(size, [weak_self, size, cb](const Buffer::Ptr &buf) {
+        auto strong_self = static_pointer_cast<HttpChunkedBody>(weak_self.lock());
+        if (!strong_self) {
+            return;
+        }
+        if (buf && !buf->size()) {
+            //空数据不能编码为chunk(会被当做结束chunk)，继续读取
+            strong_self->readDataAsync(size, cb);
+            return;
+        }
+        auto ret = std::make_shared<BufferLikeString>();
+        if (!buf) {
+            strong_self->_eof = true;
+            ret->append("0\r\n\r\n");
+            cb(ret);
+            return;
+        }
+        char header[32];
+        auto header_size = snprintf(header, sizeof(header), "%zx\r\n", buf->size());
+        ret->reserve(header_size + buf->size() + 2);
+        ret->append(header, header_size);
+        ret->append(buf->data(), buf->size());
+        ret->append("\r\n", 2);
+        cb(ret);
+    });
+}
+
 } // namespace mediakit
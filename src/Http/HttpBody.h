@@ -101,6 +101,28 @@ private:
     toolkit::Buffer::Ptr _buffer;
 };
 
+/**
+ * Transfer-Encoding: chunked方式发送的content
+ * 对被包装的content按其每次返回的数据进行chunk编码，被包装的content读完后追加结束chunk
+ * 适用于边生成边发送、长度未知的content(例如正在生成中的低延时切片)
+ */
+class HttpChunkedBody : public HttpBody {
+public:
+    using Ptr = std::shared_ptr<HttpChunkedBody>;
+    HttpChunkedBody(HttpBody::Ptr body);
+    ~HttpChunkedBody() override = default;
+
+    /**
+     * 长度未知，不设置content-length
+     */
+    int64_t remainSize() override { return -1; }
+    void readDataAsync(size_t size, const std::function<void(const toolkit::Buffer::Ptr &buf)> &cb) override;
+
+private:
+    bool _eof = false;
+    HttpBody::Ptr _body;
+};
+
 /**
  * 文件类型的content
  */
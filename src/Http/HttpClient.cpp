@@ -181,7 +181,7 @@ void HttpClient::onErr(const SockException &ex) {
 }
 
 ssize_t HttpClient::onRecvHeader(const char *data, size_t len) {
-    _parser.Parse(data);
+    _parser.Parse(data, len);
     if (_parser.Url() == "302" || _parser.Url() == "301" || _parser.Url() == "303") {
         auto new_url = Parser::merge_url(_url, _parser["Location"]);
         if (new_url.empty()) {
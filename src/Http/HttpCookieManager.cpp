@@ -153,15 +153,32 @@ HttpServerCookie::Ptr HttpCookieManager::getCookie(const string &cookie_name, co
     return it_cookie->second;
 }
 
+static string getCookieValue(const string &cookie_name, const string &cookie_header) {
+    auto cookie = FindField(cookie_header.data(), (cookie_name + "=").data(), ";");
+    if (cookie.empty()) {
+        cookie = FindField(cookie_header.data(), (cookie_name + "=").data(), nullptr);
+    }
+    return cookie;
+}
+
 HttpServerCookie::Ptr HttpCookieManager::getCookie(const string &cookie_name, const StrCaseMap &http_header) {
     auto it = http_header.find("Cookie");
     if (it == http_header.end()) {
         return nullptr;
     }
-    auto cookie = FindField(it->second.data(), (cookie_name + "=").data(), ";");
+    auto cookie = getCookieValue(cookie_name, it->second);
     if (cookie.empty()) {
-        cookie = FindField(it->second.data(), (cookie_name + "=").data(), nullptr);
+        return nullptr;
+    }
+    return getCookie(cookie_name, cookie);
+}
+
+HttpServerCookie::Ptr HttpCookieManager::getCookie(const string &cookie_name, const Parser &parser) {
+    auto &cookie_header = parser["Cookie"];
+    if (cookie_header.empty()) {
+        return nullptr;
     }
+    auto cookie = getCookieValue(cookie_name, cookie_header);
     if (cookie.empty()) {
         return nullptr;
     }
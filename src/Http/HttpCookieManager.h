@@ -182,6 +182,14 @@ public:
      */
     HttpServerCookie::Ptr getCookie(const std::string &cookie_name, const StrCaseMap &http_header);
 
+    /**
+     * 从http请求中获取cookie对象，不会触发Parser生成header map
+     * @param cookie_name cookie名，例如MY_SESSION
+     * @param parser http请求
+     * @return cookie对象
+     */
+    HttpServerCookie::Ptr getCookie(const std::string &cookie_name, const Parser &parser);
+
     /**
      * 根据uid获取cookie
      * @param cookie_name cookie名，例如MY_SESSION
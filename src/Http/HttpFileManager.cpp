@@ -18,6 +18,7 @@
 #include "HttpConst.h"
 #include "HttpSession.h"
 #include "Record/HlsMediaSource.h"
+#include "Record/DashMediaSource.h"
 #include "Common/Parser.h"
 #include "Common/config.h"
 #include "strCoding.h"
@@ -33,6 +34,7 @@ namespace mediakit {
 static int kHlsCookieSecond = 60;
 static const string kCookieName = "ZL_COOKIE";
 static const string kHlsSuffix = "/hls.m3u8";
+static const string kDashSuffix = "/dash.mpd";
 
 struct HttpCookieAttachment {
     //是否已经查找到过MediaSource
@@ -244,7 +246,7 @@ static void canAccessPath(Session &sender, const Parser &parser, const MediaInfo
     auto path = parser.Url();
 
     //先根据http头中的cookie字段获取cookie
-    HttpServerCookie::Ptr cookie = HttpCookieManager::Instance().getCookie(kCookieName, parser.getHeader());
+    HttpServerCookie::Ptr cookie = HttpCookieManager::Instance().getCookie(kCookieName, parser);
     //是否需要更新cookie
     bool update_cookie = false;
     if (!cookie && !uid.empty()) {
@@ -278,7 +280,8 @@ static void canAccessPath(Session &sender, const Parser &parser, const MediaInfo
         HttpCookieManager::Instance().delCookie(cookie);
     }
 
-    bool is_hls = media_info._schema == HLS_SCHEMA;
+    //dash与hls一样通过cookie鉴权与统计观看人数
+    bool is_hls = media_info._schema == HLS_SCHEMA || media_info._schema == DASH_SCHEMA;
 
     SockInfoImp::Ptr info = std::make_shared<SockInfoImp>();
     info->_identifier = sender.getIdentifier();
@@ -346,6 +349,81 @@ static string pathCat(const string &a, const string &b){
     return a + '/' + b;
 }
 
+/**
+ * hls内存模式、低延时hls或dash下，根据url查找内存中的切片
+ * 切片url为/app/stream_id/切片名，由于stream_id可能包含'/'，所以逐级尝试
+ * @param media_info http url信息
+ * @param cb 查找结果回调，未找到时回调nullptr，如果是即将生成的partial segment则等待其生成后再回调
+ * @return 是否找到对应的HlsMediaSource
+ */
+static bool findHlsSegment(const MediaInfo &media_info, const function<void(const Buffer::Ptr &segment)> &cb) {
+    GET_CONFIG(bool, memoryMode, Hls::kMemoryMode);
+    GET_CONFIG(float, partDuration, Hls::kPartDuration);
+    auto &stream_id = media_info._streamid;
+    //dash切片只保存在内存中
+    bool is_dash = end_with(stream_id, ".m4s");
+    if (!is_dash && !memoryMode && partDuration <= 0) {
+        return false;
+    }
+    for (auto pos = stream_id.find('/'); pos != string::npos; pos = stream_id.find('/', pos + 1)) {
+        auto src = dynamic_pointer_cast<HlsMediaSource>(MediaSource::find(is_dash ? DASH_SCHEMA : HLS_SCHEMA, media_info._vhost, media_info._app, stream_id.substr(0, pos)));
+        if (src) {
+            src->getSegment(stream_id.substr(pos + 1), cb);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * 低延时dash下，根据url查找正在生成中的切片
+ */
+static DashLiveSegment::Ptr findDashLiveSegment(const MediaInfo &media_info) {
+    auto &stream_id = media_info._streamid;
+    if (!end_with(stream_id, ".m4s")) {
+        return nullptr;
+    }
+    for (auto pos = stream_id.find('/'); pos != string::npos; pos = stream_id.find('/', pos + 1)) {
+        auto src = dynamic_pointer_cast<DashMediaSource>(MediaSource::find(DASH_SCHEMA, media_info._vhost, media_info._app, stream_id.substr(0, pos)));
+        if (src) {
+            return src->getLiveSegment(stream_id.substr(pos + 1));
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * 正在生成中的dash切片content，每次读取一个fmp4 fragment，尚未生成时等待
+ * 多个http会话共享同一个DashLiveSegment，各自记录读取位置
+ */
+class DashLiveSegmentBody : public HttpBody {
+public:
+    DashLiveSegmentBody(DashLiveSegment::Ptr segment) : _segment(std::move(segment)) {}
+
+    int64_t remainSize() override { return -1; }
+
+    void readDataAsync(size_t size, const function<void(const Buffer::Ptr &buf)> &cb) override {
+        _segment->read(_index++, cb);
+    }
+
+private:
+    size_t _index = 0;
+    DashLiveSegment::Ptr _segment;
+};
+
+/**
+ * 获取m3u8索引文件，如果是低延时hls的阻塞式请求(带_HLS_msn参数)，那么等待m3u8更新后再回调
+ */
+static void getHlsIndexFile(const HlsMediaSource::Ptr &src, const Parser &parser, const function<void(const string &file)> &cb) {
+    auto &msn = parser.getUrlArgs()["_HLS_msn"];
+    if (msn.empty()) {
+        src->getIndexFile(cb);
+        return;
+    }
+    auto &part = parser.getUrlArgs()["_HLS_part"];
+    src->getIndexFile(atoll(msn.data()), part.empty() ? -1 : atoll(part.data()), cb);
+}
+
 /**
  * 访问文件
  * @param sender 事件触发者
@@ -354,22 +432,66 @@ static string pathCat(const string &a, const string &b){
  * @param file_path 文件绝对路径
  * @param cb 回调对象
  */
+static void accessFile_l(Session &sender, const Parser &parser, const MediaInfo &media_info, const string &file_path,
+                         const Buffer::Ptr &hls_segment, const DashLiveSegment::Ptr &live_segment, const HttpFileManager::invoker &cb);
+
 static void accessFile(Session &sender, const Parser &parser, const MediaInfo &media_info, const string &file_path, const HttpFileManager::invoker &cb) {
-    bool is_hls = end_with(file_path, kHlsSuffix);
-    if (!is_hls && !File::fileExist(file_path.data())) {
+    bool is_hls = end_with(file_path, kHlsSuffix) || end_with(file_path, kDashSuffix);
+    if (is_hls || File::fileExist(file_path.data())) {
+        accessFile_l(sender, parser, media_info, file_path, nullptr, nullptr, cb);
+        return;
+    }
+
+    if (auto live_segment = findDashLiveSegment(media_info)) {
+        //低延时dash，正在生成中的切片以chunked方式边生成边发送
+        accessFile_l(sender, parser, media_info, file_path, nullptr, live_segment, cb);
+        return;
+    }
+
+    //文件不存在时，尝试从内存中查找hls切片
+    weak_ptr<Session> weak_session = sender.shared_from_this();
+    auto found = findHlsSegment(media_info, [weak_session, parser, media_info, file_path, cb](const Buffer::Ptr &segment) {
+        auto strong_session = weak_session.lock();
+        if (!strong_session) {
+            // http客户端已经断开，不需要回复
+            return;
+        }
+        if (!segment) {
+            sendNotFound(cb);
+            return;
+        }
+        //可能是在切片生成线程回调，切换到http会话线程
+        strong_session->async([weak_session, parser, media_info, file_path, segment, cb]() {
+            auto strong_session = weak_session.lock();
+            if (strong_session) {
+                accessFile_l(*strong_session, parser, media_info, file_path, segment, nullptr, cb);
+            }
+        });
+    });
+    if (!found) {
         //文件不存在且不是hls,那么直接返回404
         sendNotFound(cb);
-        return;
     }
+}
+
+static void accessFile_l(Session &sender, const Parser &parser, const MediaInfo &media_info, const string &file_path,
+                         const Buffer::Ptr &hls_segment, const DashLiveSegment::Ptr &live_segment, const HttpFileManager::invoker &cb) {
+    bool is_hls = end_with(file_path, kHlsSuffix);
+    bool is_dash = end_with(file_path, kDashSuffix);
     if (is_hls) {
         // hls，那么移除掉后缀获取真实的stream_id并且修改协议为HLS
         const_cast<string &>(media_info._schema) = HLS_SCHEMA;
         replace(const_cast<string &>(media_info._streamid), kHlsSuffix, "");
+    } else if (is_dash) {
+        // dash的mpd与hls的m3u8处理方式一致
+        const_cast<string &>(media_info._schema) = DASH_SCHEMA;
+        replace(const_cast<string &>(media_info._streamid), kDashSuffix, "");
+        is_hls = true;
     }
 
     weak_ptr<Session> weakSession = sender.shared_from_this();
     //判断是否有权限访问该文件
-    canAccessPath(sender, parser, media_info, false, [cb, file_path, parser, is_hls, media_info, weakSession](const string &err_msg, const HttpServerCookie::Ptr &cookie) {
+    canAccessPath(sender, parser, media_info, false, [cb, file_path, parser, is_hls, is_dash, hls_segment, live_segment, media_info, weakSession](const string &err_msg, const HttpServerCookie::Ptr &cookie) {
         auto strongSession = weakSession.lock();
         if (!strongSession) {
             // http客户端已经断开，不需要回复
@@ -409,9 +531,76 @@ static void accessFile(Session &sender, const Parser &parser, const MediaInfo &m
                     break;
                 }
             }
-            invoker.responseFile(parser.getHeader(), httpHeader, file_content.empty() ? file_path : file_content, !is_hls && !is_forbid_cache, file_content.empty());
+            //responseFile只用到请求头中的Range，不必为每个请求生成完整的header map
+            StrCaseMap requestHeader;
+            auto &range = parser["Range"];
+            if (!range.empty()) {
+                requestHeader.emplace("Range", range);
+            }
+            invoker.responseFile(requestHeader, httpHeader, file_content.empty() ? file_path : file_content, !is_hls && !is_forbid_cache, file_content.empty());
         };
 
+        if (hls_segment) {
+            //内存中的ts切片，直接发送而不拷贝
+            StrCaseMap httpHeader;
+            if (cookie) {
+                httpHeader["Set-Cookie"] = cookie->getCookie(cookie->getAttach<HttpCookieAttachment>()._path);
+            }
+            int code = 200;
+            Buffer::Ptr body = hls_segment;
+            auto &range = parser["Range"];
+            if (!range.empty()) {
+                //分节下载，与文件的处理方式一致
+                int64_t size = hls_segment->size();
+                int64_t range_start = atoll(FindField(range.data(), "bytes=", "-").data());
+                int64_t range_end = atoll(FindField(range.data(), "-", nullptr).data());
+                if (range_end == 0 || range_end >= size) {
+                    range_end = size - 1;
+                }
+                if (range_start < 0 || range_start > range_end) {
+                    httpHeader["Content-Range"] = "bytes */" + to_string(size);
+                    cb(416, "text/html", httpHeader, nullptr);
+                    return;
+                }
+                code = 206;
+                body = std::make_shared<BufferOffset<Buffer::Ptr> >(hls_segment, range_start, range_end - range_start + 1);
+                httpHeader.emplace("Content-Range", StrPrinter << "bytes " << range_start << "-" << range_end << "/" << size << endl);
+            }
+            if (cookie) {
+                auto &attach = cookie->getAttach<HttpCookieAttachment>();
+                if (attach._hls_data) {
+                    attach._hls_data->addByteUsage(body->size());
+                }
+            }
+            cb(code, HttpFileManager::getContentType(file_path.data()), httpHeader, std::make_shared<HttpBufferBody>(std::move(body)));
+            return;
+        }
+
+        if (live_segment) {
+            //正在生成中的dash切片，长度未知，以chunked方式发送已生成的及后续生成的fragment
+            StrCaseMap httpHeader;
+            if (cookie) {
+                httpHeader["Set-Cookie"] = cookie->getCookie(cookie->getAttach<HttpCookieAttachment>()._path);
+            }
+            httpHeader["Transfer-Encoding"] = "chunked";
+            cb(200, HttpFileManager::getContentType(file_path.data()), httpHeader,
+               std::make_shared<HttpChunkedBody>(std::make_shared<DashLiveSegmentBody>(live_segment)));
+            return;
+        }
+
+        if (is_hls && !cookie) {
+            GET_CONFIG(bool, memoryMode, Hls::kMemoryMode);
+            GET_CONFIG(float, partDuration, Hls::kPartDuration);
+            auto src = memoryMode || partDuration > 0 || is_dash ? dynamic_pointer_cast<HlsMediaSource>(MediaSource::find(media_info)) : nullptr;
+            if (src) {
+                //内存模式(包括dash)下不存在m3u8文件，低延时hls需要阻塞式获取m3u8，所以从内存获取m3u8索引文件
+                getHlsIndexFile(src, parser, [response_file, cookie, cb, file_path, parser](const string &file) {
+                    response_file(cookie, cb, file_path, parser, file);
+                });
+                return;
+            }
+        }
+
         if (!is_hls || !cookie) {
             //不是hls或访问m3u8文件不带cookie, 直接回复文件或404
             response_file(cookie, cb, file_path, parser);
@@ -424,7 +613,9 @@ static void accessFile(Session &sender, const Parser &parser, const MediaInfo &m
         auto src = cookie->getAttach<HttpCookieAttachment>()._hls_data->getMediaSource();
         if (src) {
             //直接从内存获取m3u8索引文件(而不是从文件系统)
-            response_file(cookie, cb, file_path, parser, src->getIndexFile());
+            getHlsIndexFile(src, parser, [response_file, cookie, cb, file_path, parser](const string &file) {
+                response_file(cookie, cb, file_path, parser, file);
+            });
             return;
         }
         if (cookie->getAttach<HttpCookieAttachment>()._find_src) {
@@ -450,7 +641,7 @@ static void accessFile(Session &sender, const Parser &parser, const MediaInfo &m
             attach._find_src = true;
 
             // m3u8文件可能不存在, 等待m3u8索引文件按需生成
-            hls->getIndexFile([response_file, file_path, cookie, cb, parser](const string &file) {
+            getHlsIndexFile(hls, parser, [response_file, file_path, cookie, cb, parser](const string &file) {
                 response_file(cookie, cb, file_path, parser, file);
             });
         });
@@ -60,7 +60,7 @@ ssize_t HttpSession::onRecvHeader(const char *header,size_t len) {
         s_func_map.emplace("OPTIONS",&HttpSession::Handle_Req_OPTIONS);
     }, nullptr);
 
-    _parser.Parse(header);
+    _parser.Parse(header, len);
     CHECK(_parser.Url()[0] == '/');
 
     urlDecode(_parser);
@@ -207,6 +207,12 @@ bool HttpSession::checkLiveStream(const string &schema, const string  &url_suffi
         return false;
     }
 
+    it = _parser.getUrlArgs().find("start");
+    if (it != _parser.getUrlArgs().end() && !it->second.empty()) {
+        //携带start参数时播放时移流，从start秒前开始播放
+        _mediaInfo._streamid += "@dvr" + it->second;
+    }
+
     bool close_flag = !strcasecmp(_parser["Connection"].data(), "close");
     weak_ptr<HttpSession> weak_self = dynamic_pointer_cast<HttpSession>(shared_from_this());
 
@@ -515,6 +521,7 @@ static const string kConnection = "Connection";
 static const string kKeepAlive = "Keep-Alive";
 static const string kContentType = "Content-Type";
 static const string kContentLength = "Content-Length";
+static const string kTransferEncoding = "Transfer-Encoding";
 static const string kAccessControlAllowOrigin = "Access-Control-Allow-Origin";
 static const string kAccessControlAllowCredentials = "Access-Control-Allow-Credentials";
 
@@ -534,7 +541,10 @@ void HttpSession::sendResponse(int code,
         size = body->remainSize();
     }
 
-    if (no_content_length) {
+    //chunked方式的body自带结束标记，不需要content-length，也不需要发送完毕后关闭连接
+    auto it = header.find(kTransferEncoding);
+    bool chunked = it != header.end() && !strcasecmp(it->second.data(), "chunked");
+    if (no_content_length || chunked) {
         // http-flv直播是Keep-Alive类型
         bClose = false;
     } else if ((size_t)size >= SIZE_MAX || size < 0) {
@@ -559,7 +569,7 @@ void HttpSession::sendResponse(int code,
         headerOut.emplace(kAccessControlAllowCredentials, "true");
     }
 
-    if (!no_content_length && size >= 0 && (size_t)size < SIZE_MAX) {
+    if (!no_content_length && !chunked && size >= 0 && (size_t)size < SIZE_MAX) {
         //文件长度为固定值,且不是http-flv强制设置Content-Length
         headerOut[kContentLength] = to_string(size);
     }
@@ -636,7 +646,17 @@ string HttpSession::urlDecode(const string &str){
 }
 
 void HttpSession::urlDecode(Parser &parser){
+#ifndef _WIN32
+    //不含转义字符时无需解码，url参数map也不必提前生成(由Parser按需生成)
+    if (parser.Url().find('%') != string::npos) {
+        parser.setUrl(urlDecode(parser.Url()));
+    }
+    if (parser.Params().find('%') == string::npos) {
+        return;
+    }
+#else
     parser.setUrl(urlDecode(parser.Url()));
+#endif // _WIN32
     for(auto &pr : _parser.getUrlArgs()){
         const_cast<string &>(pr.second) = urlDecode(pr.second);
     }
@@ -672,8 +692,11 @@ bool HttpSession::emitHttpEvent(bool doInvoke){
 
 std::string HttpSession::get_peer_ip() {
     GET_CONFIG(string, forwarded_ip_header, Http::kForwardedIpHeader);
-    if(!forwarded_ip_header.empty() && !_parser.getHeader()[forwarded_ip_header].empty()){
-        return _parser.getHeader()[forwarded_ip_header];
+    if (!forwarded_ip_header.empty()) {
+        auto &forwarded_ip = _parser[forwarded_ip_header.data()];
+        if (!forwarded_ip.empty()) {
+            return forwarded_ip;
+        }
     }
     return Session::get_peer_ip();
 }
@@ -13,6 +13,7 @@
 #include "Rtsp/RtspPusher.h"
 #include "Rtmp/RtmpPusher.h"
 #include "Dmsp/DmspPusher.h"
+#include "TS/TSUdpPusher.h"
 
 using namespace toolkit;
 
@@ -50,6 +51,10 @@ PusherBase::Ptr PusherBase::createPusher(const EventPoller::Ptr &poller,
         return PusherBase::Ptr(new DmspPusherImp(poller, std::dynamic_pointer_cast<DmspMediaSource>(src)), releasePusher);
     }
 
+    if (strcasecmp("udp", prefix.data()) == 0 || strcasecmp("rtp", prefix.data()) == 0) {
+        return PusherBase::Ptr(new TSUdpPusherImp(poller, std::dynamic_pointer_cast<TSMediaSource>(src)), releasePusher);
+    }
+
     throw std::invalid_argument("not supported push schema:" + url);
 }
 
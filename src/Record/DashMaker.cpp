@@ -0,0 +1,616 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <ctime>
+#include <functional>
+#include "DashMaker.h"
+#include "Common/config.h"
+#include "Util/util.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+#define FOURCC(a, b, c, d) (((uint32_t) (a) << 24) | ((uint32_t) (b) << 16) | ((uint32_t) (c) << 8) | (uint32_t) (d))
+
+static inline uint32_t loadBE16(const uint8_t *p) {
+    return ((uint32_t) p[0] << 8) | p[1];
+}
+
+static inline uint32_t loadBE32(const uint8_t *p) {
+    return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+static inline uint64_t loadBE64(const uint8_t *p) {
+    return ((uint64_t) loadBE32(p) << 32) | loadBE32(p + 4);
+}
+
+using BoxCB = function<void(uint32_t type, const uint8_t *payload, size_t size)>;
+
+/**
+ * 遍历同一层级的mp4 box
+ */
+static void forEachBox(const uint8_t *data, size_t len, const BoxCB &cb) {
+    while (len >= 8) {
+        uint64_t size = loadBE32(data);
+        auto type = loadBE32(data + 4);
+        size_t header = 8;
+        if (size == 1) {
+            if (len < 16) {
+                return;
+            }
+            size = loadBE64(data + 8);
+            header = 16;
+        } else if (size == 0) {
+            //box延续到数据末尾
+            size = len;
+        }
+        if (size < header || size > len) {
+            return;
+        }
+        cb(type, data + header, size - header);
+        data += size;
+        len -= size;
+    }
+}
+
+/**
+ * 读取mpeg4描述符头(ISO/IEC 14496-1)
+ */
+static bool readDescriptor(const uint8_t *&ptr, const uint8_t *end, uint8_t &tag, size_t &len) {
+    if (ptr >= end) {
+        return false;
+    }
+    tag = *ptr++;
+    len = 0;
+    for (int i = 0; i < 4 && ptr < end; ++i) {
+        auto byte = *ptr++;
+        len = (len << 7) | (byte & 0x7F);
+        if (!(byte & 0x80)) {
+            break;
+        }
+    }
+    return ptr + len <= end;
+}
+
+static string getAacCodec(const uint8_t *esds, size_t size) {
+    //跳过version与flags
+    if (size < 4) {
+        return "";
+    }
+    auto ptr = esds + 4, end = esds + size;
+    uint8_t tag;
+    size_t len;
+    if (!readDescriptor(ptr, end, tag, len) || tag != 0x03 || len < 3) {
+        return "";
+    }
+    //ES_Descriptor
+    auto flags = ptr[2];
+    ptr += 3;
+    if (flags & 0x80) {
+        ptr += 2;
+    }
+    if ((flags & 0x40) && ptr < end) {
+        ptr += 1 + *ptr;
+    }
+    if (flags & 0x20) {
+        ptr += 2;
+    }
+    //DecoderConfigDescriptor
+    if (!readDescriptor(ptr, end, tag, len) || tag != 0x04 || len < 13) {
+        return "";
+    }
+    auto object_type = ptr[0];
+    ptr += 13;
+    int audio_object_type = 0;
+    //DecoderSpecificInfo，即AudioSpecificConfig
+    if (readDescriptor(ptr, end, tag, len) && tag == 0x05 && len >= 1) {
+        audio_object_type = ptr[0] >> 3;
+        if (audio_object_type == 31 && len >= 2) {
+            audio_object_type = 32 + (((ptr[0] & 0x07) << 3) | (ptr[1] >> 5));
+        }
+    }
+    char buf[32];
+    if (audio_object_type) {
+        snprintf(buf, sizeof(buf), "mp4a.%02x.%d", object_type, audio_object_type);
+    } else {
+        snprintf(buf, sizeof(buf), "mp4a.%02x", object_type);
+    }
+    return buf;
+}
+
+static string getHevcCodec(const string &prefix, const uint8_t *hvcc, size_t size) {
+    if (size < 13) {
+        return prefix;
+    }
+    //rfc6381/ISO 14496-15附录E.3: hvc1.[profile_space]profile_idc.compatibility_flags.[L|H]level.constraint_flags
+    static const char *kProfileSpace[] = { "", "A", "B", "C" };
+    auto profile_space = hvcc[1] >> 6;
+    auto tier = (hvcc[1] >> 5) & 0x01;
+    auto profile_idc = hvcc[1] & 0x1F;
+    //兼容性标志按位倒序
+    uint32_t flags = loadBE32(hvcc + 2), reversed = 0;
+    for (int i = 0; i < 32; ++i) {
+        reversed = (reversed << 1) | ((flags >> i) & 0x01);
+    }
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s.%s%d.%X.%c%d", prefix.data(), kProfileSpace[profile_space], profile_idc, reversed, tier ? 'H' : 'L', hvcc[12]);
+    string ret = buf;
+    //约束标志省略末尾的0
+    int last = 11;
+    while (last >= 6 && !hvcc[last]) {
+        --last;
+    }
+    for (int i = 6; i <= last; ++i) {
+        snprintf(buf, sizeof(buf), ".%X", hvcc[i]);
+        ret += buf;
+    }
+    return ret;
+}
+
+static string fourccToString(uint32_t type) {
+    string ret;
+    for (int shift = 24; shift >= 0; shift -= 8) {
+        ret.push_back((char) ((type >> shift) & 0xFF));
+    }
+    return ret;
+}
+
+/**
+ * 解析stsd中的第一个sample entry
+ */
+static void parseSampleEntry(uint32_t type, const uint8_t *payload, size_t size, uint32_t &width, uint32_t &height, uint32_t &sample_rate, string &codec) {
+    codec = fourccToString(type);
+    switch (type) {
+        case FOURCC('a', 'v', 'c', '1'):
+        case FOURCC('a', 'v', 'c', '3'):
+        case FOURCC('h', 'v', 'c', '1'):
+        case FOURCC('h', 'e', 'v', '1'): {
+            //VisualSampleEntry固定78字节
+            if (size < 78) {
+                return;
+            }
+            width = loadBE16(payload + 24);
+            height = loadBE16(payload + 26);
+            auto prefix = codec;
+            forEachBox(payload + 78, size - 78, [&](uint32_t child, const uint8_t *data, size_t len) {
+                if (child == FOURCC('a', 'v', 'c', 'C') && len >= 4) {
+                    char buf[32];
+                    snprintf(buf, sizeof(buf), "%s.%02X%02X%02X", prefix.data(), data[1], data[2], data[3]);
+                    codec = buf;
+                } else if (child == FOURCC('h', 'v', 'c', 'C')) {
+                    codec = getHevcCodec(prefix, data, len);
+                }
+            });
+            break;
+        }
+        case FOURCC('m', 'p', '4', 'a'): {
+            //AudioSampleEntry固定28字节
+            if (size < 28) {
+                return;
+            }
+            sample_rate = loadBE32(payload + 24) >> 16;
+            forEachBox(payload + 28, size - 28, [&](uint32_t child, const uint8_t *data, size_t len) {
+                if (child == FOURCC('e', 's', 'd', 's')) {
+                    auto aac = getAacCodec(data, len);
+                    if (!aac.empty()) {
+                        codec = aac;
+                    }
+                }
+            });
+            break;
+        }
+        case FOURCC('O', 'p', 'u', 's'): {
+            codec = "opus";
+            if (size >= 28) {
+                sample_rate = loadBE32(payload + 24) >> 16;
+            }
+            break;
+        }
+        default: break;
+    }
+}
+
+/**
+ * 格式化为ISO 8601 utc时间
+ */
+static string getUtcTimeStr(uint64_t ms) {
+    time_t sec = ms / 1000;
+    struct tm tm;
+#if defined(_WIN32)
+    gmtime_s(&tm, &sec);
+#else
+    gmtime_r(&sec, &tm);
+#endif
+    char buf[64];
+    auto size = strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S", &tm);
+    snprintf(buf + size, sizeof(buf) - size, ".%03uZ", (unsigned) (ms % 1000));
+    return buf;
+}
+
+static string escapeXml(const string &str) {
+    string ret;
+    for (auto ch : str) {
+        switch (ch) {
+            case '&': ret += "&amp;"; break;
+            case '<': ret += "&lt;"; break;
+            case '>': ret += "&gt;"; break;
+            case '"': ret += "&quot;"; break;
+            default: ret.push_back(ch); break;
+        }
+    }
+    return ret;
+}
+
+DashMaker::DashMaker(float seg_duration, uint32_t seg_number, string params, bool low_latency) {
+    _low_latency = low_latency;
+    _seg_duration = seg_duration;
+    //至少保留2个切片，否则播放器无法连续播放
+    _seg_number = MAX(seg_number, 2u);
+    _params = std::move(params);
+}
+
+const string &DashMaker::getInitSegmentName() {
+    static const string kInitSegmentName = "init.m4s";
+    return kInitSegmentName;
+}
+
+string DashMaker::getSegmentName(uint64_t index) {
+    return to_string(index) + ".m4s";
+}
+
+void DashMaker::setInitSegment(const string &init_segment) {
+    if (init_segment == _init_segment) {
+        return;
+    }
+    if (!_init_segment.empty()) {
+        //track发生变化，时间轴重新开始
+        resetTimeline();
+    }
+    _init_segment = init_segment;
+    parseInitSegment(_init_segment);
+    onWriteInitSegment(_init_segment);
+}
+
+void DashMaker::parseInitSegment(const string &init_segment) {
+    _tracks.clear();
+    _main_track = 0;
+    forEachBox((uint8_t *) init_segment.data(), init_segment.size(), [&](uint32_t type, const uint8_t *moov, size_t moov_size) {
+        if (type != FOURCC('m', 'o', 'o', 'v')) {
+            return;
+        }
+        forEachBox(moov, moov_size, [&](uint32_t type, const uint8_t *trak, size_t trak_size) {
+            if (type != FOURCC('t', 'r', 'a', 'k')) {
+                return;
+            }
+            uint32_t track_id = 0;
+            TrackInfo info;
+            forEachBox(trak, trak_size, [&](uint32_t type, const uint8_t *data, size_t size) {
+                if (type == FOURCC('t', 'k', 'h', 'd') && size >= 24) {
+                    track_id = loadBE32(data + (data[0] == 1 ? 20 : 12));
+                    return;
+                }
+                if (type != FOURCC('m', 'd', 'i', 'a')) {
+                    return;
+                }
+                forEachBox(data, size, [&](uint32_t type, const uint8_t *data, size_t size) {
+                    if (type == FOURCC('m', 'd', 'h', 'd') && size >= 24) {
+                        info.timescale = loadBE32(data + (data[0] == 1 ? 20 : 12));
+                    } else if (type == FOURCC('h', 'd', 'l', 'r') && size >= 12) {
+                        info.video = loadBE32(data + 8) == FOURCC('v', 'i', 'd', 'e');
+                    } else if (type == FOURCC('m', 'i', 'n', 'f')) {
+                        forEachBox(data, size, [&](uint32_t type, const uint8_t *data, size_t size) {
+                            if (type != FOURCC('s', 't', 'b', 'l')) {
+                                return;
+                            }
+                            forEachBox(data, size, [&](uint32_t type, const uint8_t *data, size_t size) {
+                                if (type != FOURCC('s', 't', 's', 'd') || size < 8) {
+                                    return;
+                                }
+                                bool first = true;
+                                forEachBox(data + 8, size - 8, [&](uint32_t type, const uint8_t *data, size_t size) {
+                                    if (first) {
+                                        first = false;
+                                        parseSampleEntry(type, data, size, info.width, info.height, info.sample_rate, info.codec);
+                                    }
+                                });
+                            });
+                        });
+                    }
+                });
+            });
+            if (track_id && info.timescale) {
+                _tracks[track_id] = info;
+            }
+        });
+    });
+
+    for (auto &pr : _tracks) {
+        if (!_main_track || (pr.second.video && !_tracks[_main_track].video)) {
+            _main_track = pr.first;
+        }
+    }
+    if (!_main_track) {
+        WarnL << "parse fmp4 init segment failed";
+    }
+}
+
+bool DashMaker::parseFragment(const char *data, size_t len, uint32_t &track_id, int64_t &time_ms, int &sync) const {
+    bool found = false;
+    forEachBox((uint8_t *) data, len, [&](uint32_t type, const uint8_t *moof, size_t moof_size) {
+        if (found || type != FOURCC('m', 'o', 'o', 'f')) {
+            return;
+        }
+        forEachBox(moof, moof_size, [&](uint32_t type, const uint8_t *traf, size_t traf_size) {
+            if (found || type != FOURCC('t', 'r', 'a', 'f')) {
+                return;
+            }
+            uint32_t id = 0;
+            //tfhd中的default_sample_flags, 0表示不存在
+            uint32_t default_flags = 0;
+            forEachBox(traf, traf_size, [&](uint32_t type, const uint8_t *data, size_t size) {
+                if (type == FOURCC('t', 'f', 'h', 'd') && size >= 8) {
+                    id = loadBE32(data + 4);
+                    auto flags = loadBE32(data) & 0xFFFFFF;
+                    //跳过base_data_offset、sample_description_index、default_sample_duration、default_sample_size
+                    size_t offset = 8 + (flags & 0x01 ? 8 : 0) + (flags & 0x02 ? 4 : 0) + (flags & 0x08 ? 4 : 0) + (flags & 0x10 ? 4 : 0);
+                    if ((flags & 0x20) && size >= offset + 4) {
+                        default_flags = loadBE32(data + offset);
+                    }
+                } else if (type == FOURCC('t', 'f', 'd', 't') && size >= 8 && id) {
+                    auto it = _tracks.find(id);
+                    if (it == _tracks.end()) {
+                        return;
+                    }
+                    uint64_t base = data[0] == 1 ? (size >= 12 ? loadBE64(data + 4) : 0) : loadBE32(data + 4);
+                    track_id = id;
+                    time_ms = (int64_t) (base * 1000 / it->second.timescale);
+                    found = true;
+                } else if (type == FOURCC('t', 'r', 'u', 'n') && size >= 8 && found) {
+                    //第一个sample的flags依次取自first_sample_flags、sample_flags、default_sample_flags
+                    auto flags = loadBE32(data) & 0xFFFFFF;
+                    size_t offset = 8 + (flags & 0x01 ? 4 : 0);
+                    uint32_t sample_flags = default_flags;
+                    bool have_flags = default_flags != 0;
+                    if (flags & 0x04) {
+                        if (size < offset + 4) {
+                            return;
+                        }
+                        sample_flags = loadBE32(data + offset);
+                        have_flags = true;
+                    } else if (flags & 0x400) {
+                        offset += (flags & 0x100 ? 4 : 0) + (flags & 0x200 ? 4 : 0);
+                        if (size < offset + 4) {
+                            return;
+                        }
+                        sample_flags = loadBE32(data + offset);
+                        have_flags = true;
+                    }
+                    if (have_flags) {
+                        //sample_is_non_sync_sample
+                        sync = (sample_flags & 0x10000) ? 0 : 1;
+                    }
+                }
+            });
+        });
+    });
+    return found;
+}
+
+void DashMaker::inputData(const char *data, size_t len, uint64_t timestamp, bool key) {
+    if (!data || !len || _init_segment.empty()) {
+        return;
+    }
+    uint32_t track_id = _main_track;
+    int64_t time = timestamp;
+    //输入的key标记可能与fragment中的sample并不对齐，优先以trun中第一个sample是否为同步帧为准
+    int sync = -1;
+    parseFragment(data, len, track_id, time, sync);
+    if (sync != -1) {
+        key = sync;
+    }
+    bool main_track = track_id == _main_track;
+    auto it = _tracks.find(_main_track);
+    bool have_video = it != _tracks.end() && it->second.video;
+
+    if (main_track && _seg_opened && time < _last_time) {
+        //时间戳回退，时间轴重新开始
+        WarnL << "dash stamp reduce: " << _last_time << " -> " << time;
+        resetTimeline();
+    }
+
+    //有视频时按关键帧切片，纯音频时任意fragment都可以切片
+    //时间戳修正可能使关键帧间隔略小于切片时长，所以容许一个fragment间隔的误差
+    if (main_track && (key || !have_video) && (!_seg_opened || time - _seg_start + _last_step >= _seg_duration * 1000)) {
+        if (_seg_opened) {
+            closeSegment(time);
+            makeMpd(false);
+        }
+        openSegment(time);
+    }
+    if (!_seg_opened) {
+        //等待第一个关键帧
+        return;
+    }
+    onWriteSegment(data, len);
+    _seg_bytes += len;
+    if (main_track) {
+        if (time > _last_time) {
+            _last_step = time - _last_time;
+        }
+        _last_time = time;
+    }
+}
+
+void DashMaker::openSegment(int64_t start) {
+    if (!_availability_start_ms) {
+        //本切片立即可以开始生成，使其生成完毕时刚好可用
+        _availability_start_ms = getCurrentMillisecond(true) - start;
+    }
+    _seg_opened = true;
+    _seg_start = start;
+    _seg_bytes = 0;
+    _last_time = start;
+    onOpenSegment(_seg_index++);
+}
+
+void DashMaker::closeSegment(int64_t end) {
+    _seg_opened = false;
+    auto duration = MAX(end - _seg_start, (int64_t) 1);
+    auto index = _seg_index - 1;
+    _segments.emplace_back(SegmentInfo { index, _seg_start, duration, _seg_bytes });
+    onFlushLastSegment(index, duration);
+
+    GET_CONFIG(uint32_t, segRetain, Dash::kSegmentRetain);
+    while (_segments.size() > _seg_number) {
+        _retain_segments.emplace_back(_segments.front().index);
+        _segments.pop_front();
+    }
+    //从mpd中移除的切片多保留若干个，防止播放器在下载完成前切片被删除
+    while (_retain_segments.size() > segRetain) {
+        onDelSegment(_retain_segments.front());
+        _retain_segments.pop_front();
+    }
+}
+
+void DashMaker::flushLastSegment(bool eof) {
+    if (_seg_opened) {
+        //最后一个切片的结束时间按fragment间隔估算
+        closeSegment(_last_time + MAX(_last_step, (int64_t) 1));
+    }
+    if (!_segments.empty()) {
+        makeMpd(eof);
+    }
+}
+
+void DashMaker::resetTimeline() {
+    _seg_opened = false;
+    _availability_start_ms = 0;
+    _last_time = 0;
+    _last_step = 0;
+    for (auto &seg : _segments) {
+        _retain_segments.emplace_back(seg.index);
+    }
+    _segments.clear();
+    //切片序号继续递增，防止播放器或cdn缓存了旧切片
+}
+
+void DashMaker::clear() {
+    resetTimeline();
+    for (auto index : _retain_segments) {
+        onDelSegment(index);
+    }
+    _retain_segments.clear();
+}
+
+void DashMaker::makeMpd(bool eof) {
+    TrackInfo video, audio;
+    string codecs;
+    for (auto &pr : _tracks) {
+        (pr.second.video ? video : audio) = pr.second;
+        if (!pr.second.codec.empty()) {
+            codecs += (codecs.empty() ? "" : ",") + pr.second.codec;
+        }
+    }
+    bool have_video = !video.codec.empty();
+
+    int64_t total_duration = 0, max_duration = 0;
+    uint64_t max_bandwidth = 0;
+    for (auto &seg : _segments) {
+        total_duration += seg.duration;
+        max_duration = MAX(max_duration, seg.duration);
+        max_bandwidth = MAX(max_bandwidth, (uint64_t) seg.bytes * 8 * 1000 / seg.duration);
+    }
+    auto now = getCurrentMillisecond(true);
+    auto params = escapeXml(_params.empty() ? "" : "?" + _params);
+
+    char buf[1024];
+    string mpd = "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+    if (eof) {
+        snprintf(buf, sizeof(buf),
+                 "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" type=\"static\" "
+                 "mediaPresentationDuration=\"PT%.3fS\" minBufferTime=\"PT%.3fS\">\n",
+                 total_duration / 1000.0, max_duration / 1000.0);
+    } else {
+        snprintf(buf, sizeof(buf),
+                 "<MPD xmlns=\"urn:mpeg:dash:schema:mpd:2011\" profiles=\"urn:mpeg:dash:profile:isoff-live:2011\" type=\"dynamic\" "
+                 "availabilityStartTime=\"%s\" publishTime=\"%s\" minimumUpdatePeriod=\"PT%.3fS\" minBufferTime=\"PT%.3fS\" "
+                 "timeShiftBufferDepth=\"PT%.3fS\" suggestedPresentationDelay=\"PT%.3fS\">\n",
+                 getUtcTimeStr(_availability_start_ms).data(), getUtcTimeStr(now).data(), _seg_duration,
+                 max_duration / 1000.0, total_duration / 1000.0, max_duration * (_low_latency ? 1 : 3) / 1000.0);
+    }
+    mpd += buf;
+    if (_low_latency && !eof) {
+        //低延时播放器(如dash.js)据此追赶直播边缘
+        snprintf(buf, sizeof(buf), "  <ServiceDescription id=\"0\">\n    <Latency target=\"%lld\"/>\n  </ServiceDescription>\n",
+                 (long long) (_seg_duration * 1000));
+        mpd += buf;
+    }
+    mpd += "  <Period id=\"0\" start=\"PT0S\">\n";
+    //一次复用同时包含音视频，所以只有一个Representation
+    snprintf(buf, sizeof(buf), "    <AdaptationSet id=\"0\" mimeType=\"%s\" segmentAlignment=\"true\" startWithSAP=\"1\">\n",
+             have_video ? "video/mp4" : "audio/mp4");
+    mpd += buf;
+    snprintf(buf, sizeof(buf), "      <Representation id=\"0\" codecs=\"%s\" bandwidth=\"%llu\"", codecs.data(), (unsigned long long) max_bandwidth);
+    mpd += buf;
+    if (have_video && video.width && video.height) {
+        snprintf(buf, sizeof(buf), " width=\"%u\" height=\"%u\"", video.width, video.height);
+        mpd += buf;
+    }
+    if (audio.sample_rate) {
+        snprintf(buf, sizeof(buf), " audioSamplingRate=\"%u\"", audio.sample_rate);
+        mpd += buf;
+    }
+    mpd += ">\n";
+    snprintf(buf, sizeof(buf),
+             "        <SegmentTemplate timescale=\"1000\" initialization=\"%s%s\" media=\"$Number$.m4s%s\" startNumber=\"%llu\" presentationTimeOffset=\"%lld\"",
+             getInitSegmentName().data(), params.data(), params.data(), (unsigned long long) _segments.front().index,
+             (long long) (eof ? _segments.front().start : 0));
+    mpd += buf;
+    if (_low_latency && !eof) {
+        //切片开始生成并产生第一个fragment后即可请求，http服务器以chunked方式边生成边发送
+        auto offset = MAX(_seg_duration * 1000 - _last_step, (float) 0);
+        snprintf(buf, sizeof(buf), " availabilityTimeOffset=\"%.3f\" availabilityTimeComplete=\"false\"", offset / 1000);
+        mpd += buf;
+    }
+    mpd += ">\n";
+    mpd += "          <SegmentTimeline>\n";
+    for (auto it = _segments.begin(); it != _segments.end();) {
+        //时长相同的连续切片合并为一个S元素
+        auto next = it + 1;
+        int repeat = 0;
+        while (next != _segments.end() && next->duration == it->duration && next->start == it->start + (repeat + 1) * it->duration) {
+            ++repeat;
+            ++next;
+        }
+        if (repeat) {
+            snprintf(buf, sizeof(buf), "            <S t=\"%lld\" d=\"%lld\" r=\"%d\"/>\n", (long long) it->start, (long long) it->duration, repeat);
+        } else {
+            snprintf(buf, sizeof(buf), "            <S t=\"%lld\" d=\"%lld\"/>\n", (long long) it->start, (long long) it->duration);
+        }
+        mpd += buf;
+        it = next;
+    }
+    mpd += "          </SegmentTimeline>\n"
+           "        </SegmentTemplate>\n"
+           "      </Representation>\n"
+           "    </AdaptationSet>\n"
+           "  </Period>\n";
+    if (!eof) {
+        //播放器据此校准时钟，计算直播边缘
+        snprintf(buf, sizeof(buf), "  <UTCTiming schemeIdUri=\"urn:mpeg:dash:utc:direct:2014\" value=\"%s\"/>\n", getUtcTimeStr(now).data());
+        mpd += buf;
+    }
+    mpd += "</MPD>\n";
+    onWriteMpd(mpd);
+}
+
+} // namespace mediakit
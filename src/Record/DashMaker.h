@@ -0,0 +1,167 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_DASHMAKER_H
+#define ZLMEDIAKIT_DASHMAKER_H
+
+#include <map>
+#include <deque>
+#include <string>
+#include <cstdint>
+
+namespace mediakit {
+
+/**
+ * mpeg-dash直播切片器，输入fmp4 init segment与fragment，生成动态mpd(SegmentTemplate + SegmentTimeline)
+ * 切片按关键帧切分，切片时间轴取自fragment中的tfdt，与媒体时间完全一致
+ */
+class DashMaker {
+public:
+    /**
+     * @param seg_duration 切片时长，单位秒
+     * @param seg_number mpd中的切片个数
+     * @param params 切片url参数
+     * @param low_latency 是否为低延时dash，是则切片在生成过程中即可请求(availabilityTimeOffset)
+     */
+    DashMaker(float seg_duration = 2, uint32_t seg_number = 5, std::string params = "", bool low_latency = false);
+    virtual ~DashMaker() = default;
+
+    /**
+     * 设置fmp4 init segment，并从中解析各track的timescale与codecs
+     */
+    void setInitSegment(const std::string &init_segment);
+
+    /**
+     * 输入fmp4 fragment(moof + mdat)
+     * @param data fragment数据
+     * @param len 数据长度
+     * @param timestamp 毫秒时间戳，fragment中不存在tfdt时使用
+     * @param key 是否以关键帧开始
+     */
+    void inputData(const char *data, size_t len, uint64_t timestamp, bool key);
+
+    /**
+     * 清空切片记录，init segment保持不变
+     */
+    void clear();
+
+    /**
+     * 是否为低延时dash
+     */
+    bool isLowLatency() const { return _low_latency; }
+
+    /**
+     * 获取init segment，尚未收到时为空
+     */
+    const std::string &getInitSegment() const { return _init_segment; }
+
+    /**
+     * init segment文件名，与mpd文件在同一目录
+     */
+    static const std::string &getInitSegmentName();
+
+    /**
+     * 切片文件名，与mpd中的SegmentTemplate一致
+     */
+    static std::string getSegmentName(uint64_t index);
+
+protected:
+    /**
+     * 新建切片回调
+     * @param index 切片序号，即SegmentTemplate中的$Number$
+     */
+    virtual void onOpenSegment(uint64_t index) = 0;
+
+    /**
+     * 写切片数据回调
+     */
+    virtual void onWriteSegment(const char *data, size_t len) = 0;
+
+    /**
+     * 切片写入完成回调，此后切片即将在mpd中出现
+     * @param index 切片序号
+     * @param duration_ms 切片时长，单位毫秒
+     */
+    virtual void onFlushLastSegment(uint64_t index, uint64_t duration_ms) = 0;
+
+    /**
+     * 切片已从mpd中移除并超过保留个数，可以删除
+     */
+    virtual void onDelSegment(uint64_t index) = 0;
+
+    /**
+     * init segment更新回调
+     */
+    virtual void onWriteInitSegment(const std::string &init_segment) = 0;
+
+    /**
+     * 写mpd文件回调
+     */
+    virtual void onWriteMpd(const std::string &mpd) = 0;
+
+    /**
+     * 关闭当前切片并生成mpd
+     * @param eof 直播是否已结束，结束后mpd变为static类型
+     */
+    void flushLastSegment(bool eof);
+
+private:
+    struct TrackInfo {
+        bool video = false;
+        uint32_t timescale = 1000;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t sample_rate = 0;
+        std::string codec;
+    };
+
+    struct SegmentInfo {
+        uint64_t index;
+        int64_t start;
+        int64_t duration;
+        size_t bytes;
+    };
+
+    void parseInitSegment(const std::string &init_segment);
+    bool parseFragment(const char *data, size_t len, uint32_t &track_id, int64_t &time_ms, int &sync) const;
+    void openSegment(int64_t start);
+    void closeSegment(int64_t end);
+    void resetTimeline();
+    void makeMpd(bool eof);
+
+private:
+    bool _low_latency;
+    float _seg_duration;
+    uint32_t _seg_number;
+    std::string _params;
+
+    //key为track id
+    std::map<uint32_t, TrackInfo> _tracks;
+    //切片所依据的track，有视频时为视频track
+    uint32_t _main_track = 0;
+    std::string _init_segment;
+
+    //mpd中媒体时间0点对应的utc时间，单位毫秒
+    uint64_t _availability_start_ms = 0;
+    //下个切片序号
+    uint64_t _seg_index = 1;
+    bool _seg_opened = false;
+    int64_t _seg_start = 0;
+    size_t _seg_bytes = 0;
+    //主track最近一个fragment的开始时间及fragment间隔，直播结束时用于估算最后一个切片时长
+    int64_t _last_time = 0;
+    int64_t _last_step = 0;
+    std::deque<SegmentInfo> _segments;
+    //已从mpd中移除但尚未删除的切片
+    std::deque<uint64_t> _retain_segments;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_DASHMAKER_H
@@ -0,0 +1,72 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "DashMediaSource.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+void DashLiveSegment::write(Buffer::Ptr chunk) {
+    decltype(_waiters) waiters;
+    {
+        lock_guard<mutex> lck(_mtx);
+        if (_complete) {
+            return;
+        }
+        _chunks.emplace_back(chunk);
+        waiters.swap(_waiters);
+    }
+    //在锁外回调，防止回调中再次读取时死锁
+    for (auto &cb : waiters) {
+        cb(chunk);
+    }
+}
+
+void DashLiveSegment::complete() {
+    decltype(_waiters) waiters;
+    {
+        lock_guard<mutex> lck(_mtx);
+        _complete = true;
+        waiters.swap(_waiters);
+    }
+    for (auto &cb : waiters) {
+        cb(nullptr);
+    }
+}
+
+void DashLiveSegment::read(size_t index, onChunk cb) {
+    Buffer::Ptr chunk;
+    {
+        lock_guard<mutex> lck(_mtx);
+        if (index < _chunks.size()) {
+            chunk = _chunks[index];
+        } else if (!_complete) {
+            //等待下个fragment生成
+            _waiters.emplace_back(std::move(cb));
+            return;
+        }
+    }
+    cb(chunk);
+}
+
+void DashMediaSource::setLiveSegment(string name, DashLiveSegment::Ptr segment) {
+    lock_guard<mutex> lck(_mtx_live);
+    _live_name = std::move(name);
+    _live_segment = std::move(segment);
+}
+
+DashLiveSegment::Ptr DashMediaSource::getLiveSegment(const string &name) {
+    lock_guard<mutex> lck(_mtx_live);
+    return name == _live_name ? _live_segment : nullptr;
+}
+
+} // namespace mediakit
@@ -0,0 +1,88 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_DASHMEDIASOURCE_H
+#define ZLMEDIAKIT_DASHMEDIASOURCE_H
+
+#include <vector>
+#include "HlsMediaSource.h"
+
+namespace mediakit {
+
+/**
+ * 正在生成中的dash切片(低延时dash)
+ * 每生成一个fmp4 fragment(moof + mdat)即追加为一个chunk，所有请求该切片的http会话共享同一份数据
+ */
+class DashLiveSegment {
+public:
+    using Ptr = std::shared_ptr<DashLiveSegment>;
+    /**
+     * chunk回调，切片已结束时回调nullptr
+     */
+    using onChunk = std::function<void(const toolkit::Buffer::Ptr &chunk)>;
+
+    DashLiveSegment() = default;
+    ~DashLiveSegment() { complete(); }
+
+    /**
+     * 追加chunk，并唤醒等待该chunk的请求
+     */
+    void write(toolkit::Buffer::Ptr chunk);
+
+    /**
+     * 切片生成完毕(或被放弃)，唤醒所有等待中的请求
+     */
+    void complete();
+
+    /**
+     * 读取第index个chunk，尚未生成时等待其生成后再回调
+     * @param index chunk序号，从0开始
+     * @param cb 回调，切片已结束且没有更多数据时回调nullptr
+     */
+    void read(size_t index, onChunk cb);
+
+private:
+    bool _complete = false;
+    std::mutex _mtx;
+    std::vector<toolkit::Buffer::Ptr> _chunks;
+    //等待下个chunk的请求
+    std::list<onChunk> _waiters;
+};
+
+/**
+ * dash直播源，mpd与切片只保存在内存中
+ * 索引文件、切片存取与观看人数统计(http cookie)与hls内存模式完全一致，所以直接复用HlsMediaSource
+ */
+class DashMediaSource : public HlsMediaSource {
+public:
+    using Ptr = std::shared_ptr<DashMediaSource>;
+
+    DashMediaSource(const std::string &vhost, const std::string &app, const std::string &stream_id)
+        : HlsMediaSource(DASH_SCHEMA, vhost, app, stream_id) {}
+    ~DashMediaSource() override = default;
+
+    /**
+     * 设置正在生成中的切片，name为空时清除
+     */
+    void setLiveSegment(std::string name, DashLiveSegment::Ptr segment);
+
+    /**
+     * 获取正在生成中的切片，不存在或名称不匹配时返回nullptr
+     */
+    DashLiveSegment::Ptr getLiveSegment(const std::string &name);
+
+private:
+    std::mutex _mtx_live;
+    std::string _live_name;
+    DashLiveSegment::Ptr _live_segment;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_DASHMEDIASOURCE_H
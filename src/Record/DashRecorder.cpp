@@ -0,0 +1,139 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "DashRecorder.h"
+#include "Common/config.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+static string getDashParams(const string &vhost) {
+    GET_CONFIG(bool, enable_vhost, General::kEnableVhost);
+    return enable_vhost ? string(VHOST_KEY) + "=" + vhost : "";
+}
+
+DashRecorder::DashRecorder(const string &vhost, const string &app, const string &stream_id, const ProtocolOption &option)
+    : DashMaker(mINI::Instance()[Dash::kSegmentDuration].as<float>(), mINI::Instance()[Dash::kSegmentNum].as<uint32_t>(), getDashParams(vhost),
+                mINI::Instance()[Dash::kLowLatency].as<bool>()) {
+    _option = option;
+    _media_src = std::make_shared<DashMediaSource>(vhost, app, stream_id);
+}
+
+DashRecorder::~DashRecorder() {
+    try {
+        flushLastSegment(true);
+    } catch (std::exception &ex) {
+        WarnL << ex.what();
+    }
+    closeLiveSegment();
+}
+
+void DashRecorder::setListener(const std::weak_ptr<MediaSourceEvent> &listener) {
+    setDelegate(listener);
+    _media_src->setListener(shared_from_this());
+}
+
+void DashRecorder::onReaderChanged(MediaSource &sender, int size) {
+    _enabled = _option.dash_demand ? size : true;
+    if (!size && _option.dash_demand) {
+        //无人观看时删除切片，防止下次播放时视频跳跃
+        _clear_cache = true;
+    }
+    MediaSourceEventInterceptor::onReaderChanged(sender, size);
+}
+
+void DashRecorder::inputFMP4(const Buffer::Ptr &packet, uint64_t stamp, bool key) {
+    if (_clear_cache && _option.dash_demand) {
+        _clear_cache = false;
+        clearCache();
+    }
+    if (_enabled || !_option.dash_demand) {
+        inputData(packet->data(), packet->size(), stamp, key);
+    }
+}
+
+void DashRecorder::clearCache() {
+    clear();
+    _segment_buf = nullptr;
+    closeLiveSegment();
+    _media_src->clearSegment();
+    _media_src->setIndexFile("");
+    auto &init_segment = getInitSegment();
+    if (!init_segment.empty()) {
+        _media_src->addSegment(getInitSegmentName(), std::make_shared<BufferString>(init_segment));
+    }
+}
+
+void DashRecorder::onOpenSegment(uint64_t index) {
+    closeLiveSegment();
+    _segment_buf = std::make_shared<BufferLikeString>();
+    //按上个切片大小预分配，减少低延时模式下的扩容拷贝
+    _segment_buf->reserve(_last_segment_size + _last_segment_size / 4);
+    if (isLowLatency()) {
+        //低延时dash下，切片开始生成即对http服务器可见
+        _live_segment = std::make_shared<DashLiveSegment>();
+        _media_src->setLiveSegment(getSegmentName(index), _live_segment);
+    }
+}
+
+void DashRecorder::onWriteSegment(const char *data, size_t len) {
+    if (_segment_buf) {
+        if (_live_segment && _segment_buf->size() + len > _segment_buf->capacity()) {
+            //已发送的chunk引用切片缓存且可能正被http线程读取，不能原地扩容，改为拷贝至新缓存，旧缓存由chunk持有
+            auto buf = std::make_shared<BufferLikeString>();
+            buf->reserve(MAX(2 * _segment_buf->capacity(), _segment_buf->size() + len));
+            buf->append(_segment_buf->data(), _segment_buf->size());
+            _segment_buf = std::move(buf);
+        }
+        auto offset = _segment_buf->size();
+        _segment_buf->append(data, len);
+        if (_live_segment) {
+            //每个fmp4 fragment作为一个chunk，直接引用切片缓存，不再单独拷贝
+            _live_segment->write(std::make_shared<BufferOffset<Buffer::Ptr> >(_segment_buf, offset, len));
+        }
+    }
+    _media_src->onSegmentSize(len);
+}
+
+void DashRecorder::onFlushLastSegment(uint64_t index, uint64_t duration_ms) {
+    if (_segment_buf) {
+        _last_segment_size = _segment_buf->size();
+        //普通模式下切片写完后才对http服务器可见
+        _media_src->addSegment(getSegmentName(index), std::move(_segment_buf));
+    }
+    _segment_buf = nullptr;
+    //完整切片已添加，此后的请求直接获取完整切片
+    closeLiveSegment();
+}
+
+void DashRecorder::closeLiveSegment() {
+    if (_live_segment) {
+        _media_src->setLiveSegment("", nullptr);
+        _live_segment->complete();
+        _live_segment = nullptr;
+    }
+}
+
+void DashRecorder::onDelSegment(uint64_t index) {
+    _media_src->delSegment(getSegmentName(index));
+}
+
+void DashRecorder::onWriteInitSegment(const string &init_segment) {
+    //内存缓存中的切片默认钉住，dash切片由onDelSegment显式删除，init segment则一直保留
+    _media_src->addSegment(getInitSegmentName(), std::make_shared<BufferString>(init_segment));
+}
+
+void DashRecorder::onWriteMpd(const string &mpd) {
+    _media_src->setIndexFile(mpd);
+}
+
+} // namespace mediakit
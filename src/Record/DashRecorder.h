@@ -0,0 +1,75 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_DASHRECORDER_H
+#define ZLMEDIAKIT_DASHRECORDER_H
+
+#include "DashMaker.h"
+#include "DashMediaSource.h"
+
+namespace mediakit {
+
+/**
+ * mpeg-dash直播，切片数据由FMP4MediaSourceMuxer通过inputFMP4输入，mpd与切片只保存在内存中
+ * 通过http访问/app/stream/dash.mpd播放
+ */
+class DashRecorder final : public MediaSourceEventInterceptor, public DashMaker, public std::enable_shared_from_this<DashRecorder> {
+public:
+    using Ptr = std::shared_ptr<DashRecorder>;
+
+    DashRecorder(const std::string &vhost, const std::string &app, const std::string &stream_id, const ProtocolOption &option);
+    ~DashRecorder() override;
+
+    void setListener(const std::weak_ptr<MediaSourceEvent> &listener);
+
+    int readerCount() { return _media_src->readerCount(); }
+
+    void onReaderChanged(MediaSource &sender, int size) override;
+
+    bool isEnabled() {
+        //缓存尚未清空时，还允许输入数据，以便及时清空缓存
+        return _option.dash_demand ? (_clear_cache ? true : _enabled) : true;
+    }
+
+    /**
+     * 输入fmp4 fragment，由FMP4MediaSourceMuxer调用
+     * @param packet fragment数据
+     * @param stamp 时间戳
+     * @param key 是否包含关键帧
+     */
+    void inputFMP4(const toolkit::Buffer::Ptr &packet, uint64_t stamp, bool key);
+
+protected:
+    void onOpenSegment(uint64_t index) override;
+    void onWriteSegment(const char *data, size_t len) override;
+    void onFlushLastSegment(uint64_t index, uint64_t duration_ms) override;
+    void onDelSegment(uint64_t index) override;
+    void onWriteInitSegment(const std::string &init_segment) override;
+    void onWriteMpd(const std::string &mpd) override;
+
+private:
+    void clearCache();
+    void closeLiveSegment();
+
+private:
+    bool _enabled = true;
+    bool _clear_cache = false;
+    ProtocolOption _option;
+    DashMediaSource::Ptr _media_src;
+    //正在写入的切片
+    std::shared_ptr<toolkit::BufferLikeString> _segment_buf;
+    //上个切片大小，用于预分配切片缓存
+    size_t _last_segment_size = 0;
+    //低延时dash下正在写入的切片，供http请求边生成边读取
+    DashLiveSegment::Ptr _live_segment;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_DASHRECORDER_H
@@ -0,0 +1,163 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <algorithm>
+#include <unordered_map>
+#include "DvrBuffer.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+//没有视频时，每秒划分一个gop
+#define AUDIO_GOP_MS 1000
+
+static mutex s_mtx;
+//key为vhost/app/stream
+static unordered_map<string, weak_ptr<DvrBuffer> > s_dvr_map;
+
+static string getKey(const string &vhost, const string &app, const string &stream_id) {
+    return vhost + "/" + app + "/" + stream_id;
+}
+
+DvrBuffer::DvrBuffer(const string &vhost, const string &app, const string &stream_id, size_t max_second) {
+    _max_ms = max_second * 1000;
+    _key = getKey(vhost, app, stream_id);
+}
+
+DvrBuffer::~DvrBuffer() {
+    lock_guard<mutex> lck(s_mtx);
+    auto it = s_dvr_map.find(_key);
+    if (it != s_dvr_map.end() && it->second.expired()) {
+        //同名流重新推流时可能已被新的缓存替换
+        s_dvr_map.erase(it);
+    }
+}
+
+DvrBuffer::Ptr DvrBuffer::find(const string &vhost, const string &app, const string &stream_id) {
+    lock_guard<mutex> lck(s_mtx);
+    auto it = s_dvr_map.find(getKey(vhost, app, stream_id));
+    return it == s_dvr_map.end() ? nullptr : it->second.lock();
+}
+
+bool DvrBuffer::addTrack(const Track::Ptr &track) {
+    lock_guard<mutex> lck(_mtx);
+    if (track->getTrackType() == TrackVideo) {
+        _have_video = true;
+    }
+    _tracks.emplace_back(track->clone());
+    return true;
+}
+
+void DvrBuffer::addTrackCompleted() {
+    //所有track就绪后才可被时移播放，防止时移播放器只获取到部分track
+    lock_guard<mutex> lck(s_mtx);
+    s_dvr_map[_key] = shared_from_this();
+}
+
+void DvrBuffer::resetTracks() {
+    {
+        lock_guard<mutex> lck(s_mtx);
+        auto it = s_dvr_map.find(_key);
+        if (it != s_dvr_map.end() && it->second.lock().get() == this) {
+            //重新添加完毕track前不可被时移播放
+            s_dvr_map.erase(it);
+        }
+    }
+    lock_guard<mutex> lck(_mtx);
+    _have_video = false;
+    _video_key_pos = false;
+    _front_seq += _gops.size();
+    _gops.clear();
+    _tracks.clear();
+}
+
+bool DvrBuffer::inputFrame(const Frame::Ptr &frame) {
+    auto cache_frame = Frame::getCacheAbleFrame(frame);
+    lock_guard<mutex> lck(_mtx);
+    bool new_gop;
+    if (frame->getTrackType() == TrackVideo) {
+        //视频时，遇到第一帧配置帧或关键帧则标记为gop开始处
+        auto video_key_pos = frame->keyFrame() || frame->configFrame();
+        new_gop = video_key_pos && !_video_key_pos;
+        _video_key_pos = video_key_pos;
+    } else {
+        new_gop = !_have_video && (_gops.empty() || frame->dts() >= _gops.back().stamp + AUDIO_GOP_MS);
+    }
+
+    if (new_gop) {
+        _gops.emplace_back(Gop { frame->dts(), {} });
+    }
+    //淘汰完全滑出窗口的gop，保证窗口长度不小于max_second
+    while (_gops.size() > 1 && _gops[1].stamp + _max_ms <= frame->dts()) {
+        _gops.pop_front();
+        ++_front_seq;
+    }
+    if (_gops.empty()) {
+        //等待第一个关键帧
+        return false;
+    }
+    _gops.back().frames.emplace_back(std::move(cache_frame));
+    _last_dts = frame->dts();
+    return true;
+}
+
+vector<Track::Ptr> DvrBuffer::getTracks() const {
+    lock_guard<mutex> lck(_mtx);
+    return _tracks;
+}
+
+bool DvrBuffer::getRange(uint64_t &begin, uint64_t &end) const {
+    lock_guard<mutex> lck(_mtx);
+    if (_gops.empty()) {
+        return false;
+    }
+    begin = _gops.front().stamp;
+    end = _last_dts;
+    return true;
+}
+
+DvrBuffer::Cursor DvrBuffer::seek(uint64_t stamp) const {
+    lock_guard<mutex> lck(_mtx);
+    auto it = std::upper_bound(_gops.begin(), _gops.end(), stamp, [](uint64_t stamp, const Gop &gop) {
+        return stamp < gop.stamp;
+    });
+    if (it != _gops.begin()) {
+        --it;
+    }
+    Cursor ret;
+    ret.seq = _front_seq + (it - _gops.begin());
+    return ret;
+}
+
+Frame::Ptr DvrBuffer::read(Cursor &cursor) const {
+    lock_guard<mutex> lck(_mtx);
+    if (cursor.seq < _front_seq) {
+        //读取过慢(例如暂停)，所在gop已被淘汰，跳至窗口开头
+        cursor.seq = _front_seq;
+        cursor.index = 0;
+    }
+    while (cursor.seq - _front_seq < _gops.size()) {
+        auto &frames = _gops[cursor.seq - _front_seq].frames;
+        if (cursor.index < frames.size()) {
+            return frames[cursor.index++];
+        }
+        if (cursor.seq - _front_seq + 1 == _gops.size()) {
+            //已追上直播
+            break;
+        }
+        ++cursor.seq;
+        cursor.index = 0;
+    }
+    return nullptr;
+}
+
+} // namespace mediakit
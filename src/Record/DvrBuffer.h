@@ -0,0 +1,114 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_DVRBUFFER_H
+#define ZLMEDIAKIT_DVRBUFFER_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <vector>
+#include "Common/MediaSink.h"
+
+namespace mediakit {
+
+/**
+ * 直播流的时移(DVR)缓存，在内存中按gop保存最近一段时间(protocol.dvr_second)的帧数据
+ * 由MultiMediaSourceMuxer输入帧数据，供DvrReader从窗口内任意位置开始回放并追赶至直播
+ */
+class DvrBuffer : public MediaSinkInterface, public std::enable_shared_from_this<DvrBuffer> {
+public:
+    using Ptr = std::shared_ptr<DvrBuffer>;
+
+    /**
+     * 读取位置，gop被淘汰后自动跳至窗口开头
+     */
+    struct Cursor {
+        //gop序号
+        uint64_t seq = 0;
+        //帧在gop内的下标
+        size_t index = 0;
+    };
+
+    /**
+     * @param max_second 时移窗口长度，单位秒
+     */
+    DvrBuffer(const std::string &vhost, const std::string &app, const std::string &stream_id, size_t max_second);
+    ~DvrBuffer() override;
+
+    /**
+     * 查找直播流的时移缓存
+     */
+    static Ptr find(const std::string &vhost, const std::string &app, const std::string &stream_id);
+
+    bool addTrack(const Track::Ptr &track) override;
+    /**
+     * 所有track添加完毕后才可被时移播放，由MultiMediaSourceMuxer在所有track就绪时调用
+     */
+    void addTrackCompleted() override;
+    void resetTracks() override;
+    bool inputFrame(const Frame::Ptr &frame) override;
+
+    /**
+     * 时移播放器创建与销毁时调用，用于统计时移播放器个数
+     */
+    void attachReader() { ++_reader_count; }
+    void detachReader() { --_reader_count; }
+
+    /**
+     * 获取时移播放器个数
+     */
+    int readerCount() const { return _reader_count; }
+
+    /**
+     * 获取track，已就绪
+     */
+    std::vector<Track::Ptr> getTracks() const;
+
+    /**
+     * 获取时移窗口的时间戳范围，单位毫秒
+     * @return 缓存为空时返回false
+     */
+    bool getRange(uint64_t &begin, uint64_t &end) const;
+
+    /**
+     * 二分查找时间戳所在的gop
+     * @param stamp 时间戳，单位毫秒
+     * @return 该时间戳之前(含)最近一个gop的开头，早于窗口时返回窗口开头
+     */
+    Cursor seek(uint64_t stamp) const;
+
+    /**
+     * 读取下一帧
+     * @return 已追上直播时返回nullptr
+     */
+    Frame::Ptr read(Cursor &cursor) const;
+
+private:
+    struct Gop {
+        uint64_t stamp;
+        std::vector<Frame::Ptr> frames;
+    };
+
+    bool _have_video = false;
+    bool _video_key_pos = false;
+    size_t _max_ms;
+    std::string _key;
+    std::atomic<int> _reader_count { 0 };
+    mutable std::mutex _mtx;
+    //_gops.front()的序号
+    uint64_t _front_seq = 0;
+    uint64_t _last_dts = 0;
+    std::deque<Gop> _gops;
+    std::vector<Track::Ptr> _tracks;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_DVRBUFFER_H
@@ -0,0 +1,256 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include "DvrReader.h"
+#include "Common/config.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+//时移流id中直播流id与时长的分隔符
+#define DVR_STREAM_TAG "@dvr"
+//直播流时间戳跳跃超过此值(或所在gop已被淘汰)时，时间轴直接跳过，单位毫秒
+#define DVR_MAX_GAP_MS 3000
+
+/**
+ * 把直播流的时间戳转换为时移流的时间戳
+ */
+class DvrFrame : public Frame {
+public:
+    DvrFrame(Frame::Ptr frame, uint64_t base_dts) {
+        _frame = std::move(frame);
+        _base_dts = base_dts;
+    }
+
+    uint64_t dts() const override { return _frame->dts() > _base_dts ? _frame->dts() - _base_dts : 0; }
+    uint64_t pts() const override { return _frame->pts() > _base_dts ? _frame->pts() - _base_dts : 0; }
+    size_t prefixSize() const override { return _frame->prefixSize(); }
+    bool keyFrame() const override { return _frame->keyFrame(); }
+    bool configFrame() const override { return _frame->configFrame(); }
+    bool cacheAble() const override { return _frame->cacheAble(); }
+    bool dropAble() const override { return _frame->dropAble(); }
+    bool decodeAble() const override { return _frame->decodeAble(); }
+    char *data() const override { return _frame->data(); }
+    size_t size() const override { return _frame->size(); }
+    CodecId getCodecId() const override { return _frame->getCodecId(); }
+
+private:
+    uint64_t _base_dts;
+    Frame::Ptr _frame;
+};
+
+bool DvrReader::parseStreamId(const string &stream_id, string &origin_stream_id, uint64_t &delay_ms) {
+    auto pos = stream_id.rfind(DVR_STREAM_TAG);
+    if (pos == string::npos || pos == 0) {
+        return false;
+    }
+    auto delay = stream_id.substr(pos + sizeof(DVR_STREAM_TAG) - 1);
+    if (delay.empty() || delay.find_first_not_of("0123456789") != string::npos) {
+        return false;
+    }
+    origin_stream_id = stream_id.substr(0, pos);
+    delay_ms = stoull(delay) * 1000;
+    return true;
+}
+
+DvrReader::DvrReader(const string &vhost, const string &app, const string &stream_id) {
+    string origin_stream_id;
+    uint64_t delay_ms;
+    if (!parseStreamId(stream_id, origin_stream_id, delay_ms)) {
+        throw std::invalid_argument("非法的时移流id:" + stream_id);
+    }
+    _origin_url = vhost + "/" + app + "/" + origin_stream_id;
+    _dvr = DvrBuffer::find(vhost, app, origin_stream_id);
+    uint64_t begin, end;
+    if (!_dvr || !_dvr->getRange(begin, end)) {
+        throw std::runtime_error("直播流不存在或未开启时移:" + _origin_url);
+    }
+    auto tracks = _dvr->getTracks();
+    if (tracks.empty()) {
+        throw std::runtime_error("直播流没有有效的track:" + _origin_url);
+    }
+
+    //从距离直播delay_ms处之前最近的gop开始播放，超出窗口时从窗口开头播放
+    _cursor = _dvr->seek(end > begin + delay_ms ? end - delay_ms : begin);
+    _pending = _dvr->read(_cursor);
+    if (!_pending) {
+        throw std::runtime_error("时移缓存为空:" + _origin_url);
+    }
+    _base_dts = _pending->dts();
+    _poller = EventPollerPool::Instance().getPoller();
+
+    ProtocolOption option;
+    //时移播放时，不重复生成mp4文件与时移缓存
+    option.enable_mp4 = false;
+    option.dvr_second = 0;
+    _muxer = std::make_shared<MultiMediaSourceMuxer>(vhost, app, stream_id, 0, option);
+    for (auto &track : tracks) {
+        _muxer->addTrack(track);
+    }
+    //添加完毕所有track，防止单track情况下最大等待3秒
+    _muxer->addTrackCompleted();
+    //构造成功后才计入时移播放器个数，析构时移除
+    _dvr->attachReader();
+}
+
+DvrReader::~DvrReader() {
+    _dvr->detachReader();
+}
+
+bool DvrReader::startRead() {
+    auto strong_self = shared_from_this();
+    //一直读到所有track就绪为止
+    while (!_muxer->isAllTrackReady() && readNextFrame());
+    if (!_muxer->isAllTrackReady()) {
+        WarnL << "时移缓存中track未就绪:" << _origin_url;
+        return false;
+    }
+    //注册后再切换OwnerPoller
+    _muxer->setMediaListener(strong_self);
+    _seek_to = _last_dts;
+    _seek_ticker.resetTime();
+
+    GET_CONFIG(uint32_t, sampleMS, Record::kSampleMS);
+    _timer = std::make_shared<Timer>(sampleMS / 1000.0f, [strong_self]() {
+        lock_guard<recursive_mutex> lck(strong_self->_mtx);
+        return strong_self->readSample();
+    }, _poller);
+    return true;
+}
+
+bool DvrReader::readNextFrame() {
+    auto frame = _pending ? std::move(_pending) : _dvr->read(_cursor);
+    _pending = nullptr;
+    if (!frame) {
+        return false;
+    }
+    auto dvr_frame = std::make_shared<DvrFrame>(std::move(frame), _base_dts);
+    _last_dts = (uint32_t)dvr_frame->dts();
+    _muxer->inputFrame(dvr_frame);
+    return true;
+}
+
+bool DvrReader::readSample() {
+    if (_paused) {
+        return true;
+    }
+    auto now = getCurrentStamp();
+    while (true) {
+        if (!_pending) {
+            _pending = _dvr->read(_cursor);
+        }
+        if (!_pending) {
+            //已追上直播，此后以直播速度跟随
+            if (now > _last_dts) {
+                _seek_to = _last_dts;
+                _seek_ticker.resetTime();
+            }
+            break;
+        }
+        auto stamp = _pending->dts() > _base_dts ? _pending->dts() - _base_dts : 0;
+        if (stamp > now + DVR_MAX_GAP_MS && stamp > _last_dts + DVR_MAX_GAP_MS) {
+            //所在gop已被淘汰或直播流时间戳跳跃，时间轴直接跳过
+            _seek_to = now = (uint32_t)stamp;
+            _seek_ticker.resetTime();
+        }
+        if (stamp > now) {
+            break;
+        }
+        readNextFrame();
+    }
+    return true;
+}
+
+uint32_t DvrReader::getCurrentStamp() {
+    return (uint32_t) (_seek_to + !_paused * _speed * _seek_ticker.elapsedTime());
+}
+
+void DvrReader::setCurrentStamp(uint32_t new_stamp) {
+    auto old_stamp = getCurrentStamp();
+    _seek_to = new_stamp;
+    _last_dts = new_stamp;
+    _seek_ticker.resetTime();
+    if (old_stamp != new_stamp) {
+        //时间轴未拖动时不操作
+        _muxer->setTimeStamp(new_stamp);
+    }
+}
+
+void DvrReader::seekTo(uint32_t stamp) {
+    lock_guard<recursive_mutex> lck(_mtx);
+    //超过直播时从最新的gop开始播放
+    auto cursor = _dvr->seek(_base_dts + stamp);
+    auto frame = _dvr->read(cursor);
+    if (!frame) {
+        return;
+    }
+    _cursor = cursor;
+    _pending = std::move(frame);
+    setCurrentStamp(_pending->dts() > _base_dts ? (uint32_t)(_pending->dts() - _base_dts) : 0);
+}
+
+bool DvrReader::seekTo(MediaSource &sender, uint32_t stamp) {
+    //拖动进度条后应该恢复播放
+    pause(sender, false);
+    TraceL << getOriginUrl(sender) << ",stamp:" << stamp;
+    seekTo(stamp);
+    return true;
+}
+
+bool DvrReader::pause(MediaSource &sender, bool pause) {
+    lock_guard<recursive_mutex> lck(_mtx);
+    if (_paused == pause) {
+        return true;
+    }
+    //_seek_ticker重新计时，不管是暂停还是seek都不影响总的播放进度
+    setCurrentStamp(getCurrentStamp());
+    _paused = pause;
+    TraceL << getOriginUrl(sender) << ",pause:" << pause;
+    return true;
+}
+
+bool DvrReader::speed(MediaSource &sender, float speed) {
+    if (speed < 0.1 || speed > 20) {
+        WarnL << "播放速度取值范围非法:" << speed;
+        return false;
+    }
+    //设置播放速度后应该恢复播放
+    pause(sender, false);
+    lock_guard<recursive_mutex> lck(_mtx);
+    if (_speed == speed) {
+        return true;
+    }
+    setCurrentStamp(getCurrentStamp());
+    _speed = speed;
+    TraceL << getOriginUrl(sender) << ",speed:" << speed;
+    return true;
+}
+
+bool DvrReader::close(MediaSource &sender) {
+    _timer = nullptr;
+    WarnL << "close media: " << sender.getUrl();
+    return true;
+}
+
+MediaOriginType DvrReader::getOriginType(MediaSource &sender) const {
+    return MediaOriginType::time_shift;
+}
+
+string DvrReader::getOriginUrl(MediaSource &sender) const {
+    return _origin_url;
+}
+
+toolkit::EventPoller::Ptr DvrReader::getOwnerPoller(MediaSource &sender) {
+    return _poller;
+}
+
+} // namespace mediakit
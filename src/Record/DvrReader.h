@@ -0,0 +1,86 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_DVRREADER_H
+#define ZLMEDIAKIT_DVRREADER_H
+
+#include "DvrBuffer.h"
+#include "Common/MultiMediaSourceMuxer.h"
+
+namespace mediakit {
+
+/**
+ * 时移播放，从直播流的时移缓存中读取帧数据并流化为MediaSource，流id形如"cam1@dvr60"
+ * 时间戳0对应开始播放的位置，支持seek/暂停/倍速，读取到缓存末尾后以直播速度跟随
+ */
+class DvrReader : public std::enable_shared_from_this<DvrReader>, public MediaSourceEvent {
+public:
+    using Ptr = std::shared_ptr<DvrReader>;
+
+    /**
+     * @param vhost 虚拟主机
+     * @param app 应用名
+     * @param stream_id 时移流id，形如"cam1@dvr60"，代表从直播流cam1的60秒前开始播放
+     */
+    DvrReader(const std::string &vhost, const std::string &app, const std::string &stream_id);
+    ~DvrReader() override;
+
+    /**
+     * 解析时移流id
+     * @param stream_id 时移流id，形如"cam1@dvr60"
+     * @param origin_stream_id 直播流id
+     * @param delay_ms 开始播放位置距离直播的时长，单位毫秒
+     */
+    static bool parseStreamId(const std::string &stream_id, std::string &origin_stream_id, uint64_t &delay_ms);
+
+    /**
+     * 开始读取，定时器会引用本对象，直到MediaSource关闭
+     * @return 是否成功生成MediaSource
+     */
+    bool startRead();
+
+private:
+    //MediaSourceEvent override
+    bool seekTo(MediaSource &sender, uint32_t stamp) override;
+    bool pause(MediaSource &sender, bool pause) override;
+    bool speed(MediaSource &sender, float speed) override;
+
+    bool close(MediaSource &sender) override;
+    MediaOriginType getOriginType(MediaSource &sender) const override;
+    std::string getOriginUrl(MediaSource &sender) const override;
+    toolkit::EventPoller::Ptr getOwnerPoller(MediaSource &sender) override;
+
+    bool readSample();
+    bool readNextFrame();
+    uint32_t getCurrentStamp();
+    void setCurrentStamp(uint32_t stamp);
+    void seekTo(uint32_t stamp);
+
+private:
+    bool _paused = false;
+    float _speed = 1.0;
+    uint32_t _seek_to = 0;
+    uint32_t _last_dts = 0;
+    //时移流时间戳0对应的直播流时间戳
+    uint64_t _base_dts = 0;
+    std::string _origin_url;
+    std::recursive_mutex _mtx;
+    toolkit::Ticker _seek_ticker;
+    toolkit::Timer::Ptr _timer;
+    DvrBuffer::Ptr _dvr;
+    DvrBuffer::Cursor _cursor;
+    //已读取但是未到播放时间的帧
+    Frame::Ptr _pending;
+    MultiMediaSourceMuxer::Ptr _muxer;
+    toolkit::EventPoller::Ptr _poller;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_DVRREADER_H
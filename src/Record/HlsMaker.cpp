@@ -15,11 +15,17 @@ using namespace std;
 
 namespace mediakit {
 
-HlsMaker::HlsMaker(float seg_duration, uint32_t seg_number, bool seg_keep) {
+// 低延时hls保留partial segment的切片个数
+static constexpr size_t kPartSegmentNum = 3;
+
+HlsMaker::HlsMaker(float seg_duration, uint32_t seg_number, bool seg_keep, float part_duration, bool is_fmp4) {
     //最小允许设置为0，0个切片代表点播
     _seg_number = seg_number;
     _seg_duration = seg_duration;
     _seg_keep = seg_keep;
+    _is_fmp4 = is_fmp4;
+    //低延时hls只对直播有效
+    _part_duration = seg_number ? part_duration : 0;
 }
 
 HlsMaker::~HlsMaker() {
@@ -29,6 +35,7 @@ HlsMaker::~HlsMaker() {
 void HlsMaker::makeIndexFile(bool eof) {
     char file_content[1024];
     int maxSegmentDuration = 0;
+    int maxPartDuration = 0;
 
     for (auto &tp : _seg_dur_list) {
         int dur = std::get<0>(tp);
@@ -36,8 +43,17 @@ void HlsMaker::makeIndexFile(bool eof) {
             maxSegmentDuration = dur;
         }
     }
+    for (auto &pr : _seg_part_map) {
+        for (auto &part : pr.second) {
+            maxPartDuration = MAX(maxPartDuration, part.duration);
+        }
+    }
+    for (auto &part : _cur_parts) {
+        maxPartDuration = MAX(maxPartDuration, part.duration);
+    }
 
-    auto sequence = _seg_number ? (_file_index > _seg_number ? _file_index - _seg_number : 0LL) : 0LL;
+    //m3u8中第一个已生成完毕的切片序号
+    unsigned long long sequence = currentMsn() - _seg_dur_list.size();
 
     string m3u8;
      if (_seg_number == 0) {
@@ -45,29 +61,79 @@ void HlsMaker::makeIndexFile(bool eof) {
         snprintf(file_content, sizeof(file_content),
                  "#EXTM3U\n"
                  "#EXT-X-PLAYLIST-TYPE:EVENT\n"
-                 "#EXT-X-VERSION:4\n"
+                 "#EXT-X-VERSION:%d\n"
+                 "#EXT-X-TARGETDURATION:%u\n"
+                 "#EXT-X-MEDIA-SEQUENCE:%llu\n",
+                 _is_fmp4 ? 7 : 4,
+                 (maxSegmentDuration + 999) / 1000,
+                 sequence);
+    } else if (isLowLatency()) {
+        // partial segment时长可能因为帧间隔而略大于设置值
+        auto part_target = MAX(_part_duration, maxPartDuration / 1000.0f);
+        snprintf(file_content, sizeof(file_content),
+                 "#EXTM3U\n"
+                 "#EXT-X-VERSION:%d\n"
                  "#EXT-X-TARGETDURATION:%u\n"
+                 "#EXT-X-SERVER-CONTROL:CAN-BLOCK-RELOAD=YES,PART-HOLD-BACK=%.3f\n"
+                 "#EXT-X-PART-INF:PART-TARGET=%.3f\n"
                  "#EXT-X-MEDIA-SEQUENCE:%llu\n",
+                 _is_fmp4 ? 7 : 6,
                  (maxSegmentDuration + 999) / 1000,
+                 part_target * 3,
+                 part_target,
                  sequence);
     } else {
         snprintf(file_content, sizeof(file_content),
                  "#EXTM3U\n"
-                 "#EXT-X-VERSION:3\n"
+                 "#EXT-X-VERSION:%d\n"
                  "#EXT-X-ALLOW-CACHE:NO\n"
                  "#EXT-X-TARGETDURATION:%u\n"
                  "#EXT-X-MEDIA-SEQUENCE:%llu\n",
+                 _is_fmp4 ? 7 : 3,
                  (maxSegmentDuration + 999) / 1000,
                  sequence);
     }
     
     m3u8.assign(file_content);
+    if (_is_fmp4) {
+        // fmp4切片的init segment，与切片携带相同的url参数(鉴权等)
+        string params;
+        auto &seg_name = _seg_dur_list.empty() ? _last_file_name : std::get<1>(_seg_dur_list.back());
+        auto pos = seg_name.find('?');
+        if (pos != string::npos) {
+            params = seg_name.substr(pos);
+        }
+        m3u8.append("#EXT-X-MAP:URI=\"" + getInitSegmentName() + params + "\"\n");
+    }
 
+    auto append_parts = [&](const vector<PartInfo> &parts) {
+        for (auto &part : parts) {
+            snprintf(file_content, sizeof(file_content), "#EXT-X-PART:DURATION=%.3f,URI=\"%s\"%s\n",
+                     part.duration / 1000.0, part.uri.data(), part.independent ? ",INDEPENDENT=YES" : "");
+            m3u8.append(file_content);
+        }
+    };
+
+    auto index = sequence;
     for (auto &tp : _seg_dur_list) {
+        auto it = _seg_part_map.find(index++);
+        if (it != _seg_part_map.end()) {
+            append_parts(it->second);
+        }
         snprintf(file_content, sizeof(file_content), "#EXTINF:%.3f,\n%s\n", std::get<0>(tp) / 1000.0, std::get<1>(tp).data());
         m3u8.append(file_content);
     }
 
+    if (isLowLatency() && !eof) {
+        //尚未生成完毕的切片
+        append_parts(_cur_parts);
+        if (!_last_file_name.empty()) {
+            snprintf(file_content, sizeof(file_content), "#EXT-X-PRELOAD-HINT:TYPE=PART,URI=\"%s\"\n",
+                     getPartName(_cur_parts.size(), true).data());
+            m3u8.append(file_content);
+        }
+    }
+
     if (eof) {
         snprintf(file_content, sizeof(file_content), "#EXT-X-ENDLIST\n");
         m3u8.append(file_content);
@@ -81,13 +147,26 @@ void HlsMaker::inputData(void *data, size_t len, uint64_t timestamp, bool is_idr
         if (timestamp < _last_timestamp) {
             //时间戳回退了，切片时长重新计时
             WarnL << "stamp reduce: " << _last_timestamp << " -> " << timestamp;
-            _last_seg_timestamp = _last_timestamp = timestamp;
+            _last_part_timestamp = _last_seg_timestamp = _last_timestamp = timestamp;
         }
         if (is_idr_fast_packet) {
             //尝试切片ts
             addNewSegment(timestamp);
         }
         if (!_last_file_name.empty()) {
+            //先比较再相减，防止时间戳早于partial segment起始时间时无符号数下溢
+            if (_part_has_data && timestamp >= _last_part_timestamp + _part_duration * 1000) {
+                //partial segment时长已到，以本帧作为下个partial segment的开始
+                flushPart(timestamp, true);
+            }
+            if (isLowLatency() && !_part_has_data) {
+                _part_has_data = true;
+                _part_independent = is_idr_fast_packet;
+                if (_cur_parts.empty()) {
+                    //切片的第一个partial segment与切片同时开始
+                    _last_part_timestamp = _last_seg_timestamp;
+                }
+            }
             //存在切片才写入ts数据
             onWriteSegment((char *) data, len);
             _last_timestamp = timestamp;
@@ -137,12 +216,28 @@ void HlsMaker::flushLastSegment(bool eof){
         //不存在上个切片
         return;
     }
+    if (_part_has_data) {
+        //本切片的最后一个partial segment
+        flushPart(_last_timestamp, false);
+    }
     //文件创建到最后一次数据写入的时间即为切片长度
     auto seg_dur = _last_timestamp - _last_seg_timestamp;
     if (seg_dur <= 0) {
         seg_dur = 100;
     }
     _seg_dur_list.emplace_back(seg_dur, std::move(_last_file_name));
+    ++_seg_flushed;
+    if (isLowLatency()) {
+        //只有最近几个切片才在m3u8中列出partial segment
+        _seg_part_map[_file_index - 1].swap(_cur_parts);
+        _cur_parts.clear();
+        while (_seg_part_map.size() > kPartSegmentNum) {
+            for (auto &part : _seg_part_map.begin()->second) {
+                onDelPart(part.name);
+            }
+            _seg_part_map.erase(_seg_part_map.begin());
+        }
+    }
     delOldSegment();
     //先flush ts切片，否则可能存在ts文件未写入完毕就被访问的情况
     onFlushLastSegment(seg_dur);
@@ -158,8 +253,82 @@ bool HlsMaker::isKeep() {
     return _seg_keep;
 }
 
+bool HlsMaker::isLowLatency() const {
+    return _part_duration > 0;
+}
+
+bool HlsMaker::isFmp4() const {
+    return _is_fmp4;
+}
+
+const string &HlsMaker::getInitSegmentName() {
+    static const string kInitSegmentName = "init.mp4";
+    return kInitSegmentName;
+}
+
+void HlsMaker::flushPart(uint64_t timestamp, bool make_index) {
+    uint64_t part_dur = timestamp > _last_part_timestamp ? timestamp - _last_part_timestamp : 1;
+    PartInfo part;
+    part.duration = part_dur;
+    part.independent = _part_independent;
+    part.name = getPartName(_cur_parts.size(), false);
+    part.uri = getPartName(_cur_parts.size(), true);
+    _part_has_data = false;
+    _last_part_timestamp = timestamp;
+    onFlushPart(part.name, part_dur);
+    _cur_parts.emplace_back(std::move(part));
+    if (make_index) {
+        makeIndexFile(false);
+    }
+}
+
+string HlsMaker::getPartName(uint32_t index, bool with_params) const {
+    // xxx.ts?params --> xxx.part{index}.ts?params
+    auto pos = _last_file_name.find('?');
+    auto name = _last_file_name.substr(0, pos);
+    auto suffix_pos = name.rfind('.');
+    name = name.substr(0, suffix_pos) + ".part" + to_string(index) + (suffix_pos == string::npos ? "" : name.substr(suffix_pos));
+    if (with_params && pos != string::npos) {
+        name += _last_file_name.substr(pos);
+    }
+    return name;
+}
+
+uint64_t HlsMaker::currentMsn() const {
+    //已生成完毕的切片序号为0 ~ _seg_flushed - 1，最新切片(正在生成或即将生成)的序号即为_seg_flushed
+    return _seg_flushed;
+}
+
+float HlsMaker::getSegmentDuration() const {
+    return _seg_duration;
+}
+
+uint32_t HlsMaker::currentPartCount() const {
+    return _cur_parts.size();
+}
+
+string HlsMaker::preloadPartName() const {
+    if (!isLowLatency() || _last_file_name.empty()) {
+        return "";
+    }
+    return getPartName(_cur_parts.size(), false);
+}
+
 void HlsMaker::clear() {
+    for (auto &pr : _seg_part_map) {
+        for (auto &part : pr.second) {
+            onDelPart(part.name);
+        }
+    }
+    for (auto &part : _cur_parts) {
+        onDelPart(part.name);
+    }
+    _seg_part_map.clear();
+    _cur_parts.clear();
+    _part_has_data = false;
+    _last_part_timestamp = 0;
     _file_index = 0;
+    _seg_flushed = 0;
     _last_timestamp = 0;
     _last_seg_timestamp = 0;
     _seg_dur_list.clear();
@@ -14,6 +14,8 @@
 #include <string>
 #include <deque>
 #include <tuple>
+#include <map>
+#include <vector>
 
 namespace mediakit {
 
@@ -23,8 +25,10 @@ public:
      * @param seg_duration 切片文件长度
      * @param seg_number 切片个数
      * @param seg_keep 是否保留切片文件
+     * @param part_duration 低延时hls(LL-HLS)的partial segment时长，单位秒，0代表关闭低延时hls
+     * @param is_fmp4 切片是否为fmp4格式
      */
-    HlsMaker(float seg_duration = 5, uint32_t seg_number = 3, bool seg_keep = false);
+    HlsMaker(float seg_duration = 5, uint32_t seg_number = 3, bool seg_keep = false, float part_duration = 0, bool is_fmp4 = false);
     virtual ~HlsMaker();
 
     /**
@@ -46,6 +50,21 @@ public:
      */
     bool isKeep();
 
+    /**
+     * 是否为低延时hls
+     */
+    bool isLowLatency() const;
+
+    /**
+     * 切片是否为fmp4格式
+     */
+    bool isFmp4() const;
+
+    /**
+     * fmp4切片的init segment文件名，与m3u8文件在同一目录
+     */
+    static const std::string &getInitSegmentName();
+
     /**
      * 清空记录
      */
@@ -83,12 +102,46 @@ protected:
      */
     virtual void onFlushLastSegment(uint64_t duration_ms) {};
 
+    /**
+     * 低延时hls下，一个partial segment写入完成
+     * 该partial segment的数据为上次回调以来onWriteSegment写入的数据
+     * @param part_name partial segment名(不含url参数)
+     * @param duration_ms partial segment时长，单位毫秒
+     */
+    virtual void onFlushPart(const std::string &part_name, uint64_t duration_ms) {};
+
+    /**
+     * 低延时hls下，partial segment已从m3u8中移除，可以删除
+     * @param part_name partial segment名(不含url参数)
+     */
+    virtual void onDelPart(const std::string &part_name) {};
+
     /**
      * 关闭上个ts切片并且写入m3u8索引
      * @param eof HLS直播是否已结束
      */
     void flushLastSegment(bool eof);
 
+    /**
+     * 低延时hls下，m3u8中最新切片的序号(EXT-X-MEDIA-SEQUENCE计数)，该切片可能尚未生成完毕
+     */
+    uint64_t currentMsn() const;
+
+    /**
+     * 低延时hls下，m3u8中最新切片已生成的partial segment个数
+     */
+    uint32_t currentPartCount() const;
+
+    /**
+     * 切片目标时长，单位秒
+     */
+    float getSegmentDuration() const;
+
+    /**
+     * 低延时hls下，m3u8中EXT-X-PRELOAD-HINT所指的partial segment名(不含url参数)，不存在时返回空
+     */
+    std::string preloadPartName() const;
+
 private:
     /**
      * 生成m3u8文件
@@ -107,13 +160,47 @@ private:
      */
     void addNewSegment(uint64_t timestamp);
 
+    /**
+     * 关闭当前partial segment
+     * @param timestamp partial segment结束时间戳
+     * @param make_index 是否重新生成m3u8文件
+     */
+    void flushPart(uint64_t timestamp, bool make_index);
+
+    /**
+     * 获取当前切片的第index个partial segment名
+     * @param index partial segment序号
+     * @param with_params 是否包含url参数
+     */
+    std::string getPartName(uint32_t index, bool with_params) const;
+
+private:
+    struct PartInfo {
+        int duration;
+        bool independent;
+        std::string name;
+        std::string uri;
+    };
+
 private:
+    bool _is_fmp4 = false;
+    float _part_duration = 0;
+    bool _part_independent = false;
+    bool _part_has_data = false;
+    uint64_t _last_part_timestamp = 0;
+    //当前切片已生成的partial segment
+    std::vector<PartInfo> _cur_parts;
+    //已生成完毕的切片所包含的partial segment，key为切片序号
+    std::map<uint64_t, std::vector<PartInfo> > _seg_part_map;
+
     float _seg_duration = 0;
     uint32_t _seg_number = 0;
     bool _seg_keep = false;
     uint64_t _last_timestamp = 0;
     uint64_t _last_seg_timestamp = 0;
     uint64_t _file_index = 0;
+    //已生成完毕(写入m3u8)的切片个数
+    uint64_t _seg_flushed = 0;
     std::string _last_file_name;
     std::deque<std::tuple<int,std::string> > _seg_dur_list;
 };
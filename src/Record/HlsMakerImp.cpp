@@ -26,7 +26,9 @@ HlsMakerImp::HlsMakerImp(const string &m3u8_file,
                          uint32_t bufSize,
                          float seg_duration,
                          uint32_t seg_number,
-                         bool seg_keep):HlsMaker(seg_duration, seg_number, seg_keep) {
+                         bool seg_keep,
+                         float part_duration,
+                         bool is_fmp4):HlsMaker(seg_duration, seg_number, seg_keep, part_duration, is_fmp4) {
     _poller = EventPollerPool::Instance().getPoller();
     _path_prefix = m3u8_file.substr(0, m3u8_file.rfind('/'));
     _path_hls = m3u8_file;
@@ -37,6 +39,12 @@ HlsMakerImp::HlsMakerImp(const string &m3u8_file,
     });
 
     _info.folder = _path_prefix;
+
+    GET_CONFIG(bool, memoryMode, Hls::kMemoryMode);
+    //内存模式只对直播生效，录制(点播或保留切片)时还需要写文件
+    _memory_mode = memoryMode && isLive();
+    _memory_seg_num = seg_number;
+    _write_file = !memoryMode || !isLive() || isKeep();
 }
 
 HlsMakerImp::~HlsMakerImp() {
@@ -55,6 +63,14 @@ void HlsMakerImp::clearCache() {
 void HlsMakerImp::clearCache(bool immediately, bool eof) {
     //录制完了
     flushLastSegment(eof);
+    _segment_buf = nullptr;
+    _part_buf = nullptr;
+    _memory_segments.clear();
+    if (_media_src) {
+        _media_src->clearSegment();
+    }
+    //init segment随切片一起被清空了，下个切片生成时重新写入
+    _init_segment_written = false;
     if (!isLive()||isKeep()) {
         return;
     }
@@ -82,13 +98,24 @@ string HlsMakerImp::onOpenSegment(uint64_t index) {
         auto strDate = getTimeStr("%Y-%m-%d");
         auto strHour = getTimeStr("%H");
         auto strTime = getTimeStr("%M-%S");
-        segment_name = StrPrinter << strDate + "/" + strHour + "/" + strTime << "_" << index << ".ts";
+        segment_name = StrPrinter << strDate + "/" + strHour + "/" + strTime << "_" << index << (isFmp4() ? ".mp4" : ".ts");
         segment_path = _path_prefix + "/" + segment_name;
-        if (isLive()) {
+        if (isLive() && _write_file) {
             _segment_file_paths.emplace(index, segment_path);
         }
     }
-    _file = makeFile(segment_path, true);
+    if (!_init_segment_written) {
+        writeInitSegment();
+    }
+    if (_memory_mode) {
+        _segment_buf = std::make_shared<BufferLikeString>();
+    }
+    if (_write_file) {
+        _file = makeFile(segment_path, true);
+        if (!_file) {
+            WarnL << "create file failed," << segment_path << " " << get_uv_errmsg();
+        }
+    }
 
     //保存本切片的元数据
     _info.start_time = ::time(NULL);
@@ -96,9 +123,6 @@ string HlsMakerImp::onOpenSegment(uint64_t index) {
     _info.file_path = segment_path;
     _info.url = _info.app + "/" + _info.stream + "/" + segment_name;
 
-    if (!_file) {
-        WarnL << "create file failed," << segment_path << " " << get_uv_errmsg();
-    }
     if (_params.empty()) {
         return segment_name;
     }
@@ -118,21 +142,34 @@ void HlsMakerImp::onWriteSegment(const char *data, size_t len) {
     if (_file) {
         fwrite(data, len, 1, _file.get());
     }
+    if (_segment_buf) {
+        _segment_buf->append(data, len);
+    }
+    if (isLowLatency()) {
+        if (!_part_buf) {
+            _part_buf = std::make_shared<BufferLikeString>();
+        }
+        _part_buf->append(data, len);
+    }
     if (_media_src) {
         _media_src->onSegmentSize(len);
     }
 }
 
 void HlsMakerImp::onWriteHls(const std::string &data) {
-    auto hls = makeFile(_path_hls);
-    if (hls) {
+    if (_write_file) {
+        auto hls = makeFile(_path_hls);
+        if (!hls) {
+            WarnL << "create hls file failed," << _path_hls << " " << get_uv_errmsg();
+            return;
+        }
         fwrite(data.data(), data.size(), 1, hls.get());
-        hls.reset();
-        if (_media_src) {
-            _media_src->setIndexFile(data);
+    }
+    if (_media_src) {
+        if (isLowLatency()) {
+            _media_src->setPlaylistState(currentMsn(), currentPartCount(), preloadPartName(), getSegmentDuration());
         }
-    } else {
-        WarnL << "create hls file failed," << _path_hls << " " << get_uv_errmsg();
+        _media_src->setIndexFile(data);
     }
     //DebugL << "\r\n"  << string(data,len);
 }
@@ -141,14 +178,76 @@ void HlsMakerImp::onFlushLastSegment(uint64_t duration_ms) {
     //关闭并flush文件到磁盘
     _file = nullptr;
 
+    size_t segment_size = 0;
+    if (_segment_buf) {
+        segment_size = _segment_buf->size();
+        if (_media_src) {
+            //切片写完后才对http服务器可见
+            _media_src->addSegment(_info.file_name, std::move(_segment_buf));
+            _memory_segments.emplace_back(_info.file_name);
+            if (_memory_segments.size() > _memory_seg_num) {
+                //m3u8中只保留最近_memory_seg_num个切片，更早的切片允许被内存上限淘汰
+                _media_src->unpinSegment(_memory_segments[_memory_segments.size() - _memory_seg_num - 1]);
+            }
+        }
+        _segment_buf = nullptr;
+
+        //跟文件模式一样，内存中多保留若干个已从m3u8中移除的切片
+        GET_CONFIG(uint32_t, segRetain, Hls::kSegmentRetain);
+        while (_media_src && _memory_segments.size() > _memory_seg_num + segRetain) {
+            _media_src->delSegment(_memory_segments.front());
+            _memory_segments.pop_front();
+        }
+    }
+
     GET_CONFIG(bool, broadcastRecordTs, Hls::kBroadcastRecordTs);
     if (broadcastRecordTs) {
         _info.time_len = duration_ms / 1000.0f;
-        _info.file_size = File::fileSize(_info.file_path.data());
+        _info.file_size = _write_file ? File::fileSize(_info.file_path.data()) : segment_size;
         NoticeCenter::Instance().emitEvent(Broadcast::kBroadcastRecordTs, _info);
     }
 }
 
+void HlsMakerImp::setInitSegment(std::string init_segment) {
+    _init_segment = std::move(init_segment);
+    _init_segment_written = false;
+}
+
+void HlsMakerImp::writeInitSegment() {
+    if (!isFmp4() || _init_segment.empty()) {
+        return;
+    }
+    _init_segment_written = true;
+    if (_write_file) {
+        auto path = _path_prefix + "/" + getInitSegmentName();
+        auto file = makeFile(path);
+        if (!file) {
+            WarnL << "create init segment file failed," << path << " " << get_uv_errmsg();
+        } else {
+            fwrite(_init_segment.data(), _init_segment.size(), 1, file.get());
+        }
+    }
+    if (_media_src && (_memory_mode || isLowLatency())) {
+        //内存模式下切片由http服务器直接从内存读取
+        //init segment从不调用unpinSegment，会一直钉在内存缓存中，不会被淘汰
+        _media_src->addSegment(getInitSegmentName(), std::make_shared<BufferString>(_init_segment));
+    }
+}
+
+void HlsMakerImp::onFlushPart(const std::string &part_name, uint64_t duration_ms) {
+    auto part = std::move(_part_buf);
+    if (part && _media_src) {
+        //partial segment只保存在内存中
+        _media_src->addSegment(part_name, std::move(part));
+    }
+}
+
+void HlsMakerImp::onDelPart(const std::string &part_name) {
+    if (_media_src) {
+        _media_src->delSegment(part_name);
+    }
+}
+
 std::shared_ptr<FILE> HlsMakerImp::makeFile(const string &file, bool setbuf) {
     auto file_buf = _file_buf;
     auto ret = shared_ptr<FILE>(File::create_file(file.data(), "wb"), [file_buf](FILE *fp) {
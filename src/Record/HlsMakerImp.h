@@ -14,6 +14,7 @@
 #include <memory>
 #include <string>
 #include <stdlib.h>
+#include <deque>
 #include "HlsMaker.h"
 #include "HlsMediaSource.h"
 
@@ -26,7 +27,9 @@ public:
                 uint32_t bufSize  = 64 * 1024,
                 float seg_duration = 5,
                 uint32_t seg_number = 3,
-                bool seg_keep = false);
+                bool seg_keep = false,
+                float part_duration = 0,
+                bool is_fmp4 = false);
 
     ~HlsMakerImp() override;
 
@@ -49,18 +52,32 @@ public:
       */
      void clearCache();
 
+    /**
+     * 设置fmp4切片的init segment
+     */
+    void setInitSegment(std::string init_segment);
+
 protected:
     std::string onOpenSegment(uint64_t index) override ;
     void onDelSegment(uint64_t index) override;
     void onWriteSegment(const char *data, size_t len) override;
     void onWriteHls(const std::string &data) override;
     void onFlushLastSegment(uint64_t duration_ms) override;
+    void onFlushPart(const std::string &part_name, uint64_t duration_ms) override;
+    void onDelPart(const std::string &part_name) override;
 
 private:
     std::shared_ptr<FILE> makeFile(const std::string &file,bool setbuf = false);
+    void writeInitSegment();
     void clearCache(bool immediately, bool eof);
 
 private:
+    //是否把直播切片保存在内存中
+    bool _memory_mode = false;
+    //是否写切片与m3u8文件
+    bool _write_file = true;
+    //内存模式下m3u8中的切片个数
+    uint32_t _memory_seg_num = 0;
     int _buf_size;
     std::string _params;
     std::string _path_hls;
@@ -71,6 +88,15 @@ private:
     HlsMediaSource::Ptr _media_src;
     toolkit::EventPoller::Ptr _poller;
     std::map<uint64_t/*index*/,std::string/*file_path*/> _segment_file_paths;
+    //内存模式下正在写入的切片
+    std::shared_ptr<toolkit::BufferLikeString> _segment_buf;
+    //低延时hls下正在写入的partial segment
+    std::shared_ptr<toolkit::BufferLikeString> _part_buf;
+    //fmp4切片的init segment，以及是否已经写入
+    bool _init_segment_written = false;
+    std::string _init_segment;
+    //内存模式下已保存在HlsMediaSource中的切片名
+    std::deque<std::string> _memory_segments;
 };
 
 }//namespace mediakit
@@ -10,6 +10,7 @@
 
 #include "HlsMediaSource.h"
 #include "Common/config.h"
+#include "Util/util.h"
 
 using namespace toolkit;
 
@@ -65,6 +66,23 @@ HlsMediaSource::Ptr HlsCookieData::getMediaSource() const {
     return _src.lock();
 }
 
+HlsMediaSource::~HlsMediaSource() {
+    clearSegment();
+    //回复仍在等待m3u8的请求(包括低延时hls的阻塞式请求)，内容为空时由http服务器回复404，防止请求一直被挂起
+    //等待partial segment的请求已在clearSegment中回复
+    decltype(_list_cb) list_cb;
+    decltype(_list_blocking_cb) blocking_cb;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_index);
+        list_cb.swap(_list_cb);
+        blocking_cb.swap(_list_blocking_cb);
+    }
+    list_cb.for_each([](const std::function<void(const std::string &str)> &cb) { cb(""); });
+    for (auto &request : blocking_cb) {
+        request.cb("");
+    }
+}
+
 void HlsMediaSource::setIndexFile(std::string index_file)
 {
     if (!_ring) {
@@ -81,24 +99,299 @@ void HlsMediaSource::setIndexFile(std::string index_file)
     }
 
     //赋值m3u8索引文件内容
-    std::lock_guard<std::mutex> lck(_mtx_index);
-    _index_file = std::move(index_file);
+    decltype(_list_cb) list_cb;
+    std::list<std::function<void(const std::string &)> > blocking_cb;
+    std::string index;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_index);
+        _index_file = std::move(index_file);
+
+        if (!_index_file.empty()) {
+            list_cb.swap(_list_cb);
+        }
+
+        for (auto it = _list_blocking_cb.begin(); it != _list_blocking_cb.end();) {
+            auto msn = it->msn;
+            auto part = it->part;
+            //m3u8清空(流重置)时也回复，防止请求一直被挂起
+            if (_index_file.empty() || _msn > msn || (_msn == msn && part >= 0 && _part_count > part)) {
+                blocking_cb.emplace_back(std::move(it->cb));
+                it = _list_blocking_cb.erase(it);
+                continue;
+            }
+            ++it;
+        }
+        if (list_cb.empty() && blocking_cb.empty()) {
+            return;
+        }
+        index = _index_file;
+    }
 
-    if (!_index_file.empty()) {
-        _list_cb.for_each([&](const std::function<void(const std::string& str)>& cb) { cb(_index_file); });
-        _list_cb.clear();
+    //在锁外回复，回调中可能再次访问本对象
+    list_cb.for_each([&](const std::function<void(const std::string &str)> &cb) { cb(index); });
+    for (auto &cb : blocking_cb) {
+        cb(index);
     }
 }
 
+void HlsMediaSource::setPlaylistState(uint64_t msn, uint32_t part_count, std::string preload_part, float target_duration) {
+    //rfc8216bis 6.2.5.2：阻塞超过3倍目标时长的请求可以直接回复
+    _block_timeout_ms = (uint64_t) (target_duration * 3 * 1000);
+    {
+        std::lock_guard<std::mutex> lck(_mtx_index);
+        _msn = msn;
+        _part_count = part_count;
+    }
+    std::lock_guard<std::mutex> lck(_mtx_segment);
+    _preload_part = std::move(preload_part);
+}
+
+void HlsMediaSource::getIndexFile(uint64_t msn, int64_t part, std::function<void(const std::string &str)> cb) {
+    std::string index;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_index);
+        // 请求的切片太超前(超过两个切片)时直接回复，参考rfc8216bis 6.2.5.2
+        bool ready = !_index_file.empty() && (_msn > msn || (_msn == msn && part >= 0 && _part_count > part) || msn > _msn + 2);
+        if (!ready) {
+            //等待m3u8更新
+            _list_blocking_cb.emplace_back(BlockingRequest { msn, part, getCurrentMillisecond() + getBlockTimeout(), std::move(cb) });
+            startWaitTimer();
+            return;
+        }
+        index = _index_file;
+    }
+    cb(index);
+}
+
 void HlsMediaSource::getIndexFile(std::function<void(const std::string& str)> cb)
 {
-    std::lock_guard<std::mutex> lck(_mtx_index);
-    if (!_index_file.empty()) {
-        cb(_index_file);
+    std::string index;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_index);
+        if (_index_file.empty()) {
+            //等待生成m3u8文件
+            _list_cb.emplace_back(std::move(cb));
+            return;
+        }
+        index = _index_file;
+    }
+    cb(index);
+}
+
+void HlsMediaSource::addSegment(const std::string &name, toolkit::Buffer::Ptr buffer) {
+    auto bytes = buffer->size();
+    std::list<std::function<void(const toolkit::Buffer::Ptr &)> > waiters;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_segment);
+        auto range = _preload_cb.equal_range(name);
+        for (auto it = range.first; it != range.second; ++it) {
+            waiters.emplace_back(std::move(it->second.cb));
+        }
+        _preload_cb.erase(range.first, range.second);
+        _segments[name] = buffer;
+    }
+    HlsMemoryCache::Instance().onAdd(std::dynamic_pointer_cast<HlsMediaSource>(shared_from_this()), name, bytes);
+    for (auto &cb : waiters) {
+        cb(buffer);
+    }
+}
+
+void HlsMediaSource::delSegment(const std::string &name) {
+    {
+        std::lock_guard<std::mutex> lck(_mtx_segment);
+        if (!_segments.erase(name)) {
+            return;
+        }
+    }
+    HlsMemoryCache::Instance().onDel(this, name);
+}
+
+void HlsMediaSource::unpinSegment(const std::string &name) {
+    HlsMemoryCache::Instance().onUnpin(this, name);
+}
+
+toolkit::Buffer::Ptr HlsMediaSource::getSegment(const std::string &name) {
+    toolkit::Buffer::Ptr ret;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_segment);
+        auto it = _segments.find(name);
+        if (it == _segments.end()) {
+            return nullptr;
+        }
+        ret = it->second;
+    }
+    HlsMemoryCache::Instance().onAccess(this, name);
+    return ret;
+}
+
+void HlsMediaSource::getSegment(const std::string &name, std::function<void(const toolkit::Buffer::Ptr &buffer)> cb) {
+    {
+        std::lock_guard<std::mutex> lck(_mtx_segment);
+        if (!_preload_part.empty() && name == _preload_part && _segments.find(name) == _segments.end()) {
+            //等待partial segment生成
+            _preload_cb.emplace(name, PreloadRequest { getCurrentMillisecond() + getBlockTimeout(), std::move(cb) });
+            startWaitTimer();
+            return;
+        }
+    }
+    cb(getSegment(name));
+}
+
+uint64_t HlsMediaSource::getBlockTimeout() const {
+    auto ret = _block_timeout_ms.load();
+    if (!ret) {
+        //尚未生成m3u8时按配置的切片时长计算
+        GET_CONFIG(float, segDuration, Hls::kSegmentDuration);
+        ret = (uint64_t) (segDuration * 3 * 1000);
+    }
+    return ret;
+}
+
+void HlsMediaSource::startWaitTimer() {
+    //流中断时m3u8与partial segment都不再更新，需要定时回复等待超时的请求
+    std::weak_ptr<HlsMediaSource> weak_self = std::dynamic_pointer_cast<HlsMediaSource>(shared_from_this());
+    EventPollerPool::Instance().getPoller()->doDelayTask(getBlockTimeout() + 1, [weak_self]() -> uint64_t {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->onWaitTimeout();
+        }
+        return 0;
+    });
+}
+
+void HlsMediaSource::onWaitTimeout() {
+    auto now = getCurrentMillisecond();
+    std::list<std::function<void(const std::string &)> > blocking_cb;
+    std::string index;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_index);
+        for (auto it = _list_blocking_cb.begin(); it != _list_blocking_cb.end();) {
+            if (it->deadline > now) {
+                ++it;
+                continue;
+            }
+            blocking_cb.emplace_back(std::move(it->cb));
+            it = _list_blocking_cb.erase(it);
+        }
+        if (!blocking_cb.empty()) {
+            index = _index_file;
+        }
+    }
+    //超时回复当前m3u8，由播放器重新发起请求
+    for (auto &cb : blocking_cb) {
+        cb(index);
+    }
+
+    std::list<std::function<void(const toolkit::Buffer::Ptr &)> > waiters;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_segment);
+        for (auto it = _preload_cb.begin(); it != _preload_cb.end();) {
+            if (it->second.deadline > now) {
+                ++it;
+                continue;
+            }
+            waiters.emplace_back(std::move(it->second.cb));
+            it = _preload_cb.erase(it);
+        }
+    }
+    //超时的partial segment回复404
+    for (auto &cb : waiters) {
+        cb(nullptr);
+    }
+}
+
+void HlsMediaSource::clearSegment() {
+    decltype(_segments) segments;
+    decltype(_preload_cb) preload_cb;
+    {
+        std::lock_guard<std::mutex> lck(_mtx_segment);
+        segments.swap(_segments);
+        preload_cb.swap(_preload_cb);
+        _preload_part.clear();
+    }
+    for (auto &pr : segments) {
+        HlsMemoryCache::Instance().onDel(this, pr.first);
+    }
+    for (auto &pr : preload_cb) {
+        pr.second.cb(nullptr);
+    }
+}
+
+////////////////////////////////////HlsMemoryCache//////////////////////////////////////
+
+INSTANCE_IMP(HlsMemoryCache)
+
+void HlsMemoryCache::onAdd(const HlsMediaSource::Ptr &src, const std::string &name, size_t bytes) {
+    GET_CONFIG(size_t, cacheMB, Hls::kMemoryCacheMB);
+    std::list<Item> evicted;
+    {
+        std::lock_guard<std::mutex> lck(_mtx);
+        Key key(src.get(), name);
+        auto it = _items.find(key);
+        if (it != _items.end()) {
+            //覆盖同名切片
+            _total_bytes -= it->second->bytes;
+            _lru.erase(it->second);
+            _items.erase(it);
+        }
+        _lru.emplace_front(Item { src, key, bytes, true });
+        _items.emplace(std::move(key), _lru.begin());
+        _total_bytes += bytes;
+
+        //超过内存上限，淘汰最久未被访问且已从m3u8中移除的切片
+        //m3u8中的切片被淘汰会导致播放失败，所以全部切片都在m3u8中时允许超出上限
+        for (auto it = _lru.end(); cacheMB && _total_bytes > cacheMB * 1024 * 1024 && it != _lru.begin();) {
+            --it;
+            if (it->pinned) {
+                continue;
+            }
+            _total_bytes -= it->bytes;
+            _items.erase(it->key);
+            auto victim = it++;
+            evicted.splice(evicted.end(), _lru, victim);
+        }
+    }
+    //在锁外删除切片，防止死锁
+    for (auto &item : evicted) {
+        auto strong_src = item.src.lock();
+        if (strong_src) {
+            WarnL << "hls memory cache is full, evict segment: " << strong_src->getUrl() << "/" << item.key.second;
+            strong_src->delSegment(item.key.second);
+        }
+    }
+}
+
+void HlsMemoryCache::onDel(const HlsMediaSource *src, const std::string &name) {
+    std::lock_guard<std::mutex> lck(_mtx);
+    auto it = _items.find(Key(src, name));
+    if (it == _items.end()) {
         return;
     }
-    //等待生成m3u8文件
-    _list_cb.emplace_back(std::move(cb));
+    _total_bytes -= it->second->bytes;
+    _lru.erase(it->second);
+    _items.erase(it);
+}
+
+void HlsMemoryCache::onAccess(const HlsMediaSource *src, const std::string &name) {
+    std::lock_guard<std::mutex> lck(_mtx);
+    auto it = _items.find(Key(src, name));
+    if (it == _items.end()) {
+        return;
+    }
+    _lru.splice(_lru.begin(), _lru, it->second);
+}
+
+void HlsMemoryCache::onUnpin(const HlsMediaSource *src, const std::string &name) {
+    std::lock_guard<std::mutex> lck(_mtx);
+    auto it = _items.find(Key(src, name));
+    if (it == _items.end()) {
+        return;
+    }
+    it->second->pinned = false;
+}
+
+size_t HlsMemoryCache::totalBytes() const {
+    std::lock_guard<std::mutex> lck(_mtx);
+    return _total_bytes;
 }
 
 } // namespace mediakit
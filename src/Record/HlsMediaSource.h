@@ -15,6 +15,7 @@
 #include "Util/TimeTicker.h"
 #include "Util/RingBuffer.h"
 #include <atomic>
+#include <list>
 
 namespace mediakit {
 
@@ -27,7 +28,16 @@ public:
 
     HlsMediaSource(const std::string &vhost, const std::string &app, const std::string &stream_id)
         : MediaSource(HLS_SCHEMA, vhost, app, stream_id) {}
-    ~HlsMediaSource() override = default;
+    ~HlsMediaSource() override;
+
+protected:
+    /**
+     * 供同样以内存切片+索引文件方式分发的协议(dash)复用
+     */
+    HlsMediaSource(const std::string &schema, const std::string &vhost, const std::string &app, const std::string &stream_id)
+        : MediaSource(schema, vhost, app, stream_id) {}
+
+public:
 
     /**
      * 	获取媒体源的环形缓冲
@@ -49,6 +59,23 @@ public:
      */
     void getIndexFile(std::function<void(const std::string &str)> cb);
 
+    /**
+     * 低延时hls下设置m3u8的当前状态，需在setIndexFile前调用
+     * @param msn m3u8中最新切片的序号
+     * @param part_count 最新切片已生成的partial segment个数
+     * @param preload_part EXT-X-PRELOAD-HINT所指的partial segment名
+     * @param target_duration 切片目标时长(秒)，阻塞式请求最多等待其3倍时长
+     */
+    void setPlaylistState(uint64_t msn, uint32_t part_count, std::string preload_part, float target_duration);
+
+    /**
+     * 低延时hls阻塞式获取m3u8文件(Blocking Playlist Reload)
+     * 直到m3u8中包含指定切片或partial segment时才回调，超过3倍切片时长仍未生成时回复当前m3u8
+     * @param msn 请求的切片序号，即_HLS_msn参数
+     * @param part 请求的partial segment序号，即_HLS_part参数，-1代表未指定
+     */
+    void getIndexFile(uint64_t msn, int64_t part, std::function<void(const std::string &str)> cb);
+
     /**
      * 同步获取m3u8文件
      */
@@ -59,11 +86,131 @@ public:
 
     void onSegmentSize(size_t bytes) { _speed[TrackVideo] += bytes; }
 
+    /**
+     * 内存模式下添加ts切片
+     * 新增的切片被m3u8引用，不会被内存上限淘汰，直到调用unpinSegment
+     * @param name 切片名，与m3u8中的相对路径一致
+     * @param buffer 切片数据
+     */
+    void addSegment(const std::string &name, toolkit::Buffer::Ptr buffer);
+
+    /**
+     * 内存模式下切片已从m3u8中移除(仅为防止播放器下载不完整而保留)，此后允许被内存上限淘汰
+     */
+    void unpinSegment(const std::string &name);
+
+    /**
+     * 内存模式下删除ts切片
+     */
+    void delSegment(const std::string &name);
+
+    /**
+     * 内存模式下获取ts切片，未找到返回nullptr
+     */
+    toolkit::Buffer::Ptr getSegment(const std::string &name);
+
+    /**
+     * 异步获取ts切片，如果是即将生成的partial segment(EXT-X-PRELOAD-HINT)则等待其生成后再回调
+     * 未找到或等待超过3倍切片时长时回调nullptr
+     */
+    void getSegment(const std::string &name, std::function<void(const toolkit::Buffer::Ptr &buffer)> cb);
+
+    /**
+     * 清空内存中的所有ts切片
+     */
+    void clearSegment();
+
 private:
+    /**
+     * 开始等待m3u8或partial segment更新时调用，到期后回复超时的请求
+     */
+    void startWaitTimer();
+    void onWaitTimeout();
+    uint64_t getBlockTimeout() const;
+
+private:
+    struct BlockingRequest {
+        uint64_t msn;
+        int64_t part;
+        //超时时间点(毫秒)
+        uint64_t deadline;
+        std::function<void(const std::string &)> cb;
+    };
+
+    struct PreloadRequest {
+        uint64_t deadline;
+        std::function<void(const toolkit::Buffer::Ptr &)> cb;
+    };
+
     RingType::Ptr _ring;
     std::string _index_file;
     mutable std::mutex _mtx_index;
     toolkit::List<std::function<void(const std::string &)>> _list_cb;
+    //低延时hls m3u8状态
+    uint64_t _msn = 0;
+    uint32_t _part_count = 0;
+    //阻塞式请求的最长等待时间(毫秒)
+    std::atomic<uint64_t> _block_timeout_ms { 0 };
+    //等待m3u8更新的阻塞式请求
+    std::list<BlockingRequest> _list_blocking_cb;
+
+    mutable std::mutex _mtx_segment;
+    std::string _preload_part;
+    std::unordered_map<std::string, toolkit::Buffer::Ptr> _segments;
+    //等待partial segment生成的请求
+    std::multimap<std::string, PreloadRequest> _preload_cb;
+};
+
+/**
+ * hls内存模式下本节点所有切片的内存统计，超过上限后按LRU淘汰已从m3u8中移除的切片
+ */
+class HlsMemoryCache {
+public:
+    static HlsMemoryCache &Instance();
+
+    /**
+     * 新增切片后统计其内存占用
+     */
+    void onAdd(const HlsMediaSource::Ptr &src, const std::string &name, size_t bytes);
+
+    /**
+     * 切片被删除后移除其内存统计
+     */
+    void onDel(const HlsMediaSource *src, const std::string &name);
+
+    /**
+     * 切片被访问，刷新其LRU位置
+     */
+    void onAccess(const HlsMediaSource *src, const std::string &name);
+
+    /**
+     * 切片已从m3u8中移除，允许被淘汰
+     */
+    void onUnpin(const HlsMediaSource *src, const std::string &name);
+
+    /**
+     * 当前所有切片占用内存字节数
+     */
+    size_t totalBytes() const;
+
+private:
+    HlsMemoryCache() = default;
+
+private:
+    using Key = std::pair<const HlsMediaSource *, std::string>;
+    struct Item {
+        std::weak_ptr<HlsMediaSource> src;
+        Key key;
+        size_t bytes;
+        //仍被m3u8引用的切片不淘汰
+        bool pinned;
+    };
+
+    size_t _total_bytes = 0;
+    mutable std::mutex _mtx;
+    //头部为最近访问的切片
+    std::list<Item> _lru;
+    std::map<Key, std::list<Item>::iterator> _items;
 };
 
 class HlsCookieData {
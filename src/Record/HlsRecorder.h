@@ -26,9 +26,15 @@ public:
         GET_CONFIG(bool, hlsKeep, Hls::kSegmentKeep);
         GET_CONFIG(uint32_t, hlsBufSize, Hls::kFileBufSize);
         GET_CONFIG(float, hlsDuration, Hls::kSegmentDuration);
+        GET_CONFIG(float, hlsPartDuration, Hls::kPartDuration);
+        GET_CONFIG(bool, hlsFmp4, Hls::kFmp4);
 
         _option = option;
-        _hls = std::make_shared<HlsMakerImp>(m3u8_file, params, hlsBufSize, hlsDuration, hlsNum, hlsKeep);
+#if defined(ENABLE_MP4)
+        //fmp4切片复用FMP4MediaSourceMuxer的输出，未开启fmp4转换时回退为ts切片
+        _is_fmp4 = hlsFmp4 && option.enable_fmp4;
+#endif
+        _hls = std::make_shared<HlsMakerImp>(m3u8_file, params, hlsBufSize, hlsDuration, hlsNum, hlsKeep, hlsPartDuration, _is_fmp4);
         //清空上次的残余文件
         _hls->clearCache();
     }
@@ -63,6 +69,10 @@ public:
             _hls->clearCache();
             _hls->getMediaSource()->setIndexFile("");
         }
+        if (_is_fmp4) {
+            //fmp4切片数据由FMP4MediaSourceMuxer通过inputFMP4输入
+            return false;
+        }
         if (_enabled || !_option.hls_demand) {
             return MpegMuxer::inputFrame(frame);
         }
@@ -74,6 +84,30 @@ public:
         return _option.hls_demand ? (_clear_cache ? true : _enabled) : true;
     }
 
+    /**
+     * 是否为fmp4切片模式
+     */
+    bool isFmp4() const { return _is_fmp4; }
+
+    /**
+     * 设置fmp4 init segment
+     */
+    void setInitSegment(const std::string &init_segment) {
+        _hls->setInitSegment(init_segment);
+    }
+
+    /**
+     * 输入fmp4 fragment，由FMP4MediaSourceMuxer调用
+     * @param packet fragment数据
+     * @param stamp 时间戳
+     * @param key 是否包含关键帧
+     */
+    void inputFMP4(const toolkit::Buffer::Ptr &packet, uint64_t stamp, bool key) {
+        if (_is_fmp4 && (_enabled || !_option.hls_demand)) {
+            _hls->inputData(packet->data(), packet->size(), stamp, key);
+        }
+    }
+
 private:
     void onWrite(std::shared_ptr<toolkit::Buffer> buffer, uint64_t timestamp, bool key_pos) override {
         if (!buffer) {
@@ -86,6 +120,7 @@ private:
 private:
     bool _enabled = true;
     bool _clear_cache = false;
+    bool _is_fmp4 = false;
     ProtocolOption _option;
     std::shared_ptr<HlsMakerImp> _hls;
 };
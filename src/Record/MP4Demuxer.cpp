@@ -16,6 +16,7 @@
 #include "Extension/AAC.h"
 #include "Extension/G711.h"
 #include "Extension/Opus.h"
+#include "Common/config.h"
 using namespace toolkit;
 using namespace std;
 
@@ -32,12 +33,34 @@ void MP4Demuxer::openMP4(const string &file) {
 
     _mp4_file = std::make_shared<MP4FileDisk>();
     _mp4_file->openFile(file.data(), "rb+");
-    _mov_reader = _mp4_file->createReader();
-    getAllTracks();
-    _duration_ms = mov_reader_getduration(_mov_reader.get());
+    //其他播放器已经生成了该文件的索引，则无需再解析moov
+    _index = MP4SampleIndex::find(file);
+    if (!_index) {
+        _mov_reader = _mp4_file->createReader();
+        _index = MP4SampleIndex::get(file, _mov_reader.get());
+    }
+    if (!_index) {
+        //sample表不完整(例如fmp4)，通过libmov逐帧读取
+        getAllTracks();
+        _duration_ms = mov_reader_getduration(_mov_reader.get());
+        return;
+    }
+    //索引已生成，释放libmov的sample表
+    _mov_reader.reset();
+    for (auto &track : _index->getTracks()) {
+        if (track.video) {
+            onVideoTrack(track.track_id, track.object, track.width, track.height, track.extra.data(), track.extra.size());
+        } else {
+            onAudioTrack(track.track_id, track.object, track.channel_count, track.bit_per_sample, track.sample_rate, track.extra.data(), track.extra.size());
+        }
+    }
+    _duration_ms = _index->getDurationMS();
 }
 
 void MP4Demuxer::closeMP4() {
+    _index.reset();
+    _sample_pos = 0;
+    _read_ahead.reset();
     _mov_reader.reset();
     _mp4_file.reset();
 }
@@ -156,6 +179,14 @@ void MP4Demuxer::onAudioTrack(uint32_t track_id, uint8_t object, int channel_cou
 }
 
 int64_t MP4Demuxer::seekTo(int64_t stamp_ms) {
+    if (_index) {
+        if (!_index->size()) {
+            return -1;
+        }
+        //二分查找关键帧，下次从该关键帧开始读取
+        _sample_pos = _index->seek(stamp_ms);
+        return _index->dts(_sample_pos);
+    }
     if(0 != mov_reader_seek(_mov_reader.get(),&stamp_ms)){
         return -1;
     }
@@ -177,6 +208,9 @@ struct Context {
 Frame::Ptr MP4Demuxer::readFrame(bool &keyFrame, bool &eof) {
     keyFrame = false;
     eof = false;
+    if (_index) {
+        return readSample(keyFrame, eof);
+    }
 
     static mov_reader_onread2 mov_onalloc = [](void *param, uint32_t track_id, size_t bytes, int64_t pts, int64_t dts, int flags) -> void * {
         Context *ctx = (Context *) param;
@@ -212,11 +246,69 @@ Frame::Ptr MP4Demuxer::readFrame(bool &keyFrame, bool &eof) {
     }
 }
 
+Frame::Ptr MP4Demuxer::readSample(bool &keyFrame, bool &eof) {
+    if (_sample_pos >= _index->size()) {
+        eof = true;
+        return nullptr;
+    }
+    auto pos = _sample_pos++;
+    auto offset = _index->offset(pos);
+    auto bytes = _index->bytes(pos);
+    if (!_read_ahead || offset < _read_ahead_offset || offset + bytes > _read_ahead_offset + _read_ahead->size()) {
+        //该sample不在预读数据块内
+        if (!readAhead(pos)) {
+            eof = true;
+            WarnL << "读取mp4文件数据失败, offset:" << offset << ", bytes:" << bytes;
+            return nullptr;
+        }
+    }
+
+    auto buffer = _buffer_pool.obtain2();
+    buffer->setCapacity(bytes + DATA_OFFSET + 1);
+    buffer->setSize(bytes + DATA_OFFSET);
+    memcpy(buffer->data() + DATA_OFFSET, _read_ahead->data() + (offset - _read_ahead_offset), bytes);
+    keyFrame = _index->keyFrame(pos);
+    return makeFrame(_index->trackId(pos), buffer, _index->pts(pos), _index->dts(pos));
+}
+
+bool MP4Demuxer::readAhead(size_t pos) {
+    GET_CONFIG(uint32_t, read_ahead_size, Record::kReadAheadSize);
+    auto start = _index->offset(pos);
+    auto end = start + _index->bytes(pos);
+    //后续sample在预读范围内的，合并为一次磁盘读取
+    for (auto i = pos + 1; i < _index->size(); ++i) {
+        auto offset = _index->offset(i);
+        auto sample_end = offset + _index->bytes(i);
+        if (offset < start || sample_end > start + read_ahead_size) {
+            break;
+        }
+        end = MAX(end, sample_end);
+    }
+
+    if (!_read_ahead) {
+        _read_ahead = BufferRaw::create();
+    }
+    _read_ahead->setCapacity(end - start + 1);
+    _read_ahead->setSize(end - start);
+    _read_ahead_offset = start;
+
+    MP4FileIO &io = *_mp4_file;
+    if (0 != io.onSeek(start) || 0 != io.onRead(_read_ahead->data(), end - start)) {
+        _read_ahead->setSize(0);
+        return false;
+    }
+    return true;
+}
+
 Frame::Ptr MP4Demuxer::makeFrame(uint32_t track_id, const Buffer::Ptr &buf, int64_t pts, int64_t dts) {
     auto it = _track_to_codec.find(track_id);
     if (it == _track_to_codec.end()) {
         return nullptr;
     }
+    if (_stamp_offset) {
+        dts = MAX(dts + _stamp_offset, 0);
+        pts = MAX(pts + _stamp_offset, 0);
+    }
     auto bytes = buf->size() - DATA_OFFSET;
     auto data = buf->data() + DATA_OFFSET;
     auto codec = it->second->getCodecId();
@@ -282,5 +374,9 @@ uint64_t MP4Demuxer::getDurationMS() const {
     return _duration_ms;
 }
 
+void MP4Demuxer::setStampOffset(int64_t offset_ms) {
+    _stamp_offset = offset_ms;
+}
+
 }//namespace mediakit
 #endif// ENABLE_MP4
\ No newline at end of file
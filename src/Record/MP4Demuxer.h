@@ -12,6 +12,7 @@
 #define ZLMEDIAKIT_MP4DEMUXER_H
 #ifdef ENABLE_MP4
 #include "MP4.h"
+#include "MP4SampleIndex.h"
 #include "Extension/Track.h"
 #include "Util/ResourcePool.h"
 namespace mediakit {
@@ -65,16 +66,33 @@ public:
      */
     uint64_t getDurationMS() const;
 
+    /**
+     * 设置输出帧的时间戳偏移量，多文件连续点播时用于将各文件的时间戳映射至同一时间轴
+     * 不影响seekTo的参数与返回值
+     * @param offset_ms 偏移量，单位毫秒
+     */
+    void setStampOffset(int64_t offset_ms);
+
 private:
     int getAllTracks();
     void onVideoTrack(uint32_t track_id, uint8_t object, int width, int height, const void *extra, size_t bytes);
     void onAudioTrack(uint32_t track_id, uint8_t object, int channel_count, int bit_per_sample, int sample_rate, const void *extra, size_t bytes);
     Frame::Ptr makeFrame(uint32_t track_id, const toolkit::Buffer::Ptr &buf, int64_t pts, int64_t dts);
+    Frame::Ptr readSample(bool &keyFrame, bool &eof);
+    bool readAhead(size_t pos);
 
 private:
     MP4FileDisk::Ptr _mp4_file;
     MP4FileDisk::Reader _mov_reader;
+    //sample索引，存在时不再通过libmov读取与seek
+    MP4SampleIndex::Ptr _index;
+    //下个读取的sample序号
+    size_t _sample_pos = 0;
+    //预读的数据块及其在文件中的偏移量
+    uint64_t _read_ahead_offset = 0;
+    toolkit::BufferRaw::Ptr _read_ahead;
     uint64_t _duration_ms = 0;
+    int64_t _stamp_offset = 0;
     std::map<int, Track::Ptr> _track_to_codec;
     toolkit::ResourcePool<toolkit::BufferRaw> _buffer_pool;
 };
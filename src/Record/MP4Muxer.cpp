@@ -369,6 +369,7 @@ void MP4MuxerMemory::resetTracks() {
     MP4MuxerInterface::resetTracks();
     _memory_file = std::make_shared<MP4FileMemory>();
     _init_segment.clear();
+    _segment_started = false;
 }
 
 bool MP4MuxerMemory::inputFrame(const Frame::Ptr &frame) {
@@ -385,8 +386,15 @@ bool MP4MuxerMemory::inputFrame(const Frame::Ptr &frame) {
     auto data = _memory_file->getAndClearMemory();
     if (!data.empty()) {
         //输出切片数据
-        onSegmentData(std::move(data), frame->dts(), _key_frame);
+        onSegmentData(std::move(data), _segment_stamp, _key_frame);
         _key_frame = false;
+        _segment_started = false;
+    }
+
+    if (!_segment_started) {
+        //当前帧为新切片的第一帧，以其dts作为切片时间戳
+        _segment_started = true;
+        _segment_stamp = frame->dts();
     }
 
     if (key_frame) {
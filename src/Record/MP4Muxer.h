@@ -137,7 +137,7 @@ protected:
     /**
      * 输出fmp4切片回调函数
      * @param std::string 切片内容
-     * @param stamp 切片末尾时间戳
+     * @param stamp 切片第一帧的dts
      * @param key_frame 是否有关键帧
      */
     virtual void onSegmentData(std::string string, uint64_t stamp, bool key_frame) = 0;
@@ -147,6 +147,8 @@ protected:
 
 private:
     bool _key_frame = false;
+    bool _segment_started = false;
+    uint64_t _segment_stamp = 0;
     std::string _init_segment;
     MP4FileMemory::Ptr _memory_file;
 };
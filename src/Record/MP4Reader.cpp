@@ -10,7 +10,10 @@
 
 #ifdef ENABLE_MP4
 
+#include <ctime>
+#include <algorithm>
 #include "MP4Reader.h"
+#include "RecordCatalog.h"
 #include "Common/config.h"
 #include "Thread/WorkThreadPool.h"
 #include "Util/File.h"
@@ -33,10 +36,14 @@ MP4Reader::MP4Reader(const string &vhost, const string &app, const string &strea
             _file_path = app + "/" + stream_id;
         }
         _file_path = File::absolutePath(_file_path, recordPath);
+        //stream_id末尾为时间段时，为多文件连续点播
+        loadRecordFiles(stream_id);
     }
 
-    _demuxer = std::make_shared<MP4Demuxer>();
-    _demuxer->openMP4(_file_path);
+    if (!_demuxer) {
+        _demuxer = std::make_shared<MP4Demuxer>();
+        _demuxer->openMP4(_file_path);
+    }
 
     if (stream_id.empty()) {
         return;
@@ -45,7 +52,8 @@ MP4Reader::MP4Reader(const string &vhost, const string &app, const string &strea
     //读取mp4文件并流化时，不重复生成mp4/hls文件
     option.enable_mp4 = false;
     option.enable_hls = false;
-    _muxer = std::make_shared<MultiMediaSourceMuxer>(vhost, app, stream_id, _demuxer->getDurationMS() / 1000.0f, option);
+    option.dvr_second = 0;
+    _muxer = std::make_shared<MultiMediaSourceMuxer>(vhost, app, stream_id, getDurationMS() / 1000.0f, option);
     auto tracks = _demuxer->getTracks(false);
     if (tracks.empty()) {
         throw std::runtime_error(StrPrinter << "该mp4文件没有有效的track:" << _file_path);
@@ -60,6 +68,189 @@ MP4Reader::MP4Reader(const string &vhost, const string &app, const string &strea
     _muxer->addTrackCompleted();
 }
 
+static time_t makeLocalTime(int year, int month, int day, int hour, int minute, int second) {
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = minute;
+    tm.tm_sec = second;
+    tm.tm_isdst = -1;
+    return mktime(&tm);
+}
+
+//解析"20230501090000-20230501170000"格式的时间段
+static bool parseTimeRange(const string &str, time_t &begin, time_t &end) {
+    int t[12];
+    if (str.size() != sizeof("20230501090000-20230501170000") - 1 || str[14] != '-'
+        || 12 != sscanf(str.data(), "%4d%2d%2d%2d%2d%2d-%4d%2d%2d%2d%2d%2d", t, t + 1, t + 2, t + 3, t + 4, t + 5, t + 6, t + 7, t + 8, t + 9, t + 10, t + 11)) {
+        return false;
+    }
+    begin = makeLocalTime(t[0], t[1], t[2], t[3], t[4], t[5]);
+    end = makeLocalTime(t[6], t[7], t[8], t[9], t[10], t[11]);
+    return end > begin;
+}
+
+static bool isTracksCompatible(const vector<Track::Ptr> &a, const vector<Track::Ptr> &b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (a[i]->getCodecId() != b[i]->getCodecId()) {
+            return false;
+        }
+        auto video_a = dynamic_pointer_cast<VideoTrack>(a[i]);
+        auto video_b = dynamic_pointer_cast<VideoTrack>(b[i]);
+        if (video_a && video_b && (video_a->getVideoWidth() != video_b->getVideoWidth() || video_a->getVideoHeight() != video_b->getVideoHeight())) {
+            return false;
+        }
+        auto audio_a = dynamic_pointer_cast<AudioTrack>(a[i]);
+        auto audio_b = dynamic_pointer_cast<AudioTrack>(b[i]);
+        if (audio_a && audio_b && (audio_a->getAudioSampleRate() != audio_b->getAudioSampleRate() || audio_a->getAudioChannel() != audio_b->getAudioChannel())) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static MP4Demuxer::Ptr openRecordFile(const string &path, int64_t offset) {
+    try {
+        auto demuxer = std::make_shared<MP4Demuxer>();
+        demuxer->openMP4(path);
+        demuxer->setStampOffset(offset);
+        return demuxer;
+    } catch (std::exception &ex) {
+        WarnL << "打开录像文件失败:" << path << ", " << ex.what();
+        return nullptr;
+    }
+}
+
+void MP4Reader::loadRecordFiles(const string &stream_id) {
+    time_t begin, end;
+    auto pos = stream_id.rfind('/');
+    if (pos == string::npos || !parseTimeRange(stream_id.substr(pos + 1), begin, end)) {
+        return;
+    }
+
+    //从录像目录查询该时间段内的录像文件
+    auto folder = _file_path.substr(0, _file_path.rfind('/') + 1);
+    for (auto &item : RecordCatalog::Instance().getRecords(folder, begin, end)) {
+        _record_files.emplace_back(RecordFile { folder + item.file_name, (int64_t)(item.start_time - begin) * 1000 });
+    }
+    if (_record_files.empty() || !switchRecordFile(0)) {
+        throw std::runtime_error(StrPrinter << "该时间段内没有可播放的录像文件:" << folder << stream_id.substr(pos + 1));
+    }
+
+    //从开始时间之前最近的关键帧开始播放，该关键帧即为时间戳0点
+    int64_t shift = _record_files[_file_index].offset;
+    if (shift < 0) {
+        auto key_stamp = _demuxer->seekTo(-shift);
+        shift += key_stamp == -1 ? -shift : key_stamp;
+    }
+    for (auto &file : _record_files) {
+        file.offset -= shift;
+    }
+    _demuxer->setStampOffset(_record_files[_file_index].offset);
+
+    //点播时长以结束时间和最后一个文件的结束位置中较早者为准
+    auto &last = _record_files.back();
+    auto last_demuxer = &last == &_record_files[_file_index] ? _demuxer : openRecordFile(last.path, last.offset);
+    int64_t duration = (int64_t)(end - begin) * 1000 - shift;
+    if (last_demuxer) {
+        duration = MIN(duration, last.offset + (int64_t)last_demuxer->getDurationMS());
+    }
+    _duration_ms = MAX(duration, 0);
+    InfoL << "多文件连续点播:" << _file_path << ", 文件数:" << _record_files.size() << ", 时长:" << _duration_ms << "ms";
+}
+
+bool MP4Reader::switchRecordFile(size_t index) {
+    for (; index < _record_files.size(); ++index) {
+        MP4Demuxer::Ptr demuxer;
+        {
+            //_next_demuxer由后台线程赋值
+            lock_guard<recursive_mutex> lck(_mtx);
+            if (_next_demuxer && _next_index == index) {
+                //已经预先打开
+                demuxer = std::move(_next_demuxer);
+            }
+            _next_demuxer = nullptr;
+        }
+        if (!demuxer) {
+            demuxer = openRecordFile(_record_files[index].path, _record_files[index].offset);
+        }
+        if (!demuxer) {
+            continue;
+        }
+        if (_demuxer && !isTracksCompatible(_demuxer->getTracks(false), demuxer->getTracks(false))) {
+            //track无法拼接，跳过该文件
+            WarnL << "录像文件track与之前的文件不一致，已跳过:" << _record_files[index].path;
+            continue;
+        }
+        _demuxer = std::move(demuxer);
+        _file_index = index;
+        return true;
+    }
+    return false;
+}
+
+void MP4Reader::prefetchRecordFile(size_t index) {
+    if (index >= _record_files.size()) {
+        return;
+    }
+    {
+        //_next_demuxer由后台线程赋值
+        lock_guard<recursive_mutex> lck(_mtx);
+        if (_next_index == index && _next_demuxer) {
+            return;
+        }
+        _next_index = index;
+        _next_demuxer = nullptr;
+    }
+    weak_ptr<MP4Reader> weak_self = shared_from_this();
+    auto file = _record_files[index];
+    //在后台线程解析下个文件的moov，避免切换文件时卡顿
+    WorkThreadPool::Instance().getExecutor()->async([weak_self, index, file]() {
+        auto demuxer = openRecordFile(file.path, file.offset);
+        auto strong_self = weak_self.lock();
+        if (!strong_self || !demuxer) {
+            return;
+        }
+        lock_guard<recursive_mutex> lck(strong_self->_mtx);
+        if (strong_self->_next_index == index) {
+            strong_self->_next_demuxer = std::move(demuxer);
+        }
+    });
+}
+
+Frame::Ptr MP4Reader::readFrame(bool &keyFrame, bool &eof) {
+    auto frame = _demuxer->readFrame(keyFrame, eof);
+    while (eof && switchRecordFile(_file_index + 1)) {
+        //当前文件读取完毕，无缝切换至下个文件
+        eof = false;
+        auto offset = _record_files[_file_index].offset;
+        if (offset <= (int64_t)_max_dts) {
+            //录像文件间可能存在不到1秒的重叠，保证时间戳递增
+            _demuxer->setStampOffset(_max_dts + 1);
+        } else if (offset > (int64_t)getCurrentStamp()) {
+            //录像文件间存在空档，时间轴直接跳过
+            _seek_to = offset;
+            _seek_ticker.resetTime();
+        }
+        prefetchRecordFile(_file_index + 1);
+        frame = _demuxer->readFrame(keyFrame, eof);
+    }
+    if (frame) {
+        _max_dts = MAX(_max_dts, frame->dts());
+    }
+    return frame;
+}
+
+uint64_t MP4Reader::getDurationMS() const {
+    return _record_files.empty() ? _demuxer->getDurationMS() : _duration_ms;
+}
+
 bool MP4Reader::readSample() {
     if (_paused) {
         //确保暂停时，时间轴不走动
@@ -70,7 +261,7 @@ bool MP4Reader::readSample() {
     bool keyFrame = false;
     bool eof = false;
     while (!eof && _last_dts < getCurrentStamp()) {
-        auto frame = _demuxer->readFrame(keyFrame, eof);
+        auto frame = readFrame(keyFrame, eof);
         if (!frame) {
             continue;
         }
@@ -93,7 +284,7 @@ bool MP4Reader::readSample() {
 bool MP4Reader::readNextSample() {
     bool keyFrame = false;
     bool eof = false;
-    auto frame = _demuxer->readFrame(keyFrame, eof);
+    auto frame = readFrame(keyFrame, eof);
     if (!frame) {
         return false;
     }
@@ -111,6 +302,7 @@ void MP4Reader::stopReadMP4() {
 void MP4Reader::startReadMP4(uint64_t sample_ms, bool ref_self, bool file_repeat) {
     GET_CONFIG(uint32_t, sampleMS, Record::kSampleMS);
     auto strong_self = shared_from_this();
+    prefetchRecordFile(_file_index + 1);
     if (_muxer) {
         //一直读到所有track就绪为止
         while (!_muxer->isAllTrackReady() && readNextSample());
@@ -195,11 +387,31 @@ bool MP4Reader::speed(MediaSource &sender, float speed) {
 
 bool MP4Reader::seekTo(uint32_t stamp_seek) {
     lock_guard<recursive_mutex> lck(_mtx);
-    if (stamp_seek > _demuxer->getDurationMS()) {
+    if (stamp_seek > getDurationMS()) {
         //超过文件长度
         return false;
     }
-    auto stamp = _demuxer->seekTo(stamp_seek);
+    int64_t stamp;
+    if (!_record_files.empty()) {
+        //二分查找时间戳所在的录像文件
+        auto it = std::upper_bound(_record_files.begin(), _record_files.end(), (int64_t)stamp_seek, [](int64_t stamp, const RecordFile &file) {
+            return stamp < file.offset;
+        });
+        size_t index = it == _record_files.begin() ? 0 : it - _record_files.begin() - 1;
+        if (index != _file_index && !switchRecordFile(index)) {
+            return false;
+        }
+        auto offset = _record_files[_file_index].offset;
+        _demuxer->setStampOffset(offset);
+        _max_dts = 0;
+        prefetchRecordFile(_file_index + 1);
+        stamp = _demuxer->seekTo(MAX((int64_t)stamp_seek - offset, 0));
+        if (stamp != -1) {
+            stamp += offset;
+        }
+    } else {
+        stamp = _demuxer->seekTo(stamp_seek);
+    }
     if (stamp == -1) {
         //seek失败
         return false;
@@ -214,7 +426,7 @@ bool MP4Reader::seekTo(uint32_t stamp_seek) {
     bool keyFrame = false;
     bool eof = false;
     while (!eof) {
-        auto frame = _demuxer->readFrame(keyFrame, eof);
+        auto frame = readFrame(keyFrame, eof);
         if (!frame) {
             //文件读完了都未找到下一帧关键帧
             continue;
@@ -27,6 +27,8 @@ public:
      * @param app 应用名
      * @param stream_id 流id,置空时,只解复用mp4,但是不生成MediaSource
      * @param file_path 文件路径，如果为空则根据配置文件和上面参数自动生成，否则使用指定的文件
+     * file_path为空且stream_id形如"live/cam1/20230501090000-20230501170000"时，为多文件连续点播：
+     * 将录像目录live/cam1下该时间段内的所有mp4录像文件拼接为一个点播流，时间戳0对应开始时间(之前最近的关键帧)
      */
     MP4Reader(const std::string &vhost, const std::string &app, const std::string &stream_id, const std::string &file_path = "");
     ~MP4Reader() override = default;
@@ -65,8 +67,20 @@ private:
     uint32_t getCurrentStamp();
     void setCurrentStamp(uint32_t stamp);
     bool seekTo(uint32_t stamp_seek);
+    uint64_t getDurationMS() const;
+    Frame::Ptr readFrame(bool &keyFrame, bool &eof);
+
+    void loadRecordFiles(const std::string &stream_id);
+    bool switchRecordFile(size_t index);
+    void prefetchRecordFile(size_t index);
 
 private:
+    //多文件连续点播的录像文件
+    struct RecordFile {
+        std::string path;
+        //文件开始时间在点播时间轴上的位置，单位毫秒
+        int64_t offset;
+    };
     bool _file_repeat = false;
     bool _have_video = false;
     bool _paused = false;
@@ -79,6 +93,15 @@ private:
     toolkit::Timer::Ptr _timer;
     MP4Demuxer::Ptr _demuxer;
     MultiMediaSourceMuxer::Ptr _muxer;
+    //以下为多文件连续点播相关，_record_files为空时为单文件点播
+    size_t _file_index = 0;
+    uint64_t _duration_ms = 0;
+    //已输出帧的最大时间戳，切换文件时保证时间戳不回退
+    uint64_t _max_dts = 0;
+    std::vector<RecordFile> _record_files;
+    //预先打开(已解析moov)的下个文件
+    size_t _next_index = 0;
+    MP4Demuxer::Ptr _next_demuxer;
     toolkit::EventPoller::Ptr _poller;
 };
 
@@ -16,6 +16,7 @@
 #include "MP4Recorder.h"
 #include "Thread/WorkThreadPool.h"
 #include "MP4Muxer.h"
+#include "RecordCatalog.h"
 #include "Util/logger.h"
 
 using namespace std;
@@ -86,6 +87,8 @@ void MP4Recorder::asyncClose() {
             }
             // 临时文件名改成正式文件名，防止mp4未完成时被访问
             rename(full_path_tmp.data(), full_path.data());
+            //更新录像目录
+            RecordCatalog::Instance().addRecord(info);
         }
         //触发mp4录制切片生成事件
         NoticeCenter::Instance().emitEvent(Broadcast::kBroadcastRecordMP4, info);
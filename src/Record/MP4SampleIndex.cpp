@@ -0,0 +1,227 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifdef ENABLE_MP4
+#include <sys/stat.h>
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include "MP4SampleIndex.h"
+#include "Util/logger.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+//与libmov中mov_reader_next的交织规则保持一致
+#define AV_TRACK_TIMEBASE 1000
+
+struct IndexCache {
+    int64_t size;
+    int64_t mtime;
+    std::weak_ptr<const MP4SampleIndex> index;
+};
+
+static std::mutex s_mtx;
+//key为文件路径
+static std::map<std::string, IndexCache> s_cache;
+
+static bool getFileStat(const string &file, int64_t &size, int64_t &mtime) {
+    struct stat st;
+    if (0 != stat(file.data(), &st)) {
+        return false;
+    }
+    size = st.st_size;
+    mtime = st.st_mtime;
+    return true;
+}
+
+MP4SampleIndex::Ptr MP4SampleIndex::find(const string &file) {
+    int64_t size, mtime;
+    if (!getFileStat(file, size, mtime)) {
+        return nullptr;
+    }
+    lock_guard<mutex> lck(s_mtx);
+    auto it = s_cache.find(file);
+    if (it == s_cache.end()) {
+        return nullptr;
+    }
+    auto ret = it->second.index.lock();
+    if (!ret || it->second.size != size || it->second.mtime != mtime) {
+        //已无人引用或文件已被修改
+        s_cache.erase(it);
+        return nullptr;
+    }
+    return ret;
+}
+
+MP4SampleIndex::Ptr MP4SampleIndex::get(const string &file, mov_reader_t *reader) {
+    if (auto ret = find(file)) {
+        return ret;
+    }
+    int64_t size, mtime;
+    if (!getFileStat(file, size, mtime)) {
+        return nullptr;
+    }
+    std::shared_ptr<MP4SampleIndex> index(new MP4SampleIndex);
+    if (!index->load(reader)) {
+        return nullptr;
+    }
+    DebugL << "生成mp4 sample索引:" << file << ", sample数:" << index->size() << ", 关键帧数:" << index->_key_samples.size();
+
+    lock_guard<mutex> lck(s_mtx);
+    for (auto it = s_cache.begin(); it != s_cache.end();) {
+        //顺便清理已无人引用的索引
+        if (it->second.index.expired()) {
+            it = s_cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    s_cache[file] = IndexCache { size, mtime, index };
+    return index;
+}
+
+namespace {
+struct RawSample {
+    uint64_t offset;
+    uint32_t bytes;
+    int64_t pts;
+    int64_t dts;
+    int flags;
+};
+
+struct LoadContext {
+    std::vector<MP4SampleIndex::TrackInfo> tracks;
+    //与tracks一一对应
+    std::vector<std::vector<RawSample>> samples;
+};
+} // namespace
+
+bool MP4SampleIndex::load(mov_reader_t *reader) {
+    static mov_reader_trackinfo_t s_on_track = {
+        [](void *param, uint32_t track, uint8_t object, int width, int height, const void *extra, size_t bytes) {
+            //onvideo
+            TrackInfo info;
+            info.video = true;
+            info.track_id = track;
+            info.object = object;
+            info.width = width;
+            info.height = height;
+            info.extra.assign((char *)extra, bytes);
+            ((LoadContext *)param)->tracks.emplace_back(std::move(info));
+        },
+        [](void *param, uint32_t track, uint8_t object, int channel_count, int bit_per_sample, int sample_rate, const void *extra, size_t bytes) {
+            //onaudio
+            TrackInfo info;
+            info.track_id = track;
+            info.object = object;
+            info.channel_count = channel_count;
+            info.bit_per_sample = bit_per_sample;
+            info.sample_rate = sample_rate;
+            info.extra.assign((char *)extra, bytes);
+            ((LoadContext *)param)->tracks.emplace_back(std::move(info));
+        },
+        [](void *param, uint32_t track, uint8_t object, const void *extra, size_t bytes) {
+            //onsubtitle, do nothing
+        }
+    };
+
+    static mov_reader_onsample s_on_sample = [](void *param, uint32_t track, uint64_t offset, size_t bytes, int64_t pts, int64_t dts, int flags) {
+        LoadContext *ctx = (LoadContext *)param;
+        for (size_t i = 0; i < ctx->tracks.size(); ++i) {
+            if (ctx->tracks[i].track_id == track) {
+                ctx->samples[i].emplace_back(RawSample { offset, (uint32_t)bytes, pts, dts, flags });
+                return;
+            }
+        }
+        //不支持的track(字幕等)，忽略之
+    };
+
+    LoadContext ctx;
+    if (mov_reader_getinfo(reader, &s_on_track, &ctx) < 0 || ctx.tracks.empty() || ctx.tracks.size() > 0x7F) {
+        return false;
+    }
+    ctx.samples.resize(ctx.tracks.size());
+    if (0 != mov_reader_getsamples(reader, s_on_sample, &ctx)) {
+        return false;
+    }
+
+    size_t total = 0;
+    for (auto &samples : ctx.samples) {
+        total += samples.size();
+    }
+    _offset.reserve(total);
+    _bytes.reserve(total);
+    _dts.reserve(total);
+    _cts.reserve(total);
+    _attr.reserve(total);
+
+    //seek所依据的track
+    int key_track = -1;
+    for (size_t i = 0; i < ctx.tracks.size(); ++i) {
+        if (ctx.tracks[i].video) {
+            key_track = i;
+            break;
+        }
+    }
+
+    //按照libmov的规则对各track的sample进行交织，保证与逐帧读取时顺序一致
+    std::vector<size_t> cursor(ctx.tracks.size(), 0);
+    while (true) {
+        int best = -1;
+        int64_t best_dts = 0;
+        for (size_t i = 0; i < ctx.samples.size(); ++i) {
+            if (cursor[i] >= ctx.samples[i].size()) {
+                continue;
+            }
+            auto &sample = ctx.samples[i][cursor[i]];
+            if (best == -1 || (sample.dts < best_dts && best_dts - sample.dts > AV_TRACK_TIMEBASE)
+                || sample.offset < ctx.samples[best][cursor[best]].offset) {
+                best = i;
+                best_dts = sample.dts;
+            }
+        }
+        if (best == -1) {
+            break;
+        }
+        auto &sample = ctx.samples[best][cursor[best]++];
+        bool key = sample.flags & MOV_AV_FLAG_KEYFREAME;
+        if (key_track == -1 || (key_track == best && key)) {
+            _key_samples.emplace_back((uint32_t)_offset.size());
+        }
+        _offset.emplace_back(sample.offset);
+        _bytes.emplace_back(sample.bytes);
+        _dts.emplace_back(sample.dts);
+        _cts.emplace_back((int32_t)(sample.pts - sample.dts));
+        _attr.emplace_back((uint8_t)best | (key ? 0x80 : 0));
+    }
+
+    _tracks = std::move(ctx.tracks);
+    _duration_ms = mov_reader_getduration(reader);
+    return true;
+}
+
+size_t MP4SampleIndex::seek(int64_t stamp_ms) const {
+    if (_key_samples.empty()) {
+        return 0;
+    }
+    auto it = std::upper_bound(_key_samples.begin(), _key_samples.end(), stamp_ms, [this](int64_t stamp, uint32_t index) {
+        return stamp < _dts[index];
+    });
+    if (it != _key_samples.begin()) {
+        --it;
+    }
+    return *it;
+}
+
+}//namespace mediakit
+#endif// ENABLE_MP4
@@ -0,0 +1,92 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_MP4SAMPLEINDEX_H
+#define ZLMEDIAKIT_MP4SAMPLEINDEX_H
+#ifdef ENABLE_MP4
+
+#include <vector>
+#include "MP4.h"
+
+namespace mediakit {
+
+/**
+ * mp4文件sample索引，打开文件时由libmov的sample表一次性生成
+ * sample按libmov的读取顺序(各track按dts交织)排列，以数组的方式(SoA)保存偏移量、长度与时间戳
+ * 同一文件的索引在所有点播该文件的MP4Demuxer间共享，文件被修改后自动失效
+ */
+class MP4SampleIndex {
+public:
+    using Ptr = std::shared_ptr<const MP4SampleIndex>;
+
+    struct TrackInfo {
+        bool video = false;
+        uint32_t track_id = 0;
+        uint8_t object = 0;
+        int width = 0;
+        int height = 0;
+        int channel_count = 0;
+        int bit_per_sample = 0;
+        int sample_rate = 0;
+        std::string extra;
+    };
+
+    /**
+     * 获取文件的sample索引，缓存中不存在时通过reader生成并缓存
+     * @param file 文件路径
+     * @param reader 已打开该文件的libmov解复用器
+     * @return sample索引，sample表不完整(例如fmp4)时返回nullptr
+     */
+    static Ptr get(const std::string &file, mov_reader_t *reader);
+
+    /**
+     * 在缓存中查找文件的sample索引，文件已修改时返回nullptr
+     */
+    static Ptr find(const std::string &file);
+
+    const std::vector<TrackInfo> &getTracks() const { return _tracks; }
+    uint64_t getDurationMS() const { return _duration_ms; }
+    size_t size() const { return _offset.size(); }
+
+    uint64_t offset(size_t index) const { return _offset[index]; }
+    uint32_t bytes(size_t index) const { return _bytes[index]; }
+    int64_t dts(size_t index) const { return _dts[index]; }
+    int64_t pts(size_t index) const { return _dts[index] + _cts[index]; }
+    uint32_t trackId(size_t index) const { return _tracks[_attr[index] & 0x7F].track_id; }
+    bool keyFrame(size_t index) const { return _attr[index] & 0x80; }
+
+    /**
+     * 二分查找时间戳所在的关键帧
+     * @param stamp_ms 时间戳，单位毫秒
+     * @return 该时间戳之前(含)最近一个关键帧的sample序号，时间戳早于第一个关键帧时返回第一个关键帧
+     */
+    size_t seek(int64_t stamp_ms) const;
+
+private:
+    MP4SampleIndex() = default;
+    bool load(mov_reader_t *reader);
+
+private:
+    uint64_t _duration_ms = 0;
+    std::vector<TrackInfo> _tracks;
+    std::vector<uint64_t> _offset;
+    std::vector<uint32_t> _bytes;
+    std::vector<int64_t> _dts;
+    //pts - dts
+    std::vector<int32_t> _cts;
+    //低7位为_tracks下标，最高位为关键帧标记
+    std::vector<uint8_t> _attr;
+    //seek所依据的关键帧sample序号，有视频时为视频关键帧，否则为所有sample
+    std::vector<uint32_t> _key_samples;
+};
+
+}//namespace mediakit
+#endif//ENABLE_MP4
+#endif //ZLMEDIAKIT_MP4SAMPLEINDEX_H
@@ -0,0 +1,453 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <set>
+#include <ctime>
+#include <cstdio>
+#include "RecordCatalog.h"
+#include "Common/config.h"
+#include "Util/File.h"
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Thread/WorkThreadPool.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+//目录文件名，位于流的录像文件夹下
+static const char kCatalogFile[] = ".record_catalog";
+//目录超过该时长未被访问则从内存中释放，单位毫秒
+static constexpr uint64_t kCatalogIdleMS = 10 * 60 * 1000;
+
+static string baseName(const string &path) {
+    return path.substr(path.rfind('/') + 1);
+}
+
+//日期文件夹，例如2023-05-01
+static bool isDateName(const string &name) {
+    int year, month, day;
+    return name.size() == sizeof("2023-05-01") - 1 && 3 == sscanf(name.data(), "%4d-%2d-%2d", &year, &month, &day);
+}
+
+//解析录像文件路径(相对于录像文件夹)获取开始时间，例如2023-05-01/09-00-00.mp4
+//正在录制的临时文件(以.开头)不是录像文件
+static bool parseRecordName(const string &file_name, time_t &start_time) {
+    int t[6];
+    if (file_name.size() != sizeof("2023-05-01/09-00-00.mp4") - 1
+        || 6 != sscanf(file_name.data(), "%4d-%2d-%2d/%2d-%2d-%2d.mp4", t, t + 1, t + 2, t + 3, t + 4, t + 5)) {
+        return false;
+    }
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = t[0] - 1900;
+    tm.tm_mon = t[1] - 1;
+    tm.tm_mday = t[2];
+    tm.tm_hour = t[3];
+    tm.tm_min = t[4];
+    tm.tm_sec = t[5];
+    tm.tm_isdst = -1;
+    start_time = mktime(&tm);
+    return true;
+}
+
+static uint32_t loadBE32(const uint8_t *ptr) {
+    return (uint32_t)ptr[0] << 24 | (uint32_t)ptr[1] << 16 | (uint32_t)ptr[2] << 8 | ptr[3];
+}
+
+static uint64_t loadBE64(const uint8_t *ptr) {
+    return (uint64_t)loadBE32(ptr) << 32 | loadBE32(ptr + 4);
+}
+
+//遍历mp4顶层box，获取moov偏移量，并从mvhd获取录像长度
+static void probeRecordFile(const string &path, RecordCatalog::Item &item) {
+    std::shared_ptr<FILE> fp(fopen(path.data(), "rb"), [](FILE *fp) {
+        if (fp) {
+            fclose(fp);
+        }
+    });
+    if (!fp) {
+        return;
+    }
+    uint64_t offset = 0;
+    uint8_t buf[40];
+    while (0 == fseek64(fp.get(), offset, SEEK_SET) && 8 == fread(buf, 1, 8, fp.get())) {
+        uint64_t size = loadBE32(buf);
+        if (size == 1) {
+            //64位box长度
+            if (8 != fread(buf + 8, 1, 8, fp.get())) {
+                break;
+            }
+            size = loadBE64(buf + 8);
+        }
+        if (0 == memcmp(buf + 4, "moov", 4)) {
+            item.index_offset = offset;
+            //moov的第一个子box一般为mvhd
+            if (item.time_len == 0 && 40 == fread(buf, 1, 40, fp.get()) && 0 == memcmp(buf + 4, "mvhd", 4)) {
+                uint32_t timescale = buf[8] == 1 ? loadBE32(buf + 28) : loadBE32(buf + 20);
+                uint64_t duration = buf[8] == 1 ? loadBE64(buf + 32) : loadBE32(buf + 24);
+                item.time_len = timescale ? (float)duration / timescale : 0;
+            }
+            break;
+        }
+        if (size < 8) {
+            //box长度为0表示延伸至文件末尾
+            break;
+        }
+        offset += size;
+    }
+}
+
+////////////////////////////////////StreamCatalog//////////////////////////////////////
+
+class RecordCatalog::StreamCatalog {
+public:
+    StreamCatalog(std::string folder) : _folder(std::move(folder)) {
+        load();
+    }
+
+    void add(const Item &item) {
+        lock_guard<mutex> lck(_mtx);
+        _items[item.file_name] = item;
+        //追加写入目录文件
+        std::shared_ptr<FILE> fp(File::create_file((_folder + kCatalogFile).data(), "ab"), [](FILE *fp) {
+            if (fp) {
+                fclose(fp);
+            }
+        });
+        if (fp) {
+            auto line = toLine(item);
+            fwrite(line.data(), 1, line.size(), fp.get());
+        }
+    }
+
+    vector<Item> getRecords(time_t begin, time_t end) {
+        vector<Item> ret;
+        lock_guard<mutex> lck(_mtx);
+        //文件名即开始时间，按文件名排序即按时间排序
+        auto it = _items.lower_bound(getTimeStr("%Y-%m-%d/%H-%M-%S.mp4", begin));
+        if (it != _items.begin()) {
+            //开始时间之前的文件可能包含开始时间
+            auto prev = std::prev(it);
+            if (prev->second.start_time + (time_t)prev->second.time_len > begin) {
+                it = prev;
+            }
+        }
+        for (; it != _items.end() && it->second.start_time < end; ++it) {
+            ret.emplace_back(it->second);
+        }
+        return ret;
+    }
+
+    vector<Item> getRecords(const string &date) {
+        vector<Item> ret;
+        auto prefix = date + "/";
+        lock_guard<mutex> lck(_mtx);
+        for (auto it = _items.lower_bound(prefix); it != _items.end() && it->first.compare(0, prefix.size(), prefix) == 0; ++it) {
+            ret.emplace_back(it->second);
+        }
+        return ret;
+    }
+
+    vector<string> getDates(const string &period) {
+        vector<string> ret;
+        lock_guard<mutex> lck(_mtx);
+        auto it = _items.lower_bound(period);
+        while (it != _items.end() && it->first.compare(0, period.size(), period) == 0) {
+            auto date = it->first.substr(0, it->first.find('/'));
+            ret.emplace_back(date);
+            //跳过该日期的所有文件('0'大于'/')
+            it = _items.lower_bound(date + "0");
+        }
+        return ret;
+    }
+
+    bool empty() {
+        lock_guard<mutex> lck(_mtx);
+        return _items.empty();
+    }
+
+    //最早的录像的结束时间，没有录像时返回0
+    time_t oldestEndTime() {
+        lock_guard<mutex> lck(_mtx);
+        if (_items.empty()) {
+            return 0;
+        }
+        auto &item = _items.begin()->second;
+        return item.start_time + (time_t)item.time_len;
+    }
+
+    void deleteExpired(time_t expire_time) {
+        set<string> dates;
+        {
+            lock_guard<mutex> lck(_mtx);
+            for (auto it = _items.begin(); it != _items.end() && it->second.start_time + (time_t)it->second.time_len < expire_time;) {
+                InfoL << "删除过期录像文件:" << _folder << it->first;
+                File::delete_file((_folder + it->first).data());
+                dates.emplace(it->first.substr(0, it->first.find('/')));
+                it = _items.erase(it);
+            }
+            if (dates.empty()) {
+                return;
+            }
+            save();
+        }
+        for (auto &date : dates) {
+            //删除空的日期文件夹
+            bool empty = true;
+            File::scanDir(_folder + date, [&](const string &path, bool is_dir) {
+                empty = false;
+                return false;
+            });
+            if (empty) {
+                File::delete_file((_folder + date).data());
+            }
+        }
+    }
+
+private:
+    static string toLine(const Item &item) {
+        return StrPrinter << item.file_name << "\t" << item.start_time << "\t" << item.time_len << "\t" << item.file_size << "\t" << item.index_offset << "\n";
+    }
+
+    void load() {
+        //读取目录文件
+        auto content = File::loadFile((_folder + kCatalogFile).data());
+        for (auto &line : split(content, "\n")) {
+            auto fields = split(line, "\t");
+            if (fields.size() < 5) {
+                continue;
+            }
+            Item item;
+            item.file_name = fields[0];
+            item.start_time = atoll(fields[1].data());
+            item.time_len = atof(fields[2].data());
+            item.file_size = strtoull(fields[3].data(), nullptr, 10);
+            item.index_offset = strtoull(fields[4].data(), nullptr, 10);
+            _items[item.file_name] = std::move(item);
+        }
+
+        //与磁盘文件核对
+        auto loaded = _items.size();
+        bool changed = false;
+        set<string> on_disk;
+        File::scanDir(_folder, [&](const string &path, bool is_dir) {
+            auto date = baseName(path);
+            if (!is_dir || !isDateName(date)) {
+                return true;
+            }
+            File::scanDir(path, [&](const string &file, bool is_dir) {
+                Item item;
+                item.file_name = date + "/" + baseName(file);
+                if (is_dir || !parseRecordName(item.file_name, item.start_time)) {
+                    return true;
+                }
+                on_disk.emplace(item.file_name);
+                if (_items.find(item.file_name) == _items.end()) {
+                    //目录中没有的文件(例如升级前的录像)
+                    item.file_size = File::fileSize(file.data());
+                    probeRecordFile(file, item);
+                    _items.emplace(item.file_name, std::move(item));
+                    changed = true;
+                }
+                return true;
+            });
+            return true;
+        });
+        for (auto it = _items.begin(); it != _items.end();) {
+            if (on_disk.find(it->first) == on_disk.end()) {
+                //文件已被删除
+                it = _items.erase(it);
+                changed = true;
+            } else {
+                ++it;
+            }
+        }
+        if (changed) {
+            save();
+        }
+        DebugL << "加载录像目录:" << _folder << ", 目录记录数:" << loaded << ", 核对后文件数:" << _items.size();
+    }
+
+    void save() {
+        string content;
+        for (auto &pr : _items) {
+            content += toLine(pr.second);
+        }
+        //先写临时文件再改名，防止写入过程中异常退出导致目录损坏
+        auto path = _folder + kCatalogFile;
+        if (File::saveFile(content, (path + ".tmp").data())) {
+            rename((path + ".tmp").data(), path.data());
+        }
+    }
+
+private:
+    std::mutex _mtx;
+    std::string _folder;
+    //key为相对于录像文件夹的文件路径
+    std::map<std::string, Item> _items;
+};
+
+////////////////////////////////////RecordCatalog//////////////////////////////////////
+
+INSTANCE_IMP(RecordCatalog)
+
+RecordCatalog::RecordCatalog() {
+    _timer = std::make_shared<Timer>(60.0f, [this]() {
+        onManager();
+        return true;
+    }, nullptr);
+}
+
+std::shared_ptr<RecordCatalog::StreamCatalog> RecordCatalog::getCatalog(const string &folder) {
+    std::shared_ptr<mutex> load_mtx;
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _catalogs.find(folder);
+        if (it != _catalogs.end()) {
+            it->second.last_access = getCurrentMillisecond();
+            return it->second.catalog;
+        }
+        auto &ref = _loading[folder];
+        if (!ref) {
+            ref = std::make_shared<mutex>();
+        }
+        load_mtx = ref;
+    }
+    //在全局锁外加载，防止核对磁盘文件时阻塞其他流；
+    //同一文件夹串行加载，防止重复加载并同时改写目录临时文件
+    lock_guard<mutex> load_lck(*load_mtx);
+    {
+        lock_guard<mutex> lck(_mtx);
+        auto it = _catalogs.find(folder);
+        if (it != _catalogs.end()) {
+            //其他线程已加载完毕
+            it->second.last_access = getCurrentMillisecond();
+            return it->second.catalog;
+        }
+    }
+    auto catalog = std::make_shared<StreamCatalog>(folder);
+    lock_guard<mutex> lck(_mtx);
+    _loading.erase(folder);
+    _evicted.erase(folder);
+    if (catalog->empty()) {
+        //文件夹不存在或没有录像(例如查询了错误的流)，不缓存，防止内存随查询无限增长
+        return catalog;
+    }
+    auto &cache = _catalogs[folder];
+    cache.catalog = std::move(catalog);
+    cache.last_access = getCurrentMillisecond();
+    return cache.catalog;
+}
+
+void RecordCatalog::addRecord(const RecordInfo &info) {
+    if (info.file_path.compare(0, info.folder.size(), info.folder) != 0) {
+        return;
+    }
+    Item item;
+    item.file_name = info.file_path.substr(info.folder.size());
+    item.start_time = info.start_time;
+    item.time_len = info.time_len;
+    item.file_size = info.file_size;
+    probeRecordFile(info.file_path, item);
+    getCatalog(info.folder)->add(item);
+}
+
+vector<RecordCatalog::Item> RecordCatalog::getRecords(const string &folder, time_t begin, time_t end) {
+    return getCatalog(folder)->getRecords(begin, end);
+}
+
+vector<RecordCatalog::Item> RecordCatalog::getRecords(const string &folder, const string &date) {
+    return getCatalog(folder)->getRecords(date);
+}
+
+vector<string> RecordCatalog::getDates(const string &folder, const string &period) {
+    return getCatalog(folder)->getDates(period);
+}
+
+void RecordCatalog::loadAll() {
+    GET_CONFIG(string, record_path, Protocol::kMP4SavePath);
+    auto root = File::absolutePath("", record_path);
+    WorkThreadPool::Instance().getExecutor()->async([this, root]() {
+        //录像文件夹结构为: 根目录/[vhost/]record/app/stream/日期/时分秒.mp4
+        size_t count = 0;
+        function<void(const string &, int)> visit = [&](const string &dir, int depth) {
+            vector<string> sub_dirs;
+            bool is_stream_folder = false;
+            File::scanDir(dir, [&](const string &path, bool is_dir) {
+                if (is_dir) {
+                    is_stream_folder = is_stream_folder || isDateName(baseName(path));
+                    sub_dirs.emplace_back(path);
+                }
+                return true;
+            });
+            if (is_stream_folder) {
+                getCatalog(dir + "/");
+                ++count;
+                return;
+            }
+            if (depth < 8) {
+                for (auto &sub_dir : sub_dirs) {
+                    visit(sub_dir, depth + 1);
+                }
+            }
+        };
+        Ticker ticker;
+        visit(root.back() == '/' ? root.substr(0, root.size() - 1) : root, 0);
+        InfoL << "录像目录核对完毕:" << root << ", 流个数:" << count << ", 耗时:" << ticker.elapsedTime() << "ms";
+    });
+}
+
+void RecordCatalog::onManager() {
+    GET_CONFIG(uint32_t, retain_days, Record::kRetainDays);
+    auto now = getCurrentMillisecond();
+    auto expire_time = ::time(nullptr) - (time_t)retain_days * 24 * 3600;
+    vector<std::shared_ptr<StreamCatalog> > catalogs;
+    vector<string> expired_folders;
+    {
+        lock_guard<mutex> lck(_mtx);
+        for (auto it = _catalogs.begin(); it != _catalogs.end();) {
+            if (now - it->second.last_access > kCatalogIdleMS) {
+                //长时间未访问，释放内存，只记录何时需要删除其中的过期录像
+                auto oldest = it->second.catalog->oldestEndTime();
+                if (oldest) {
+                    _evicted[it->first] = oldest;
+                }
+                it = _catalogs.erase(it);
+                continue;
+            }
+            if (retain_days) {
+                catalogs.emplace_back(it->second.catalog);
+            }
+            ++it;
+        }
+        for (auto it = _evicted.begin(); retain_days && it != _evicted.end(); ++it) {
+            if (it->second < expire_time) {
+                expired_folders.emplace_back(it->first);
+            }
+        }
+    }
+    if (catalogs.empty() && expired_folders.empty()) {
+        return;
+    }
+    //删除文件比较耗时，放在后台线程执行
+    WorkThreadPool::Instance().getExecutor()->async([this, catalogs, expired_folders, expire_time]() {
+        for (auto &catalog : catalogs) {
+            catalog->deleteExpired(expire_time);
+        }
+        for (auto &folder : expired_folders) {
+            //已释放的目录重新加载后删除
+            getCatalog(folder)->deleteExpired(expire_time);
+        }
+    });
+}
+
+} // namespace mediakit
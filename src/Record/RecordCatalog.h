@@ -0,0 +1,103 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_RECORDCATALOG_H
+#define ZLMEDIAKIT_RECORDCATALOG_H
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include "Recorder.h"
+#include "Poller/Timer.h"
+
+namespace mediakit {
+
+/**
+ * mp4录像目录(catalog)，记录每个流的所有录像文件，避免查询录像时遍历磁盘目录
+ * 每个流的目录持久化在其录像文件夹下的.record_catalog文件中，每关闭一个录像文件追加一行
+ * 某个流的目录首次被访问时(或服务器启动后在后台)与磁盘文件核对一次
+ * 长时间未访问的目录从内存中释放，再次访问时重新加载；不存在或没有录像的文件夹不缓存
+ */
+class RecordCatalog {
+public:
+    struct Item {
+        //相对于录像文件夹的路径，例如2023-05-01/09-00-00.mp4
+        std::string file_name;
+        //开始时间，GMT标准时间，单位秒
+        time_t start_time = 0;
+        //录像长度，单位秒
+        float time_len = 0;
+        //文件大小，单位BYTE
+        uint64_t file_size = 0;
+        //moov(关键帧等索引信息)在文件中的偏移量，fastStart时位于文件头部
+        uint64_t index_offset = 0;
+    };
+
+    static RecordCatalog &Instance();
+
+    /**
+     * 录像文件生成后添加至目录，由MP4Recorder在文件关闭后调用
+     */
+    void addRecord(const RecordInfo &info);
+
+    /**
+     * 查询与时间段[begin, end)有交集的录像文件，按开始时间排序
+     * @param folder 流的录像文件夹，见Recorder::getRecordPath
+     * @param begin 开始时间，GMT标准时间，单位秒
+     * @param end 结束时间，GMT标准时间，单位秒
+     */
+    std::vector<Item> getRecords(const std::string &folder, time_t begin, time_t end);
+
+    /**
+     * 查询某天的录像文件，按开始时间排序
+     * @param date 日期，例如2023-05-01
+     */
+    std::vector<Item> getRecords(const std::string &folder, const std::string &date);
+
+    /**
+     * 查询有录像的日期
+     * @param period 日期前缀，例如2023-05，为空时返回所有日期
+     */
+    std::vector<std::string> getDates(const std::string &folder, const std::string &period);
+
+    /**
+     * 在后台遍历mp4录像根目录，加载所有流的录像目录并与磁盘核对，服务器启动时调用
+     */
+    void loadAll();
+
+private:
+    RecordCatalog();
+
+    class StreamCatalog;
+    std::shared_ptr<StreamCatalog> getCatalog(const std::string &folder);
+    void onManager();
+
+private:
+    struct CatalogCache {
+        std::shared_ptr<StreamCatalog> catalog;
+        //最后访问时间，单位毫秒
+        uint64_t last_access = 0;
+    };
+
+    std::mutex _mtx;
+    //key为流的录像文件夹
+    std::unordered_map<std::string, CatalogCache> _catalogs;
+    //因长时间未访问而释放的目录，value为其最早的录像的结束时间，到期后重新加载以删除过期录像
+    std::unordered_map<std::string, time_t> _evicted;
+    //正在加载的录像文件夹及其加载锁，同一文件夹只允许一个线程加载
+    std::unordered_map<std::string, std::shared_ptr<std::mutex> > _loading;
+    toolkit::Timer::Ptr _timer;
+};
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_RECORDCATALOG_H
@@ -125,6 +125,15 @@ void FlvMuxer::onWriteFlvHeader(const RtmpMediaSource::Ptr &src) {
 }
 
 void FlvMuxer::onWriteFlvTag(const RtmpPacket::Ptr &pkt, uint32_t time_stamp, bool flush) {
+    auto &header = pkt->getFlvTagHeader();
+    auto &tag_size = pkt->getFlvTagSize();
+    if (header && tag_size && time_stamp == pkt->time_stamp) {
+        //时间戳未修改，直接复用RtmpMediaSource中已序列化好的flv tag
+        onWrite(header, false);
+        onWrite(pkt, false);
+        onWrite(tag_size, flush);
+        return;
+    }
     onWriteFlvTag(pkt->type_id, pkt, time_stamp, flush);
 }
 
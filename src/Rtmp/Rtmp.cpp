@@ -9,6 +9,7 @@
  */
 
 #include "Rtmp.h"
+#include "Rtmp/utils.h"
 #include "Extension/Factory.h"
 namespace mediakit{
 
@@ -163,6 +164,88 @@ void RtmpPacket::clear()
     ts_field = 0;
     body_size = 0;
     buffer.clear();
+    _flv_tag_header = nullptr;
+    _flv_tag_size = nullptr;
+    clearChunkHeader();
+}
+
+RtmpPacket::~RtmpPacket() {
+    clearChunkHeader();
+}
+
+void RtmpPacket::clearChunkHeader() {
+    auto node = _chunk_header.exchange(nullptr);
+    while (node) {
+        auto next = node->next_node;
+        delete node;
+        node = next;
+    }
+}
+
+void RtmpPacket::getChunkHeader(uint32_t stream_index, int chunk_id, toolkit::Buffer::Ptr &first, toolkit::Buffer::Ptr &next) {
+    auto find = [&](ChunkHeader *node) {
+        for (; node; node = node->next_node) {
+            if (node->stream_index == stream_index && node->chunk_id == chunk_id) {
+                first = node->first;
+                next = node->next;
+                return true;
+            }
+        }
+        return false;
+    };
+    auto head = _chunk_header.load(std::memory_order_acquire);
+    if (find(head)) {
+        return;
+    }
+
+    //首次使用，生成chunk头
+    bool ext_stamp = time_stamp >= 0xFFFFFF;
+    auto header_first = toolkit::BufferRaw::create();
+    header_first->setCapacity(sizeof(RtmpHeader) + 4);
+    header_first->setSize(sizeof(RtmpHeader) + (ext_stamp ? 4 : 0));
+    RtmpHeader *header = (RtmpHeader *) header_first->data();
+    header->fmt = 0;
+    header->chunk_id = chunk_id;
+    header->type_id = type_id;
+    set_be24(header->time_stamp, ext_stamp ? 0xFFFFFF : time_stamp);
+    set_be24(header->body_size, (uint32_t) size());
+    set_le32(header->stream_index, stream_index);
+    if (ext_stamp) {
+        set_be32(header_first->data() + sizeof(RtmpHeader), time_stamp);
+    }
+
+    auto header_next = toolkit::BufferRaw::create();
+    header_next->setCapacity(1 + 4);
+    header_next->setSize(1 + (ext_stamp ? 4 : 0));
+    header = (RtmpHeader *) header_next->data();
+    header->fmt = 3;
+    header->chunk_id = chunk_id;
+    if (ext_stamp) {
+        set_be32(header_next->data() + 1, time_stamp);
+    }
+
+    auto node = new ChunkHeader { stream_index, chunk_id, std::move(header_first), std::move(header_next), head };
+    while (!_chunk_header.compare_exchange_weak(node->next_node, node, std::memory_order_acq_rel, std::memory_order_acquire)) {
+        //其他线程已插入新节点，可能已生成相同参数的chunk头
+        if (find(node->next_node)) {
+            delete node;
+            return;
+        }
+    }
+    first = node->first;
+    next = node->next;
+}
+
+void RtmpPacket::makeFlvTag() {
+    RtmpTagHeader header;
+    header.type = type_id;
+    set_be24(header.data_size, (uint32_t) size());
+    header.timestamp_ex = (time_stamp >> 24) & 0xff;
+    set_be24(header.timestamp, time_stamp & 0xFFFFFF);
+    _flv_tag_header = std::make_shared<toolkit::BufferString>(std::string((char *) &header, sizeof(header)));
+
+    uint32_t tag_size = htonl((uint32_t) (size() + sizeof(header)));
+    _flv_tag_size = std::make_shared<toolkit::BufferString>(std::string((char *) &tag_size, 4));
 }
 
 bool RtmpPacket::isVideoKeyFrame() const
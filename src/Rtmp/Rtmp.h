@@ -13,6 +13,7 @@
 
 #include <memory>
 #include <string>
+#include <atomic>
 #include <cstdlib>
 #include "amf.h"
 #include "Network/Buffer.h"
@@ -187,15 +188,59 @@ public:
     int getAudioSampleBit() const;
     int getAudioChannel() const;
 
+    /**
+     * 序列化flv tag头与PreviousTagSize，由RtmpMediaSource在写入环形缓存前调用一次
+     * 之后所有http-flv/ws-flv播放器共享该序列化结果，不再逐个播放器重复生成
+     */
+    void makeFlvTag();
+
+    /**
+     * 获取共享的flv tag头(11字节)，未序列化时返回空
+     */
+    const toolkit::Buffer::Ptr &getFlvTagHeader() const { return _flv_tag_header; }
+
+    /**
+     * 获取共享的PreviousTagSize(4字节)，未序列化时返回空
+     */
+    const toolkit::Buffer::Ptr &getFlvTagSize() const { return _flv_tag_size; }
+
+    /**
+     * 获取rtmp chunk头，首次使用时生成，之后参数相同的播放器共享；负载不拷贝，由发送者按chunk size切片发送
+     * 可被多个播放器线程同时无锁调用
+     * @param stream_index 消息流id
+     * @param chunk_id 块流id
+     * @param first 第一个chunk的头(fmt0，含扩展时间戳)
+     * @param next 后续chunk的头(fmt3，含扩展时间戳)
+     */
+    void getChunkHeader(uint32_t stream_index, int chunk_id, toolkit::Buffer::Ptr &first, toolkit::Buffer::Ptr &next);
+
+    ~RtmpPacket() override;
+
 private:
     friend class toolkit::ResourcePool_l<RtmpPacket>;
     RtmpPacket(){
         clear();
     }
 
+    void clearChunkHeader();
+
     RtmpPacket &operator=(const RtmpPacket &that);
 
 private:
+    //flv tag序列化缓存，写入环形缓存后不再修改，可被多线程只读共享
+    toolkit::Buffer::Ptr _flv_tag_header;
+    toolkit::Buffer::Ptr _flv_tag_size;
+
+    struct ChunkHeader {
+        uint32_t stream_index;
+        int chunk_id;
+        toolkit::Buffer::Ptr first;
+        toolkit::Buffer::Ptr next;
+        ChunkHeader *next_node;
+    };
+    //rtmp chunk头缓存，节点生成后只读，通过cas插入链表头部；一般所有播放器参数相同，只会有一个节点
+    std::atomic<ChunkHeader *> _chunk_header{nullptr};
+
     //对象个数统计
     toolkit::ObjectStatistic<RtmpPacket> _statistic;
 };
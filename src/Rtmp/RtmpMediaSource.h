@@ -20,6 +20,7 @@
 #include "Rtmp.h"
 #include "Common/MediaSource.h"
 #include "Common/PacketCache.h"
+#include "Common/IngestProfiler.h"
 #include "Util/RingBuffer.h"
 
 #define RTMP_GOP_SIZE 512
@@ -148,6 +149,7 @@ private:
     void onFlush(std::shared_ptr<toolkit::List<RtmpPacket::Ptr> > rtmp_list, bool key_pos) override {
         //如果不存在视频，那么就没有存在GOP缓存的意义，所以is_key一直为true确保一直清空GOP缓存
         _ring->write(std::move(rtmp_list), _have_video ? key_pos : true);
+        IngestProfiler::onRingWrite(IngestProfiler::kStageRtmp);
     }
 
 private:
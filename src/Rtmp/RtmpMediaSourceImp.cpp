@@ -24,6 +24,8 @@ void RtmpMediaSource::onWrite(RtmpPacket::Ptr pkt, bool /*= true*/)
 {
     bool is_video = pkt->type_id == MSG_VIDEO;
     _speed[is_video ? TrackVideo : TrackAudio] += pkt->size();
+    //flv tag只在源头序列化一次，所有http-flv/ws-flv播放器共享
+    pkt->makeFlvTag();
     //保存当前时间戳
     switch (pkt->type_id) {
     case MSG_VIDEO: _track_stamps[TrackVideo] = pkt->time_stamp, _have_video = true; break;
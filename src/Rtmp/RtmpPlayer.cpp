@@ -14,6 +14,7 @@
 #include "Util/onceToken.h"
 #include "Thread/ThreadPool.h"
 #include "Common/config.h"
+#include "Common/IngestProfiler.h"
 #include "Common/Parser.h"
 
 #include "RtmpDemuxer.h"
@@ -155,6 +156,7 @@ void RtmpPlayer::onConnect(const SockException &err) {
 }
 
 void RtmpPlayer::onRecv(const Buffer::Ptr &buf){
+    IngestProfiler::RecvScope profile("rtmp");
     try {
         if (_benchmark_mode && !_play_timer) {
             //在性能测试模式下，如果rtmp握手完毕后，不再解析rtmp包
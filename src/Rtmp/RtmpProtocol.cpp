@@ -265,7 +265,42 @@ void RtmpProtocol::sendRtmp(uint8_t type, uint32_t stream_index, const Buffer::P
         totalSize += chunk;
         offset += chunk;
     }
-    _bytes_sent += (uint32_t)totalSize;
+    onSendBytes(totalSize);
+}
+
+void RtmpProtocol::sendRtmp(const RtmpPacket::Ptr &pkt, uint32_t stream_index) {
+    if (pkt->chunk_id < 2 || pkt->chunk_id > 63) {
+        //不支持的块流id，由该函数抛异常
+        sendRtmp(pkt->type_id, stream_index, pkt, pkt->time_stamp, pkt->chunk_id);
+        return;
+    }
+    Buffer::Ptr header_first, header_next;
+    pkt->getChunkHeader(stream_index, pkt->chunk_id, header_first, header_next);
+    onSendRawData(header_first);
+
+    size_t offset = 0;
+    size_t total_size = header_first->size();
+    auto body_size = pkt->size();
+    while (offset < body_size) {
+        if (offset) {
+            onSendRawData(header_next);
+            total_size += header_next->size();
+        }
+        auto chunk = min(_chunk_size_out, body_size - offset);
+        if (chunk == body_size) {
+            //只有一个chunk时直接发送rtmp包，无需切片
+            onSendRawData(pkt);
+        } else {
+            onSendRawData(std::make_shared<BufferPartial>(pkt, offset, chunk));
+        }
+        total_size += chunk;
+        offset += chunk;
+    }
+    onSendBytes(total_size);
+}
+
+void RtmpProtocol::onSendBytes(size_t bytes) {
+    _bytes_sent += (uint32_t) bytes;
     if (_windows_size > 0 && _bytes_sent - _bytes_sent_last >= _windows_size) {
         _bytes_sent_last = _bytes_sent;
         sendAcknowledgement(_bytes_sent);
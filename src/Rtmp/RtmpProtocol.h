@@ -61,6 +61,10 @@ protected:
     void sendResponse(int type, const std::string &str);
     void sendRtmp(uint8_t type, uint32_t stream_index, const std::string &buffer, uint32_t stamp, int chunk_id);
     void sendRtmp(uint8_t type, uint32_t stream_index, const toolkit::Buffer::Ptr &buffer, uint32_t stamp, int chunk_id);
+    /**
+     * 发送媒体rtmp包，chunk头缓存在RtmpPacket中由各会话共享，负载按chunk size切片发送，不拷贝
+     */
+    void sendRtmp(const RtmpPacket::Ptr &pkt, uint32_t stream_index);
     toolkit::BufferRaw::Ptr obtainBuffer(const void *data = nullptr, size_t len = 0);
 
 private:
@@ -78,6 +82,7 @@ private:
     const char* handle_C2(const char *data, size_t len);
     const char* handle_rtmp(const char *data, size_t len);
     void handle_chunk(RtmpPacket::Ptr chunk_data);
+    void onSendBytes(size_t bytes);
 
 protected:
     int _send_req_id = 0;
@@ -196,7 +196,7 @@ void RtmpPusher::send_metaData(){
     sendRequest(MSG_DATA, enc.data());
 
     src->getConfigFrame([&](const RtmpPacket::Ptr &pkt) {
-        sendRtmp(pkt->type_id, _stream_index, pkt, pkt->time_stamp, pkt->chunk_id);
+        sendRtmp(pkt, _stream_index);
     });
 
     src->pause(false);
@@ -215,7 +215,7 @@ void RtmpPusher::send_metaData(){
             if (++i == size) {
                 strong_self->setSendFlushFlag(true);
             }
-            strong_self->sendRtmp(rtmp->type_id, strong_self->_stream_index, rtmp, rtmp->time_stamp, rtmp->chunk_id);
+            strong_self->sendRtmp(rtmp, strong_self->_stream_index);
         });
     });
     _rtmp_reader->setDetachCB([weak_self]() {
@@ -10,6 +10,7 @@
 
 #include "RtmpSession.h"
 #include "Common/config.h"
+#include "Common/IngestProfiler.h"
 #include "Util/onceToken.h"
 
 using namespace std;
@@ -70,6 +71,7 @@ void RtmpSession::onManager() {
 }
 
 void RtmpSession::onRecv(const Buffer::Ptr &buf) {
+    IngestProfiler::RecvScope profile("rtmp");
     _ticker.resetTime();
     _total_bytes += buf->size();
     onParseRtmp(buf->data(), buf->size());
@@ -573,7 +575,7 @@ void RtmpSession::onCmd_seek(AMFDecoder &dec) {
 }
 
 void RtmpSession::onSendMedia(const RtmpPacket::Ptr &pkt) {
-    sendRtmp(pkt->type_id, pkt->stream_index, pkt, pkt->time_stamp, pkt->chunk_id);
+    sendRtmp(pkt, pkt->stream_index);
 }
 
 bool RtmpSession::close(MediaSource &sender) {
@@ -11,34 +11,190 @@
 #if defined(ENABLE_RTPPROXY)
 
 #include "PSEncoder.h"
+#include "mpeg-ps.h"
 #include "Common/config.h"
-#include "Extension/H264.h"
-#include "Extension/CommonRtp.h"
-#include "Rtsp/RtspMuxer.h"
 
 using namespace toolkit;
 
 namespace mediakit{
 
-PSEncoderImp::PSEncoderImp(uint32_t ssrc, uint8_t payload_type) : MpegMuxer(true) {
+PSEncoderImp::PSEncoderImp(uint32_t ssrc, uint8_t payload_type) {
     GET_CONFIG(uint32_t,video_mtu,Rtp::kVideoMtuSize);
-    _rtp_encoder = std::make_shared<CommonRtpEncoder>(CodecInvalid, ssrc, video_mtu, 90000, payload_type, 0);
-    _rtp_encoder->setRtpRing(std::make_shared<RtpRing::RingType>());
-    _rtp_encoder->getRtpRing()->setDelegate(std::make_shared<RingDelegateHelper>([this](RtpPacket::Ptr rtp, bool is_key){
-        onRTP(std::move(rtp),is_key);
-    }));
-    InfoL << this << " " << printSSRC(_rtp_encoder->getSsrc());
+    if (ssrc == 0) {
+        ssrc = ((uint64_t) this) & 0xFFFFFFFF;
+    }
+    _ssrc = ssrc;
+    _pt = payload_type;
+    _max_payload = video_mtu - RtpPacket::kRtpHeaderSize;
+    _packet_pool.setSize(64);
+    createContext();
+    InfoL << this << " " << printSSRC(_ssrc);
 }
 
 PSEncoderImp::~PSEncoderImp() {
-    InfoL << this << " " << printSSRC(_rtp_encoder->getSsrc());
+    releaseContext();
+    InfoL << this << " " << printSSRC(_ssrc);
+}
+
+#define XX(name, type, value, str, mpeg_id)                                                                          \
+    case name : {                                                                                                    \
+        if (mpeg_id == PSI_STREAM_RESERVED) {                                                                        \
+            break;                                                                                                   \
+        }                                                                                                            \
+        _codec_to_trackid[track->getCodecId()] = ps_muxer_add_stream((::ps_muxer_t *)_context, mpeg_id, nullptr, 0); \
+        return true;                                                                                                 \
+    }
+
+bool PSEncoderImp::addTrack(const Track::Ptr &track) {
+    if (track->getTrackType() == TrackVideo) {
+        _have_video = true;
+    }
+    switch (track->getCodecId()) {
+        CODEC_MAP(XX)
+        default: break;
+    }
+    WarnL << "不支持该编码格式,已忽略:" << track->getCodecName();
+    return false;
+}
+#undef XX
+
+bool PSEncoderImp::inputFrame(const Frame::Ptr &frame) {
+    auto it = _codec_to_trackid.find(frame->getCodecId());
+    if (it == _codec_to_trackid.end()) {
+        return false;
+    }
+    auto track_id = it->second;
+    _key_pos = !_have_video;
+    switch (frame->getCodecId()) {
+        case CodecH264:
+        case CodecH265: {
+            //这里的代码逻辑是让SPS、PPS、IDR这些时间戳相同的帧打包到一起当做一个帧处理，
+            return _frame_merger.inputFrame(frame, [this, track_id](uint64_t dts, uint64_t pts, const Buffer::Ptr &buffer, bool have_idr) {
+                _key_pos = have_idr;
+                //取视频时间戳为rtp的时间戳
+                _timestamp = dts;
+                inputES(track_id, have_idr ? MPEG_FLAG_IDR_FRAME : 0, pts, dts, buffer->data(), buffer->size());
+            });
+        }
+
+        case CodecAAC: {
+            if (frame->prefixSize() == 0) {
+                WarnL << "必须提供adts头才能mpeg-ps打包";
+                return false;
+            }
+        }
+
+        default: {
+            if (!_have_video) {
+                //没有视频时，才以音频时间戳为rtp的时间戳
+                _timestamp = frame->dts();
+            }
+            inputES(track_id, frame->keyFrame() ? MPEG_FLAG_IDR_FRAME : 0, frame->pts(), frame->dts(), frame->data(), frame->size());
+            return true;
+        }
+    }
+}
+
+void PSEncoderImp::inputES(int track_id, int flags, uint64_t pts, uint64_t dts, const char *data, size_t bytes) {
+    static ps_muxer_onsegment s_on_segment = [](void *param, const void *data, size_t bytes, int payload) {
+        ((PSEncoderImp *)param)->onSegment((const char *)data, bytes);
+        return 0;
+    };
+    ps_muxer_input_v((::ps_muxer_t *)_context, track_id, flags, pts * 90LL, dts * 90LL, data, bytes, s_on_segment, this);
+    //一帧ps数据打包完毕，最后一个rtp包设置mark位
+    flushRtp(true);
 }
 
-void PSEncoderImp::onWrite(std::shared_ptr<Buffer> buffer, uint64_t stamp, bool key_pos) {
-    if (!buffer) {
+void PSEncoderImp::onSegment(const char *data, size_t bytes) {
+    while (bytes) {
+        if (!_rtp) {
+            _rtp = _packet_pool.obtain2();
+            _rtp->setCapacity(RtpPacket::kRtpTcpHeaderSize + RtpPacket::kRtpHeaderSize + _max_payload);
+            _rtp->setSize(RtpPacket::kRtpTcpHeaderSize + RtpPacket::kRtpHeaderSize);
+            _rtp->sample_rate = 90000;
+            _rtp->type = TrackVideo;
+            _rtp->ntp_stamp = _timestamp;
+
+            //rtsp over tcp 头，长度在flushRtp时写入
+            auto ptr = (uint8_t *) _rtp->data();
+            ptr[0] = '$';
+            ptr[1] = 0;
+
+            //rtp头
+            auto header = _rtp->getHeader();
+            header->version = RtpPacket::kRtpVersion;
+            header->padding = 0;
+            header->ext = 0;
+            header->csrc = 0;
+            header->mark = 0;
+            header->pt = _pt;
+            header->seq = htons(_seq);
+            ++_seq;
+            header->stamp = htonl(uint64_t(_timestamp) * 90);
+            header->ssrc = htonl(_ssrc);
+        }
+        auto payload_size = _rtp->size() - RtpPacket::kRtpTcpHeaderSize - RtpPacket::kRtpHeaderSize;
+        auto size = MIN(bytes, _max_payload - payload_size);
+        memcpy(_rtp->data() + _rtp->size(), data, size);
+        _rtp->setSize(_rtp->size() + size);
+        data += size;
+        bytes -= size;
+        if (payload_size + size == _max_payload) {
+            //rtp包已满
+            flushRtp(false);
+        }
+    }
+}
+
+void PSEncoderImp::flushRtp(bool mark) {
+    if (!_rtp) {
         return;
     }
-    _rtp_encoder->inputFrame(std::make_shared<FrameFromPtr>(buffer->data(), buffer->size(), stamp, stamp,0,key_pos));
+    auto rtp = std::move(_rtp);
+    auto ptr = (uint8_t *) rtp->data();
+    auto rtp_size = rtp->size() - RtpPacket::kRtpTcpHeaderSize;
+    ptr[2] = rtp_size >> 8;
+    ptr[3] = rtp_size & 0xFF;
+    rtp->getHeader()->mark = mark;
+    onRTP(std::move(rtp), _key_pos);
+    //只有关键帧的第一个rtp包标记为关键帧
+    _key_pos = false;
+}
+
+void PSEncoderImp::resetTracks() {
+    _have_video = false;
+    releaseContext();
+    createContext();
+}
+
+void PSEncoderImp::createContext() {
+    static ps_muxer_func_t func = {
+        /*alloc*/
+        [](void *param, size_t bytes) -> void * {
+            //只使用ps_muxer_input_v，不分配ps包
+            return nullptr;
+        },
+        /*free*/
+        [](void *param, void *packet) {},
+        /*write*/
+        [](void *param, int stream, void *packet, size_t bytes) { return 0; }
+    };
+    if (_context == nullptr) {
+        _context = (struct ps_muxer_t *)ps_muxer_create(&func, this);
+    }
+}
+
+void PSEncoderImp::releaseContext() {
+    if (_context) {
+        ps_muxer_destroy((::ps_muxer_t *)_context);
+        _context = nullptr;
+    }
+    _codec_to_trackid.clear();
+    _frame_merger.clear();
+}
+
+void PSEncoderImp::flush() {
+    _frame_merger.flush();
 }
 
 }//namespace mediakit
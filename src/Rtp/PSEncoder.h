@@ -13,25 +13,51 @@
 
 #if defined(ENABLE_RTPPROXY)
 
-#include "Record/MPEG.h"
 #include "Common/MediaSink.h"
+#include "Rtsp/Rtsp.h"
+#include "Util/ResourcePool.h"
 
 namespace mediakit{
-class CommonRtpEncoder;
-class PSEncoderImp : public MpegMuxer{
+
+/**
+ * ps over rtp打包器
+ * pack/pes头部直接写入rtp负载，帧数据直接从Frame拷贝至rtp负载，不生成中间的ps包，rtp包对象池化复用
+ */
+class PSEncoderImp : public MediaSinkInterface {
 public:
     PSEncoderImp(uint32_t ssrc, uint8_t payload_type = 96);
     ~PSEncoderImp() override;
 
+    bool addTrack(const Track::Ptr &track) override;
+    void resetTracks() override;
+    bool inputFrame(const Frame::Ptr &frame) override;
+    void flush() override;
+
 protected:
     //rtp打包后回调
     virtual void onRTP(toolkit::Buffer::Ptr rtp,bool is_key = false) = 0;
 
-protected:
-    void onWrite(std::shared_ptr<toolkit::Buffer> buffer, uint64_t stamp, bool key_pos) override;
+private:
+    void createContext();
+    void releaseContext();
+    void inputES(int track_id, int flags, uint64_t pts, uint64_t dts, const char *data, size_t bytes);
+    void onSegment(const char *data, size_t bytes);
+    void flushRtp(bool mark);
 
 private:
-    std::shared_ptr<CommonRtpEncoder> _rtp_encoder;
+    bool _have_video = false;
+    bool _key_pos = false;
+    uint8_t _pt;
+    uint16_t _seq = 0;
+    uint32_t _ssrc;
+    size_t _max_payload;
+    uint64_t _timestamp = 0;
+    struct ps_muxer_t *_context = nullptr;
+    std::unordered_map<int, int/*track_id*/> _codec_to_trackid;
+    FrameMerger _frame_merger{FrameMerger::h264_prefix};
+    //正在写入的rtp包
+    RtpPacket::Ptr _rtp;
+    toolkit::ResourcePool<RtpPacket> _packet_pool;
 };
 
 }//namespace mediakit
@@ -85,6 +85,39 @@ void RtpSelector::delProcess(const string &stream_id,const RtpProcess *ptr) {
     process->onDetach();
 }
 
+bool RtpSelector::bindSSRC(uint32_t ssrc, const string &stream_id, bool only_audio) {
+    lock_guard<mutex> lck(_mtx_ssrc);
+    return _map_ssrc.emplace(ssrc, SSRCInfo { only_audio, stream_id, nullptr }).second;
+}
+
+void RtpSelector::unbindSSRC(uint32_t ssrc, const string &stream_id) {
+    lock_guard<mutex> lck(_mtx_ssrc);
+    auto it = _map_ssrc.find(ssrc);
+    if (it != _map_ssrc.end() && it->second.stream_id == stream_id) {
+        _map_ssrc.erase(it);
+    }
+}
+
+void RtpSelector::setSSRCOnDetach(uint32_t ssrc, const string &stream_id, function<void()> cb) {
+    lock_guard<mutex> lck(_mtx_ssrc);
+    auto it = _map_ssrc.find(ssrc);
+    if (it != _map_ssrc.end() && it->second.stream_id == stream_id) {
+        it->second.on_detach = std::move(cb);
+    }
+}
+
+bool RtpSelector::findSSRC(uint32_t ssrc, string &stream_id, bool &only_audio, function<void()> &on_detach) {
+    lock_guard<mutex> lck(_mtx_ssrc);
+    auto it = _map_ssrc.find(ssrc);
+    if (it == _map_ssrc.end()) {
+        return false;
+    }
+    stream_id = it->second.stream_id;
+    only_audio = it->second.only_audio;
+    on_detach = it->second.on_detach;
+    return true;
+}
+
 void RtpSelector::onManager() {
     List<RtpProcess::Ptr> clear_list;
     {
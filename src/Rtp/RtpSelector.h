@@ -74,6 +74,35 @@ public:
      */
     void delProcess(const std::string &stream_id, const RtpProcess *ptr);
 
+    /**
+     * 单端口复用模式下，把ssrc绑定到流id，公共rtp端口(rtp_proxy.port)收到该ssrc的rtp后按此流id创建rtp处理器
+     * @param ssrc rtp的ssrc
+     * @param stream_id 流id
+     * @param only_audio 是否只有音频
+     * @return ssrc已被绑定时返回false
+     */
+    bool bindSSRC(uint32_t ssrc, const std::string &stream_id, bool only_audio);
+
+    /**
+     * 解除ssrc与流id的绑定
+     */
+    void unbindSSRC(uint32_t ssrc, const std::string &stream_id);
+
+    /**
+     * 设置单端口复用模式下rtp处理器的onDetach事件回调
+     */
+    void setSSRCOnDetach(uint32_t ssrc, const std::string &stream_id, std::function<void()> cb);
+
+    /**
+     * 根据ssrc查找绑定的流id
+     * @param ssrc rtp的ssrc
+     * @param stream_id 绑定的流id
+     * @param only_audio 是否只有音频
+     * @param on_detach rtp处理器onDetach事件回调
+     * @return 未绑定时返回false
+     */
+    bool findSSRC(uint32_t ssrc, std::string &stream_id, bool &only_audio, std::function<void()> &on_detach);
+
 private:
     void onManager();
     void createTimer();
@@ -82,6 +111,14 @@ private:
     toolkit::Timer::Ptr _timer;
     std::recursive_mutex _mtx_map;
     std::unordered_map<std::string,RtpProcessHelper::Ptr> _map_rtp_process;
+
+    struct SSRCInfo {
+        bool only_audio;
+        std::string stream_id;
+        std::function<void()> on_detach;
+    };
+    std::mutex _mtx_ssrc;
+    std::unordered_map<uint32_t, SSRCInfo> _map_ssrc;
 };
 
 }//namespace mediakit
@@ -14,6 +14,7 @@
 #include "RtpSelector.h"
 #include "Rtcp/RtcpContext.h"
 #include "Common/config.h"
+#include "Common/IngestProfiler.h"
 
 using namespace std;
 using namespace toolkit;
@@ -21,6 +22,9 @@ using namespace toolkit;
 namespace mediakit{
 
 RtpServer::~RtpServer() {
+    if (_delay_task) {
+        _delay_task->cancel();
+    }
     if (_on_cleanup) {
         _on_cleanup();
     }
@@ -59,6 +63,7 @@ public:
     }
 
     void onRecvRtp(const Socket::Ptr &sock, const Buffer::Ptr &buf, struct sockaddr *addr) {
+        IngestProfiler::RecvScope profile("rtp");
         if (!_process) {
             _process = RtpSelector::Instance().getProcess(_stream_id, true);
             _process->setOnlyAudio(_only_audio);
@@ -241,13 +246,86 @@ void RtpServer::start(uint16_t local_port, const string &stream_id, TcpMode tcp_
     _rtcp_helper = helper;
 }
 
+void RtpServer::startShared(const string &stream_id, TcpMode tcp_mode, uint32_t ssrc, bool only_audio) {
+    GET_CONFIG(uint16_t, shared_port, RtpProxy::kPort);
+    if (!shared_port) {
+        throw std::runtime_error("未开启公共rtp端口(rtp_proxy.port)，无法使用单端口复用模式");
+    }
+    if (stream_id.empty()) {
+        throw std::runtime_error("单端口复用模式时必需指定流id");
+    }
+    _tcp_mode = tcp_mode;
+    if (tcp_mode == ACTIVE) {
+        //tcp主动模式时由本机连接设备，不占用监听端口；创建TcpServer对象也仅用于传参
+        _rtp_socket = Socket::createSocket(nullptr, true);
+        _tcp_server = std::make_shared<TcpServer>(_rtp_socket->getPoller());
+        (*_tcp_server)[RtpSession::kStreamID] = stream_id;
+        (*_tcp_server)[RtpSession::kSSRC] = ssrc;
+        (*_tcp_server)[RtpSession::kOnlyAudio] = only_audio;
+    } else if (!ssrc) {
+        throw std::runtime_error("单端口复用模式时必需指定ssrc");
+    } else if (!RtpSelector::Instance().bindSSRC(ssrc, stream_id, only_audio)) {
+        throw std::runtime_error(StrPrinter << "ssrc已被其他流绑定:" << ssrc);
+    }
+    _shared_port = shared_port;
+    _stream_id = stream_id;
+    _ssrc = ssrc;
+
+    //超时未收到rtp时，触发rtp server超时事件
+    GET_CONFIG(uint64_t, timeoutSec, RtpProxy::kTimeoutSec);
+    weak_ptr<RtpServer> weak_self = shared_from_this();
+    auto poller = _rtp_socket ? _rtp_socket->getPoller() : EventPollerPool::Instance().getPoller();
+    _delay_task = poller->doDelayTask(timeoutSec * 1000, [weak_self]() {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return 0;
+        }
+        auto process = RtpSelector::Instance().getProcess(strong_self->_stream_id, false);
+        if (process) {
+            if (strong_self->_on_detach) {
+                process->setOnDetach(std::move(strong_self->_on_detach));
+            }
+            return 0;
+        }
+        NoticeCenter::Instance().emitEvent(Broadcast::KBroadcastRtpServerTimeout, strong_self->_shared_port, strong_self->_stream_id,
+                                           (int)strong_self->_tcp_mode, true, strong_self->_ssrc);
+        if (strong_self->_on_detach) {
+            strong_self->_on_detach();
+        }
+        return 0;
+    });
+
+    _on_cleanup = [stream_id, ssrc, tcp_mode]() {
+        if (tcp_mode != ACTIVE) {
+            RtpSelector::Instance().unbindSSRC(ssrc, stream_id);
+        }
+        // 关闭该流的rtp处理器，否则公共端口上的推流在rtp server关闭后会残留直至超时
+        auto process = RtpSelector::Instance().getProcess(stream_id, false);
+        if (process && !process->close(MediaSource::NullMediaSource())) {
+            // 未被RtpSession接管时直接从RtpSelector删除
+            RtpSelector::Instance().delProcess(stream_id, process.get());
+        }
+    };
+}
+
 void RtpServer::setOnDetach(function<void()> cb) {
     if (_rtcp_helper) {
         _rtcp_helper->setOnDetach(std::move(cb));
+        return;
+    }
+    if (_shared_port) {
+        if (_tcp_mode != ACTIVE) {
+            //公共rtp端口收到该ssrc的rtp并创建rtp处理器时设置
+            RtpSelector::Instance().setSSRCOnDetach(_ssrc, _stream_id, cb);
+        }
+        _on_detach = std::move(cb);
     }
 }
 
 uint16_t RtpServer::getPort() {
+    if (_shared_port) {
+        return _shared_port;
+    }
     return _udp_server ? _udp_server->getPort() : _rtp_socket->get_local_port();
 }
 
@@ -271,7 +349,7 @@ void RtpServer::connectToServer(const std::string &url, uint16_t port, const fun
         }
         cb(err);
     },
-    5.0F, "::", _rtp_socket->get_local_port());
+    5.0F, "::", _shared_port ? 0 : _rtp_socket->get_local_port());
 }
 
 void RtpServer::onConnect() {
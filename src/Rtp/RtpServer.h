@@ -46,6 +46,15 @@ public:
     void start(uint16_t local_port, const std::string &stream_id = "", TcpMode tcp_mode = PASSIVE,
                const char *local_ip = "::", bool re_use_port = true, uint32_t ssrc = 0, bool only_audio = false);
 
+    /**
+     * 单端口复用模式，不创建独立的socket，在公共rtp端口(rtp_proxy.port)上根据ssrc区分流，可能抛异常
+     * tcp主动模式时从随机端口连接设备，其他模式时设备推流至公共rtp端口(udp或tcp)
+     * @param stream_id 流id
+     * @param tcp_mode tcp服务模式
+     * @param ssrc 指定的ssrc，tcp主动模式以外时必须指定
+     */
+    void startShared(const std::string &stream_id, TcpMode tcp_mode = PASSIVE, uint32_t ssrc = 0, bool only_audio = false);
+
     /**
      * 连接到tcp服务(tcp主动模式)
      * @param url 服务器地址
@@ -78,6 +87,12 @@ protected:
     bool _only_audio = false;
     //用于tcp主动模式
     TcpMode _tcp_mode = NONE;
+    //单端口复用模式时为公共rtp端口
+    uint16_t _shared_port = 0;
+    uint32_t _ssrc = 0;
+    std::string _stream_id;
+    std::function<void()> _on_detach;
+    toolkit::EventPoller::DelayTask::Ptr _delay_task;
 };
 
 }//namespace mediakit
@@ -15,6 +15,7 @@
 #include "Rtsp/Rtsp.h"
 #include "Rtsp/RtpReceiver.h"
 #include "Common/config.h"
+#include "Common/IngestProfiler.h"
 
 using namespace std;
 using namespace toolkit;
@@ -54,6 +55,7 @@ RtpSession::~RtpSession() {
 }
 
 void RtpSession::onRecv(const Buffer::Ptr &data) {
+    IngestProfiler::RecvScope profile("rtp");
     if (_is_udp) {
         onRtpPacket(data->data(), data->size());
         return;
@@ -107,8 +109,9 @@ void RtpSession::onRtpPacket(const char *data, size_t len) {
         if (!_ssrc && !RtpSelector::getSSRC(data, len, _ssrc)) {
             return;
         }
-        if (_stream_id.empty()) {
-            //未指定流id就使用ssrc为流id
+        function<void()> on_detach;
+        if (_stream_id.empty() && !RtpSelector::Instance().findSSRC(_ssrc, _stream_id, _only_audio, on_detach)) {
+            //未指定流id且ssrc未绑定流id(单端口复用模式)时，就使用ssrc为流id
             _stream_id = printSSRC(_ssrc);
         }
         try {
@@ -124,6 +127,9 @@ void RtpSession::onRtpPacket(const char *data, size_t len) {
             return;
         }
         _process->setOnlyAudio(_only_audio);
+        if (on_detach) {
+            _process->setOnDetach(std::move(on_detach));
+        }
         _process->setDelegate(dynamic_pointer_cast<RtpSession>(shared_from_this()));
     }
     try {
@@ -45,7 +45,6 @@ static uint32_t addressToInt(const string &ip){
 }
 
 std::shared_ptr<uint32_t> MultiCastAddressMaker::obtain(uint32_t max_try) {
-    lock_guard<recursive_mutex> lck(_mtx);
     GET_CONFIG_FUNC(uint32_t, addrMin, MultiCast::kAddrMin, [](const string &str) {
         return addressToInt(str);
     });
@@ -53,20 +52,26 @@ std::shared_ptr<uint32_t> MultiCastAddressMaker::obtain(uint32_t max_try) {
         return addressToInt(str);
     });
 
-    if (_addr > addrMax || _addr == 0) {
-        _addr = addrMin;
-    }
-    auto iGotAddr = _addr++;
-    if (_used_addr.find(iGotAddr) != _used_addr.end()) {
-        //已经分配过了
-        if (max_try) {
-            return obtain(--max_try);
+    uint32_t iGotAddr = 0;
+    {
+        lock_guard<mutex> lck(_mtx);
+        for (uint32_t i = 0; i <= max_try; ++i) {
+            if (_addr > addrMax || _addr == 0) {
+                _addr = addrMin;
+            }
+            auto addr = _addr++;
+            if (_used_addr.emplace(addr).second) {
+                iGotAddr = addr;
+                break;
+            }
+            //已经分配过了，尝试下一个
         }
+    }
+    if (!iGotAddr) {
         //分配完了,应该不可能到这里
-        ErrorL;
+        ErrorL << "multicast address exhausted";
         return nullptr;
     }
-    _used_addr.emplace(iGotAddr);
     std::shared_ptr<uint32_t> ret(new uint32_t(iGotAddr), [](uint32_t *ptr) {
         MultiCastAddressMaker::Instance().release(*ptr);
         delete ptr;
@@ -75,7 +80,7 @@ std::shared_ptr<uint32_t> MultiCastAddressMaker::obtain(uint32_t max_try) {
 }
 
 void MultiCastAddressMaker::release(uint32_t addr){
-    lock_guard<recursive_mutex> lck(_mtx);
+    lock_guard<mutex> lck(_mtx);
     _used_addr.erase(addr);
 }
 
@@ -96,6 +101,10 @@ void RtpMultiCaster::setDetachCB(void* listener, const onDetach& cb) {
 RtpMultiCaster::~RtpMultiCaster() {
     _rtp_reader->setReadCB(nullptr);
     _rtp_reader->setDetachCB(nullptr);
+    if (_sap_sock) {
+        //通知接收端该组播会话已结束
+        sendSap(true);
+    }
     DebugL;
 }
 
@@ -109,6 +118,10 @@ RtpMultiCaster::RtpMultiCaster(SocketHelper &helper, const string &local_ip, con
     if (!_multicast_ip) {
         throw std::runtime_error("获取组播地址失败");
     }
+    _local_ip = local_ip;
+    _vhost = vhost;
+    _app = app;
+    _stream = stream;
 
     for (auto i = 0; i < 2; ++i) {
         //创建udp socket, 数组下标为TrackType
@@ -135,14 +148,7 @@ RtpMultiCaster::RtpMultiCaster(SocketHelper &helper, const string &local_ip, con
 
     src->pause(false);
     _rtp_reader = src->getRing()->attach(helper.getPoller());
-    _rtp_reader->setReadCB([this](const RtspMediaSource::RingDataType &pkt) {
-        size_t i = 0;
-        auto size = pkt->size();
-        pkt->for_each([&](const RtpPacket::Ptr &rtp) {
-            auto &sock = _udp_sock[rtp->type];
-            sock->send(std::make_shared<BufferRtp>(rtp, 4), nullptr, 0, ++i == size);
-        });
-    });
+    _rtp_reader->setReadCB([this](const RtspMediaSource::RingDataType &pkt) { onRtp(pkt); });
 
     _rtp_reader->setDetachCB([this]() {
         unordered_map<void *, onDetach> _detach_map_copy;
@@ -155,12 +161,117 @@ RtpMultiCaster::RtpMultiCaster(SocketHelper &helper, const string &local_ip, con
         }
     });
 
+    makeSdp(src->getSdp(), local_ip);
+    startSap(helper, local_ip);
+
     DebugL << MultiCastAddressMaker::toString(*_multicast_ip) << " "
            << _udp_sock[0]->get_local_port() << " "
            << _udp_sock[1]->get_local_port() << " "
            << vhost << " " << app << " " << stream;
 }
 
+void RtpMultiCaster::onRtp(const RtspMediaSource::RingDataType &pkt) {
+    //下标为TrackType
+    size_t packets[2] = { 0, 0 };
+    size_t bytes[2] = { 0, 0 };
+    pkt->for_each([&](const RtpPacket::Ptr &rtp) {
+        auto &sock = _udp_sock[rtp->type];
+        //先缓存，每个track一批数据发送完毕后再一次性flush(sendmmsg)
+        sock->send(std::make_shared<BufferRtp>(rtp, RtpPacket::kRtpTcpHeaderSize), nullptr, 0, false);
+        ++packets[rtp->type];
+        bytes[rtp->type] += rtp->size() - RtpPacket::kRtpTcpHeaderSize;
+    });
+
+    for (auto i = 0; i < 2; ++i) {
+        if (!packets[i]) {
+            continue;
+        }
+        auto &stat = _statistic[i];
+        if (_udp_sock[i]->flushAll()) {
+            ++stat.send_failed;
+        }
+        //统计只在本线程修改，其他线程只读
+        stat.packets.store(stat.packets.load(memory_order_relaxed) + packets[i], memory_order_relaxed);
+        stat.bytes.store(stat.bytes.load(memory_order_relaxed) + bytes[i], memory_order_relaxed);
+        stat.speed += bytes[i];
+        stat.bytes_speed.store(stat.speed.getSpeed(), memory_order_relaxed);
+    }
+}
+
+void RtpMultiCaster::makeSdp(const string &src_sdp, const string &local_ip) {
+    GET_CONFIG(uint32_t, udpTTL, MultiCast::kUdpTTL);
+    SdpParser parser(src_sdp);
+    _StrPrinter printer;
+    printer << "v=0\r\n";
+    printer << "o=- " << *_multicast_ip << " 1 IN IP4 " << local_ip << "\r\n";
+    printer << "s=" << _app << "/" << _stream << "\r\n";
+    printer << "c=IN IP4 " << getMultiCasterIP() << "/" << udpTTL << "\r\n";
+    printer << "t=0 0\r\n";
+    for (auto type : { TrackVideo, TrackAudio }) {
+        auto track = parser.getTrack(type);
+        if (!track) {
+            continue;
+        }
+        //组播无需rtsp control属性
+        auto copy = *track;
+        copy._attr.erase("control");
+        printer << copy.toString(getMultiCasterPort(type));
+    }
+    _sdp = printer;
+}
+
+void RtpMultiCaster::startSap(SocketHelper &helper, const string &local_ip) {
+    GET_CONFIG(float, sapInterval, MultiCast::kSapInterval);
+    GET_CONFIG(string, sapAddr, MultiCast::kSapAddr);
+    GET_CONFIG(uint32_t, udpTTL, MultiCast::kUdpTTL);
+    if (sapInterval <= 0) {
+        return;
+    }
+    _sap_sock = helper.createSocket();
+    if (!_sap_sock->bindUdpSock(0, local_ip.data())) {
+        WarnL << "create sap socket failed:" << local_ip;
+        _sap_sock = nullptr;
+        return;
+    }
+    auto fd = _sap_sock->rawFD();
+    SockUtil::setMultiTTL(fd, udpTTL);
+    SockUtil::setMultiLOOP(fd, false);
+    SockUtil::setMultiIF(fd, local_ip.data());
+    //sap标准端口
+    auto peer = SockUtil::make_sockaddr(sapAddr.data(), 9875);
+    _sap_sock->bindPeerAddr((struct sockaddr *) &peer);
+
+    //sdp变化时消息id必须变化
+    _sap_msg_id = (uint16_t) std::hash<string>()(_sdp);
+    sendSap(false);
+    _sap_timer = std::make_shared<Timer>(sapInterval, [this]() {
+        sendSap(false);
+        return true;
+    }, helper.getPoller());
+}
+
+void RtpMultiCaster::sendSap(bool deletion) {
+    //rfc2974: V=1,A=0(ipv4),R=0,T(0:announcement, 1:deletion),E=0,C=0
+    string packet;
+    packet.reserve(8 + 16 + _sdp.size());
+    packet.push_back((char) (0x20 | (deletion ? 0x04 : 0)));
+    //auth len
+    packet.push_back(0);
+    packet.push_back((char) (_sap_msg_id >> 8));
+    packet.push_back((char) (_sap_msg_id & 0xFF));
+    //originating source
+    auto source = inet_addr(_local_ip.data());
+    packet.append((char *) &source, 4);
+    //payload type
+    packet.append("application/sdp", sizeof("application/sdp"));
+    packet.append(_sdp);
+    _sap_sock->send(std::move(packet));
+}
+
+const string &RtpMultiCaster::getSdp() const {
+    return _sdp;
+}
+
 uint16_t RtpMultiCaster::getMultiCasterPort(TrackType trackType) {
     return _udp_sock[trackType]->get_local_port();
 }
@@ -171,7 +282,41 @@ string RtpMultiCaster::getMultiCasterIP() {
     return SockUtil::inet_ntoa(addr);
 }
 
-RtpMultiCaster::Ptr RtpMultiCaster::get(SocketHelper &helper, const string &local_ip, const string &vhost, const string &app, const string &stream, uint32_t multicast_ip, uint16_t video_port, uint16_t audio_port) {
+vector<RtpMultiCaster::Statistic> RtpMultiCaster::getStatistic() {
+    vector<RtpMultiCaster::Ptr> casters;
+    {
+        lock_guard<recursive_mutex> lck(g_mtx);
+        for (auto &pr : g_multi_caster_map) {
+            if (auto caster = pr.second.lock()) {
+                casters.emplace_back(std::move(caster));
+            }
+        }
+    }
+    vector<Statistic> ret;
+    for (auto &caster : casters) {
+        Statistic stat;
+        stat.multicast_ip = caster->getMultiCasterIP();
+        stat.local_ip = caster->_local_ip;
+        stat.vhost = caster->_vhost;
+        stat.app = caster->_app;
+        stat.stream = caster->_stream;
+        for (auto i = 0; i < 2; ++i) {
+            auto &track = caster->_statistic[i];
+            stat.track[i].port = caster->_udp_sock[i]->get_local_port();
+            stat.track[i].packets = track.packets.load(memory_order_relaxed);
+            stat.track[i].bytes = track.bytes.load(memory_order_relaxed);
+            stat.track[i].send_failed = track.send_failed.load(memory_order_relaxed);
+            stat.track[i].bytes_speed = track.bytes_speed.load(memory_order_relaxed);
+        }
+        ret.emplace_back(std::move(stat));
+    }
+    return ret;
+}
+
+RtpMultiCaster::Ptr RtpMultiCaster::get(SocketHelper &helper, const string &local_ip_in, const string &vhost, const string &app, const string &stream, uint32_t multicast_ip, uint16_t video_port, uint16_t audio_port) {
+    //可以指定组播出口网卡，否则使用rtsp会话所在网卡
+    GET_CONFIG(string, multicastInterface, MultiCast::kInterface);
+    string local_ip = multicastInterface.empty() ? local_ip_in : multicastInterface;
     static auto on_create = [](SocketHelper &helper, const string &local_ip, const string &vhost, const string &app, const string &stream, uint32_t multicast_ip, uint16_t video_port, uint16_t audio_port){
         try {
             auto poller = helper.getPoller();
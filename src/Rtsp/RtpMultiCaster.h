@@ -12,11 +12,14 @@
 #define SRC_RTSP_RTPBROADCASTER_H_
 
 #include <mutex>
+#include <atomic>
 #include <memory>
 #include <unordered_set>
 #include <unordered_map>
 #include "RtspMediaSource.h"
 #include "Network/Socket.h"
+#include "Poller/Timer.h"
+#include "Util/SpeedStatistic.h"
 
 namespace mediakit{
 
@@ -35,7 +38,7 @@ private:
 
 private:
     uint32_t _addr = 0;
-    std::recursive_mutex _mtx;
+    std::mutex _mtx;
     std::unordered_set<uint32_t> _used_addr;
 };
 
@@ -44,6 +47,27 @@ public:
     using Ptr = std::shared_ptr<RtpMultiCaster>;
     using onDetach = std::function<void()>;
 
+    /**
+     * 组播组统计信息
+     */
+    struct Statistic {
+        std::string multicast_ip;
+        std::string local_ip;
+        std::string vhost;
+        std::string app;
+        std::string stream;
+        //下标为TrackType
+        struct {
+            uint16_t port = 0;
+            uint64_t packets = 0;
+            uint64_t bytes = 0;
+            //发送失败的批次数
+            uint64_t send_failed = 0;
+            //发送速率，单位bytes/s
+            int bytes_speed = 0;
+        } track[2];
+    };
+
     ~RtpMultiCaster();
 
     static Ptr get(toolkit::SocketHelper &helper, const std::string &local_ip, const std::string &vhost, const std::string &app, const std::string &stream, uint32_t multicast_ip = 0, uint16_t video_port = 0, uint16_t audio_port = 0);
@@ -52,15 +76,49 @@ public:
     std::string getMultiCasterIP();
     uint16_t getMultiCasterPort(TrackType trackType);
 
+    /**
+     * 获取组播sdp，接收端可以直接通过该sdp加入组播，无需rtsp DESCRIBE
+     */
+    const std::string &getSdp() const;
+
+    /**
+     * 获取所有组播组的统计信息，线程安全
+     */
+    static std::vector<Statistic> getStatistic();
+
 private:
     RtpMultiCaster(toolkit::SocketHelper &helper, const std::string &local_ip, const std::string &vhost, const std::string &app, const std::string &stream, uint32_t multicast_ip, uint16_t video_port, uint16_t audio_port);
 
+    void onRtp(const RtspMediaSource::RingDataType &pkt);
+    void makeSdp(const std::string &src_sdp, const std::string &local_ip);
+    void startSap(toolkit::SocketHelper &helper, const std::string &local_ip);
+    void sendSap(bool deletion);
+
 private:
+    struct TrackStatistic {
+        std::atomic<uint64_t> packets { 0 };
+        std::atomic<uint64_t> bytes { 0 };
+        std::atomic<uint64_t> send_failed { 0 };
+        std::atomic<int> bytes_speed { 0 };
+        //只在poller线程访问
+        toolkit::BytesSpeed speed;
+    };
+
     std::recursive_mutex _mtx;
+    std::string _local_ip;
+    std::string _vhost;
+    std::string _app;
+    std::string _stream;
+    std::string _sdp;
     toolkit::Socket::Ptr _udp_sock[2];
+    TrackStatistic _statistic[2];
     std::shared_ptr<uint32_t> _multicast_ip;
     std::unordered_map<void * , onDetach > _detach_map;
     RtspMediaSource::RingType::RingReader::Ptr _rtp_reader;
+    //sap广播
+    uint16_t _sap_msg_id = 0;
+    toolkit::Socket::Ptr _sap_sock;
+    toolkit::Timer::Ptr _sap_timer;
 };
 
 }//namespace mediakit
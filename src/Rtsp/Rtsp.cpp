@@ -470,6 +470,25 @@ Buffer::Ptr makeRtpOverTcpPrefix(uint16_t size, uint8_t interleaved) {
     return rtp_tcp;
 }
 
+void sendRtpOverTcp(SockSender &sender, const RtpPacket::Ptr &rtp, const vector<SdpTrack::Ptr> &tracks) {
+    //数据源生成的interleaved固定为2 * type
+    uint8_t interleaved = 2 * rtp->type;
+    for (auto &track : tracks) {
+        if (track->_type == rtp->type || tracks.size() == 1) {
+            interleaved = track->_interleaved;
+            break;
+        }
+    }
+    if ((uint8_t) rtp->data()[1] == interleaved) {
+        //绝大多数情况，直接发送共享的rtp包
+        sender.send(rtp);
+        return;
+    }
+    auto size = rtp->size() - RtpPacket::kRtpTcpHeaderSize;
+    sender.send(makeRtpOverTcpPrefix((uint16_t) size, interleaved));
+    sender.send(std::make_shared<BufferOffset<Buffer::Ptr> >(rtp, RtpPacket::kRtpTcpHeaderSize));
+}
+
 #define AV_RB16(x)                           \
     ((((const uint8_t*)(x))[0] << 8) |          \
       ((const uint8_t*)(x))[1])
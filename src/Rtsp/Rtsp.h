@@ -332,6 +332,16 @@ private:
 
 //创建rtp over tcp4个字节的头
 toolkit::Buffer::Ptr makeRtpOverTcpPrefix(uint16_t size, uint8_t interleaved);
+
+/**
+ * rtp over tcp方式发送rtp包
+ * rtp包在数据源处已经生成了4个字节的rtp over tcp头(所有tcp播放器共享)，interleaved与本会话一致时直接发送整个rtp包；
+ * 不一致时(例如推流时服务器指定了其他通道号)单独生成头部，rtp包跳过预留的头部发送
+ * @param sender 发送者
+ * @param rtp rtp包
+ * @param tracks 本会话的track，用于查找rtp包对应的interleaved
+ */
+void sendRtpOverTcp(toolkit::SockSender &sender, const RtpPacket::Ptr &rtp, const std::vector<SdpTrack::Ptr> &tracks);
 //创建rtp-rtcp端口对
 void makeSockPair(std::pair<toolkit::Socket::Ptr, toolkit::Socket::Ptr> &pair, const std::string &local_ip, bool re_use_port = false, bool is_udp = true);
 //十六进制方式打印ssrc
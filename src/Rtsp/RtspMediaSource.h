@@ -17,6 +17,7 @@
 #include <functional>
 #include "Common/MediaSource.h"
 #include "Common/PacketCache.h"
+#include "Common/IngestProfiler.h"
 #include "Util/RingBuffer.h"
 
 #define RTP_GOP_SIZE 512
@@ -136,6 +137,7 @@ private:
     void onFlush(std::shared_ptr<toolkit::List<RtpPacket::Ptr> > rtp_list, bool key_pos) override {
         //如果不存在视频，那么就没有存在GOP缓存的意义，所以is_key一直为true确保一直清空GOP缓存
         _ring->write(std::move(rtp_list), _have_video ? key_pos : true);
+        IngestProfiler::onRingWrite(IngestProfiler::kStageRtsp);
     }
 
 private:
@@ -13,6 +13,7 @@
 #include <algorithm>
 #include <iomanip>
 #include "Common/config.h"
+#include "Common/IngestProfiler.h"
 #include "RtspPlayer.h"
 #include "Util/MD5.h"
 #include "Util/base64.h"
@@ -118,6 +119,7 @@ void RtspPlayer::onConnect(const SockException &err){
 }
 
 void RtspPlayer::onRecv(const Buffer::Ptr& buf) {
+    IngestProfiler::RecvScope profile("rtsp");
     if(_benchmark_mode && !_play_check_timer){
         //在性能测试模式下，如果rtsp握手完毕后，不再解析rtp包
         _rtp_recv_ticker.resetTime();
@@ -359,6 +361,7 @@ void RtspPlayer::handleResSETUP(const Parser &parser, unsigned int track_idx) {
                 WarnL << "收到其他地址的rtp数据:" << SockUtil::inet_ntoa(addr);
                 return;
             }
+            IngestProfiler::RecvScope profile("rtsp");
             strongSelf->handleOneRtp(track_idx, strongSelf->_sdp_track[track_idx]->_type,
                                      strongSelf->_sdp_track[track_idx]->_samplerate, (uint8_t *) buf->data(), buf->size());
         });
@@ -393,7 +393,7 @@ void RtspPusher::sendRtpPacket(const RtspMediaSource::RingDataType &pkt) {
                 if (++i == size) {
                     setSendFlushFlag(true);
                 }
-                send(rtp);
+                sendRtpOverTcp(*this, rtp, _track_vec);
             });
             break;
         }
@@ -11,6 +11,7 @@
 #include <atomic>
 #include <iomanip>
 #include "Common/config.h"
+#include "Common/IngestProfiler.h"
 #include "UDPServer.h"
 #include "RtspSession.h"
 #include "Util/MD5.h"
@@ -120,6 +121,7 @@ void RtspSession::onManager() {
 }
 
 void RtspSession::onRecv(const Buffer::Ptr &buf) {
+    IngestProfiler::RecvScope profile("rtsp");
     _alive_ticker.resetTime();
     _bytes_usage += buf->size();
     if (_on_recv) {
@@ -955,6 +957,7 @@ void RtspSession::onRcvPeerUdpData(int interleaved, const Buffer::Ptr &buf, cons
     if (interleaved % 2 == 0) {
         if (_push_src) {
             //这是rtsp推流上来的rtp包
+            IngestProfiler::RecvScope profile("rtsp");
             auto &ref = _sdp_track[interleaved / 2];
             handleOneRtp(interleaved / 2, ref->_type, ref->_samplerate, (uint8_t *) buf->data(), buf->size());
         } else if (!_udp_connected_flags.count(interleaved)) {
@@ -1203,7 +1206,7 @@ void RtspSession::sendRtpPacket(const RtspMediaSource::RingDataType &pkt) {
             pkt->for_each([&](const RtpPacket::Ptr &rtp) {
                 if (_target_play_track == TrackInvalid || _target_play_track == rtp->type) {
                     updateRtcpContext(rtp);
-                    send(rtp);
+                    sendRtpOverTcp(*this, rtp, _sdp_track);
                 }
             });
             flushAll();
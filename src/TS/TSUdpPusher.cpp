@@ -0,0 +1,427 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <unordered_map>
+#include "TSUdpPusher.h"
+#include "Common/config.h"
+#include "Common/Parser.h"
+#include "Network/sockutil.h"
+#include "Util/util.h"
+
+using namespace std;
+using namespace toolkit;
+
+namespace mediakit {
+
+static constexpr size_t kTsPacketSize = 188;
+//每个udp包7个ts包，1316字节，不超过以太网mtu
+static constexpr size_t kTsPerDatagram = 7;
+static constexpr size_t kRtpHeaderSize = 12;
+//rfc3551规定mp2t的payload type为33
+static constexpr uint8_t kRtpPayloadMP2T = 33;
+//数据源时间戳映射到本地时间时预留的缓冲时长，用于吸收输入抖动
+static constexpr uint64_t kScheduleDelayUS = 200 * 1000;
+//时间戳跳变超过该值时重新映射
+static constexpr int64_t kMaxStampJumpUS = 2 * 1000 * 1000;
+//VBR模式下未凑满7个ts包的udp包最多等待时长
+static constexpr uint64_t kMaxDatagramWaitUS = 10 * 1000;
+//待发送的帧滞后超过该值时丢弃最旧的帧，防止CBR码率不足时队列无限增长
+static constexpr uint64_t kMaxQueueLagUS = 1000 * 1000;
+
+static mutex s_mtx;
+static unordered_map<void *, weak_ptr<TSUdpPusher> > s_pushers;
+
+TSUdpPusher::TSUdpPusher(const EventPoller::Ptr &poller, const TSMediaSource::Ptr &src) {
+    _poller = poller;
+    _publish_src = src;
+    if (src) {
+        _vhost = src->getVhost();
+        _app = src->getApp();
+        _stream = src->getId();
+    }
+    _rtp_ssrc = (uint32_t) (uintptr_t) this;
+}
+
+TSUdpPusher::~TSUdpPusher() {
+    {
+        lock_guard<mutex> lck(s_mtx);
+        s_pushers.erase(this);
+    }
+    if (_timer) {
+        _timer->cancel();
+    }
+    _ts_reader = nullptr;
+    DebugL << _url;
+}
+
+void TSUdpPusher::setNetif(const string &netif, uint16_t mss) {
+    _netif = netif;
+}
+
+void TSUdpPusher::publish(const string &url) {
+    weak_ptr<TSUdpPusher> weak_self = shared_from_this();
+    _poller->async([weak_self, url]() {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->publish_l(url);
+        }
+    });
+}
+
+void TSUdpPusher::publish_l(const string &url) {
+    auto src = _publish_src.lock();
+    if (!src) {
+        onPublishResult(SockException(Err_other, "the media source was released"));
+        return;
+    }
+
+    _url = url;
+    auto schema = FindField(url.data(), NULL, "://");
+    _is_rtp = strcasecmp(schema.data(), "rtp") == 0;
+    string host;
+    uint16_t port = 0;
+    auto host_port = url.substr(schema.size() + 3);
+    auto pos = host_port.find_first_of("/?");
+    if (pos != string::npos) {
+        host_port.resize(pos);
+    }
+    try {
+        splitUrl(host_port, host, port);
+    } catch (std::exception &ex) {
+        WarnL << ex.what();
+    }
+    if (host.empty() || !port) {
+        onPublishResult(SockException(Err_other, "invalid ts udp url:" + url));
+        return;
+    }
+
+    auto local_ip = _netif.empty() ? string(SockUtil::is_ipv6(host.data()) ? "::" : "0.0.0.0") : _netif;
+    _socket = Socket::createSocket(_poller, false);
+    if (!_socket->bindUdpSock(0, local_ip)) {
+        onPublishResult(SockException(Err_other, "bind udp socket failed:" + local_ip));
+        return;
+    }
+    auto fd = _socket->rawFD();
+    GET_CONFIG(uint32_t, udpTTL, MultiCast::kUdpTTL);
+    SockUtil::setMultiTTL(fd, udpTTL);
+    SockUtil::setMultiLOOP(fd, false);
+    if (!_netif.empty()) {
+        SockUtil::setMultiIF(fd, _netif.data());
+    }
+    auto peer = SockUtil::make_sockaddr(host.data(), port);
+    _socket->bindPeerAddr((struct sockaddr *) &peer);
+
+    _bitrate = (*this)[Client::kTsBitrate].as<uint64_t>();
+
+    src->pause(false);
+    //广播场景从当前位置开始输出，不发送gop缓存，否则gop缓存的时长会一直累积为延时
+    _ts_reader = src->getRing()->attach(_poller, false);
+    weak_ptr<TSUdpPusher> weak_self = shared_from_this();
+    _ts_reader->setReadCB([weak_self](const TSMediaSource::RingDataType &pkt) {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->onTS(pkt);
+        }
+    });
+    _ts_reader->setDetachCB([weak_self]() {
+        if (auto strong_self = weak_self.lock()) {
+            strong_self->onShutdown(SockException(Err_shutdown, "媒体源被释放"));
+        }
+    });
+
+    //1毫秒定时器，依赖poller的时间轮
+    _timer = _poller->doDelayTask(1, [weak_self]() -> uint64_t {
+        auto strong_self = weak_self.lock();
+        if (!strong_self) {
+            return 0;
+        }
+        strong_self->onTick();
+        return 1;
+    });
+
+    {
+        lock_guard<mutex> lck(s_mtx);
+        s_pushers[this] = weak_self;
+    }
+    InfoL << "start ts udp push:" << url << ", bitrate:" << _bitrate;
+    onPublishResult(SockException(Err_success, "success"));
+}
+
+void TSUdpPusher::teardown() {
+    if (_timer) {
+        _timer->cancel();
+        _timer = nullptr;
+    }
+    _ts_reader = nullptr;
+    _socket = nullptr;
+    _segments.clear();
+    _last_frame = nullptr;
+    _last_duration_us = 0;
+}
+
+void TSUdpPusher::onTS(const TSMediaSource::RingDataType &pkt) {
+    pkt->for_each([&](const TSPacket::Ptr &ts) {
+        //帧的发送时长由下一帧的时间戳决定，所以总是缓存一帧
+        if (_last_frame) {
+            scheduleFrame(std::move(_last_frame), ts->time_stamp);
+        }
+        _last_frame = ts;
+    });
+}
+
+void TSUdpPusher::scheduleFrame(TSPacket::Ptr frame, uint64_t next_stamp) {
+    auto count = frame->size() / kTsPacketSize;
+    if (!count) {
+        return;
+    }
+    auto now = getCurrentMicrosecond();
+    auto start = (int64_t) _wall_anchor + ((int64_t) frame->time_stamp - (int64_t) _stamp_anchor) * 1000;
+    if (!_anchored || start < (int64_t) now - kMaxStampJumpUS || start > (int64_t) (now + kScheduleDelayUS) + kMaxStampJumpUS) {
+        //首帧或时间戳跳变，重新建立时间戳与本地时间的映射
+        _anchored = true;
+        _stamp_anchor = frame->time_stamp;
+        _wall_anchor = now + kScheduleDelayUS;
+        start = _wall_anchor;
+    }
+    //该帧的ts包在本帧与下一帧的时间戳之间均匀发送
+    uint64_t duration = 0;
+    if (next_stamp > frame->time_stamp && next_stamp - frame->time_stamp < 1000) {
+        duration = (next_stamp - frame->time_stamp) * 1000;
+        _last_duration_us = duration;
+    } else {
+        //与下一帧时间戳相同(例如同一时间戳的音视频帧)或时间戳跳变，按上一帧的间隔发送，避免突发
+        duration = _last_duration_us;
+    }
+    _segments.emplace_back(Segment { std::move(frame), 0, count, (uint64_t) start, (double) duration / count });
+
+    //码率不足时发送跟不上输入，丢弃滞后最久的帧
+    size_t dropped = 0;
+    while (_segments.size() > 1 && _segments.front().nextTime() + kMaxQueueLagUS < now) {
+        auto &front = _segments.front();
+        dropped += front.count - front.index;
+        _segments.pop_front();
+    }
+    if (dropped) {
+        _stat_dropped_packets.fetch_add(dropped, memory_order_relaxed);
+        _drop_warn_packets += dropped;
+        if (now - _drop_warn_us >= 1000 * 1000) {
+            WarnL << "ts udp pusher lags more than " << kMaxQueueLagUS / 1000 << "ms, drop " << _drop_warn_packets
+                  << " ts packets, bitrate may be too low:" << _bitrate << ", url:" << _url;
+            _drop_warn_us = now;
+            _drop_warn_packets = 0;
+        }
+    }
+}
+
+bool TSUdpPusher::frontDue(uint64_t time_us) const {
+    return !_segments.empty() && _segments.front().nextTime() <= time_us;
+}
+
+void TSUdpPusher::onTick() {
+    if (!_socket) {
+        return;
+    }
+    auto now = getCurrentMicrosecond();
+    auto datagrams = _stat_datagrams.load(memory_order_relaxed);
+    if (_bitrate) {
+        sendCBR(now);
+    } else {
+        sendVBR(now);
+    }
+    if (datagrams != _stat_datagrams.load(memory_order_relaxed)) {
+        //本轮所有udp包一次性flush(sendmmsg)
+        if (_socket->flushAll()) {
+            ++_stat_send_failed;
+        }
+    }
+
+    int64_t queue_ms = 0;
+    if (!_segments.empty()) {
+        auto &back = _segments.back();
+        queue_ms = ((int64_t) (back.start_us + (uint64_t) (back.count * back.step_us)) - (int64_t) now) / 1000;
+    }
+    _stat_queue_ms.store(queue_ms, memory_order_relaxed);
+}
+
+void TSUdpPusher::sendCBR(uint64_t now) {
+    if (!_cbr_start) {
+        if (_segments.empty()) {
+            //等待首个数据包
+            return;
+        }
+        _cbr_start = now;
+        _slots = 0;
+    }
+    //每个ts包占用的发送时长
+    auto slot_us = kTsPacketSize * 8 * 1000000.0 / _bitrate;
+    auto due = (uint64_t) ((now - _cbr_start) / slot_us);
+    if (due > _slots + (uint64_t) (1000000 / slot_us)) {
+        //poller卡顿超过1秒，放弃补发空包
+        WarnL << "ts udp pusher stalled, skip " << due - _slots << " slots:" << _url;
+        _slots = due;
+    }
+    while (_slots + kTsPerDatagram <= due) {
+        for (size_t i = 0; i < kTsPerDatagram; ++i, ++_slots) {
+            auto slot_time = _cbr_start + (uint64_t) (_slots * slot_us);
+            if (frontDue(slot_time)) {
+                appendPacket(slot_time);
+            } else {
+                //CBR填充空包
+                appendNullPacket();
+            }
+        }
+        flushDatagram(_cbr_start + (uint64_t) (_slots * slot_us));
+    }
+    if (frontDue(now > 100 * 1000 ? now - 100 * 1000 : 0)) {
+        //码率设置过低，数据包滞后超过100ms
+        _stat_late_packets.fetch_add(1, memory_order_relaxed);
+    }
+}
+
+void TSUdpPusher::sendVBR(uint64_t now) {
+    while (frontDue(now)) {
+        appendPacket(now);
+        if (_datagram_packets == kTsPerDatagram) {
+            flushDatagram(now);
+        }
+    }
+    if (_datagram_packets && now - _datagram_since > kMaxDatagramWaitUS) {
+        flushDatagram(now);
+    }
+}
+
+static inline BufferRaw::Ptr makeDatagram(bool is_rtp) {
+    auto ret = BufferRaw::create();
+    ret->setCapacity((is_rtp ? kRtpHeaderSize : 0) + kTsPacketSize * kTsPerDatagram);
+    ret->setSize(is_rtp ? kRtpHeaderSize : 0);
+    return ret;
+}
+
+void TSUdpPusher::appendPacket(uint64_t emit_us) {
+    auto &seg = _segments.front();
+    auto ts = (uint8_t *) seg.packet->data() + seg.index * kTsPacketSize;
+    checkPcr(ts, emit_us);
+    if (!_datagram) {
+        _datagram = makeDatagram(_is_rtp);
+        _datagram_since = emit_us;
+    }
+    memcpy(_datagram->data() + _datagram->size(), ts, kTsPacketSize);
+    _datagram->setSize(_datagram->size() + kTsPacketSize);
+    ++_datagram_packets;
+    _stat_ts_packets.fetch_add(1, memory_order_relaxed);
+    if (++seg.index == seg.count) {
+        _segments.pop_front();
+    }
+}
+
+void TSUdpPusher::appendNullPacket() {
+    if (!_datagram) {
+        _datagram = makeDatagram(_is_rtp);
+    }
+    auto ptr = (uint8_t *) _datagram->data() + _datagram->size();
+    //PID 0x1FFF，仅含负载，负载全部为0xFF
+    ptr[0] = 0x47;
+    ptr[1] = 0x1F;
+    ptr[2] = 0xFF;
+    ptr[3] = 0x10;
+    memset(ptr + 4, 0xFF, kTsPacketSize - 4);
+    _datagram->setSize(_datagram->size() + kTsPacketSize);
+    ++_datagram_packets;
+    _stat_null_packets.fetch_add(1, memory_order_relaxed);
+}
+
+void TSUdpPusher::flushDatagram(uint64_t emit_us) {
+    if (!_datagram_packets) {
+        return;
+    }
+    if (_is_rtp) {
+        auto ptr = (uint8_t *) _datagram->data();
+        //rtp时间戳为90KHz的发送时间
+        auto stamp = (uint32_t) (emit_us * 9 / 100);
+        ptr[0] = 0x80;
+        ptr[1] = kRtpPayloadMP2T;
+        ptr[2] = _rtp_seq >> 8;
+        ptr[3] = _rtp_seq & 0xFF;
+        ++_rtp_seq;
+        ptr[4] = stamp >> 24;
+        ptr[5] = (stamp >> 16) & 0xFF;
+        ptr[6] = (stamp >> 8) & 0xFF;
+        ptr[7] = stamp & 0xFF;
+        ptr[8] = _rtp_ssrc >> 24;
+        ptr[9] = (_rtp_ssrc >> 16) & 0xFF;
+        ptr[10] = (_rtp_ssrc >> 8) & 0xFF;
+        ptr[11] = _rtp_ssrc & 0xFF;
+    }
+    _stat_bytes.fetch_add(_datagram->size(), memory_order_relaxed);
+    _stat_datagrams.fetch_add(1, memory_order_relaxed);
+    _socket->send(std::move(_datagram), nullptr, 0, false);
+    _datagram = nullptr;
+    _datagram_packets = 0;
+}
+
+void TSUdpPusher::checkPcr(const uint8_t *ts, uint64_t emit_us) {
+    //adaptation_field_control包含adaptation，且PCR_flag置位
+    if (!(ts[3] & 0x20) || ts[4] < 7 || !(ts[5] & 0x10)) {
+        return;
+    }
+    uint64_t base = ((uint64_t) ts[6] << 25) | ((uint64_t) ts[7] << 17) | ((uint64_t) ts[8] << 9) | ((uint64_t) ts[9] << 1) | (ts[10] >> 7);
+    uint64_t ext = ((uint64_t) (ts[10] & 0x01) << 8) | ts[11];
+    //27MHz转微秒
+    auto pcr_us = (base * 300 + ext) / 27;
+
+    auto jitter = ((int64_t) emit_us - (int64_t) _pcr_emit_anchor_us) - ((int64_t) pcr_us - (int64_t) _pcr_anchor_us);
+    if (!_pcr_anchored || jitter > kMaxStampJumpUS || jitter < -kMaxStampJumpUS) {
+        //首个PCR，或者PCR回环、不连续
+        _pcr_anchored = true;
+        _pcr_anchor_us = pcr_us;
+        _pcr_emit_anchor_us = emit_us;
+        jitter = 0;
+    }
+    _stat_pcr_jitter.store(jitter, memory_order_relaxed);
+    _jitter_window_max = std::max(_jitter_window_max, jitter > 0 ? jitter : -jitter);
+    if (emit_us - _jitter_window_start >= 1000 * 1000) {
+        _stat_pcr_jitter_max.store(_jitter_window_max, memory_order_relaxed);
+        _jitter_window_max = 0;
+        _jitter_window_start = emit_us;
+    }
+}
+
+vector<TSUdpPusher::Statistic> TSUdpPusher::getStatistic() {
+    vector<TSUdpPusher::Ptr> pushers;
+    {
+        lock_guard<mutex> lck(s_mtx);
+        for (auto &pr : s_pushers) {
+            if (auto pusher = pr.second.lock()) {
+                pushers.emplace_back(std::move(pusher));
+            }
+        }
+    }
+    vector<Statistic> ret;
+    for (auto &pusher : pushers) {
+        Statistic stat;
+        stat.url = pusher->_url;
+        stat.vhost = pusher->_vhost;
+        stat.app = pusher->_app;
+        stat.stream = pusher->_stream;
+        stat.bitrate = pusher->_bitrate;
+        stat.datagrams = pusher->_stat_datagrams.load(memory_order_relaxed);
+        stat.bytes = pusher->_stat_bytes.load(memory_order_relaxed);
+        stat.ts_packets = pusher->_stat_ts_packets.load(memory_order_relaxed);
+        stat.null_packets = pusher->_stat_null_packets.load(memory_order_relaxed);
+        stat.send_failed = pusher->_stat_send_failed.load(memory_order_relaxed);
+        stat.late_packets = pusher->_stat_late_packets.load(memory_order_relaxed);
+        stat.dropped_packets = pusher->_stat_dropped_packets.load(memory_order_relaxed);
+        stat.pcr_jitter_us = pusher->_stat_pcr_jitter.load(memory_order_relaxed);
+        stat.pcr_jitter_max_us = pusher->_stat_pcr_jitter_max.load(memory_order_relaxed);
+        stat.queue_ms = pusher->_stat_queue_ms.load(memory_order_relaxed);
+        ret.emplace_back(std::move(stat));
+    }
+    return ret;
+}
+
+} // namespace mediakit
@@ -0,0 +1,151 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#ifndef ZLMEDIAKIT_TSUDPPUSHER_H
+#define ZLMEDIAKIT_TSUDPPUSHER_H
+
+#include <deque>
+#include <atomic>
+#include "TSMediaSource.h"
+#include "Pusher/PusherBase.h"
+#include "Network/Socket.h"
+
+namespace mediakit {
+
+/**
+ * mpeg-ts over udp/rtp推流(单节目流SPTS)，用于对接广播前端与IRD
+ * 支持的url: udp://239.1.1.1:1234 (裸ts) 或 rtp://239.1.1.1:1234 (rfc2250, pt=33)
+ * 每个udp包固定为7个188字节的ts包，按帧时间戳在poller定时器中平滑发送
+ * 设置Client::kTsBitrate后以恒定码率(CBR)发送，空闲时隙填充空包(PID 0x1FFF)
+ */
+class TSUdpPusher : public PusherBase, public std::enable_shared_from_this<TSUdpPusher> {
+public:
+    using Ptr = std::shared_ptr<TSUdpPusher>;
+
+    struct Statistic {
+        std::string url;
+        std::string vhost;
+        std::string app;
+        std::string stream;
+        //CBR码率，0为VBR
+        uint64_t bitrate = 0;
+        uint64_t datagrams = 0;
+        uint64_t bytes = 0;
+        uint64_t ts_packets = 0;
+        uint64_t null_packets = 0;
+        //flush失败次数
+        uint64_t send_failed = 0;
+        //CBR码率不足导致发送滞后的ts包个数
+        uint64_t late_packets = 0;
+        //发送滞后超过上限而丢弃的ts包个数
+        uint64_t dropped_packets = 0;
+        //最近一个PCR的发送时间与其理想时间的偏差，单位微秒
+        int64_t pcr_jitter_us = 0;
+        //上一个统计周期(1秒)内PCR偏差绝对值的最大值，单位微秒
+        int64_t pcr_jitter_max_us = 0;
+        //待发送数据的时长，单位毫秒
+        int64_t queue_ms = 0;
+    };
+
+    TSUdpPusher(const toolkit::EventPoller::Ptr &poller, const TSMediaSource::Ptr &src);
+    ~TSUdpPusher() override;
+
+    void publish(const std::string &url) override;
+    void teardown() override;
+    void setNetif(const std::string &netif, uint16_t mss) override;
+
+    /**
+     * 获取所有ts udp推流的统计信息，线程安全
+     */
+    static std::vector<Statistic> getStatistic();
+
+private:
+    struct Segment {
+        TSPacket::Ptr packet;
+        size_t index;
+        size_t count;
+        uint64_t start_us;
+        double step_us;
+
+        uint64_t nextTime() const { return start_us + (uint64_t) (index * step_us); }
+    };
+
+    void publish_l(const std::string &url);
+    void onTS(const TSMediaSource::RingDataType &pkt);
+    void scheduleFrame(TSPacket::Ptr frame, uint64_t next_stamp);
+    void onTick();
+    void sendCBR(uint64_t now);
+    void sendVBR(uint64_t now);
+    bool frontDue(uint64_t time_us) const;
+    void appendPacket(uint64_t emit_us);
+    void appendNullPacket();
+    void flushDatagram(uint64_t emit_us);
+    void checkPcr(const uint8_t *ts, uint64_t emit_us);
+
+private:
+    std::string _url;
+    std::string _netif;
+    std::string _vhost;
+    std::string _app;
+    std::string _stream;
+    bool _is_rtp = false;
+    uint64_t _bitrate = 0;
+    toolkit::EventPoller::Ptr _poller;
+    std::weak_ptr<TSMediaSource> _publish_src;
+    toolkit::Socket::Ptr _socket;
+    TSMediaSource::RingType::RingReader::Ptr _ts_reader;
+    toolkit::EventPoller::DelayTask::Ptr _timer;
+
+    //帧时间戳与本地时间的映射
+    bool _anchored = false;
+    uint64_t _stamp_anchor = 0;
+    uint64_t _wall_anchor = 0;
+    TSPacket::Ptr _last_frame;
+    //上一帧的发送时长，用于与下一帧时间戳相同的帧
+    uint64_t _last_duration_us = 0;
+    std::deque<Segment> _segments;
+    //上次打印丢包警告的时间
+    uint64_t _drop_warn_us = 0;
+    uint64_t _drop_warn_packets = 0;
+
+    //CBR发送起点与已发送的时隙
+    uint64_t _cbr_start = 0;
+    uint64_t _slots = 0;
+
+    //正在组装的udp包
+    toolkit::BufferRaw::Ptr _datagram;
+    size_t _datagram_packets = 0;
+    uint64_t _datagram_since = 0;
+    uint16_t _rtp_seq = 0;
+    uint32_t _rtp_ssrc = 0;
+
+    //PCR偏差统计
+    bool _pcr_anchored = false;
+    uint64_t _pcr_anchor_us = 0;
+    uint64_t _pcr_emit_anchor_us = 0;
+    int64_t _jitter_window_max = 0;
+    uint64_t _jitter_window_start = 0;
+
+    std::atomic<uint64_t> _stat_datagrams { 0 };
+    std::atomic<uint64_t> _stat_bytes { 0 };
+    std::atomic<uint64_t> _stat_ts_packets { 0 };
+    std::atomic<uint64_t> _stat_null_packets { 0 };
+    std::atomic<uint64_t> _stat_send_failed { 0 };
+    std::atomic<uint64_t> _stat_late_packets { 0 };
+    std::atomic<uint64_t> _stat_dropped_packets { 0 };
+    std::atomic<int64_t> _stat_pcr_jitter { 0 };
+    std::atomic<int64_t> _stat_pcr_jitter_max { 0 };
+    std::atomic<int64_t> _stat_queue_ms { 0 };
+};
+
+using TSUdpPusherImp = PusherImp<TSUdpPusher, PusherBase>;
+
+} // namespace mediakit
+#endif // ZLMEDIAKIT_TSUDPPUSHER_H
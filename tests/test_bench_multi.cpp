@@ -0,0 +1,495 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <signal.h>
+#include <cstring>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include "Util/CMD.h"
+#include "Util/util.h"
+#include "Util/logger.h"
+#include "Common/config.h"
+#include "Rtsp/Rtsp.h"
+#include "Player/MediaPlayer.h"
+#if !defined(_WIN32)
+#include <unistd.h>
+#include <sys/wait.h>
+#endif
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+        (*_parser) << Option('l', "level", Option::ArgRequired, to_string(LError).data(), false, "日志等级,LTrace~LError(0~4)", nullptr);
+        (*_parser) << Option('t', "threads", Option::ArgRequired, to_string(thread::hardware_concurrency()).data(), false, "每个进程的事件触发线程数", nullptr);
+        (*_parser) << Option('i', "in", Option::ArgRequired, nullptr, true, "拉流url列表,逗号分隔,播放器轮流使用;支持rtsp/rtmp/hls(.m3u8)/http-ts(.ts)", nullptr);
+        (*_parser) << Option('c', "count", Option::ArgRequired, "1000", false, "播放器总个数", nullptr);
+        (*_parser) << Option('p', "process", Option::ArgRequired, "1", false, "进程个数,播放器平均分配到各进程", nullptr);
+        (*_parser) << Option('r', "rate", Option::ArgRequired, "100", false, "每秒新增播放器个数(所有进程合计)", nullptr);
+        (*_parser) << Option('s', "second", Option::ArgRequired, "60", false, "测试时长(含爬坡时间),单位秒", nullptr);
+        (*_parser) << Option('T', "rtp", Option::ArgRequired, "0", false, "rtsp拉流方式列表,逗号分隔,rtsp播放器轮流使用,支持tcp/udp/multicast:0/1/2", nullptr);
+        (*_parser) << Option('S', "stall", Option::ArgRequired, "1000", false, "两帧间隔超过该值(毫秒)时记为一次卡顿", nullptr);
+        (*_parser) << Option('P', "pid", Option::ArgRequired, "0", false, "服务器进程pid,用于采样服务器cpu与内存(仅linux)", nullptr);
+        (*_parser) << Option('o', "out", Option::ArgRequired, "", false, "json结果输出文件,默认输出至标准输出", nullptr);
+        (*_parser) << Option('d', "detail", Option::ArgRequired, "0", false, "是否在结果中输出每个播放器的统计", nullptr);
+    }
+
+    ~CMD_main() override {}
+
+    const char *description() const override {
+        return "主程序命令参数";
+    }
+};
+
+//不依赖ZLToolKit的时间戳线程，fork后的子进程同样可用
+static uint64_t nowMS() {
+    return chrono::duration_cast<chrono::milliseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+//单个播放器的统计结果
+struct ClientRecord {
+    string protocol;
+    bool success = false;
+    //从发起播放到收到第一帧的耗时，单位毫秒
+    int64_t startup_ms = -1;
+    uint64_t bytes = 0;
+    uint64_t frames = 0;
+    uint64_t stalls = 0;
+    //收到第一帧后的时长，单位毫秒
+    uint64_t play_ms = 0;
+
+    string serialize() const {
+        return StrPrinter << protocol << " " << success << " " << startup_ms << " " << bytes << " " << frames << " " << stalls << " " << play_ms;
+    }
+
+    bool parse(const string &line) {
+        istringstream ss(line);
+        return (bool) (ss >> protocol >> success >> startup_ms >> bytes >> frames >> stalls >> play_ms);
+    }
+};
+
+class BenchClient {
+public:
+    using Ptr = std::shared_ptr<BenchClient>;
+
+    BenchClient(const EventPoller::Ptr &poller, string protocol, uint64_t stall_ms) {
+        _poller = poller;
+        _protocol = std::move(protocol);
+        _stall_ms = stall_ms;
+        _player = std::make_shared<MediaPlayer>(poller);
+    }
+
+    MediaPlayer &player() { return *_player; }
+
+    void play(const string &url) {
+        _start_ms = nowMS();
+        auto weak_player = weak_ptr<MediaPlayer>(_player);
+        //播放器回调只引用统计数据，不引用本对象
+        auto stat = _stat;
+        auto start_ms = _start_ms;
+        auto stall_ms = _stall_ms;
+        _player->setOnPlayResult([weak_player, stat, start_ms, stall_ms](const SockException &ex) {
+            auto strong_player = weak_player.lock();
+            if (ex || !strong_player) {
+                return;
+            }
+            stat->success = true;
+            auto tracks = strong_player->getTracks(false);
+            //音视频帧交替到达会掩盖视频卡顿，所以只统计视频的帧间隔；纯音频时统计音频
+            auto stall_track = tracks.empty() ? nullptr : tracks.front();
+            for (auto &track : tracks) {
+                if (track->getTrackType() == TrackVideo) {
+                    stall_track = track;
+                }
+            }
+            for (auto &track : tracks) {
+                bool check_stall = track == stall_track;
+                track->addDelegate([stat, start_ms, stall_ms, check_stall](const Frame::Ptr &frame) {
+                    if (check_stall) {
+                        auto now = nowMS();
+                        auto last = stat->last_frame_ms.exchange(now);
+                        if (!last) {
+                            stat->first_frame_ms = now;
+                            stat->startup_ms = (int64_t) (now - start_ms);
+                        } else if (now - last > stall_ms) {
+                            ++stat->stalls;
+                        }
+                    }
+                    stat->bytes += frame->size();
+                    ++stat->frames;
+                    return true;
+                });
+            }
+        });
+        _player->play(url);
+    }
+
+    ClientRecord getRecord() const {
+        ClientRecord ret;
+        auto now = nowMS();
+        ret.protocol = _protocol;
+        ret.success = _stat->success;
+        ret.startup_ms = _stat->startup_ms;
+        ret.bytes = _stat->bytes;
+        ret.frames = _stat->frames;
+        ret.stalls = _stat->stalls;
+        auto first = _stat->first_frame_ms.load();
+        auto last = _stat->last_frame_ms.load();
+        if (first) {
+            ret.play_ms = now - first;
+            if (now - last > _stall_ms) {
+                //测试结束时仍处于卡顿状态
+                ++ret.stalls;
+            }
+        }
+        return ret;
+    }
+
+    const EventPoller::Ptr &getPoller() const { return _poller; }
+
+    void releasePlayer() { _player = nullptr; }
+
+private:
+    struct Statistic {
+        std::atomic<bool> success { false };
+        std::atomic<int64_t> startup_ms { -1 };
+        std::atomic<uint64_t> first_frame_ms { 0 };
+        std::atomic<uint64_t> last_frame_ms { 0 };
+        std::atomic<uint64_t> bytes { 0 };
+        std::atomic<uint64_t> frames { 0 };
+        std::atomic<uint64_t> stalls { 0 };
+    };
+
+    uint64_t _start_ms = 0;
+    uint64_t _stall_ms;
+    string _protocol;
+    EventPoller::Ptr _poller;
+    MediaPlayer::Ptr _player;
+    std::shared_ptr<Statistic> _stat = std::make_shared<Statistic>();
+};
+
+static string getProtocol(const string &url, int rtp_type) {
+    auto schema = url.substr(0, url.find("://"));
+    if (schema == "rtsp" || schema == "rtsps") {
+        static const char *types[] = { "tcp", "udp", "multicast" };
+        return schema + "_" + types[rtp_type % 3];
+    }
+    auto path = url.substr(0, url.find('?'));
+    if (end_with(path, ".m3u8")) {
+        return "hls";
+    }
+    if (end_with(path, ".ts")) {
+        return "http_ts";
+    }
+    return schema;
+}
+
+/**
+ * 在本进程中按速率创建播放器，测试时长到达后返回所有播放器的统计
+ * @param begin_ms 所有进程共同的开始时间
+ * @param index 本进程序号，用于在各进程间错开爬坡
+ */
+static vector<ClientRecord> runClients(CMD_main &cmd, int count, double rate, uint64_t begin_ms, int index, int process) {
+    auto urls = split(cmd["in"], ",");
+    auto rtp_types = split(cmd["rtp"], ",");
+    auto stall_ms = cmd["stall"].as<uint64_t>();
+    auto duration_ms = cmd["second"].as<uint64_t>() * 1000;
+
+    vector<BenchClient::Ptr> clients;
+    size_t rtsp_index = 0;
+    auto add_client = [&](int i) {
+        auto &url = urls[i % urls.size()];
+        int rtp_type = 0;
+        if (start_with(url, "rtsp")) {
+            rtp_type = atoi(rtp_types[rtsp_index++ % rtp_types.size()].data());
+        }
+        auto poller = EventPollerPool::Instance().getPoller();
+        auto client = std::make_shared<BenchClient>(poller, getProtocol(url, rtp_type), stall_ms);
+        client->player()[Client::kRtpType] = rtp_type;
+        clients.emplace_back(client);
+        poller->async([client, url]() { client->play(url); });
+    };
+
+    //所有进程合计每秒新增rate个播放器，第n个播放器由第n % process个进程创建
+    int added = 0;
+    while (true) {
+        auto elapsed = nowMS() - begin_ms;
+        if (elapsed >= duration_ms) {
+            break;
+        }
+        while (added < count && (added * process + index) < elapsed * rate / 1000) {
+            add_client(added * process + index);
+            ++added;
+        }
+        this_thread::sleep_for(chrono::milliseconds(10));
+    }
+
+    vector<ClientRecord> ret;
+    for (auto &client : clients) {
+        ret.emplace_back(client->getRecord());
+        //在播放器所在线程释放，确保在play之后执行
+        client->getPoller()->async([client]() { client->releasePlayer(); });
+    }
+    //等待播放器释放
+    this_thread::sleep_for(chrono::milliseconds(500));
+    return ret;
+}
+
+struct ServerSample {
+    uint64_t second;
+    double cpu;
+    uint64_t rss_kb;
+};
+
+//采样服务器进程cpu时间(单位秒)与常驻内存(单位KB)
+static bool sampleServer(int pid, double &cpu_sec, uint64_t &rss_kb) {
+#if defined(__linux__)
+    ifstream stat_file(StrPrinter << "/proc/" << pid << "/stat");
+    string stat;
+    if (!getline(stat_file, stat)) {
+        return false;
+    }
+    //进程名中可能含空格，从')'之后开始解析，utime/stime为第14/15个字段
+    istringstream ss(stat.substr(stat.rfind(')') + 2));
+    string field;
+    uint64_t utime = 0, stime = 0;
+    for (int i = 3; i <= 15 && ss >> field; ++i) {
+        if (i == 14) {
+            utime = stoull(field);
+        } else if (i == 15) {
+            stime = stoull(field);
+        }
+    }
+    cpu_sec = (double) (utime + stime) / sysconf(_SC_CLK_TCK);
+
+    ifstream status_file(StrPrinter << "/proc/" << pid << "/status");
+    string line;
+    rss_kb = 0;
+    while (getline(status_file, line)) {
+        if (start_with(line, "VmRSS:")) {
+            rss_kb = stoull(line.substr(6));
+            break;
+        }
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+static double percentile(vector<int64_t> &values, double ratio) {
+    if (values.empty()) {
+        return 0;
+    }
+    sort(values.begin(), values.end());
+    return (double) values[min(values.size() - 1, (size_t) (ratio * values.size()))];
+}
+
+static string makeReport(CMD_main &cmd, const vector<ClientRecord> &records, const vector<ServerSample> &samples) {
+    struct Summary {
+        uint64_t clients = 0;
+        uint64_t success = 0;
+        uint64_t started = 0;
+        uint64_t stalls = 0;
+        uint64_t stalled_clients = 0;
+        double kbps_sum = 0;
+        vector<int64_t> startup;
+    };
+    map<string, Summary> summaries;
+    for (auto &record : records) {
+        for (auto &summary : { &summaries[record.protocol], &summaries["all"] }) {
+            ++summary->clients;
+            summary->success += record.success;
+            summary->stalls += record.stalls;
+            summary->stalled_clients += record.stalls > 0;
+            if (record.startup_ms >= 0) {
+                ++summary->started;
+                summary->startup.emplace_back(record.startup_ms);
+            }
+            if (record.play_ms) {
+                summary->kbps_sum += record.bytes * 8.0 / record.play_ms;
+            }
+        }
+    }
+
+    _StrPrinter printer;
+    printer << "{\n"
+            << "  \"in\": \"" << cmd["in"] << "\",\n"
+            << "  \"count\": " << cmd["count"] << ",\n"
+            << "  \"process\": " << cmd["process"] << ",\n"
+            << "  \"rate\": " << cmd["rate"] << ",\n"
+            << "  \"second\": " << cmd["second"] << ",\n"
+            << "  \"protocols\": {";
+    bool first = true;
+    for (auto &pr : summaries) {
+        auto &summary = pr.second;
+        printer << (first ? "" : ",") << "\n    \"" << pr.first << "\": {"
+                << "\"clients\": " << summary.clients << ", \"success\": " << summary.success << ", \"started\": " << summary.started
+                << ", \"startup_p50_ms\": " << percentile(summary.startup, 0.5) << ", \"startup_p90_ms\": " << percentile(summary.startup, 0.9)
+                << ", \"startup_p99_ms\": " << percentile(summary.startup, 0.99)
+                << ", \"startup_max_ms\": " << (summary.startup.empty() ? 0 : *max_element(summary.startup.begin(), summary.startup.end()))
+                << ", \"stalls\": " << summary.stalls << ", \"stalled_clients\": " << summary.stalled_clients
+                << ", \"avg_kbps\": " << (summary.started ? summary.kbps_sum / summary.started : 0) << "}";
+        first = false;
+    }
+    printer << "\n  },\n  \"server\": [";
+    for (size_t i = 0; i < samples.size(); ++i) {
+        printer << (i ? "," : "") << "\n    {\"second\": " << samples[i].second << ", \"cpu\": " << samples[i].cpu
+                << ", \"rss_kb\": " << samples[i].rss_kb << "}";
+    }
+    printer << "\n  ]";
+    if (cmd["detail"].as<int>()) {
+        printer << ",\n  \"clients\": [";
+        for (size_t i = 0; i < records.size(); ++i) {
+            auto &record = records[i];
+            printer << (i ? "," : "") << "\n    {\"protocol\": \"" << record.protocol << "\", \"success\": " << record.success
+                    << ", \"startup_ms\": " << record.startup_ms << ", \"stalls\": " << record.stalls
+                    << ", \"kbps\": " << (record.play_ms ? record.bytes * 8.0 / record.play_ms : 0) << "}";
+        }
+        printer << "\n  ]";
+    }
+    printer << "\n}\n";
+    return printer;
+}
+
+//此程序用于多协议拉流压力测试，支持多进程、按速率爬坡，并以json输出各协议的起播耗时、卡顿、码率与服务器资源占用
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+    auto count = cmd_main["count"].as<int>();
+    auto rate = MAX(cmd_main["rate"].as<double>(), 0.01);
+    auto second = cmd_main["second"].as<int>();
+    auto server_pid = cmd_main["pid"].as<int>();
+    auto process = MAX(cmd_main["process"].as<int>(), 1);
+#if defined(_WIN32)
+    process = 1;
+#endif
+    auto begin_ms = nowMS();
+
+    //子进程中初始化日志与线程池，fork前不得创建任何线程
+    auto init = [&](int index) {
+        LogLevel logLevel = (LogLevel) cmd_main["level"].as<int>();
+        logLevel = MIN(MAX(logLevel, LTrace), LError);
+        Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", logLevel));
+        EventPollerPool::setPoolSize(cmd_main["threads"].as<int>());
+
+        //rtsp udp拉流的本地端口从rtp_proxy.port_range分配，各进程使用不同的子区间以免冲突
+        auto range = split(mINI::Instance()[RtpProxy::kPortRange], "-");
+        auto min_port = atoi(range[0].data());
+        auto step = (atoi(range[1].data()) - min_port) / process & ~1;
+        mINI::Instance()[RtpProxy::kPortRange] = to_string(min_port + index * step) + "-" + to_string(min_port + (index + 1) * step);
+    };
+
+    vector<ClientRecord> records;
+    vector<ServerSample> samples;
+    auto sample_server = [&]() {
+        //每秒采样一次服务器资源占用，直到测试结束
+        double last_cpu = 0;
+        uint64_t rss_kb;
+        bool have_last = server_pid && sampleServer(server_pid, last_cpu, rss_kb);
+        for (int i = 1; i <= second && have_last; ++i) {
+            auto next_ms = begin_ms + i * 1000;
+            auto now = nowMS();
+            if (next_ms > now) {
+                this_thread::sleep_for(chrono::milliseconds(next_ms - now));
+            }
+            double cpu;
+            if (!sampleServer(server_pid, cpu, rss_kb)) {
+                break;
+            }
+            samples.emplace_back(ServerSample { (uint64_t) i, (cpu - last_cpu) * 100, rss_kb });
+            last_cpu = cpu;
+        }
+    };
+
+#if !defined(_WIN32)
+    if (process > 1) {
+        vector<pair<pid_t, int> > children;
+        for (int i = 0; i < process; ++i) {
+            int fds[2];
+            if (pipe(fds) != 0) {
+                cout << "创建管道失败:" << strerror(errno) << endl;
+                return -1;
+            }
+            auto pid = fork();
+            if (pid == 0) {
+                //子进程，播放器个数平均分配
+                close(fds[0]);
+                init(i);
+                auto child_count = count / process + (i < count % process);
+                string out;
+                for (auto &record : runClients(cmd_main, child_count, rate, begin_ms, i, process)) {
+                    out += record.serialize() + "\n";
+                }
+                for (size_t offset = 0; offset < out.size();) {
+                    auto n = write(fds[1], out.data() + offset, out.size() - offset);
+                    if (n <= 0) {
+                        break;
+                    }
+                    offset += n;
+                }
+                close(fds[1]);
+                _exit(0);
+            }
+            close(fds[1]);
+            children.emplace_back(pid, fds[0]);
+        }
+
+        sample_server();
+        for (auto &child : children) {
+            string out;
+            char buf[4096];
+            ssize_t n;
+            while ((n = read(child.second, buf, sizeof(buf))) > 0) {
+                out.append(buf, n);
+            }
+            close(child.second);
+            waitpid(child.first, nullptr, 0);
+            for (auto &line : split(out, "\n")) {
+                ClientRecord record;
+                if (record.parse(line)) {
+                    records.emplace_back(std::move(record));
+                }
+            }
+        }
+    } else
+#endif
+    {
+        init(0);
+        thread sampler(sample_server);
+        records = runClients(cmd_main, count, rate, begin_ms, 0, 1);
+        sampler.join();
+    }
+
+    auto report = makeReport(cmd_main, records, samples);
+    if (cmd_main["out"].empty()) {
+        cout << report;
+    } else {
+        ofstream(cmd_main["out"]) << report;
+    }
+    return 0;
+}
@@ -0,0 +1,168 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <string>
+#include <iostream>
+#include "Util/logger.h"
+#include "Util/TimeTicker.h"
+#include "Common/Parser.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+//原先的Parser::Parse实现(每行及每个header都拷贝为string并插入multimap)，作为对照
+class LegacyParser {
+public:
+    void Parse(const char *buf) {
+        const char *start = buf;
+        Clear();
+        while (true) {
+            auto line = FindField(start, NULL, "\r\n");
+            if (line.size() == 0) {
+                break;
+            }
+            if (start == buf) {
+                _strMethod = FindField(line.data(), NULL, " ");
+                auto strFullUrl = FindField(line.data(), " ", " ");
+                auto args_pos = strFullUrl.find('?');
+                if (args_pos != string::npos) {
+                    _strUrl = strFullUrl.substr(0, args_pos);
+                    _params = strFullUrl.substr(args_pos + 1);
+                    _mapUrlArgs = Parser::parseArgs(_params);
+                } else {
+                    _strUrl = strFullUrl;
+                }
+                _strTail = FindField(line.data(), (strFullUrl + " ").data(), NULL);
+            } else {
+                auto field = FindField(line.data(), NULL, ": ");
+                auto value = FindField(line.data(), ": ", NULL);
+                if (field.size() != 0) {
+                    _mapHeaders.emplace_force(field, value);
+                }
+            }
+            start = start + line.size() + 2;
+            if (strncmp(start, "\r\n", 2) == 0) {
+                _strContent = FindField(start, "\r\n", NULL);
+                break;
+            }
+        }
+    }
+
+    const string &operator[](const char *name) const {
+        auto it = _mapHeaders.find(name);
+        if (it == _mapHeaders.end()) {
+            return _strNull;
+        }
+        return it->second;
+    }
+
+    void Clear() {
+        _strMethod.clear();
+        _strUrl.clear();
+        _params.clear();
+        _strTail.clear();
+        _strContent.clear();
+        _mapHeaders.clear();
+        _mapUrlArgs.clear();
+    }
+
+public:
+    string _strMethod;
+    string _strUrl;
+    string _strTail;
+    string _strContent;
+    string _strNull;
+    string _params;
+    StrCaseMap _mapHeaders;
+    StrCaseMap _mapUrlArgs;
+};
+
+//hls边缘节点典型的切片请求
+static const string kRequest = "GET /live/test/hls.m3u8?_HLS_msn=1024&_HLS_part=3 HTTP/1.1\r\n"
+                               "Host: 192.168.1.100:80\r\n"
+                               "Connection: keep-alive\r\n"
+                               "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/107.0.0.0 Safari/537.36\r\n"
+                               "Accept: */*\r\n"
+                               "Origin: http://192.168.1.100\r\n"
+                               "Referer: http://192.168.1.100/player.html\r\n"
+                               "Accept-Encoding: gzip, deflate\r\n"
+                               "Accept-Language: zh-CN,zh;q=0.9\r\n"
+                               "Cookie: ZL_COOKIE=7d4c4b5a0e1f4c0f9e1d2c3b4a596877\r\n"
+                               "\r\n";
+
+//HttpSession处理一个请求时访问的典型字段
+template <typename P>
+static size_t touch(const P &parser) {
+    return parser["Origin"].size() + parser["Connection"].size() + parser["Sec-WebSocket-Key"].size() + parser["Cookie"].size()
+        + parser["Range"].size();
+}
+
+static bool check() {
+    LegacyParser legacy;
+    Parser parser;
+    legacy.Parse(kRequest.data());
+    parser.Parse(kRequest.data(), kRequest.size());
+    bool ok = legacy._strMethod == parser.Method() && legacy._strUrl == parser.Url() && legacy._params == parser.Params()
+        && legacy._strTail == parser.Tail() && legacy._mapHeaders.size() == parser.getHeader().size()
+        && legacy._mapUrlArgs.size() == parser.getUrlArgs().size() && parser.getUrlArgs()["_HLS_msn"] == "1024";
+    for (auto &pr : legacy._mapHeaders) {
+        ok = ok && parser[pr.first.data()] == pr.second;
+    }
+
+    //http pipelining: 同一块数据中包含两个请求，只应解析第一个请求
+    auto pipelined = kRequest + kRequest;
+    Parser pipelined_parser;
+    pipelined_parser.Parse(pipelined.data(), kRequest.size());
+    ok = ok && pipelined_parser.Content().empty() && pipelined_parser.Url() == parser.Url();
+    legacy.Parse(pipelined.data());
+    InfoL << "pipelining时原实现误当做content的字节数:" << legacy._strContent.size();
+    return ok;
+}
+
+/**
+ * http请求解析性能测试，对比Parser与原先的实现
+ * 用法: test_httpParser [请求个数]
+ */
+int main(int argc, char *argv[]) {
+    //初始化日志系统
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+
+    if (!check()) {
+        ErrorL << "解析结果与原实现不一致";
+        return -1;
+    }
+
+    size_t count = argc > 1 ? atoi(argv[1]) : 1000000;
+    size_t sum = 0;
+    {
+        //与HttpSession一样重复使用同一个解析对象
+        LegacyParser parser;
+        Ticker ticker;
+        for (size_t i = 0; i < count; ++i) {
+            parser.Parse(kRequest.data());
+            sum += touch(parser);
+        }
+        auto ms = ticker.elapsedTime();
+        InfoL << "原实现: " << count << "个请求, 耗时:" << ms << "ms, " << (ms ? count * 1000 / ms : 0) << "个/秒";
+    }
+    {
+        Parser parser;
+        Ticker ticker;
+        for (size_t i = 0; i < count; ++i) {
+            parser.Parse(kRequest.data(), kRequest.size());
+            sum += touch(parser);
+        }
+        auto ms = ticker.elapsedTime();
+        InfoL << "Parser: " << count << "个请求, 耗时:" << ms << "ms, " << (ms ? count * 1000 / ms : 0) << "个/秒";
+    }
+    InfoL << "checksum:" << sum;
+    return 0;
+}
@@ -0,0 +1,224 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <signal.h>
+#include <iostream>
+#include "Util/CMD.h"
+#include "Util/logger.h"
+#include "Util/util.h"
+#include "Common/config.h"
+#include "Common/Device.h"
+#include "Common/LatencyProbe.h"
+#include "Network/TcpServer.h"
+#include "Rtsp/RtspSession.h"
+#include "Rtmp/RtmpSession.h"
+#include "Http/HttpSession.h"
+#include "Player/MediaPlayer.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+class CMD_main : public CMD {
+public:
+    CMD_main() {
+        _parser.reset(new OptionParser(nullptr));
+        (*_parser) << Option('l', "level", Option::ArgRequired, to_string(LWarn).data(), false, "日志等级,LTrace~LError(0~4)", nullptr);
+        (*_parser) << Option('s', "second", Option::ArgRequired, "20", false, "测试时长,单位秒", nullptr);
+        (*_parser) << Option('f', "fps", Option::ArgRequired, "25", false, "视频帧率", nullptr);
+        (*_parser) << Option('g', "gop", Option::ArgRequired, "50", false, "gop长度,单位帧", nullptr);
+        (*_parser) << Option('m', "merge", Option::ArgRequired, "0", false, "合并写时长(general.mergeWriteMS),单位毫秒", nullptr);
+        (*_parser) << Option('L', "low_latency", Option::ArgRequired, "0", false, "是否开启rtsp/rtp低延时模式", nullptr);
+        (*_parser) << Option('P', "protocol", Option::ArgRequired, "rtmp,rtsp,rtsp_udp,ts,hls", false, "测试的协议列表,逗号分隔", nullptr);
+        (*_parser) << Option('x', "max_p99", Option::ArgRequired, "0", false, "任一协议p99延时超过该值(毫秒)时返回非0，用于回归测试，0为不检查", nullptr);
+        (*_parser) << Option('R', "rtsp_port", Option::ArgRequired, "8554", false, "rtsp端口", nullptr);
+        (*_parser) << Option('M', "rtmp_port", Option::ArgRequired, "1935", false, "rtmp端口", nullptr);
+        (*_parser) << Option('H', "http_port", Option::ArgRequired, "8080", false, "http端口", nullptr);
+    }
+
+    ~CMD_main() override {}
+
+    const char *description() const override {
+        return "主程序命令参数";
+    }
+};
+
+//640x360 baseline sps/pps，图像数据为不可解码的填充数据，仅用于测试转发链路
+static const string kSPS("\x00\x00\x00\x01\x67\x42\xc0\x1e\xda\x02\x80\xbf\xe5\x40", 14);
+static const string kPPS("\x00\x00\x00\x01\x68\xce\x3c\x80", 8);
+
+static string makeSlice(bool idr, size_t size) {
+    //first_mb_in_slice为0，填充数据不含0字节，避免出现起始码
+    string ret("\x00\x00\x00\x01", 4);
+    ret.push_back(idr ? 0x65 : 0x41);
+    ret.push_back((char) 0x88);
+    ret.append(size, (char) 0xAA);
+    return ret;
+}
+
+//此程序用于测量各协议从推流(DevChannel)到播放器收到帧的端到端延时，结果以json格式输出
+int main(int argc, char *argv[]) {
+    CMD_main cmd_main;
+    try {
+        cmd_main.operator()(argc, argv);
+    } catch (ExitException &) {
+        return 0;
+    } catch (std::exception &ex) {
+        cout << ex.what() << endl;
+        return -1;
+    }
+
+    LogLevel logLevel = (LogLevel) cmd_main["level"].as<int>();
+    logLevel = MIN(MAX(logLevel, LTrace), LError);
+    Logger::Instance().add(std::make_shared<ConsoleChannel>("ConsoleChannel", logLevel));
+
+    auto second = cmd_main["second"].as<int>();
+    auto fps = MAX(cmd_main["fps"].as<int>(), 1);
+    auto gop = MAX(cmd_main["gop"].as<int>(), 1);
+    auto max_p99 = cmd_main["max_p99"].as<double>();
+    uint16_t rtsp_port = cmd_main["rtsp_port"];
+    uint16_t rtmp_port = cmd_main["rtmp_port"];
+    uint16_t http_port = cmd_main["http_port"];
+
+    mINI::Instance()[General::kMergeWriteMS] = cmd_main["merge"];
+    mINI::Instance()[Rtsp::kLowLatency] = cmd_main["low_latency"];
+    mINI::Instance()[Rtp::kLowLatency] = cmd_main["low_latency"];
+    NoticeCenter::Instance().emitEvent(Broadcast::kBroadcastReloadConfig);
+
+    auto rtsp_srv = std::make_shared<TcpServer>();
+    auto rtmp_srv = std::make_shared<TcpServer>();
+    auto http_srv = std::make_shared<TcpServer>();
+    rtsp_srv->start<RtspSession>(rtsp_port);
+    rtmp_srv->start<RtmpSession>(rtmp_port);
+    http_srv->start<HttpSession>(http_port);
+
+    ProtocolOption option;
+    option.enable_hls = true;
+    option.enable_ts = true;
+    option.enable_mp4 = false;
+    auto channel = std::make_shared<DevChannel>(DEFAULT_VHOST, "live", "latency", 0, option);
+    VideoInfo info;
+    info.codecId = CodecH264;
+    info.iWidth = 640;
+    info.iHeight = 360;
+    info.iFrameRate = fps;
+    channel->initVideo(info);
+    channel->addTrackCompleted();
+    channel->enableLatencyProbe();
+
+    //按帧率输入视频
+    auto poller = EventPollerPool::Instance().getPoller();
+    auto index = std::make_shared<uint64_t>(0);
+    auto timer = std::make_shared<Timer>(1.0f / fps, [channel, index, fps, gop]() {
+        auto dts = *index * 1000 / fps;
+        if (*index % gop == 0) {
+            channel->inputH264(kSPS.data(), kSPS.size(), dts);
+            channel->inputH264(kPPS.data(), kPPS.size(), dts);
+            auto idr = makeSlice(true, 20 * 1024);
+            channel->inputH264(idr.data(), idr.size(), dts);
+        } else {
+            auto slice = makeSlice(false, 2 * 1024);
+            channel->inputH264(slice.data(), slice.size(), dts);
+        }
+        ++*index;
+        return true;
+    }, poller);
+
+    map<string, string> urls = {
+        { "rtmp", StrPrinter << "rtmp://127.0.0.1:" << rtmp_port << "/live/latency" },
+        { "rtsp", StrPrinter << "rtsp://127.0.0.1:" << rtsp_port << "/live/latency" },
+        { "rtsp_udp", StrPrinter << "rtsp://127.0.0.1:" << rtsp_port << "/live/latency" },
+        { "ts", StrPrinter << "http://127.0.0.1:" << http_port << "/live/latency.live.ts" },
+        { "hls", StrPrinter << "http://127.0.0.1:" << http_port << "/live/latency/hls.m3u8" },
+    };
+
+    recursive_mutex mtx;
+    vector<LatencyProbe::Ptr> probes;
+    map<string, MediaPlayer::Ptr> players;
+    function<void(const string &)> play;
+    play = [&](const string &protocol) {
+        auto probe = std::make_shared<LatencyProbe>(protocol);
+        auto player = std::make_shared<MediaPlayer>(poller);
+        weak_ptr<MediaPlayer> weak_player = player;
+        if (protocol == "rtsp_udp") {
+            (*player)[Client::kRtpType] = Rtsp::RTP_UDP;
+        }
+        player->setOnPlayResult([&, protocol, probe, weak_player](const SockException &ex) {
+            if (ex) {
+                //流未就绪(例如hls切片还未生成)，稍后重试
+                poller->doDelayTask(1000, [&, protocol]() {
+                    play(protocol);
+                    return 0;
+                });
+                return;
+            }
+            auto strong_player = weak_player.lock();
+            if (!strong_player) {
+                return;
+            }
+            for (auto &track : strong_player->getTracks(false)) {
+                if (track->getTrackType() == TrackVideo) {
+                    probe->attach(track);
+                }
+            }
+            lock_guard<recursive_mutex> lck(mtx);
+            probes.emplace_back(probe);
+        });
+        lock_guard<recursive_mutex> lck(mtx);
+        players[protocol] = player;
+        player->play(urls[protocol]);
+    };
+
+    for (auto &protocol : split(cmd_main["protocol"], ",")) {
+        if (!urls.count(protocol)) {
+            cout << "不支持的协议:" << protocol << endl;
+            return -1;
+        }
+        //播放器在poller线程中创建，确保与重试时线程一致
+        poller->async([&, protocol]() { play(protocol); });
+    }
+
+    sleep(second);
+
+    int ret = 0;
+    _StrPrinter printer;
+    printer << "{\n"
+            << "  \"fps\": " << fps << ",\n"
+            << "  \"gop\": " << gop << ",\n"
+            << "  \"merge_ms\": " << cmd_main["merge"] << ",\n"
+            << "  \"low_latency\": " << cmd_main["low_latency"] << ",\n"
+            << "  \"results\": [";
+    {
+        lock_guard<recursive_mutex> lck(mtx);
+        for (size_t i = 0; i < probes.size(); ++i) {
+            auto report = probes[i]->getReport();
+            printer << (i ? "," : "") << "\n    {\"protocol\": \"" << report.name << "\", \"count\": " << report.count
+                    << ", \"min_ms\": " << report.min << ", \"mean_ms\": " << report.mean << ", \"p50_ms\": " << report.p50
+                    << ", \"p90_ms\": " << report.p90 << ", \"p99_ms\": " << report.p99 << ", \"max_ms\": " << report.max << "}";
+            if (!report.count || (max_p99 > 0 && report.p99 > max_p99)) {
+                ret = 1;
+            }
+        }
+        if (probes.size() != split(cmd_main["protocol"], ",").size()) {
+            //有协议播放失败
+            ret = 1;
+        }
+    }
+    printer << "\n  ]\n}";
+    cout << printer << endl;
+
+    //清理对象
+    poller->sync([&]() {
+        lock_guard<recursive_mutex> lck(mtx);
+        timer = nullptr;
+        players.clear();
+    });
+    return ret;
+}
@@ -0,0 +1,199 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <vector>
+#include <iostream>
+#include "Util/logger.h"
+#include "Common/config.h"
+#include "Extension/AAC.h"
+#include "Extension/H264.h"
+#include "Extension/CommonRtp.h"
+#include "Rtsp/RtspMuxer.h"
+#include "Record/MPEG.h"
+#include "Rtp/PSEncoder.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+#if defined(ENABLE_RTPPROXY)
+
+static int s_failed = 0;
+
+#define CHECK(exp) \
+    do { \
+        if (!(exp)) { \
+            ErrorL << "check failed: " << #exp; \
+            ++s_failed; \
+        } \
+    } while (0)
+
+static const string kH264SPS("\x00\x00\x00\x01\x67\x42\xc0\x1f\x8d\x8d\x40\x28\x02\xdd\x08\x00\x00\x1f\x40\x00\x06\x1a\x84\x20", 24);
+static const string kH264PPS("\x00\x00\x00\x01\x68\xce\x3c\x80", 8);
+//44100hz双声道aac-lc
+static const string kAacConfig("\x12\x10", 2);
+
+static const uint32_t kSSRC = 0x12345678;
+
+struct RtpOutput {
+    string rtp;
+    bool is_key;
+};
+
+/**
+ * 原先的ps over rtp打包方式：MpegMuxer生成完整的ps包，再由CommonRtpEncoder拷贝分片
+ */
+class LegacyPSEncoder : public MpegMuxer {
+public:
+    LegacyPSEncoder() : MpegMuxer(true) {
+        GET_CONFIG(uint32_t, video_mtu, Rtp::kVideoMtuSize);
+        _rtp_encoder = std::make_shared<CommonRtpEncoder>(CodecInvalid, kSSRC, video_mtu, 90000, 96, 0);
+        _rtp_encoder->setRtpRing(std::make_shared<RtpRing::RingType>());
+        _rtp_encoder->getRtpRing()->setDelegate(std::make_shared<RingDelegateHelper>([this](RtpPacket::Ptr rtp, bool is_key) {
+            out.push_back({ string(rtp->data() + RtpPacket::kRtpTcpHeaderSize, rtp->size() - RtpPacket::kRtpTcpHeaderSize), is_key });
+        }));
+    }
+
+    vector<RtpOutput> out;
+
+protected:
+    void onWrite(std::shared_ptr<Buffer> buffer, uint64_t stamp, bool key_pos) override {
+        if (buffer) {
+            _rtp_encoder->inputFrame(std::make_shared<FrameFromPtr>(buffer->data(), buffer->size(), stamp, stamp, 0, key_pos));
+        }
+    }
+
+private:
+    CommonRtpEncoder::Ptr _rtp_encoder;
+};
+
+/**
+ * ps_muxer_input_v零拷贝打包
+ */
+class DirectPSEncoder : public PSEncoderImp {
+public:
+    DirectPSEncoder() : PSEncoderImp(kSSRC, 96) {}
+
+    vector<RtpOutput> out;
+
+protected:
+    void onRTP(Buffer::Ptr rtp, bool is_key) override {
+        out.push_back({ string(rtp->data() + RtpPacket::kRtpTcpHeaderSize, rtp->size() - RtpPacket::kRtpTcpHeaderSize), is_key });
+    }
+};
+
+//生成不含起始码的伪随机负载
+static string makePayload(size_t size, uint32_t &seed) {
+    string ret;
+    ret.reserve(size);
+    for (size_t i = 0; i < size; ++i) {
+        seed = seed * 1103515245 + 12345;
+        ret.push_back((char) (1 + (seed >> 16) % 255));
+    }
+    return ret;
+}
+
+/**
+ * 生成3个gop的h264(含sps/pps/idr，帧大小覆盖单包与多包)与aac(带adts头)帧，按时间戳交织
+ */
+static vector<Frame::Ptr> makeFrames(vector<string> &storage) {
+    vector<Frame::Ptr> ret;
+    uint32_t seed = 1;
+    storage.reserve(1024);
+    auto add_video = [&](string nal, uint64_t dts, uint64_t pts) {
+        storage.emplace_back(std::move(nal));
+        auto &ref = storage.back();
+        ret.emplace_back(std::make_shared<H264FrameNoCacheAble>((char *) ref.data(), ref.size(), dts, pts, 4));
+    };
+    auto add_audio = [&](size_t size, uint64_t stamp) {
+        uint8_t adts[7];
+        dumpAacConfig(kAacConfig, size + 7, adts, sizeof(adts));
+        storage.emplace_back(string((char *) adts, 7) + makePayload(size, seed));
+        auto &ref = storage.back();
+        ret.emplace_back(std::make_shared<FrameFromPtr>(CodecAAC, (char *) ref.data(), ref.size(), stamp, stamp, 7));
+    };
+
+    uint64_t audio_stamp = 0;
+    for (int i = 0; i < 75; ++i) {
+        uint64_t dts = i * 40;
+        //aac帧时长约23ms，时间戳不晚于视频帧的先输入
+        while (audio_stamp <= dts) {
+            add_audio(200 + (audio_stamp / 23) % 200, audio_stamp);
+            audio_stamp += 23;
+        }
+        if (i % 25 == 0) {
+            add_video(kH264SPS, dts, dts);
+            add_video(kH264PPS, dts, dts);
+            add_video(string("\x00\x00\x00\x01\x65", 5) + makePayload(6000 + i * 10, seed), dts, dts);
+        } else {
+            //帧大小覆盖小于、接近与大于mtu的情况
+            add_video(string("\x00\x00\x00\x01\x41", 5) + makePayload(100 + (i * 397) % 3000, seed), dts, dts);
+        }
+    }
+    return ret;
+}
+
+/**
+ * 同样的h264+aac帧分别经过原先的MpegMuxer+CommonRtpEncoder与新的ps_muxer_input_v打包，rtp包须逐字节一致
+ */
+static void testSameOutput() {
+    vector<string> storage;
+    auto frames = makeFrames(storage);
+
+    LegacyPSEncoder legacy;
+    DirectPSEncoder direct;
+    for (auto encoder : { (MediaSinkInterface *) &legacy, (MediaSinkInterface *) &direct }) {
+        encoder->addTrack(std::make_shared<H264Track>(kH264SPS, kH264PPS));
+        encoder->addTrack(std::make_shared<AACTrack>(kAacConfig));
+        encoder->addTrackCompleted();
+        for (auto &frame : frames) {
+            encoder->inputFrame(frame);
+        }
+        encoder->flush();
+    }
+
+    InfoL << "input frames:" << frames.size() << ", legacy rtp:" << legacy.out.size() << ", direct rtp:" << direct.out.size();
+    CHECK(!legacy.out.empty());
+    CHECK(legacy.out.size() == direct.out.size());
+    size_t mismatch = 0;
+    for (size_t i = 0; i < legacy.out.size() && i < direct.out.size(); ++i) {
+        auto &a = legacy.out[i];
+        auto &b = direct.out[i];
+        //包含rtp头(seq、时间戳、mark位)与负载
+        if (a.rtp != b.rtp || a.is_key != b.is_key) {
+            if (!mismatch++) {
+                ErrorL << "first mismatch at rtp " << i << ", size:" << a.rtp.size() << "/" << b.rtp.size() << ", key:" << a.is_key << "/" << b.is_key;
+            }
+        }
+    }
+    CHECK(mismatch == 0);
+}
+
+//此程序用于校验ps over rtp零拷贝打包与原先的打包方式输出一致
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    testSameOutput();
+    if (s_failed) {
+        ErrorL << s_failed << " check(s) failed";
+        return -1;
+    }
+    InfoL << "all checks passed";
+    return 0;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    ErrorL << "please ENABLE_RTPPROXY and then test";
+    return 0;
+}
+
+#endif // defined(ENABLE_RTPPROXY)
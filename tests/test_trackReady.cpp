@@ -0,0 +1,124 @@
+﻿/*
+ * Copyright (c) 2016 The ZLMediaKit project authors. All Rights Reserved.
+ *
+ * This file is part of ZLMediaKit(https://github.com/xia-chu/ZLMediaKit).
+ *
+ * Use of this source code is governed by MIT license that can be found in the
+ * LICENSE file in the root of the source tree. All contributing project authors
+ * may be found in the AUTHORS file in the root of the source tree.
+ */
+
+#include <iostream>
+#include "Util/logger.h"
+#include "Extension/H264.h"
+#include "Extension/H265.h"
+
+using namespace std;
+using namespace toolkit;
+using namespace mediakit;
+
+static int s_failed = 0;
+
+#define CHECK(exp) \
+    do { \
+        if (!(exp)) { \
+            ErrorL << "check failed: " << #exp; \
+            ++s_failed; \
+        } \
+    } while (0)
+
+//640x360、1280x720 h264参数集
+static const string kH264SPS360("\x00\x00\x00\x01\x67\x42\xc0\x1e\xda\x02\x80\xbf\xe5\x40", 14);
+static const string kH264SPS720("\x00\x00\x00\x01\x67\x42\xc0\x1f\x8d\x8d\x40\x28\x02\xdd\x08\x00\x00\x1f\x40\x00\x06\x1a\x84\x20", 24);
+static const string kH264PPS("\x00\x00\x00\x01\x68\xce\x3c\x80", 8);
+
+//640x360、1280x720 h265参数集
+static const string kH265VPS("\x00\x00\x00\x01\x40\x01\x0c\x01\xff\xff\x01\x60\x00\x00\x03\x00\x90\x00\x00\x03\x00\x00\x03\x00\x5d\xac\x09", 27);
+static const string kH265SPS360("\x00\x00\x00\x01\x42\x01\x01\x01\x60\x00\x00\x03\x00\x90\x00\x00\x03\x00\x00\x03\x00\x5d\xa0\x05\x02\x01\x69\x63\x6b\x92\x44\x82\x20\x10\x00\x00\x3e\x80\x00\x06\x1a\x80\x80", 43);
+static const string kH265SPS720("\x00\x00\x00\x01\x42\x01\x01\x01\x60\x00\x00\x03\x00\x90\x00\x00\x03\x00\x00\x03\x00\x5d\xa0\x02\x80\x80\x2d\x16\x36\xb9\x24\x48\x22\x01\x00\x00\x03\x03\xe8\x00\x00\x61\xa8\x08", 44);
+static const string kH265PPS("\x00\x00\x00\x01\x44\x01\xc0\x71\x80\x12", 10);
+
+template <typename FrameType>
+static void input(const Track::Ptr &track, const string &nal) {
+    track->inputFrame(std::make_shared<FrameType>((char *)nal.data(), nal.size(), 0, 0, 4));
+}
+
+/**
+ * 无extradata创建的h264 track，收到sps+pps后须变为ready；
+ * 重复收到相同的参数集不触发变更回调，参数集内容变化时才触发
+ */
+static void testH264() {
+    auto track = std::make_shared<H264Track>();
+    int changed = 0;
+    track->setOnChangedCB([&](bool is_video) {
+        CHECK(is_video);
+        ++changed;
+    });
+    CHECK(!track->ready());
+
+    input<H264FrameNoCacheAble>(track, kH264SPS360);
+    CHECK(!track->ready());
+    input<H264FrameNoCacheAble>(track, kH264PPS);
+    CHECK(track->ready());
+    CHECK(track->getVideoWidth() == 640);
+    CHECK(track->getVideoHeight() == 360);
+    //第一次收到参数集不算变更
+    CHECK(changed == 0);
+
+    input<H264FrameNoCacheAble>(track, kH264SPS360);
+    input<H264FrameNoCacheAble>(track, kH264PPS);
+    CHECK(changed == 0);
+
+    input<H264FrameNoCacheAble>(track, kH264SPS720);
+    input<H264FrameNoCacheAble>(track, kH264PPS);
+    CHECK(changed == 1);
+    CHECK(track->getSps() == kH264SPS720.substr(4));
+}
+
+/**
+ * 无extradata创建的h265 track，收到vps+sps+pps后须变为ready；
+ * 重复收到相同的参数集不触发变更回调，参数集内容变化时才触发
+ */
+static void testH265() {
+    auto track = std::make_shared<H265Track>();
+    int changed = 0;
+    track->setOnChangedCB([&](bool is_video) {
+        CHECK(is_video);
+        ++changed;
+    });
+    CHECK(!track->ready());
+
+    input<H265FrameNoCacheAble>(track, kH265VPS);
+    input<H265FrameNoCacheAble>(track, kH265SPS360);
+    CHECK(!track->ready());
+    input<H265FrameNoCacheAble>(track, kH265PPS);
+    CHECK(track->ready());
+    CHECK(track->getVideoWidth() == 640);
+    CHECK(track->getVideoHeight() == 360);
+    //第一次收到参数集不算变更
+    CHECK(changed == 0);
+
+    input<H265FrameNoCacheAble>(track, kH265VPS);
+    input<H265FrameNoCacheAble>(track, kH265SPS360);
+    input<H265FrameNoCacheAble>(track, kH265PPS);
+    CHECK(changed == 0);
+
+    input<H265FrameNoCacheAble>(track, kH265VPS);
+    input<H265FrameNoCacheAble>(track, kH265SPS720);
+    input<H265FrameNoCacheAble>(track, kH265PPS);
+    CHECK(changed == 1);
+    CHECK(track->getSps() == kH265SPS720.substr(4));
+}
+
+//此程序用于校验无extradata的h264/h265 track能通过带内参数集变为ready，以及参数集变更回调的触发时机
+int main(int argc, char *argv[]) {
+    Logger::Instance().add(std::make_shared<ConsoleChannel>());
+    testH264();
+    testH265();
+    if (s_failed) {
+        ErrorL << s_failed << " check(s) failed";
+        return -1;
+    }
+    InfoL << "all checks passed";
+    return 0;
+}